@@ -0,0 +1,63 @@
+#!/usr/local/bin/silkjs
+/**
+ * Canvas line chart benchmark.
+ *
+ * Usage: canvas-bench.js [points]
+ *
+ * Draws a line chart of the given number of points (default 100000) with a
+ * cairo.context_* call per segment, and with the Canvas API, which records
+ * the path in a command list replayed by one cairo.execute() call per 4096
+ * elements.
+ */
+
+require.path.unshift('../modules');
+
+var cairo = require('builtin/cairo'),
+    time = require('builtin/time'),
+    console = require('console'),
+    Canvas = require('Canvas').Canvas;
+
+function run(name, fn) {
+    var start = time.gettimeofday();
+    fn();
+    console.log(name + ': ' + ((time.gettimeofday() - start) * 1000).toFixed(2) + ' ms');
+}
+
+function main(points) {
+    var n = parseInt(points || 100000, 10),
+        width = 1000,
+        height = 400,
+        ys = [],
+        i;
+
+    for (i = 0; i < n; i++) {
+        ys.push(height / 2 + Math.sin(i / 50) * height / 3 + Math.random() * 20);
+    }
+
+    run('cairo.context_line_to', function() {
+        var surface = cairo.image_surface_create(cairo.FORMAT_ARGB32, width, height),
+            cr = cairo.context_create(surface);
+        cairo.context_move_to(cr, 0, ys[0]);
+        for (i = 1; i < n; i++) {
+            cairo.context_line_to(cr, i * width / n, ys[i]);
+        }
+        cairo.context_set_source_rgba(cr, 0, 0, 1, 1);
+        cairo.context_stroke(cr);
+        cairo.context_destroy(cr);
+        cairo.surface_destroy(surface);
+    });
+
+    run('Canvas lineTo', function() {
+        var canvas = new Canvas(width, height),
+            ctx = canvas.getContext('2d');
+        ctx.strokeStyle = '#0000ff';
+        ctx.beginPath();
+        ctx.moveTo(0, ys[0]);
+        for (i = 1; i < n; i++) {
+            ctx.lineTo(i * width / n, ys[i]);
+        }
+        ctx.stroke();
+        canvas.flush();
+        canvas.destroy();
+    });
+}
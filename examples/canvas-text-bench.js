@@ -0,0 +1,69 @@
+#!/usr/local/bin/silkjs
+/**
+ * Canvas text benchmark.
+ *
+ * Usage: canvas-text-bench.js [labels]
+ *
+ * Draws the given number of centered axis labels (default 20000), selecting
+ * the font and measuring each label with cairo.context_select_font_face(),
+ * cairo.context_set_font_size() and cairo.context_text_extents(), and with
+ * the Canvas API, which uses the process-wide scaled font and extents cache
+ * (cairo.font_cache_*).
+ */
+
+require.path.unshift('../modules');
+
+var cairo = require('builtin/cairo'),
+    time = require('builtin/time'),
+    console = require('console'),
+    Canvas = require('Canvas').Canvas;
+
+function run(name, fn) {
+    var start = time.gettimeofday();
+    fn();
+    console.log(name + ': ' + ((time.gettimeofday() - start) * 1000).toFixed(2) + ' ms');
+}
+
+function main(labels) {
+    var n = parseInt(labels || 20000, 10),
+        width = 1000,
+        height = 400,
+        i;
+
+    function label(i) {
+        return String((i % 50) * 25);
+    }
+
+    run('cairo.context_select_font_face', function() {
+        var surface = cairo.image_surface_create(cairo.FORMAT_ARGB32, width, height),
+            cr = cairo.context_create(surface),
+            extents, x;
+        cairo.context_set_source_rgba(cr, 0, 0, 0, 1);
+        for (i = 0; i < n; i++) {
+            cairo.context_select_font_face(cr, 'sans-serif', cairo.FONT_SLANT_NORMAL, cairo.FONT_WEIGHT_NORMAL);
+            cairo.context_set_font_size(cr, 12);
+            extents = cairo.context_text_extents(cr, label(i));
+            x = (i % 50) * 20;
+            cairo.context_move_to(cr, x - extents.width / 2, height - 10);
+            cairo.context_text_path(cr, label(i));
+            cairo.context_fill(cr);
+        }
+        cairo.context_destroy(cr);
+        cairo.surface_destroy(surface);
+    });
+
+    run('Canvas fillText', function() {
+        var canvas = new Canvas(width, height),
+            ctx = canvas.getContext('2d');
+        ctx.fillStyle = '#000000';
+        ctx.textAlign = 'center';
+        for (i = 0; i < n; i++) {
+            ctx.font = '12px sans-serif';
+            ctx.fillText(label(i), (i % 50) * 20, height - 10);
+        }
+        canvas.flush();
+        canvas.destroy();
+    });
+
+    console.log(JSON.stringify(cairo.font_cache_stats()));
+}
@@ -0,0 +1,65 @@
+#!/usr/local/bin/silkjs
+/**
+ * Native handle creation benchmark.
+ *
+ * Usage: handle-bench.js [iterations]
+ *
+ * Runs gd and cairo drawing loops that create thousands of short lived opaque handles
+ * (images, surfaces, contexts, patterns, matrices), first destroying each one explicitly,
+ * then leaving them to the garbage collector's finalizers.
+ */
+
+var gd = require('builtin/gd'),
+    cairo = require('builtin/cairo'),
+    time = require('builtin/time');
+
+function gdLoop(n, destroy) {
+    for (var i = 0; i < n; i++) {
+        var im = gd.imageCreateTrueColor(64, 64),
+            white = gd.imageColorAllocate(im, 255, 255, 255),
+            red = gd.imageColorAllocate(im, 255, 0, 0);
+        gd.imageFilledRectangle(im, 0, 0, 63, 63, white);
+        gd.imageLine(im, 0, 0, 63, 63, red);
+        gd.imageFilledEllipse(im, 32, 32, 20, 20, red);
+        if (destroy) {
+            gd.imageDestroy(im);
+        }
+    }
+}
+
+function cairoLoop(n, destroy) {
+    for (var i = 0; i < n; i++) {
+        var surface = cairo.image_surface_create(cairo.FORMAT_ARGB32, 64, 64),
+            context = cairo.context_create(surface),
+            gradient = cairo.pattern_create_linear(0, 0, 64, 64),
+            matrix;
+        cairo.pattern_add_color_stop_rgb(gradient, 0, 1, 0, 0);
+        cairo.pattern_add_color_stop_rgb(gradient, 1, 0, 0, 1);
+        cairo.context_set_source(context, gradient);
+        cairo.context_rectangle(context, 8, 8, 48, 48);
+        cairo.context_fill(context);
+        matrix = cairo.context_get_matrix(context);
+        if (destroy) {
+            cairo.matrix_destroy(matrix);
+            cairo.pattern_destroy(gradient);
+            cairo.context_destroy(context);
+            cairo.surface_destroy(surface);
+        }
+    }
+}
+
+function run(name, fn, n, handlesPer) {
+    var start = time.gettimeofday();
+    fn(n);
+    var elapsed = time.gettimeofday() - start;
+    console.log(name + ': ' + elapsed.toFixed(3) + 's, ' + Math.round(n * handlesPer / elapsed) + ' handles/s');
+}
+
+function main(iterations) {
+    var n = parseInt(iterations || 20000, 10);
+
+    run('gd, destroyed', function(n) { gdLoop(n, true); }, n, 1);
+    run('gd, finalized', function(n) { gdLoop(n, false); }, n, 1);
+    run('cairo, destroyed', function(n) { cairoLoop(n, true); }, n, 4);
+    run('cairo, finalized', function(n) { cairoLoop(n, false); }, n, 4);
+}
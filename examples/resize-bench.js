@@ -0,0 +1,70 @@
+#!/usr/local/bin/silkjs
+/**
+ * Image resize and sharpen benchmark.
+ *
+ * Usage: resize-bench.js [iterations]
+ *
+ * Compares gd.imageResample() (separable Lanczos/bicubic, SSE2/AVX2) with libgd's
+ * gd.imageCopyResampled(), and gd.imageUnsharpMask() with gd.imageSharpen(), on a
+ * 3000x2000 truecolor image.
+ */
+
+var gd = require('builtin/gd'),
+    time = require('builtin/time'),
+    console = require('console');
+
+function makeImage(w, h) {
+    var im = gd.imageCreateTrueColor(w, h),
+        x, y;
+    for (y = 0; y < h; y += 50) {
+        for (x = 0; x < w; x += 50) {
+            gd.imageFilledRectangle(im, x, y, x + 49, y + 49, gd.imageColorAllocate(im, x % 256, y % 256, (x + y) % 256));
+        }
+    }
+    gd.imageFilledEllipse(im, w / 2, h / 2, w / 2, h / 2, gd.imageColorAllocate(im, 255, 255, 255));
+    return im;
+}
+
+function run(name, n, fn) {
+    var start = time.gettimeofday();
+    for (var i = 0; i < n; i++) {
+        fn();
+    }
+    var elapsed = time.gettimeofday() - start;
+    console.log(name + ': ' + (elapsed * 1000 / n).toFixed(2) + ' ms');
+}
+
+function main(iterations) {
+    var n = parseInt(iterations || 10, 10),
+        src = makeImage(3000, 2000),
+        small = makeImage(800, 600);
+
+    console.log('resample kernels: ' + gd.resampleSimd());
+    [ [ 200, 133 ], [ 1024, 683 ], [ 4500, 3000 ] ].each(function(size) {
+        var w = size[0],
+            h = size[1],
+            dst = gd.imageCreateTrueColor(w, h);
+        console.log('3000x2000 -> ' + w + 'x' + h);
+        run('  gd.imageCopyResampled', n, function() {
+            gd.imageCopyResampled(dst, src, 0, 0, 0, 0, w, h, 3000, 2000);
+        });
+        run('  gd.imageResample lanczos', n, function() {
+            gd.imageResample(dst, src, 0, 0, 0, 0, w, h, 3000, 2000);
+        });
+        run('  gd.imageResample bicubic', n, function() {
+            gd.imageResample(dst, src, 0, 0, 0, 0, w, h, 3000, 2000, 'bicubic');
+        });
+        gd.imageDestroy(dst);
+    });
+
+    console.log('sharpen 800x600');
+    run('  gd.imageSharpen', n, function() {
+        gd.imageSharpen(small, 50);
+    });
+    run('  gd.imageUnsharpMask', n, function() {
+        gd.imageUnsharpMask(small, 1, 0.5, 2);
+    });
+
+    gd.imageDestroy(small);
+    gd.imageDestroy(src);
+}
@@ -0,0 +1,74 @@
+#!/usr/local/bin/silkjs
+/**
+ * Multi-process SQLite read/write throughput benchmark.
+ *
+ * Usage: sqlite-bench.js [processes] [operations per process] [write percent] [database]
+ *
+ * Forks the given number of processes, each of which opens the database with SQLite.openShared()
+ * and performs a mix of primary key reads and REPLACE writes against a single table,
+ * the way HttpChild processes would use a shared session or cache store.
+ */
+
+var SQLite = require('SQLite').SQLite,
+    time = require('builtin/time');
+
+function worker(filename, ops, writePercent) {
+    var db = SQLite.openShared(filename),
+        id = process.getpid(),
+        keys = 1000,
+        key,
+        i;
+
+    for (i = 0; i < ops; i++) {
+        key = Math.floor(Math.random() * keys);
+        if (Math.random() * 100 < writePercent) {
+            db.run('REPLACE INTO bench (id, value, writer) VALUES (?, ?, ?)', [ key, 'value ' + i, id ]);
+        }
+        else {
+            db.get('SELECT * FROM bench WHERE id=?', [ key ]);
+        }
+    }
+    db.close();
+}
+
+function main(procs, ops, writePercent, filename) {
+    procs = parseInt(procs || 4, 10);
+    ops = parseInt(ops || 10000, 10);
+    writePercent = parseInt(writePercent === undefined ? 10 : writePercent, 10);
+    filename = filename || '/tmp/sqlite-bench.db';
+
+    var db = SQLite.openShared(filename);
+    db.exec('CREATE TABLE IF NOT EXISTS bench (id INTEGER PRIMARY KEY, value TEXT, writer INTEGER)');
+    db.close();
+
+    var start = time.gettimeofday(),
+        failed = 0,
+        child,
+        i;
+
+    for (i = 0; i < procs; i++) {
+        if (process.fork() === 0) {
+            try {
+                worker(filename, ops, writePercent);
+            }
+            catch (e) {
+                console.log(process.getpid() + ': ' + e.message);
+                process.exit(1);
+            }
+            process.exit(0);
+        }
+    }
+    for (i = 0; i < procs; i++) {
+        child = process.wait();
+        if (!child || child.status !== 0) {
+            failed++;
+        }
+    }
+
+    var elapsed = time.gettimeofday() - start;
+    console.log(procs + ' processes, ' + ops + ' operations each, ' + writePercent + '% writes');
+    console.log('elapsed: ' + elapsed.toFixed(3) + 's, ' + Math.round(procs * ops / elapsed) + ' operations/s');
+    if (failed) {
+        console.log(failed + ' processes failed');
+    }
+}
@@ -440,7 +440,8 @@ HttpChild = (function() {
             for (var b=0; b<bits; b++) {
                 Math.random();
             }
-            var logfile = global.logfile;
+            var logfile = global.logfile,
+                sessions = global.sessions;
             if (HttpChild.onStart) {
                 HttpChild.onStart();
             }
@@ -448,6 +449,9 @@ HttpChild = (function() {
             if (Config.mysql) {
                 SQL = new MySQL();
                 SQL.connect();
+                if (Config.mysql.cache) {
+                    SQL.enableCache(Config.mysql.cache === true ? {} : Config.mysql.cache);
+                }
             }
             var REQUESTS_PER_CHILD = Config.requestsPerChild,
 				watchdogTimeout = Config.watchdogTimeout || 0,
@@ -481,6 +485,9 @@ HttpChild = (function() {
                         }
                         // console.log(time.getrusage() - start_time);
                         keepAlive = res.init(sock, keepAlive, requestsHandled);
+                        if (sessions) {
+                            sessions.attach(req);
+                        }
 						if (watchdogTimeout) {
 							watchdog.set(watchdogTimeout);
 						}
@@ -502,6 +509,12 @@ HttpChild = (function() {
                     if (endRequest) {
                         endRequest();
                     }
+                    if (sessions) {
+                        sessions.save();
+                    }
+                    if (Config.mysql && SQL.cache) {
+                        SQL.resetCache();
+                    }
                     req.data = {};
                     res.data = {};
                     try {
@@ -512,6 +525,10 @@ HttpChild = (function() {
                         elapsed = '' + elapsed;
                         elapsed = elapsed.substr(0, 8);
                         logfile.write(req.remote_addr + ' ' + req.method + ' ' + req.uri + ' completed in ' + elapsed + 's\n');
+                        if (sessions) {
+                            // write-behind, after the response has been sent
+                            sessions.persist();
+                        }
                     }
                     catch (e) {
                         console.dir(e.stack);
@@ -35,12 +35,19 @@
         user: user.name,    // username to run child processes as
         group: group.name,  // groupname to run child processes as
         numChildren: 50,
-        requestsPerChild: 100000,
+        requestsPerChild: 1000000,  // native objects a request leaks are freed when garbage collected (see v8.handles()), so children can live long
+        maxPostSize: 64 * 1024 * 1024, // larger request bodies are not read; the request has no POST data
         watchdogTimeout: 30,    // if process runs this long for a request, the alarm handler will exit()
         listenIp: '0.0.0.0',    // listen socket will be bound to this IP.  '0.0.0.0' means ANY IP on this machine.
         documentRoot: docRoot,
         sendFile: true, // Enable/Disable linux sendFile()
         logFile: '/tmp/httpd-silkjs.log',
+        // shared memory cache for all the HttpChild processes, created as global.shmcache.  See ShmCache and the local option of Memcached.
+    //  shmcache: { size: 64 * 1024 * 1024, maxEntries: 65536 },
+        // sessions in shared memory, as req.session, with write-behind to SQLite or Berkeley DB.  See the Session module.
+    //  session: { secret: 'change me', ttl: 3600, store: { sqlite: '/tmp/silkjs-sessions.db' } },
+        // rendered images stored on disk and indexed in shared memory, as global.renderCache.  See the RenderCache module.
+    //  renderCache: { dir: '/tmp/silkjs-render', size: 4 * 1024 * 1024, maxAge: 3600 },
         directoryIndex: [
             'index.sjs',
             'index.jst',
@@ -54,7 +61,9 @@
     //      host: 'localhost',
     //      user: 'xxx',
     //      passwd: 'xxx',
-    //      db: 'xxx'
+    //      db: 'xxx',
+    //      multiStatements: true,  // saves SQL.batch() two round trips per batch, see SQL.batch()
+    //      cache: { memcached: 'localhost', ttl: 60 }  // optional query cache, see SQL.enableCache()
     //  },
         lockFile: '/tmp/silkf.lock'
     };
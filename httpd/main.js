@@ -6,6 +6,9 @@ console = require('console');
 fs = require('fs');
 
 LogFile = require('LogFile');
+ShmCache = require('ShmCache');
+Session = require('Session');
+RenderCache = require('RenderCache');
 net = require('builtin/net');
 process = require('builtin/process');
 async = require('builtin/async');
@@ -41,6 +44,15 @@ function masterServer(debugMode) {
     // fs.close(fd);
     var serverSocket = net.listen(Config.port, 50, Config.listenIp);
     global.logfile = new LogFile(Config.logFile || '/tmp/httpd-silkjs.log');
+    if (Config.shmcache) {
+        global.shmcache = new ShmCache(Config.shmcache.size, Config.shmcache.maxEntries);
+    }
+    if (Config.session) {
+        global.sessions = new Session(Config.session);
+    }
+    if (Config.renderCache) {
+        global.renderCache = new RenderCache(Config.renderCache);
+    }
 
     Server.onStart();
 
@@ -258,6 +270,15 @@ function lockServer(debugMode) {
     // open log file
     try {
         global.logfile = new LogFile(Config.logFile || '/tmp/httpd-silkjs.log');
+        if (Config.shmcache) {
+            global.shmcache = new ShmCache(Config.shmcache.size, Config.shmcache.maxEntries);
+        }
+        if (Config.session) {
+            global.sessions = new Session(Config.session);
+        }
+        if (Config.renderCache) {
+            global.renderCache = new RenderCache(Config.renderCache);
+        }
     }
     catch (e) {
         console.log(e.toString());
@@ -100,7 +100,7 @@ req = (function() {
 				var contentType = headers['content-type'];
 				if (contentType && contentType.toLowerCase().indexOf('multipart/form-data') != -1) {
 					var boundary = contentType.replace(/^.*?boundary=/i, '');
-					post = http.readMime(stream, contentLength, boundary);
+					post = http.readMime(stream, contentLength, boundary, Config.maxPostSize) || '';
 					mimeParts = post.split('--'+boundary);
 					mimeParts.shift();
 					mimeParts.pop();
@@ -128,7 +128,7 @@ req = (function() {
 					});
 				}
 				else {
-					post = http.readPost(stream, contentLength);
+					post = http.readPost(stream, contentLength, Config.maxPostSize);
 					if (post) {
 						if (headers['content-type'] && headers['content-type'].match(/^application\/x-www-form-urlencoded/i)) {
 							post.split('&').each(function(part) {
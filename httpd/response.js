@@ -43,6 +43,8 @@ var responseCodeText = {
 
 res = function() {
 	var buf = buffer.create(),
+		json = require('builtin/json'),
+		arena = require('builtin/arena'),
 		watchdog = require('builtin/watchdog');
 
 	return {
@@ -55,6 +57,8 @@ res = function() {
         headersSent: false,
 		
 		init: function(sock, keepAlive, requestsHandled) {
+			// free what the native code needed for a large previous request
+			arena.reset();
 			buffer.reset(buf);
 			res.extend({
 				sock: sock,
@@ -93,8 +97,15 @@ res = function() {
 		reset: function() {
 			buffer.reset(buf);
 		},
+
+		// the response body, for native functions that write into a buffer,
+		// e.g. gd.imagePngBuffer(im, res.getBuffer()) or canvas.toBuffer(res.getBuffer())
+		getBuffer: function() {
+			return buf;
+		},
 		
-		setCookie: function(key, value, expires, path, domain) {
+		// options: { httpOnly: true, secure: true } for the HttpOnly and Secure attributes
+		setCookie: function(key, value, expires, path, domain, options) {
 			var cookie = {
 				value: value
 			};
@@ -108,15 +119,28 @@ res = function() {
 			if (domain) {
 				cookie.domain = domain;
 			}
+			if (options) {
+				cookie.httpOnly = !!options.httpOnly;
+				cookie.secure = !!options.secure;
+			}
 			res.cookies[key] = cookie;
 		},
 		
-        unsetCookie: function(key) {
+        // path and domain must be the ones the cookie was set with, or the browser keeps it
+        unsetCookie: function(key, path, domain) {
             var now = new Date().getTime() / 1000;
             var yesterday = now - 86400;
-            res.cookies[key] = {
+            var cookie = {
+                value: '',
                 expires: new Date(yesterday*1000).toGMTString()
             };
+            if (path) {
+                cookie.path = path;
+            }
+            if (domain) {
+                cookie.domain = domain;
+            }
+            res.cookies[key] = cookie;
         },
         
 		setHeader: function(key, value) {
@@ -144,6 +168,12 @@ res = function() {
 					if (cookie.domain) {
 						out += '; Domain='+encodeURIComponent(cookie.domain);
 					}
+					if (cookie.secure) {
+						out += '; Secure';
+					}
+					if (cookie.httpOnly) {
+						out += '; HttpOnly';
+					}
 					out += '\r\n';
 				});
 				out += 'Content-Type: ' + res.contentType + '\r\n';
@@ -174,6 +204,11 @@ res = function() {
 			}
 		},
 		
+		// encode o as JSON directly into the response buffer
+		writeJson: function(o) {
+			json.stringifyTo(buf, o);
+		},
+
 		writeln: function(s) {
             res.write(s + '\n');
 		},
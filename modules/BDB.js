@@ -0,0 +1,335 @@
+/**
+ * @class BDB
+ *
+ * ### Synopsis
+ *
+ * var BDB = require('BDB');
+ *
+ * JavaScript wrapper around the builtin/bdb (Berkeley DB) module.
+ *
+ * ### Description
+ *
+ * A BDB.Environment is a directory holding one or more databases, with a shared memory pool, locking and (optionally) transactions, so several processes can use the databases at once.  Each process opens the environment itself, after it is forked.  The first process to open it (e.g. the HTTP server before forking, in Server.onStart) should pass recover: true; the children must not.
+ *
+ * Keys and values are strings.
+ *
+ * ### Example
+ * ```
+ * var env = new BDB.Environment('/var/lib/myapp', { recover: true });
+ * var sessions = env.open('sessions.db');
+ * sessions.put('abc', Json.encode({ user: 1 }));
+ * env.transaction(function(txn) {
+ *     var n = parseInt(sessions.get('counter', txn) || '0', 10);
+ *     sessions.put('counter', String(n + 1), txn);
+ * });
+ * console.dir(sessions.range('a', 'b'));
+ * ```
+ */
+var bdb = require('builtin/bdb');
+
+/**
+ * @constructor BDB.Database
+ *
+ * ### Synopsis
+ *
+ * var db = env.open(file, options);
+ *
+ * An open database.  Databases are opened with env.open(), not directly.
+ *
+ * In the methods below, txn is an optional transaction, as passed to the function given to env.transaction().
+ */
+function Database(env, file, options) {
+    options = options || {};
+    var flags = bdb.DB_CREATE;
+    if (env.transactional) {
+        flags |= bdb.DB_AUTO_COMMIT;
+    }
+    this.env = env;
+    this.handle = bdb.open(env.handle, file, options.database || null, options.type === 'hash' ? bdb.DB_HASH : bdb.DB_BTREE, flags);
+    if (typeof this.handle === 'string') {
+        error('BDB: could not open ' + file + ': ' + this.handle);
+    }
+}
+
+Database.prototype.extend({
+    /**
+     * @function db.get
+     *
+     * ### Synopsis
+     *
+     * var value = db.get(key, txn);
+     *
+     * @param {string} key - the key.
+     * @param {object} txn - optional transaction.
+     * @returns {string} value - the value, or null if the key is not in the database.
+     */
+    get: function(key, txn) {
+        return bdb.get(this.handle, txn || null, key);
+    },
+
+    /**
+     * @function db.mget
+     *
+     * ### Synopsis
+     *
+     * var values = db.mget(keys, txn);
+     *
+     * @param {array} keys - the keys.
+     * @param {object} txn - optional transaction.
+     * @returns {object} values - hash of values indexed by key; keys not in the database are omitted.
+     */
+    mget: function(keys, txn) {
+        return bdb.mget(this.handle, txn || null, keys);
+    },
+
+    /**
+     * @function db.put
+     *
+     * ### Synopsis
+     *
+     * db.put(key, value, txn);
+     *
+     * Store a value, replacing any value already stored for the key.
+     *
+     * @param {string} key - the key.
+     * @param {string} value - the value.
+     * @param {object} txn - optional transaction.
+     */
+    put: function(key, value, txn) {
+        bdb.put(this.handle, txn || null, key, value);
+    },
+
+    /**
+     * @function db.add
+     *
+     * ### Synopsis
+     *
+     * var added = db.add(key, value, txn);
+     *
+     * Store a value if the key is not already in the database.
+     *
+     * @param {string} key - the key.
+     * @param {string} value - the value.
+     * @param {object} txn - optional transaction.
+     * @returns {boolean} added - false if the key already exists.
+     */
+    add: function(key, value, txn) {
+        return bdb.put(this.handle, txn || null, key, value, bdb.DB_NOOVERWRITE) === 0;
+    },
+
+    /**
+     * @function db.remove
+     *
+     * ### Synopsis
+     *
+     * var removed = db.remove(key, txn);
+     *
+     * @param {string} key - the key.
+     * @param {object} txn - optional transaction.
+     * @returns {boolean} removed - false if the key was not in the database.
+     */
+    remove: function(key, txn) {
+        return bdb.del(this.handle, txn || null, key) === 0;
+    },
+
+    /**
+     * @function db.range
+     *
+     * ### Synopsis
+     *
+     * var records = db.range(start, end, limit, txn);
+     *
+     * Get the records with keys from start (inclusive) to end (exclusive), in key order, using bulk retrieval.  B-tree databases only.
+     *
+     * @param {string} start - first key, or null to start at the first record.
+     * @param {string} end - key to stop at, or null to continue to the last record.
+     * @param {int} limit - maximum number of records, 0 or omitted for no limit.
+     * @param {object} txn - optional transaction.
+     * @returns {array} records - array of objects with key and value members.
+     */
+    range: function(start, end, limit, txn) {
+        return bdb.range(this.handle, txn || null, start === undefined ? null : start, end === undefined ? null : end, limit || 0);
+    },
+
+    /**
+     * @function db.each
+     *
+     * ### Synopsis
+     *
+     * db.each(fn, txn);
+     * db.each(start, fn, txn);
+     *
+     * Call fn(key, value) for each record, in key order, optionally starting at the first key greater than or equal to start.  If fn returns false, the iteration stops.
+     *
+     * @param {string} start - optional first key.
+     * @param {function} fn - function to call for each record.
+     * @param {object} txn - optional transaction.
+     */
+    each: function(start, fn, txn) {
+        if (typeof start === 'function') {
+            txn = fn;
+            fn = start;
+            start = null;
+        }
+        var cursor = bdb.cursor(this.handle, txn || null),
+            record = start === null ? bdb.cursor_get(cursor, bdb.DB_FIRST) : bdb.cursor_get(cursor, bdb.DB_SET_RANGE, start);
+        try {
+            while (record && fn(record.key, record.value) !== false) {
+                record = bdb.cursor_get(cursor, bdb.DB_NEXT);
+            }
+        }
+        finally {
+            bdb.cursor_close(cursor);
+        }
+    },
+
+    /**
+     * @function db.close
+     *
+     * ### Synopsis
+     *
+     * db.close();
+     *
+     * Close the database.
+     */
+    close: function() {
+        bdb.close(this.handle);
+        this.handle = null;
+    }
+});
+
+/**
+ * @constructor BDB.Environment
+ *
+ * ### Synopsis
+ *
+ * var env = new BDB.Environment(home);
+ * var env = new BDB.Environment(home, options);
+ *
+ * Open (or create) an environment.
+ *
+ * The options are:
+ *
+ * + transactions: use transactions and write-ahead logging (default true).
+ * + recover: run recovery; only the first process to open the environment may do this (default false).
+ * + cacheSize: size of the shared memory pool, in bytes (default 32MB).
+ * + noSync: don't flush the log to disk when transactions commit, trading durability of the last transactions for speed (default false).
+ *
+ * @param {string} home - directory of the environment; it is created if necessary.
+ * @param {object} options - optional settings.
+ */
+function Environment(home, options) {
+    options = options || {};
+    var fs = require('fs'),
+        flags = bdb.DB_CREATE | bdb.DB_INIT_MPOOL | bdb.DB_INIT_LOCK;
+
+    if (!fs.exists(home)) {
+        fs.mkdir(home, true);
+    }
+    this.transactional = options.transactions !== false;
+    if (this.transactional) {
+        flags |= bdb.DB_INIT_LOG | bdb.DB_INIT_TXN;
+    }
+    if (options.recover) {
+        flags |= bdb.DB_RECOVER;
+    }
+    this.txnFlags = options.noSync ? bdb.DB_TXN_NOSYNC : 0;
+    this.handle = bdb.env_open(home, flags, options.cacheSize);
+    if (typeof this.handle === 'string') {
+        error('BDB: could not open environment ' + home + ': ' + this.handle);
+    }
+}
+
+Environment.prototype.extend({
+    /**
+     * @function env.open
+     *
+     * ### Synopsis
+     *
+     * var db = env.open(file);
+     * var db = env.open(file, options);
+     *
+     * Open (or create) a database in the environment.
+     *
+     * The options are:
+     *
+     * + type: 'btree' (default) or 'hash'.
+     * + database: name of the database within the file, to keep several in one file.
+     *
+     * @param {string} file - file name, relative to the environment home.
+     * @param {object} options - optional settings.
+     * @returns {Database} db - the open database.
+     */
+    open: function(file, options) {
+        return new Database(this, file, options);
+    },
+
+    /**
+     * @function env.transaction
+     *
+     * ### Synopsis
+     *
+     * var result = env.transaction(fn);
+     * var result = env.transaction(fn, retries);
+     *
+     * Call fn(txn) within a transaction.  The transaction is committed if fn returns, and aborted if it throws.
+     *
+     * If the transaction is chosen as the victim of a deadlock, it is aborted and fn is called again, up to retries times (default 3).
+     *
+     * @param {function} fn - function to call with the transaction.
+     * @param {int} retries - how many times to retry after a deadlock.
+     * @returns {mixed} result - the value returned by fn.
+     */
+    transaction: function(fn, retries) {
+        retries = retries === undefined ? 3 : retries;
+        for (;;) {
+            var txn = bdb.txn_begin(this.handle, null, this.txnFlags),
+                result;
+            try {
+                result = fn(txn);
+            }
+            catch (e) {
+                bdb.txn_abort(txn);
+                if (retries-- > 0 && String(e).indexOf('DB_LOCK_DEADLOCK') !== -1) {
+                    continue;
+                }
+                throw e;
+            }
+            var rc = bdb.txn_commit(txn);
+            if (rc) {
+                error('BDB: commit failed: ' + bdb.strerror(rc));
+            }
+            return result;
+        }
+    },
+
+    /**
+     * @function env.checkpoint
+     *
+     * ### Synopsis
+     *
+     * env.checkpoint();
+     *
+     * Write a checkpoint, bounding the time recovery takes.  Call this periodically from one process.
+     */
+    checkpoint: function() {
+        bdb.env_checkpoint(this.handle);
+    },
+
+    /**
+     * @function env.close
+     *
+     * ### Synopsis
+     *
+     * env.close();
+     *
+     * Close the environment.  Its databases must be closed first.
+     */
+    close: function() {
+        bdb.env_close(this.handle);
+        this.handle = null;
+    }
+});
+
+exports.Environment = Environment;
+exports.Database = Database;
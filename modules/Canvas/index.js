@@ -24,13 +24,15 @@
  *
  * The Canvas API is implemented on top of SilkJS' native libcairo methods.
  *
- * The only two context2d methods not implemented are createImageData() and putImageData(), otherwise this is a complete API.
+ * ImageData objects (getImageData(), createImageData(), putImageData()) hold their pixels in native memory, indexed like an array, so pixel effects can be written as plain JavaScript loops over imageData.data.
  *
  * Garbage collection is an issue, since libcairo objects are instantiated by the Canvas API that need to be freed/released.  For this reason, the Image, CanvasRenderingContext2D, and Canvas classes all have destroy() methods that you should call when you are done using those objects.
  *
  * The Canvas object implements some garbage collection for patterns.  Those are destroyed() automatically when you call the canvas' destroy() method.
  *
- * In addition to the destroy() methods, the Canvas.writeToFile(path) method is implemented to save your rendered canvas to a PNG file.
+ * In addition to the destroy() methods, the Canvas.writeToFile(path) method is implemented to save your rendered canvas to a PNG file, and Canvas.toBuffer() and Canvas.toDataURL() encode it as PNG in memory, e.g. to send with canvas.toBuffer(res.getBuffer()).
+ *
+ * Paths, transformations, and solid color fills and strokes are recorded in a command list and drawn by a single native call when the list is full or the cairo context is next used.  If you use canvas.surface directly with the cairo functions, call canvas.flush() first.
  */
 
 // http://www.w3.org/TR/2dcontext/
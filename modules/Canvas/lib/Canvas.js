@@ -5,6 +5,7 @@ global.debug = function(s) {
 }
 
 var cairo = require('builtin/cairo'),
+    buffer = require('builtin/buffer'),
     console = require('console');
 
 var CanvasRenderingContext2D = require('CanvasRenderingContext2D').CanvasRenderingContext2D;
@@ -31,12 +32,62 @@ Canvas.prototype.extend({
         return this._context;
     },
     getSurface: function() {
+        this.flush();
         return this.surface;
     },
+    // execute the context's recorded drawing commands, before the surface is read
+    flush: function() {
+        if (this._context) {
+            this._context.flush();
+        }
+    },
     writeToFile: function(filename) {
+        this.flush();
         cairo.surface_write_to_png(this.surface, filename);
 
     },
+    /**
+     * @function Canvas.toBuffer
+     *
+     * ### Synopsis
+     *
+     * var buf = canvas.toBuffer();
+     * canvas.toBuffer(buf);
+     *
+     * Encode the canvas as a PNG image into a buffer (see builtin/buffer), e.g. the response body from res.getBuffer(), so it can be sent without writing a file.
+     *
+     * @param {object} buf - optional buffer to append the image to; if not given, a new buffer is created, which the caller should buffer.destroy().
+     * @return {object} buf - the buffer.
+     */
+    toBuffer: function(buf) {
+        buf = buf || buffer.create();
+        this.flush();
+        var status = cairo.surface_write_to_png_buffer(this.surface, buf);
+        if (status !== cairo.STATUS_SUCCESS) {
+            throw cairo.status_to_string(status);
+        }
+        return buf;
+    },
+    /**
+     * @function Canvas.toDataURL
+     *
+     * ### Synopsis
+     *
+     * var url = canvas.toDataURL();
+     *
+     * Encode the canvas as a PNG image in a data: URL.  Only image/png is supported.
+     *
+     * @return {string} url - data:image/png;base64,...
+     */
+    toDataURL: function() {
+        var buf = this.toBuffer();
+        try {
+            return 'data:image/png;base64,' + buffer.read64(buf);
+        }
+        finally {
+            buffer.destroy(buf);
+        }
+    },
     addPattern: function(pattern) {
         this._patterns.push(pattern);
         return pattern;
@@ -25,11 +25,13 @@ var CanvasLineStyles = {
     set lineWidth(value) {
         debug('set lineWidth ' + value);
         if (value <= 0 || isNaN(value) || value == Number.NEGATIVE_INFINITY || value == Number.POSITIVE_INFINITY) {
-            cairo.context_set_line_width(this._context, this._lineWidth);
-            return;
+            value = this._lineWidth;
         }
         this._lineWidth = value;
-        cairo.context_set_line_width(this._context, value);
+        var cmds = this._commands,
+            n = this._command(2);
+        cmds[n] = cairo.CMD_SET_LINE_WIDTH;
+        cmds[n+1] = value;
     },
     get lineCap() {
         debug('get lineCap');
@@ -7,39 +7,54 @@ var debug = global.debug;
 var cairo = require('builtin/cairo'),
     console = require('console');
 
+// These are recorded in the context's command list (see
+// CanvasRenderingContext2D._command()) rather than calling cairo directly.
 var CanvasPathMethods = {
     // shared path API methods
     closePath: function() {
         debug('closePath');
-        cairo.context_close_path(this._context);
+        this._commands[this._command(1)] = cairo.CMD_CLOSE_PATH;
     },
     moveTo: function(x, y) {
         if (y == 424) { y = 324; }
         debug('moveTo ' + x + ',' + y);
-        cairo.context_move_to(this._context, x, y);
+        var cmds = this._commands,
+            n = this._command(3);
+        cmds[n] = cairo.CMD_MOVE_TO;
+        cmds[n+1] = x;
+        cmds[n+2] = y;
     },
     lineTo: function(x, y) {
         if (y == 424) { y = 324; }
         debug('lineTo ' + x + ',' + y);
-        cairo.context_line_to(this._context, x, y);
+        var cmds = this._commands,
+            n = this._command(3);
+        cmds[n] = cairo.CMD_LINE_TO;
+        cmds[n+1] = x;
+        cmds[n+2] = y;
     },
     quadraticCurveTo: function(x1, y1, x2, y2) {
         debug('quadraticCurveTo ' + [x1,y1,x2,y2].join(','));
-        var point = cairo.context_get_current_point(this._context);
-        var x = point.x || x,
-            y = point.y || y;
-
-        cairo.context_curve_to(
-            this._context,
-            x  + 2.0 / 3.0 * (x1 - x),  y  + 2.0 / 3.0 * (y1 - y),
-            x2 + 2.0 / 3.0 * (x1 - x2), y2 + 2.0 / 3.0 * (y1 - y2),
-            x2,
-            y2
-        );
+        // converted to a cubic curve from the current point by cairo.execute()
+        var cmds = this._commands,
+            n = this._command(5);
+        cmds[n] = cairo.CMD_QUAD_CURVE_TO;
+        cmds[n+1] = x1;
+        cmds[n+2] = y1;
+        cmds[n+3] = x2;
+        cmds[n+4] = y2;
     },
     bezierCurveTo: function(cp1x, cp1y, cp2x, cp2y, x, y) {
-        debug('quadraticCurveTo ' + [cp1x,cp1y,cp2x,cp2y,x,y].join(','));
-        cairo.curve_to(this.context, cp1x, cp1y, cp2x, cp2y, x, y);
+        debug('bezierCurveTo ' + [cp1x,cp1y,cp2x,cp2y,x,y].join(','));
+        var cmds = this._commands,
+            n = this._command(7);
+        cmds[n] = cairo.CMD_CURVE_TO;
+        cmds[n+1] = cp1x;
+        cmds[n+2] = cp1y;
+        cmds[n+3] = cp2x;
+        cmds[n+4] = cp2y;
+        cmds[n+5] = x;
+        cmds[n+6] = y;
     },
     arcTo: function(x1, y1, x2, y2, radius) {
         debug('arcTo ' + [x1,y1,x2,y2,radius].join(','));
@@ -136,16 +151,24 @@ var CanvasPathMethods = {
     },
     rect: function(x,y, w, h) {
         debug('rect ' + [x,y,w,h].join(','));
-        cairo.context_rectangle(this._context, x, y, w, h);
+        var cmds = this._commands,
+            n = this._command(5);
+        cmds[n] = cairo.CMD_RECTANGLE;
+        cmds[n+1] = x;
+        cmds[n+2] = y;
+        cmds[n+3] = w;
+        cmds[n+4] = h;
     },
     arc: function(x,y, radius, startAngle, endAngle, anticlockwise) {
         debug('arc ' + [x,y, radius, startAngle, endAngle, anticlockwise].join(','));
-        if (anticlockwise && Math.PI * 2 != endAngle) {
-            cairo.context_arc_negative(this._context, x, y, radius, startAngle, endAngle);
-        }
-        else {
-            cairo.context_arc(this._context, x, y, radius, startAngle, endAngle);
-        }
+        var cmds = this._commands,
+            n = this._command(6);
+        cmds[n] = (anticlockwise && Math.PI * 2 != endAngle) ? cairo.CMD_ARC_NEGATIVE : cairo.CMD_ARC;
+        cmds[n+1] = x;
+        cmds[n+2] = y;
+        cmds[n+3] = radius;
+        cmds[n+4] = startAngle;
+        cmds[n+5] = endAngle;
     }
 };
 
@@ -77,12 +77,12 @@ function setTextPath(context, str, x, y) {
         extents;
     switch (context._textAlign) {
         case 'center':
-            extents = cairo.context_text_extents(ctx, str);
+            extents = cairo.font_cache_text_extents(ctx, str);
             x -= extents.width / 2;
             break;
         case 'right':
         case 'end':
-            extents = cairo.context_text_extents(ctx, str);
+            extents = cairo.font_cache_text_extents(ctx, str);
             x -= extents.width;
             break;
     }
@@ -91,15 +91,15 @@ function setTextPath(context, str, x, y) {
     switch (context._textBaseline) {
         case 'top':
         case 'hanging':
-            extents = cairo.context_font_extents(ctx);
+            extents = cairo.font_cache_font_extents(ctx);
             y += extents.ascent;
             break;
         case 'middle':
-            extents = cairo.context_font_extents(ctx);
+            extents = cairo.font_cache_font_extents(ctx);
             y += extents.ascent / 2;
             break;
         case 'bottom':
-            extents = cairo.context_font_extents(ctx);
+            extents = cairo.font_cache_font_extents(ctx);
             y -= extents.height - extents.ascent;
             break;
     }
@@ -107,6 +107,9 @@ function setTextPath(context, str, x, y) {
     cairo.context_text_path(ctx, str);
 }
 
+// number of elements in each context's command list
+var COMMANDS_SIZE = 4096;
+
 function hasShadow(ctx) {
     return ctx._shadowColor.a && (ctx._shadowBlur || ctx._shadowOffsetX || ctx._shadowOffsetY);
 }
@@ -158,7 +161,10 @@ function CanvasRenderingContext2D(canvas) {
     var transparent = { r: 0, g: 0, b: 0, a: 1},
         transparent_black = { r: 0, g: 0, b: 0, a: 0};
     this._canvas = canvas;
-    this._context = cairo.context_create(canvas.surface);
+    this._cr = cairo.context_create(canvas.surface);
+    // drawing commands not yet executed, see flush()
+    this._commands = cairo.commands_create(COMMANDS_SIZE);
+    this._count = 0;
     this._globalAlpha = 1;
     this._globalCompositeOperation = 'source-over';
     this._strokeStyle = null;
@@ -178,14 +184,65 @@ CanvasRenderingContext2D.prototype.extend({
     get canvas() {
         return this._canvas;
     },
+    /**
+     * @function CanvasRenderingContext2D._context
+     *
+     * ### Synopsis
+     *
+     * var cr = ctx._context;
+     *
+     * The cairo context, with any recorded commands executed, so it may be used with the cairo.context_* functions.
+     */
+    get _context() {
+        this.flush();
+        return this._cr;
+    },
+    /**
+     * @function CanvasRenderingContext2D._command
+     *
+     * ### Synopsis
+     *
+     * var n = ctx._command(size);
+     *
+     * Make room for a command of size elements (the opcode and its arguments) in the command list.
+     *
+     * Path building, transformations, and solid color fills and strokes are recorded in the command list rather than calling cairo for each one, and executed by cairo.execute() in one call when the list is full or when the cairo context is next used directly.
+     *
+     * @param {int} size - number of elements needed.
+     * @return {int} n - index in this._commands to store the command at.
+     */
+    _command: function(size) {
+        if (this._count + size > COMMANDS_SIZE) {
+            this.flush();
+        }
+        var n = this._count;
+        this._count += size;
+        return n;
+    },
+    /**
+     * @function CanvasRenderingContext2D.flush
+     *
+     * ### Synopsis
+     *
+     * ctx.flush();
+     *
+     * Execute the recorded drawing commands.
+     */
+    flush: function() {
+        var count = this._count;
+        if (count) {
+            this._count = 0;
+            cairo.execute(this._cr, this._commands, count);
+        }
+    },
     // state
     save: function() {
         debug('save');
-        cairo.context_save(this._context);
+        this._commands[this._command(1)] = cairo.CMD_SAVE;
     },
     restore: function() {
         debug('restore');
-        cairo.context_restore(this._context);
+        this._commands[this._command(1)] = cairo.CMD_RESTORE;
     },
     // compositing
     get globalAlpha() {
@@ -353,11 +410,24 @@ CanvasRenderingContext2D.prototype.extend({
     // [path API (see also CanvasPathMethods)
     beginPath: function() {
         debug('beginPath');
-        cairo.context_new_path(this._context);
+        this._commands[this._command(1)] = cairo.CMD_NEW_PATH;
     },
     // fill and apply shadow
     fill: function(preserve) {
         debug('fill');
+        var cmds, n, color;
+        if (!this._fillStyle && !hasShadow(this)) {
+            color = this._fillColor;
+            cmds = this._commands;
+            n = this._command(6);
+            cmds[n] = cairo.CMD_SET_SOURCE_RGBA;
+            cmds[n+1] = color.r/255;
+            cmds[n+2] = color.g/255;
+            cmds[n+3] = color.b/255;
+            cmds[n+4] = color.a/255;
+            cmds[n+5] = preserve ? cairo.CMD_FILL_PRESERVE : cairo.CMD_FILL;
+            return;
+        }
         if (this._fillStyle) {
             if ('CanvasGradient' === this._fillStyle.constructor.name) {
                 debug('fill gradient');
@@ -371,7 +441,7 @@ CanvasRenderingContext2D.prototype.extend({
             }
         }
         else {
-            var color = this._fillColor;
+            color = this._fillColor;
             debug('fill color');
             cairo.context_set_source_rgba(this._context, color.r/255, color.g/255, color.b/255, color.a/255);
         }
@@ -385,6 +455,19 @@ CanvasRenderingContext2D.prototype.extend({
     },
     stroke: function(preserve) {
         debug('stroke');
+        var cmds, n, color;
+        if (!this._strokeStyle && !hasShadow(this)) {
+            color = this._strokeColor;
+            cmds = this._commands;
+            n = this._command(6);
+            cmds[n] = cairo.CMD_SET_SOURCE_RGBA;
+            cmds[n+1] = color.r/255;
+            cmds[n+2] = color.g/255;
+            cmds[n+3] = color.b/255;
+            cmds[n+4] = color.a/255;
+            cmds[n+5] = preserve ? cairo.CMD_STROKE_PRESERVE : cairo.CMD_STROKE;
+            return;
+        }
         if (this._strokeStyle) {
             if ('CanvasGradient' === this._strokeStyle.constructor.name) {
                 cairo.pattern_set_filter(this._strokeStyle._pattern, patternQualities[this._patternQuality]);
@@ -396,7 +479,7 @@ CanvasRenderingContext2D.prototype.extend({
             }
         }
         else {
-            var color = this._strokeColor;
+            color = this._strokeColor;
             cairo.context_set_source_rgba(this._context, color.r/255, color.g/255, color.b/255, color.a/255);
         }
 
@@ -463,8 +546,8 @@ CanvasRenderingContext2D.prototype.extend({
     measureText: function(str) {
         debug('measureText ' + str);
         var ctx = this._context;
-        var te = cairo.context_text_extents(ctx, str),
-            fe = cairo.context_font_extents(ctx);
+        var te = cairo.font_cache_text_extents(ctx, str),
+            fe = cairo.font_cache_font_extents(ctx);
 
         var x_offset = 0.0;
         switch (this._textAlign) {
@@ -520,6 +603,7 @@ CanvasRenderingContext2D.prototype.extend({
             sh = element.height;
         }
         else if ('Canvas' === element.constructor.name) {
+            element.flush();
             surface = element.surface;
             sw = element.width;
             sh = element.height;
@@ -580,19 +664,53 @@ CanvasRenderingContext2D.prototype.extend({
 //
 //    },
     // pixel manipulation
-    createImageData: function(sw, dh) {
-        throw 'Not implemented';
+    /**
+     * @function CanvasRenderingContext2D.createImageData
+     *
+     * ### Synopsis
+     *
+     * var imageData = ctx.createImageData(sw, sh);
+     * var imageData = ctx.createImageData(imageData);
+     *
+     * Create an ImageData object of transparent black pixels, of the given size or the size of another ImageData.
+     *
+     * imageData.data is held in native memory; see cairo.image_surface_get_data().
+     */
+    createImageData: function(sw, sh) {
+        debug('createImageData');
+        if (typeof sw === 'object') {
+            sh = sw.height;
+            sw = sw.width;
+        }
+        return cairo.image_data_create(Math.abs(sw), Math.abs(sh));
     },
     getImageData: function(sx, sy, sw, sh) {
         debug('getImageData ' + [sx,sy,sw,sh].join(','));
+        if (sw < 0) {
+            sx += sw;
+            sw = -sw;
+        }
+        if (sh < 0) {
+            sy += sh;
+            sh = -sh;
+        }
+        this.flush();
         return cairo.image_surface_get_data(this._canvas.surface, sx, sy, sw, sh);
     },
     putImageData: function(imagedata, dx,dy, dirtyX, dirtyY, dirtyWidth, dirtyHeight) {
-        throw 'Not implemented';
+        debug('putImageData ' + [dx,dy].join(','));
+        this.flush();
+        if (dirtyHeight === undefined) {
+            cairo.image_surface_put_data(this._canvas.surface, imagedata, dx, dy);
+        }
+        else {
+            cairo.image_surface_put_data(this._canvas.surface, imagedata, dx, dy, dirtyX, dirtyY, dirtyWidth, dirtyHeight);
+        }
     },
     //
     destroy: function() {
-        cairo.context_destroy(this._context);
+        cairo.commands_destroy(this._commands);
+        cairo.context_destroy(this._cr);
     }
 });
 CanvasRenderingContext2D.prototype.extend(CanvasTransformation);
@@ -59,6 +59,12 @@ var parseFont = function(str) {
     return cache[str] = font;
 };
 
+var slants = {
+    normal: cairo.FONT_SLANT_NORMAL,
+    italic: cairo.FONT_SLANT_ITALIC,
+    oblique: cairo.FONT_SLANT_OBLIQUE
+};
+
 var valid_textAlign = [ 'start', 'end', 'left', 'right', 'center' ];
 var valid_textBaseline = [ 'top', 'hanging', 'middle', 'alphabetic', 'ideographic', 'bottom' ];
 
@@ -76,22 +82,10 @@ var CanvasText = {
         var font = parseFont(value);
 //        console.dir(font);
         if (font) {
-            var ctx = this._context;
             this._fontString = value;
             this._font = font;
-            cairo.context_set_font_size(ctx, font.size);
-            switch (font.style) {
-                case 'italic':
-                    cairo.context_select_font_face(ctx, font.family, cairo.FONT_SLANT_ITALIC, font.weight === 'bold' ? cairo.FONT_WEIGHT_BOLD : cairo.FONT_WEIGHT_NORMAL);
-                    break;
-                case 'oblique':
-                    cairo.context_select_font_face(ctx, font.family, cairo.FONT_SLANT_OBLIQUE, font.weight === 'bold' ? cairo.FONT_WEIGHT_BOLD : cairo.FONT_WEIGHT_NORMAL);
-                    break;
-                case 'normal':
-                default:
-                    cairo.context_select_font_face(ctx, font.family, cairo.FONT_SLANT_NORMAL, font.weight === 'bold' ? cairo.FONT_WEIGHT_BOLD : cairo.FONT_WEIGHT_NORMAL);
-                    break;
-            }
+            // the scaled font comes from a cache shared by all canvases (see cairo.font_cache_select)
+            cairo.font_cache_select(this._context, font.family, slants[font.style] || cairo.FONT_SLANT_NORMAL, font.weight === 'bold' ? cairo.FONT_WEIGHT_BOLD : cairo.FONT_WEIGHT_NORMAL, font.size);
         }
     },
     get textAlign() {
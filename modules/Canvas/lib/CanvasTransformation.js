@@ -4,32 +4,47 @@
 
 var cairo = require('builtin/cairo');
 
+// These are recorded in the context's command list (see
+// CanvasRenderingContext2D._command()) rather than calling cairo directly.
 var CanvasTransformation = {
     // transformations (default transform is the identity matrix)
     scale: function(x, y) {
-        cairo.context_scale(this._context, x, y);
+        var cmds = this._commands,
+            n = this._command(3);
+        cmds[n] = cairo.CMD_SCALE;
+        cmds[n+1] = x;
+        cmds[n+2] = y;
     },
     rotate: function(angle) {
-        cairo.context_rotate(this._context, angle);
+        var cmds = this._commands,
+            n = this._command(2);
+        cmds[n] = cairo.CMD_ROTATE;
+        cmds[n+1] = angle;
     },
     translate: function(x, y) {
-        cairo.context_translate(this._context, x, y);
+        var cmds = this._commands,
+            n = this._command(3);
+        cmds[n] = cairo.CMD_TRANSLATE;
+        cmds[n+1] = x;
+        cmds[n+2] = y;
     },
     transform: function(a, b, c, d, e, f) {
-        var matrix = cairo.matrix_create();
-        cairo.matrix_init(matrix, a, b, c, d, e, f);
-        cairo.context_transform(this._context, matrix);
-        cairo.matrix_destroy(matrix);
+        var cmds = this._commands,
+            n = this._command(7);
+        cmds[n] = cairo.CMD_TRANSFORM;
+        cmds[n+1] = a;
+        cmds[n+2] = b;
+        cmds[n+3] = c;
+        cmds[n+4] = d;
+        cmds[n+5] = e;
+        cmds[n+6] = f;
     },
     setTransform: function(a, b, c, d, e, f) {
-        cairo.context_identity_matrix(this._context);
-        var matrix = cairo.matrix_create();
-        cairo.matrix_init(matrix, a, b, c, d, e, f);
-        cairo.context_transform(this._context, matrix);
-        cairo.matrix_destroy(matrix);
+        this.resetTransform();
+        this.transform(a, b, c, d, e, f);
     },
     resetTransform: function() {
-        cairo.context_identity_matrix(this._context);
+        this._commands[this._command(1)] = cairo.CMD_IDENTITY_MATRIX;
     }
 };
 
@@ -2,9 +2,10 @@
 
 var cairo = require('builtin/cairo');
 
+// filename may instead be a buffer (see builtin/buffer) containing a PNG image
 function Image(filename) {
     this._filename = filename;
-    this._surface = cairo.image_surface_create_from_png(filename);
+    this._surface = typeof filename === 'object' ? cairo.image_surface_create_from_png_buffer(filename) : cairo.image_surface_create_from_png(filename);
     this._pattern = cairo.pattern_create_for_surface(this._surface);
     this.width = cairo.image_surface_get_width(this._surface);
     this.height = cairo.image_surface_get_height(this._surface);
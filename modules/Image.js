@@ -18,6 +18,8 @@
  * 
  * The current functionality of this class is to allow an image to be loaded, resized/cropped, and then written back to disk.
  * 
+ * To make thumbnails, use Image.thumbnail(), which is much faster for large JPEG images.
+ * 
  */
 "use strict";
 
@@ -77,7 +79,7 @@ Image.prototype.extend({
             return;
         }
         var newImage = gd.imageCreateTrueColor(width, height);
-        gd.imageCopyResampled(newImage, this.handle, 0,0, 0,0, width, height, this.width, this.height);
+        gd.imageResample(newImage, this.handle, 0,0, 0,0, width, height, this.width, this.height);
         gd.imageDestroy(this.handle);
         this.handle = newImage;
         this.width = width;
@@ -179,6 +181,51 @@ Image.prototype.extend({
     }
 })
 
+/**
+ * @function Image.thumbnail
+ * 
+ * ### Synopsis
+ * 
+ * var info = Image.thumbnail(src, options);
+ * 
+ * Make a thumbnail of an image file, much faster than loading it with new Image() and resizing it: JPEG images are decoded at reduced size, and the full size image is never in memory.
+ * 
+ * @param {string} src - path to image file (or a builtin/buffer holding the image).
+ * @param {object} options - width, height, fit ('contain', 'cover' or 'fill'), file or buffer, format and quality; see builtin/image.thumbnail.
+ * @return {object} info - width, height and size (in bytes) of the thumbnail.
+ * 
+ * ### Example
+ * ```
+ * Image.thumbnail(upload, { width: 200, height: 200, fit: 'cover', file: '/var/thumbs/' + id + '.jpg' });
+ * ```
+ */
+Image.thumbnail = function(src, options) {
+    return require('builtin/image').thumbnail(src, options);
+};
+
+/**
+ * @function Image.thumbnails
+ * 
+ * ### Synopsis
+ * 
+ * var results = Image.thumbnails(jobs);
+ * 
+ * Make a batch of thumbnails in parallel, using all the CPU cores.
+ * 
+ * @param {array} jobs - array of objects with a src member and the options of Image.thumbnail().
+ * @return {array} results - for each job, the info Image.thumbnail() returns, or an object with an error member if that job failed.
+ * 
+ * ### Example
+ * ```
+ * var results = Image.thumbnails(ids.map(function(id) {
+ *     return { src: '/var/images/' + id + '.jpg', width: 200, file: '/var/thumbs/' + id + '.jpg' };
+ * }));
+ * ```
+ */
+Image.thumbnails = function(jobs) {
+    return require('builtin/image').thumbnails(jobs);
+};
+
 if (exports) {
     exports = Image;
 }
\ No newline at end of file
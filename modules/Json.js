@@ -93,20 +93,24 @@ var Json = function() {
             res.reset();
             obj = obj || {};
             obj.success = true;
+            // encoded directly into the response buffer, see builtin/json
             if (req.data.callback) {
                 res.contentType = 'text/javascript';
-                res.write([req.data.callback, '(', Json.encode(obj), ')'].join(''));
+                res.write(req.data.callback + '(');
+                res.writeJson(obj);
+                res.write(')');
             }
             else {
                 var contentType = req.getHeader('content-type') || '';
-                var ret = Json.encode(obj);
                 if (contentType.indexOf('multipart/form-data') != -1) {
                     // it's something like a post through an invisible iframe, so we wrap the reponse in  textarea tags
-                    res.write('<textarea>' + ret + '</textarea>');
+                    res.write('<textarea>');
+                    res.writeJson(obj);
+                    res.write('</textarea>');
                 }
                 else {
                     res.contentType = 'application/json';
-                    res.write(ret);
+                    res.writeJson(obj);
                 }
             }
             if (global.Server && global.Server.endRequest()) {
@@ -156,10 +160,12 @@ var Json = function() {
             };
             var contentType = req.getHeader('content-type') || '';
             if (contentType && contentType.indexOf('multipart/form-data') !== -1) {
-                res.write('<textarea>' + Json.encode(responseObj) + '</textarea>');
+                res.write('<textarea>');
+                res.writeJson(responseObj);
+                res.write('</textarea>');
             }
             else {
-                res.write(Json.encode(responseObj));
+                res.writeJson(responseObj);
             }
 
             if (global.Server && global.Server.endRequest()) {
@@ -185,10 +191,10 @@ var Json = function() {
          */
         exception : function(msg) {
             res.status = 500;
-            res.write(Json.encode({
+            res.writeJson({
                 success   : false,
                 exception : msg
-            }));
+            });
             if (global.Server && global.Server.endRequest()) {
                 Server.endRequest();
             }
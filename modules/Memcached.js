@@ -13,6 +13,14 @@
  * mc.add('foo, 'bar');
  * console.dir(mc.get('foo'));
  * ```
+ *
+ * With several cache servers, use consistent hashing so adding or removing a server doesn't invalidate most of the cache.  mc.mget() fetches all its keys in one round trip per server; mc.mset() and mc.mdelete() wait for each item's reply unless buffered (or noReply) is set, whatever the protocol:
+ *
+ * ```
+ * var mc = new Memcached('cache1,cache2,cache3', { ketama: true, binary: true, buffered: true, noDelay: true });
+ * mc.mset({ a: 1, b: 'two', c: [ 3 ] }, 60);
+ * console.dir(mc.mget([ 'a', 'b', 'c' ]));
+ * ```
  */
 var memcached = require('builtin/memcached'),
     Json = require('Json');
@@ -22,16 +30,34 @@ function isArray(v) {
 function isString(v) {
     return typeof v === 'string';
 }
-function exec(handle, method, key, o, expires) {
-    expires = expires || 0;
-    var flags = 0;  // not a string
-    if (isString(o)) {
-        flags = 1;
+function encode(mc, o, compress) {
+    var flags = memcached.FLAG_STRING;
+    if (!isString(o)) {
+        if (mc.packed) {
+            flags = memcached.FLAG_PACKED;
+        }
+        else {
+            flags = 0;  // JSON
+            o = Json.encode(o);
+        }
     }
-    else {
-        o = Json.encode(o);
+    return { value: o, flags: compress ? flags | mc.compression : flags };
+}
+function decode(o) {
+    if (o.flags & (memcached.FLAG_STRING | memcached.FLAG_PACKED)) {
+        return o.value;
+    }
+    return Json.decode(o.value);
+}
+function exec(mc, method, key, o, expires) {
+    // prepend/append concatenate on the server, so they can't be compressed
+    var item = encode(mc, o, method !== 'prepend' && method !== 'append');
+    return memcached[method](mc.handle, key, item.value, expires || 0, item.flags, mc.compressThreshold);
+}
+function check(handle, rc) {
+    if (rc && rc !== memcached.BUFFERED) {
+        error(memcached.error(handle, rc));
     }
-    return memcached[method](handle, key, o, expires, flags);
 }
 /**
  * @constructor Memcached
@@ -39,23 +65,54 @@ function exec(handle, method, key, o, expires) {
  * ### Synopsis
  *
  * var mc = new Memcached(hosts);
+ * var mc = new Memcached(hosts, options);
  *
  * Create a new Memcached connection instance.
  *
+ * The options are libmemcached behaviors to turn on; see memcached.connect() for details:
+ *
+ * + binary: use the binary protocol.
+ * + ketama: use consistent hashing to distribute keys over the servers.
+ * + noDelay: set TCP_NODELAY on the sockets.
+ * + noReply: don't wait for replies to storage commands; errors from set, add, etc., are not reported.
+ * + buffered: buffer storage commands until a reply is needed.
+ *
+ * The options also control how values are stored:
+ *
+ * + serialize: 'pack' (default) to store objects in a compact binary encoding, decoded natively, or 'json' to store them as JSON text, e.g. for other clients to read.
+ * + compress: 'lz4' (default), 'zlib' or false; compress values larger than compressThreshold.
+ * + compressThreshold: size in bytes above which values are compressed (default 2048).
+ *
+ * Values stored in any of these ways can be read back regardless of the options.
+ *
+ * Hot keys can be served from a cache in shared memory on this machine, consulted before memcached:
+ *
+ * + local: a ShmCache instance (e.g. global.shmcache in the HTTP server).  Values read from or stored to memcached are copied into it.
+ * + localTtl: time to live (seconds) of values in the local cache (default 5).  Values changed on memcached by another machine may be seen up to this long after the change; changes made through this machine are seen immediately.
+ *
+ * Keys are not namespaced in the local cache, so Memcached instances connected to different servers should not share one.
+ *
  * @param {string|array) hosts - host names, either an array or comma separated list in a string.
+ * @param {object} options - optional behaviors.
  *
  * ### Note
  *
  * This function throws an error if a connection could not be made.
  */
-function Memcached(hosts) {
+function Memcached(hosts, options) {
     if (isArray(hosts)) {
         hosts = hosts.join(',');
     }
-    this.handle = memcached.connect(hosts);
+    options = options || {};
+    this.handle = memcached.connect(hosts, options);
     if (!this.handle) {
         error('Could not connect to memcached');
     }
+    this.packed = options.serialize !== 'json';
+    this.compression = options.compress === false ? 0 : (options.compress === 'zlib' ? memcached.FLAG_ZLIB : memcached.FLAG_LZ4);
+    this.compressThreshold = options.compressThreshold === undefined ? 2048 : options.compressThreshold;
+    this.local = options.local || null;
+    this.localTtl = options.localTtl === undefined ? 5 : options.localTtl;
 }
 Memcached.prototype.extend({
     /**
@@ -78,12 +135,12 @@ Memcached.prototype.extend({
      *
      * This function throws an error if the action was unsuccessful.
      *
-     * If the value to store is an object, it is JSON encoded automatically.
+     * If the value to store is not a string, it is serialized automatically.
      */
     set: function(key, o, expires) {
-        var rc = exec(this.handle, 'set', key, o, expires);
-        if (rc) {
-            error(memcached.error(this.handle, rc));
+        check(this.handle, exec(this, 'set', key, o, expires));
+        if (this.local) {
+            this.local.set(key, o, this.localTtl);
         }
     },
     /**
@@ -106,13 +163,13 @@ Memcached.prototype.extend({
      *
      * This function throws an error if the action was unsuccessful.
      *
-     * If the value to store is an object, it is JSON encoded automatically.
+     * If the value to store is not a string, it is serialized automatically.
      */
     add: function(key, o, expires) {
-        var rc = exec(this.handle, 'add', key, o, expires);
-        if (rc) {
-            error(memcached.error(this.handle, rc));
+        if (this.local) {
+            this.local.remove(key);
         }
+        check(this.handle, exec(this, 'add', key, o, expires));
     },
     /**
      * @function mc.replace
@@ -134,13 +191,13 @@ Memcached.prototype.extend({
      *
      * This function throws an error if the action was unsuccessful.
      *
-     * If the value to store is an object, it is JSON encoded automatically.
+     * If the value to store is not a string, it is serialized automatically.
      */
     replace: function(key, o, expires) {
-        var rc = exec(this.handle, 'replace', key, o, expires);
-        if (rc) {
-            error(memcached.error(this.handle, rc));
+        if (this.local) {
+            this.local.remove(key);
         }
+        check(this.handle, exec(this, 'replace', key, o, expires));
     },
     /**
      * @function mc.prepend
@@ -162,13 +219,13 @@ Memcached.prototype.extend({
      *
      * This function throws an error if the action was unsuccessful.
      *
-     * If the value to store is an object, it is JSON encoded automatically.
+     * If the value to store is not a string, it is serialized automatically.
      */
     prepend: function(key, o, expires) {
-        var rc = exec(this.handle, 'prepend', key, o, expires);
-        if (rc) {
-            error(memcached.error(this.handle, rc));
+        if (this.local) {
+            this.local.remove(key);
         }
+        check(this.handle, exec(this, 'prepend', key, o, expires));
     },
     /**
      * @function mc.append
@@ -193,10 +250,10 @@ Memcached.prototype.extend({
      * If an object identified by key does not exist, an error occurs.
      */
     append: function(key, o, expires) {
-        var rc = exec(this.handle, 'append', key, o, expires);
-        if (rc) {
-            error(memcached.error(this.handle, rc));
+        if (this.local) {
+            this.local.remove(key);
         }
+        check(this.handle, exec(this, 'append', key, o, expires));
     },
     /**
      * @function mc.get
@@ -211,11 +268,22 @@ Memcached.prototype.extend({
      * @return {object} o - if the item stored is an object, the object is returned; if the item stored is a string, the string is returned; or false if an error occurred.
      */
     get: function(key) {
+        var value;
+        if (this.local) {
+            value = this.local.get(key);
+            if (value !== undefined) {
+                return value;
+            }
+        }
         var o = memcached.get(this.handle, key);
         if (o.rc !== 0) {
             return false;
         }
-        return o.flags === 0 ? Json.decode(o.value) : o.value;
+        value = decode(o);
+        if (this.local) {
+            this.local.set(key, value, this.localTtl);
+        }
+        return value;
     },
     /**
      * @function mc.mget
@@ -234,14 +302,74 @@ Memcached.prototype.extend({
      * @return {object} o - hash of returned objects; index/hash/key is the key, value is an object or string; or false if an error occurred.
      */
     mget: function(keys) {
+        var local = this.local,
+            localTtl = this.localTtl,
+            o = {};
+        if (local) {
+            var missing = [];
+            keys.each(function(key) {
+                var value = local.get(key);
+                if (value === undefined) {
+                    missing.push(key);
+                }
+                else {
+                    o[key] = value;
+                }
+            });
+            if (!missing.length) {
+                return o;
+            }
+            keys = missing;
+        }
         var res = memcached.mget(this.handle, keys);
-        var o = {};
+        if (isString(res)) {
+            return false;
+        }
         res.each(function(value, key) {
-            if (value.rc !== 0) {
-                o[key] = value.flags === 0 ? Json.decode(value.value) : value.value;
+            if (value.rc === 0) {
+                o[key] = decode(value);
+                if (local) {
+                    local.set(key, o[key], localTtl);
+                }
             }
         });
-        return res;
+        return o;
+    },
+    /**
+     * @function mc.mset
+     *
+     * ### Synopsis
+     *
+     * mc.mset(items);
+     * mc.mset(items, expires);
+     *
+     * Store several items in memcached.  Items are serialized and compressed as for mc.set().
+     *
+     * With the buffered or noReply options, the items are pipelined, so storing many of them takes about one round trip; otherwise each waits for its reply, even with the binary protocol.  With buffered, failures of individual items are not reported.
+     *
+     * @param {object} items - hash of values to store, indexed by key.
+     * @param {int} expires - time to live (seconds) of the items in cache.
+     *
+     * ### Notes
+     *
+     * This function throws an error if any of the items could not be stored.
+     */
+    mset: function(items, expires) {
+        var me = this,
+            list = [];
+        items.each(function(o, key) {
+            var item = encode(me, o, true);
+            item.key = key;
+            list.push(item);
+        });
+        check(this.handle, memcached.mset(this.handle, list, expires || 0, this.compressThreshold));
+        if (this.local) {
+            var local = this.local,
+                localTtl = this.localTtl;
+            items.each(function(o, key) {
+                local.set(key, o, localTtl);
+            });
+        }
     },
     /**
      * @function mc.remove
@@ -256,8 +384,32 @@ Memcached.prototype.extend({
      * @return {int} rc - result code; 0 if no error, otherwise the error code.
      */
     remove: function(key) {
+        if (this.local) {
+            this.local.remove(key);
+        }
         return memcached.remove(this.handle, key);
     },
+    /**
+     * @function mc.mdelete
+     *
+     * ### Synopsis
+     *
+     * var rc = mc.mdelete(keys);
+     *
+     * Remove several items from memcached by key.  Keys that are not in the cache are ignored.
+     *
+     * @param {array} keys - keys of the items to remove.
+     * @return {int} rc - result code; 0 if no error, otherwise the error code.
+     */
+    mdelete: function(keys) {
+        var local = this.local;
+        if (local) {
+            keys.each(function(key) {
+                local.remove(key);
+            });
+        }
+        return memcached.mdelete(this.handle, keys);
+    },
     /**
     * @function mc.flush
     *
@@ -272,6 +424,9 @@ Memcached.prototype.extend({
     * @return {int} rc - result code; 0 if no error, otherwise the error code.
     */
     flush: function(expiration) {
+        if (this.local) {
+            this.local.clear();
+        }
         return memcached.flush(this.handle, expiration);
     },
     /**
@@ -41,7 +41,9 @@
  * builtin/mysql
  * modules/Schema
  */
-var mysql = require('builtin/mysql');
+var mysql = require('builtin/mysql'),
+    async = require('builtin/async'),
+    Util = require('Util');
 
 function isArray(v) {
     return toString.apply(v) === '[object Array]';
@@ -51,6 +53,114 @@ function addslashes(str) {
     return (str + '').replace(/([\\"'])/g, "\\$1").replace(/\0/g, "\\0");
 }
 
+// Query cache helpers.  See SQL.enableCache().
+
+var uncacheable = /\b(FOR\s+UPDATE|LOCK\s+IN\s+SHARE\s+MODE|SQL_CALC_FOUND_ROWS|FOUND_ROWS\(|LAST_INSERT_ID\(|NOW\(|CURDATE\(|CURTIME\(|UNIX_TIMESTAMP\(\)|RAND\(|UUID\()/i,
+    tableList = /\b(?:FROM|JOIN|INTO|UPDATE|TABLE)\s+((?:[\w.`]+(?:\s+(?:AS\s+)?\w+)?\s*,\s*)*[\w.`]+)/gi;
+
+function normalize(sql) {
+    return sql.replace(/\s+/g, ' ').replace(/^ | $/g, '');
+}
+
+// names of the tables a query refers to, lower cased, without database prefix
+function queryTables(sql) {
+    var found = {},
+        ret = [],
+        match;
+    tableList.lastIndex = 0;
+    while ((match = tableList.exec(sql))) {
+        match[1].split(',').each(function(table) {
+            table = table.replace(/^\s+/, '').split(/\s+/)[0].replace(/`/g, '').split('.').pop().toLowerCase();
+            if (!found[table]) {
+                found[table] = true;
+                ret.push(table);
+            }
+        });
+    }
+    return ret;
+}
+
+// cached values are handed out as copies, since callers (e.g. Schema onLoad handlers) modify rows
+function copyRow(row) {
+    var ret = {};
+    for (var key in row) {
+        if (row.hasOwnProperty(key)) {
+            ret[key] = row[key];
+        }
+    }
+    return ret;
+}
+
+function copyResult(value) {
+    if (isArray(value)) {
+        var ret = [];
+        for (var i = 0, len = value.length; i < len; i++) {
+            ret.push(copyRow(value[i]));
+        }
+        return ret;
+    }
+    if (value && typeof value === 'object') {
+        return copyRow(value);
+    }
+    return value;
+}
+
+// current version of a table in the shared (L1) cache, fetched once per request
+function tableVersion(cache, table) {
+    var version = cache.versions[table];
+    if (version === undefined) {
+        try {
+            version = cache.l1.get(cache.prefix + 'table:' + table);
+        }
+        catch (e) {
+            version = false;
+        }
+        cache.versions[table] = version = version || '0';
+    }
+    return version;
+}
+
+function cachedQuery(sql, kind, query, fetch) {
+    var cache = sql.cache;
+    if (!cache || sql.inTransaction || !/^\s*SELECT\b/i.test(query) || uncacheable.test(query)) {
+        return fetch();
+    }
+    var key = kind + ':' + normalize(query),
+        entry = cache.l0[key];
+    if (entry) {
+        return copyResult(entry.value);
+    }
+    var tables = queryTables(query),
+        l1key = null,
+        value;
+    if (cache.l1) {
+        var versions = [];
+        tables.each(function(table) {
+            versions.push(tableVersion(cache, table));
+        });
+        l1key = cache.prefix + Util.md5(key + '|' + versions.join(','));
+        try {
+            var hit = cache.l1.get(l1key);
+            if (hit) {
+                cache.l0[key] = { tables: tables, value: hit.v };
+                return copyResult(hit.v);
+            }
+        }
+        catch (e) {
+        }
+    }
+    value = fetch();
+    cache.l0[key] = { tables: tables, value: value };
+    if (l1key) {
+        try {
+            cache.l1.set(l1key, { v: value }, cache.ttl);
+        }
+        catch (e) {
+        }
+    }
+    return copyResult(value);
+}
+
 /**
  * @constructor MySQL
  *
@@ -78,6 +188,8 @@ function addslashes(str) {
 var MySQL = function() {
     this.queryCount = 0;
     this.handle = null;
+    this.cache = null;
+    this.inTransaction = false;
 };
 
 MySQL.prototype.extend({
@@ -94,6 +206,8 @@ MySQL.prototype.extend({
      *
      * The second form for SQL.connect, with no arguments, means a global Config.mysql object is expected with host, user, passwd, and db members that specify the connection parameeters.
      *
+     * If Config.mysql.multiStatements is true, the connection is opened with multiple statement support enabled, which saves SQL.batch() from toggling it on and off for each batch.
+     *
      * @param {string} host - host name of MySQL server.
      * @param {string} user - MySQL username.
      * @param {string} passwd - MySQL password for the given user;
@@ -105,7 +219,7 @@ MySQL.prototype.extend({
             user = user || Config.mysql.user;
             passwd = passwd !== undefined ? passwd : Config.mysql.passwd;
             db = db || Config.mysql.db;
-            this.handle = mysql.connect(host, user, passwd, db);
+            this.handle = mysql.connect(host, user, passwd, db, undefined, !!(global.Config && Config.mysql && Config.mysql.multiStatements));
         }
     },
 
@@ -148,8 +262,11 @@ MySQL.prototype.extend({
      */
     getDataRows: function(sql) {
         sql = isArray(sql) ? sql.join('\n') : sql;
+        var handle = this.handle;
         try {
-            return mysql.getDataRows(this.handle, sql);
+            return cachedQuery(this, 'rows', sql, function() {
+                return mysql.getDataRows(handle, sql);
+            });
 //          return eval(mysql.getDataRowsJson(sql).replace(/\n/igm, '\\n'));
         }
         catch (e) {
@@ -199,8 +316,11 @@ MySQL.prototype.extend({
      */
     getDataRow: function(sql) {
         sql = isArray(sql) ? sql.join('\n') : sql;
+        var handle = this.handle;
         try {
-            return mysql.getDataRow(this.handle, sql);
+            return cachedQuery(this, 'row', sql, function() {
+                return mysql.getDataRow(handle, sql);
+            });
         }
         catch (e) {
             throw new SQLException(e, sql);
@@ -244,8 +364,11 @@ MySQL.prototype.extend({
      */
     getScalar: function(sql) {
         sql = isArray(sql) ? sql.join('\n') : sql;
+        var handle = this.handle;
         try {
-            return mysql.getScalar(this.handle, sql);
+            return cachedQuery(this, 'scalar', sql, function() {
+                return mysql.getScalar(handle, sql);
+            });
         }
         catch (e) {
             throw new SQLException(e, sql);
@@ -253,6 +376,56 @@ MySQL.prototype.extend({
     },
 
 
+    /**
+     * @function SQL.batch
+     *
+     * ### Synopsis
+     *
+     * var results = SQL.batch(queries);
+     *
+     * Perform several independent queries in a single round trip to the server.
+     *
+     * ### Description
+     *
+     * The queries are sent to the server together and their results are returned in an array, in the same order as the queries.  Each entry is an array of rows (as returned by SQL.getDataRows()) for queries that return a result set, or the number of affected rows for update type queries.
+     *
+     * Each query may be a string or an array, as with SQL.getDataRows().
+     *
+     * If any query fails, an SQLException is thrown; queries after the failing one are not executed.
+     *
+     * Unless the connection was opened with Config.mysql.multiStatements true (see SQL.connect()), multiple statement support is turned on before the batch and off after it, which costs two more round trips to the server per batch: three in all, so a batch of two queries saves nothing.  Applications that use SQL.batch() should set multiStatements, if they can accept that any query may then contain several statements (an SQL injection is no longer limited to a single statement).
+     *
+     * @param {array} queries - array of queries to perform.
+     * @returns {array} results - array of results, one per query.
+     *
+     * ### Example
+     *
+     * ```
+     * var results = SQL.batch([
+     *     'SELECT * FROM Users WHERE userId=' + SQL.quote(userId),
+     *     'SELECT COUNT(*) AS count FROM Messages WHERE userId=' + SQL.quote(userId)
+     * ]);
+     * var user = results[0][0],
+     *     messageCount = results[1][0].count;
+     * ```
+     */
+    batch: function(queries) {
+        var sql = [];
+        queries.each(function(query) {
+            sql.push(isArray(query) ? query.join('\n') : query);
+        });
+        var results;
+        try {
+            results = mysql.batch(this.handle, sql);
+        }
+        catch (e) {
+            this.invalidateQueries(sql);
+            throw new SQLException(e, sql.join(';\n'));
+        }
+        this.invalidateQueries(sql);
+        return results;
+    },
+
     /**
      * @function SQL.update
      *
@@ -264,17 +437,135 @@ MySQL.prototype.extend({
      *
      * The query may be a string or an array.  If it is an array, this function will join that array with newline.  See examples below.
      *
+     * If the query cache is enabled, cached results for the tables the query refers to are invalidated.
+     *
      * @param {string|array} query - the query to perform (an update/delete/alter table/etc.)
      * @returns {int} affectedRows - the number of rows in the table affected by the update query.
      */
     update: function(sql) {
         sql = isArray(sql) ? sql.join('\n') : sql;
+        var affectedRows;
         try {
-            return mysql.update(this.handle, sql);
+            affectedRows = mysql.update(this.handle, sql);
         }
         catch (e) {
             throw new SQLException(e, sql);
         }
+        this.invalidateQueries([sql]);
+        return affectedRows;
+    },
+
+    /**
+     * @function SQL.enableCache
+     *
+     * ### Synopsis
+     *
+     * SQL.enableCache();
+     * SQL.enableCache(options);
+     *
+     * Cache the results of SELECT queries made through SQL.getDataRows(), SQL.getDataRow() and SQL.getScalar().
+     *
+     * ### Description
+     *
+     * Results are cached per request (L0) keyed by the normalized query text, so repeating an identical query within a request costs nothing.  Optionally, results are also cached in memcached (L1) and shared by all processes.
+     *
+     * Cached results are tagged with the tables the query refers to.  SQL.update() (and so Schema.putOne() and Schema.remove()) invalidates cached results for the tables it modifies, in this process and, through per-table versions kept in memcached, in all others.  Use SQL.invalidate() after modifying tables by other means.
+     *
+     * Queries made inside a transaction, and queries whose results vary from call to call (NOW(), RAND(), FOR UPDATE, etc.) are not cached.
+     *
+     * The HTTP server calls SQL.resetCache() at the end of each request and enables the cache for the global SQL connection if Config.mysql.cache is set to the options object.
+     *
+     * The options are:
+     *
+     * + memcached: a Memcached instance, or host(s) to connect to, for the shared L1 cache.
+     * + ttl: time to live (seconds) of results in the L1 cache, default 60.
+     * + prefix: prefix for L1 cache keys, default 'sqlcache:'.
+     *
+     * @param {object} options - optional cache options.
+     */
+    enableCache: function(options) {
+        options = options || {};
+        var l1 = options.memcached || null;
+        if (l1 && !l1.handle) {
+            var Memcached = require('Memcached');
+            l1 = new Memcached(l1);
+        }
+        this.cache = {
+            l0: {},
+            versions: {},
+            l1: l1,
+            ttl: options.ttl || 60,
+            prefix: options.prefix || 'sqlcache:'
+        };
+    },
+
+    /**
+     * @function SQL.resetCache
+     *
+     * ### Synopsis
+     *
+     * SQL.resetCache();
+     *
+     * Discard the per-request (L0) query cache.  Called at the end of each request.
+     */
+    resetCache: function() {
+        if (this.cache) {
+            this.cache.l0 = {};
+            this.cache.versions = {};
+        }
+    },
+
+    /**
+     * @function SQL.invalidate
+     *
+     * ### Synopsis
+     *
+     * SQL.invalidate(table);
+     * SQL.invalidate(tables);
+     *
+     * Invalidate cached query results for one or more tables, in this process and in the shared cache.
+     *
+     * @param {string|array} tables - table name or array of table names.
+     */
+    invalidate: function(tables) {
+        var cache = this.cache;
+        if (!cache) {
+            return;
+        }
+        tables = isArray(tables) ? tables : [tables];
+        tables.each(function(table) {
+            table = table.toLowerCase();
+            cache.l0.each(function(entry, key) {
+                if (entry.tables.indexOf(table) !== -1) {
+                    delete cache.l0[key];
+                }
+            });
+            if (cache.l1) {
+                var version = new Date().getTime() + '.' + Math.floor(Math.random() * 1000000);
+                cache.versions[table] = version;
+                try {
+                    cache.l1.set(cache.prefix + 'table:' + table, version);
+                }
+                catch (e) {
+                }
+            }
+        });
+    },
+
+    /** @private */
+    invalidateQueries: function(queries) {
+        if (!this.cache) {
+            return;
+        }
+        var tables = [];
+        queries.each(function(query) {
+            if (!/^\s*SELECT\b/i.test(query)) {
+                tables = tables.concat(queryTables(query));
+            }
+        });
+        if (tables.length) {
+            this.invalidate(tables);
+        }
     },
 
     /**
@@ -312,6 +603,7 @@ MySQL.prototype.extend({
      * The example at the top of this page.
      */
     startTransaction: function() {
+        this.inTransaction = true;
         try {
             return mysql.update(this.handle, 'START TRANSACTION');
         }
@@ -334,7 +626,8 @@ MySQL.prototype.extend({
      * The example at the top of this page.
      */
     commit: function() {
-         try {
+        this.inTransaction = false;
+        try {
            return mysql.update(this.handle, 'COMMIT');
         }
         catch (e) {
@@ -356,6 +649,7 @@ MySQL.prototype.extend({
      * The example at the top of this page.
      */
     rollback: function() {
+        this.inTransaction = false;
         try {
             return mysql.update(this.handle, 'ROLLBACK');
         }
@@ -409,12 +703,167 @@ MySQL.prototype.extend({
         }
     },
 
+    /**
+     * @function SQL.socket
+     *
+     * ### Synopsis
+     *
+     * var fd = SQL.socket();
+     *
+     * Get the file descriptor of the connection to the server, for use with builtin/async select loops.
+     *
+     * ### See Also
+     *
+     * MySQL.parallel()
+     *
+     * @returns {int} fd - file descriptor of the connection.
+     */
+    socket: function() {
+        return mysql.socket(this.handle);
+    },
+
     close: function() {
         mysql.close(this.handle);
         this.handle = null;
     }
 });
 
+/**
+ * @function MySQL.parallel
+ *
+ * ### Synopsis
+ *
+ * var results = MySQL.parallel(requests);
+ *
+ * Perform queries on several connections at the same time.
+ *
+ * ### Description
+ *
+ * Each request is an object with an SQL member, a connected MySQL instance, and a query member, a string or array as with SQL.getDataRows().  Each connection may appear only once.
+ *
+ * All the queries are started without blocking and the connections are waited on together with select(), so the time taken is that of the slowest query rather than the sum of all of them.  This is useful for fanning out queries to several shards.
+ *
+ * The results are returned in the same order as the requests.  Each is an array of rows for queries that return a result set, or the number of affected rows for update type queries.
+ *
+ * If any query fails, an SQLException is thrown once all the queries have completed.  If a query can't be started, or select() fails, the queries already started are abandoned (their connections are reconnected when next used) and the exception is thrown at once.  Queries time out according to the connections' read and write timeouts, if they were set.
+ *
+ * This requires a MySQL client library with non-blocking support (MariaDB).
+ *
+ * @param {array} requests - array of { SQL: connection, query: query } objects.
+ * @returns {array} results - array of results, one per request.
+ *
+ * ### Example
+ *
+ * ```
+ * var results = MySQL.parallel([
+ *     { SQL: shard1, query: 'SELECT * FROM Orders WHERE userId=' + shard1.quote(userId) },
+ *     { SQL: shard2, query: 'SELECT * FROM Orders WHERE userId=' + shard2.quote(userId) }
+ * ]);
+ * ```
+ */
+MySQL.parallel = function(requests) {
+    var pending = [],
+        completed = false;
+    var readfds = async.alloc_fd_set(),
+        writefds = async.alloc_fd_set();
+    try {
+        requests.each(function(request) {
+            var sql = isArray(request.query) ? request.query.join('\n') : request.query,
+                p = {
+                    handle: request.SQL.handle,
+                    fd: mysql.socket(request.SQL.handle),
+                    query: sql,
+                    status: 0
+                };
+            pending.push(p);
+            p.status = mysql.queryStart(p.handle, sql);
+        });
+
+        while (true) {
+            var maxfd = -1,
+                timeout = null;
+            async.FD_ZERO(readfds);
+            async.FD_ZERO(writefds);
+            pending.each(function(p) {
+                if (p.status & mysql.WAIT_READ) {
+                    async.FD_SET(p.fd, readfds);
+                }
+                if (p.status & mysql.WAIT_WRITE) {
+                    async.FD_SET(p.fd, writefds);
+                }
+                if (p.status & mysql.WAIT_TIMEOUT) {
+                    var ms = mysql.queryTimeout(p.handle);
+                    if (timeout === null || ms < timeout) {
+                        timeout = ms;
+                    }
+                }
+                if (p.status && p.fd > maxfd) {
+                    maxfd = p.fd;
+                }
+            });
+            if (maxfd === -1) {
+                break;
+            }
+            var ready = async.select(maxfd + 1, readfds, writefds, null, timeout),
+                timedOut = false;
+            if (!ready) {
+                var errno = async.errno();
+                if (errno === async.EINTR) {
+                    continue;
+                }
+                if (errno) {
+                    throw new SQLException('MySQL.parallel: select failed, errno ' + errno, '');
+                }
+                // the queries waiting for a timeout are continued with WAIT_TIMEOUT, and fail
+                ready = { read: [], write: [] };
+                timedOut = true;
+            }
+            pending.each(function(p) {
+                var flags = 0;
+                if (ready.read.indexOf(p.fd) !== -1) {
+                    flags |= mysql.WAIT_READ;
+                }
+                if (ready.write.indexOf(p.fd) !== -1) {
+                    flags |= mysql.WAIT_WRITE;
+                }
+                if (timedOut && (p.status & mysql.WAIT_TIMEOUT)) {
+                    flags = mysql.WAIT_TIMEOUT;
+                }
+                if (p.status && flags) {
+                    p.status = mysql.queryContinue(p.handle, flags);
+                }
+            });
+        }
+        completed = true;
+    }
+    finally {
+        async.free_fd_set(readfds);
+        async.free_fd_set(writefds);
+        if (!completed) {
+            // don't leave connections stuck in a query nobody will finish
+            pending.each(function(p) {
+                mysql.queryAbort(p.handle);
+            });
+        }
+    }
+
+    var results = [],
+        error = null;
+    pending.each(function(p) {
+        try {
+            results.push(mysql.queryResult(p.handle));
+        }
+        catch (e) {
+            results.push(false);
+            error = error || new SQLException(e, p.query);
+        }
+    });
+    if (error) {
+        throw error;
+    }
+    return results;
+};
+
 if (exports) {
     exports.MySQL = MySQL;
 }
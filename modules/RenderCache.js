@@ -0,0 +1,256 @@
+/**
+ * @class RenderCache
+ *
+ * ### Synopsis
+ *
+ * var RenderCache = require('RenderCache');
+ *
+ * ### Description
+ *
+ * Cache for dynamically rendered images (gd, cairo, Canvas) served by the HTTP server.
+ *
+ * Each rendering is identified by a key, an MD5 hash of its source files (their paths, sizes and modification times), the operations applied to them, and the output format.  The same key always means the same bytes, so:
+ *
+ * + the rendered image is written once, to a file named after the key, and later requests are served from that file with net.sendFile().
+ * + the key is sent as the ETag, so a browser revalidating its copy gets a 304 Not Modified without anything being rendered or read.
+ *
+ * Which keys have been rendered is kept in a shared memory cache (see ShmCache) shared by all the HttpChild processes, so an image rendered by one child is served from disk by all the others.  When the index is full, the least recently used keys are evicted; their files are rendered again if they are requested, and removed by prune().
+ *
+ * ### Notes
+ *
+ * The HTTP server creates the cache as global.renderCache, before forking, if Config.renderCache is set:
+ *
+ * ```
+ * Config.renderCache = {
+ *     dir: '/var/cache/myapp/render'
+ * };
+ * ```
+ *
+ * Then, in a request:
+ *
+ * ```
+ * var path = 'images/' + req.data.name,
+ *     width = parseInt(req.data.width, 10),
+ *     key = renderCache.key(path, [ 'thumbnail', width ], 'jpeg');
+ *
+ * renderCache.serve(key, 'image/jpeg', function(buf) {
+ *     Image.thumbnail(path, { width: width, buffer: buf });
+ * });
+ * ```
+ */
+/*global require, exports: true, req, res */
+
+(function() {
+    "use strict";
+    var fs = require('builtin/fs'),
+        net = require('builtin/net'),
+        buffer = require('builtin/buffer'),
+        process = require('builtin/process'),
+        ShmCache = require('ShmCache'),
+        Util = require('Util');
+
+    /**
+     * @constructor RenderCache
+     *
+     * ### Synopsis
+     *
+     * var renderCache = new RenderCache(options);
+     *
+     * Create a render cache.  This must be done before calling process.fork() if the child processes are to share it.
+     *
+     * The options are:
+     *
+     * + dir: directory for the rendered files (default '/tmp/silkjs-render'); it is created if necessary.
+     * + size: size of the shared memory index, in bytes (default 4MB).
+     * + maxEntries: maximum number of keys in the index (default one per 512 bytes of size).
+     * + maxAge: seconds browsers may use their copy without revalidating it (default 3600).
+     *
+     * @param {object} options - see above.
+     * @returns {object} renderCache - instance of RenderCache class.
+     */
+    var RenderCache = function(options) {
+        options = options || {};
+        this.dir = options.dir || '/tmp/silkjs-render';
+        this.maxAge = options.maxAge === undefined ? 3600 : options.maxAge;
+        this.index = new ShmCache(options.size || 4 * 1024 * 1024, options.maxEntries);
+        this.hits = this.misses = this.notModified = 0;
+    };
+    RenderCache.prototype.extend({
+        /**
+         * @function renderCache.key
+         *
+         * ### Synopsis
+         *
+         * var key = renderCache.key(sources, operations, format);
+         *
+         * Compute the key for a rendering.
+         *
+         * Changing a source file changes its modification time, and so the key; the old rendering is no longer used.
+         *
+         * @param {mixed} sources - path of the source file, an array of paths, or null for images rendered from nothing but the operations (e.g. charts).
+         * @param {mixed} operations - the operations and their parameters; any value that can be stored as JSON.
+         * @param {string} format - output format, e.g. 'png'.
+         * @returns {string} key - MD5 hash, as 32 hex digits.
+         */
+        key: function(sources, operations, format) {
+            var files = [];
+            if (sources) {
+                if (typeof sources === 'string') {
+                    sources = [ sources ];
+                }
+                sources.each(function(path) {
+                    files.push(fs.exists(path) ? [ path, fs.fileSize(path), fs.fileModified(path) ] : [ path ]);
+                });
+            }
+            return Util.md5(JSON.stringify([ files, operations, format ]));
+        },
+
+        /**
+         * @function renderCache.path
+         *
+         * ### Synopsis
+         *
+         * var path = renderCache.path(key);
+         *
+         * Get the path of the file a rendering is stored in.
+         *
+         * @param {string} key - key from renderCache.key().
+         * @returns {string} path - path of the file.
+         */
+        path: function(key) {
+            return this.dir + '/' + key;
+        },
+
+        /**
+         * @function renderCache.serve
+         *
+         * ### Synopsis
+         *
+         * renderCache.serve(key, contentType, render);
+         *
+         * Send the response for a rendering, and end the request (see res.stop()).
+         *
+         * + If the request's If-None-Match header is the key's ETag, a 304 Not Modified response is sent.
+         * + If the rendering is cached, the file is sent with net.sendFile().
+         * + Otherwise, render(buf) is called to encode the image into the response body (e.g. with gd.imagePngBuffer(), canvas.toBuffer() or Image.thumbnail()), which is stored in the cache, then sent.
+         *
+         * @param {string} key - key from renderCache.key().
+         * @param {string} contentType - MIME type of the image, e.g. 'image/png'.
+         * @param {function} render - function(buf) that appends the encoded image to buf.
+         */
+        serve: function(key, contentType, render) {
+            var etag = '"' + key + '"',
+                path = this.path(key);
+
+            res.contentType = contentType;
+            res.headers.ETag = etag;
+            res.headers['Cache-Control'] = 'public, max-age=' + this.maxAge;
+            if (req.headers['if-none-match'] === etag) {
+                this.notModified++;
+                res.status = 304;
+                res.stop();
+            }
+            if (this.index.get(key) && fs.exists(path)) {
+                this.hits++;
+                res.sendFile(path);
+                res.stop();
+            }
+            this.misses++;
+            res.reset();
+            var buf = res.getBuffer();
+            render(buf);
+            this.store(key, buf);
+            res.stop();
+        },
+
+        /**
+         * @function renderCache.store
+         *
+         * ### Synopsis
+         *
+         * renderCache.store(key, buf);
+         *
+         * Store a rendering.  The file is written under a temporary name and renamed, so other processes never send a partly written file.
+         *
+         * @param {string} key - key from renderCache.key().
+         * @param {object} buf - buffer (see builtin/buffer) containing the encoded image.
+         */
+        store: function(key, buf) {
+            var path = this.path(key),
+                tmp = path + '.' + process.getpid(),
+                written = -1,
+                fd;
+
+            if (!fs.isDir(this.dir)) {
+                fs.mkdir(this.dir, parseInt('0755', 8));
+            }
+            fd = fs.open(tmp, fs.O_WRONLY | fs.O_CREAT | fs.O_TRUNC, parseInt('0644', 8));
+            if (fd < 0) {
+                return;
+            }
+            try {
+                written = net.writeBuffer(fd, buf);
+            }
+            catch (e) {
+                // disk full, etc.: the rendering is served, just not cached
+            }
+            finally {
+                fs.close(fd);
+            }
+            // fs.rename() returns 0 on success, like rename(2)
+            if (written === buffer.size(buf) && fs.rename(tmp, path) === 0) {
+                this.index.set(key, { created: new Date().getTime() });
+            }
+            else {
+                fs.unlink(tmp);
+            }
+        },
+
+        /**
+         * @function renderCache.prune
+         *
+         * ### Synopsis
+         *
+         * var removed = renderCache.prune();
+         *
+         * Remove the files of renderings that are no longer in the index.
+         *
+         * @returns {int} removed - number of files removed.
+         */
+        prune: function() {
+            var me = this,
+                removed = 0;
+            if (!fs.isDir(this.dir)) {
+                return 0;
+            }
+            fs.readDir(this.dir).each(function(name) {
+                if (!me.index.get(name.split('.')[0]) && fs.unlink(me.dir + '/' + name)) {
+                    removed++;
+                }
+            });
+            return removed;
+        },
+
+        /**
+         * @function renderCache.stats
+         *
+         * ### Synopsis
+         *
+         * var stats = renderCache.stats();
+         *
+         * Get the hits, misses and 304 responses of this process, and the index's statistics (see cache.stats()).
+         *
+         * @returns {object} stats - statistics.
+         */
+        stats: function() {
+            return {
+                hits: this.hits,
+                misses: this.misses,
+                notModified: this.notModified,
+                index: this.index.stats()
+            };
+        }
+    });
+
+    exports = RenderCache;
+}());
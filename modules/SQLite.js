@@ -0,0 +1,350 @@
+/**
+ * @class SQLite
+ *
+ * ### Synopsis
+ *
+ * SQLite interface built on top of the builtin/sqlite3 module.
+ *
+ * ### Description
+ *
+ * A SQLite instance represents an open database file.  Statements are prepared once and cached by their SQL text, so repeated queries only bind parameters and step the statement.  Values are passed as bound parameters rather than being quoted into the SQL.
+ *
+ * Rows are returned as objects keyed by column name.  INTEGER and FLOAT columns are numbers, TEXT columns strings, NULL columns null and BLOB columns base64 encoded strings.
+ *
+ * ### Usage
+ *
+ * var SQLite = require('SQLite').SQLite;
+ *
+ * ### Example
+ *
+ * ```
+ * var db = new SQLite('/tmp/config.db');
+ * db.exec('CREATE TABLE IF NOT EXISTS config (name TEXT PRIMARY KEY, value TEXT)');
+ * db.run('REPLACE INTO config VALUES (?, ?)', [ 'theme', 'dark' ]);
+ * console.dir(db.get('SELECT * FROM config WHERE name=:name', { name: 'theme' }));
+ * db.close();
+ * ```
+ *
+ * ### See Also
+ *
+ * builtin/sqlite3
+ */
+var sqlite3 = require('builtin/sqlite3');
+
+/**
+ * @constructor Statement
+ *
+ * ### Synopsis
+ *
+ * var stmt = db.prepare(sql);
+ *
+ * A prepared statement.  Statements are created by db.prepare(), not directly.
+ *
+ * In the methods below, params is optional.  It is either an array of values for positional (?) parameters, or an object whose keys name :name, @name or $name parameters.  Parameters bound by a previous call are cleared first.
+ */
+function Statement(db, sql) {
+    this.db = db;
+    this.sql = sql;
+    this.stmt = sqlite3.prepare_v2(db.handle, sql);
+    if (typeof this.stmt === 'string') {
+        throw new SQLException(this.stmt, sql);
+    }
+}
+
+Statement.prototype.extend({
+    /**
+     * @function stmt.bind
+     *
+     * ### Synopsis
+     *
+     * stmt.bind(params);
+     *
+     * Bind parameters to the statement.
+     *
+     * @param {array|object} params - parameters to bind.
+     */
+    bind: function(params) {
+        sqlite3.clear_bindings(this.stmt);
+        if (params !== undefined) {
+            if (sqlite3.bind(this.stmt, params) !== sqlite3.OK) {
+                throw new SQLException(sqlite3.errmsg(this.db.handle), this.sql);
+            }
+        }
+        return this;
+    },
+
+    /**
+     * @function stmt.all
+     *
+     * ### Synopsis
+     *
+     * var rows = stmt.all(params);
+     *
+     * Execute the statement and return all the resulting rows.
+     *
+     * @param {array|object} params - parameters to bind.
+     * @returns {array} rows - array (possibly empty) of rows.
+     */
+    all: function(params) {
+        this.bind(params);
+        try {
+            return sqlite3.all(this.stmt);
+        }
+        catch (e) {
+            throw new SQLException(e.message, this.sql);
+        }
+    },
+
+    /**
+     * @function stmt.each
+     *
+     * ### Synopsis
+     *
+     * var count = stmt.each(params, fn);
+     * var count = stmt.each(fn);
+     *
+     * Execute the statement and call fn(row) for each resulting row.  If fn returns false, no more rows are fetched.
+     *
+     * @param {array|object} params - parameters to bind.
+     * @param {function} fn - function to call for each row.
+     * @returns {int} count - number of rows passed to fn.
+     */
+    each: function(params, fn) {
+        if (typeof params === 'function') {
+            fn = params;
+            params = undefined;
+        }
+        this.bind(params);
+        return sqlite3.each(this.stmt, fn);
+    },
+
+    /**
+     * @function stmt.get
+     *
+     * ### Synopsis
+     *
+     * var row = stmt.get(params);
+     *
+     * Execute the statement and return the first resulting row.
+     *
+     * @param {array|object} params - parameters to bind.
+     * @returns {object|false} row - the first row, or false if there are none.
+     */
+    get: function(params) {
+        var ret = false;
+        this.each(params, function(row) {
+            ret = row;
+            return false;
+        });
+        return ret;
+    },
+
+    /**
+     * @function stmt.run
+     *
+     * ### Synopsis
+     *
+     * var info = stmt.run(params);
+     *
+     * Execute a statement that returns no rows (INSERT, UPDATE, etc.).
+     *
+     * @param {array|object} params - parameters to bind.
+     * @returns {object} info - object with changes (number of rows changed) and lastInsertId members.
+     */
+    run: function(params) {
+        this.bind(params);
+        var rc = sqlite3.step(this.stmt);
+        sqlite3.reset(this.stmt);
+        if (rc !== sqlite3.DONE && rc !== sqlite3.ROW) {
+            throw new SQLException(sqlite3.errmsg(this.db.handle), this.sql);
+        }
+        return {
+            changes: sqlite3.changes(this.db.handle),
+            lastInsertId: sqlite3.last_insert_rowid(this.db.handle)
+        };
+    },
+
+    /**
+     * @function stmt.finalize
+     *
+     * ### Synopsis
+     *
+     * stmt.finalize();
+     *
+     * Free the statement and remove it from the database's statement cache.
+     */
+    finalize: function() {
+        if (this.stmt) {
+            sqlite3.finalize(this.stmt);
+            delete this.db.statements[this.sql];
+            this.stmt = null;
+        }
+    }
+});
+
+/**
+ * @constructor SQLite
+ *
+ * ### Synopsis
+ *
+ * var db = new SQLite(filename);
+ * var db = new SQLite(filename, flags);
+ *
+ * Open a database file.
+ *
+ * @param {string} filename - path to the database file.
+ * @param {int|object} flags - optional sqlite3.OPEN_* flags, defaults to read/write, creating the file if necessary.  If an object, the database is opened with SQLite.openShared() options.
+ */
+function SQLite(filename, flags) {
+    if (flags !== null && typeof flags === 'object') {
+        this.handle = sqlite3.openShared(filename, flags);
+    }
+    else {
+        this.handle = flags === undefined ? sqlite3.open(filename) : sqlite3.open_v2(filename, flags);
+    }
+    if (typeof this.handle === 'string') {
+        throw new SQLException(this.handle, filename);
+    }
+    this.statements = {};
+}
+
+SQLite.prototype.extend({
+    /**
+     * @function db.prepare
+     *
+     * ### Synopsis
+     *
+     * var stmt = db.prepare(sql);
+     *
+     * Get a prepared statement for the given SQL.  Statements are cached, so preparing the same SQL again returns the same statement.
+     *
+     * @param {string|array} sql - the SQL; an array is joined with newlines.
+     * @returns {Statement} stmt - the prepared statement.
+     */
+    prepare: function(sql) {
+        sql = Array.isArray(sql) ? sql.join('\n') : sql;
+        return this.statements[sql] || (this.statements[sql] = new Statement(this, sql));
+    },
+
+    /**
+     * @function db.exec
+     *
+     * ### Synopsis
+     *
+     * db.exec(sql);
+     *
+     * Execute one or more SQL statements that take no parameters and return no rows.
+     *
+     * @param {string|array} sql - the SQL; an array is joined with newlines.
+     */
+    exec: function(sql) {
+        sql = Array.isArray(sql) ? sql.join('\n') : sql;
+        if (sqlite3.exec(this.handle, sql) !== sqlite3.OK) {
+            throw new SQLException(sqlite3.errmsg(this.handle), sql);
+        }
+    },
+
+    /**
+     * @function db.all
+     *
+     * ### Synopsis
+     *
+     * var rows = db.all(sql, params);
+     *
+     * Shorthand for db.prepare(sql).all(params).
+     */
+    all: function(sql, params) {
+        return this.prepare(sql).all(params);
+    },
+
+    /**
+     * @function db.each
+     *
+     * ### Synopsis
+     *
+     * var count = db.each(sql, params, fn);
+     *
+     * Shorthand for db.prepare(sql).each(params, fn).
+     */
+    each: function(sql, params, fn) {
+        return this.prepare(sql).each(params, fn);
+    },
+
+    /**
+     * @function db.get
+     *
+     * ### Synopsis
+     *
+     * var row = db.get(sql, params);
+     *
+     * Shorthand for db.prepare(sql).get(params).
+     */
+    get: function(sql, params) {
+        return this.prepare(sql).get(params);
+    },
+
+    /**
+     * @function db.run
+     *
+     * ### Synopsis
+     *
+     * var info = db.run(sql, params);
+     *
+     * Shorthand for db.prepare(sql).run(params).
+     */
+    run: function(sql, params) {
+        return this.prepare(sql).run(params);
+    },
+
+    /**
+     * @function db.close
+     *
+     * ### Synopsis
+     *
+     * db.close();
+     *
+     * Finalize all cached statements and close the database.
+     */
+    close: function() {
+        var statements = this.statements;
+        statements.each(function(stmt) {
+            stmt.finalize();
+        });
+        sqlite3.close(this.handle);
+        this.handle = null;
+    }
+});
+
+/**
+ * @function SQLite.openShared
+ *
+ * ### Synopsis
+ *
+ * var db = SQLite.openShared(filename);
+ * var db = SQLite.openShared(filename, options);
+ *
+ * Open a database that is shared by several processes, such as the HttpChild processes, e.g. as a session or cache store.
+ *
+ * ### Description
+ *
+ * The database is put in WAL mode, so readers don't block the writer, and is memory mapped.  A busy handler retries with exponential backoff when another process holds the write lock, instead of failing with SQLITE_BUSY.  Statements are cached per process, as for any SQLite instance.
+ *
+ * Each process must open the database itself, after it is forked; a handle must not be shared across fork().  In the HTTP server, HttpChild.onStart is a good place to do this.
+ *
+ * The options are:
+ *
+ * + wal: use WAL journal mode (default true).
+ * + mmapSize: number of bytes of the database to memory map (default 64MB, 0 disables).
+ * + synchronous: 'OFF', 'NORMAL' (default) or 'FULL'.  NORMAL is safe in WAL mode, but the last transactions may be lost on power failure.
+ * + busyTimeout: milliseconds to keep retrying a locked database before failing (default 5000).
+ * + cacheSize: page cache size, as for PRAGMA cache_size.
+ *
+ * @param {string} filename - path to the database file.
+ * @param {object} options - optional tuning options.
+ * @returns {SQLite} db - the opened database.
+ */
+SQLite.openShared = function(filename, options) {
+    return new SQLite(filename, options || {});
+};
+
+exports.SQLite = SQLite;
@@ -116,18 +116,15 @@
 
         /**
          * @private
-         * Query a Schema for a row or rows by example
+         * Build the SELECT query for a find by example
          *
-         * @param {object} name name of Schema OR a Schema object
+         * @param {object} schema Schema object
          * @param {object} example example to query
-         * @param {boolean} single true to return a single row, otherwise all matching rows
-         * @returns {object} A single row matching example, or all matching rows
+         * @returns {array} query lines
          */
-        function find(name, example, single) {
-            var schema = getSchema(name);
-            name = schema.name;
-            example = example || {};
-            var where = Schema.where(name, example);
+        function findQuery(schema, example) {
+            var name = schema.name;
+            var where = Schema.where(name, example || {});
             var query = [
                 'SELECT',
                 '       *',
@@ -138,6 +135,21 @@
                 query.push('WHERE');
                 query.push(where.join(' AND '));
             }
+            return query;
+        }
+
+        /**
+         * @private
+         * Query a Schema for a row or rows by example
+         *
+         * @param {object} name name of Schema OR a Schema object
+         * @param {object} example example to query
+         * @param {boolean} single true to return a single row, otherwise all matching rows
+         * @returns {object} A single row matching example, or all matching rows
+         */
+        function find(name, example, single) {
+            var schema = getSchema(name);
+            var query = findQuery(schema, example);
             if (single) {
                 var ret = SQL.getDataRow(query);
                 return empty(ret) ? false : Schema.onLoad(schema, ret);
@@ -450,6 +462,30 @@
                 return find(name, example, true);
             },
 
+            /**
+             * <p>Query several schemas for a single record each, in one round trip
+             * to the database.</p>
+             *
+             * <p>Use this in place of a series of independent findOne() calls.</p>
+             *
+             * @param {array} requests array of [name, example] pairs
+             * @returns {array} a single row (or false) for each request, in order
+             */
+            findOneBatch: function(requests) {
+                var schemas = [],
+                    queries = [];
+                requests.each(function(request) {
+                    var schema = getSchema(request[0]);
+                    schemas.push(schema);
+                    queries.push(findQuery(schema, request[1]).concat(['LIMIT 1']));
+                });
+                var ret = [];
+                SQL.batch(queries).each(function(rows, ndx) {
+                    ret.push(rows.length ? Schema.onLoad(schemas[ndx], rows[0]) : false);
+                });
+                return ret;
+            },
+
             /**
              * <p>Get a list for ExtJS grid</p>
              *
@@ -0,0 +1,308 @@
+/**
+ * @class Session
+ *
+ * ### Synopsis
+ *
+ * var Session = require('Session');
+ *
+ * ### Description
+ *
+ * Session store for the HTTP server.  Session data is kept in a shared memory cache (see ShmCache) shared by all the HttpChild processes, so loading and saving a session involves no network round trip.  When the cache is full, the least recently used sessions are evicted.
+ *
+ * The session ID is a random 128 bit value, sent to the browser in an HMAC signed cookie; cookies with a missing or wrong signature are ignored.
+ *
+ * Sessions are loaded lazily, the first time req.session is used in a request, and saved at the end of the request only if they were modified (or are half way to expiring).  A new session's cookie is only sent once something is stored in it.
+ *
+ * Optionally, sessions are also written to a SQLite or Berkeley DB database after the response has been sent (write-behind), so they survive eviction from the cache and server restarts.
+ *
+ * ### Notes
+ *
+ * The HTTP server creates the store as global.sessions, before forking, if Config.session is set:
+ *
+ * ```
+ * Config.session = {
+ *     secret: 'a long random string',
+ *     ttl: 3600,
+ *     store: { sqlite: '/var/lib/myapp/sessions.db' }
+ * };
+ * ```
+ *
+ * Then, in a request:
+ *
+ * ```
+ * req.session.user = user.id;
+ * ```
+ */
+/*global require, exports: true, error, res */
+
+(function() {
+    "use strict";
+    var session = require('builtin/session'),
+        ShmCache = require('ShmCache');
+
+    function now() {
+        return new Date().getTime();
+    }
+
+    /**
+     * @constructor Session
+     *
+     * ### Synopsis
+     *
+     * var sessions = new Session(options);
+     *
+     * Create a session store.  This must be done before calling process.fork() if the child processes are to share it.
+     *
+     * The options are:
+     *
+     * + secret: key used to sign the session cookies (required).
+     * + cookie: name of the session cookie (default 'sid').
+     * + path: path of the session cookie (default '/').
+     * + domain: domain of the session cookie.
+     * + secure: send the session cookie only over https (default false).  The cookie is always HttpOnly.
+     * + ttl: seconds a session lives after it was last saved (default 3600).
+     * + size: size of the shared memory cache, in bytes (default 16MB).
+     * + maxEntries: maximum number of sessions in the cache.
+     * + store: persistent store, { sqlite: filename }, { bdb: directory } or an object with get(id), put(id, json, expires) and remove(id) methods.
+     *
+     * @param {object} options - the options.
+     * @returns {object} sessions - instance of Session class.
+     */
+    var Session = function(options) {
+        if (!options || !options.secret) {
+            error('Session: a secret is required');
+        }
+        this.secret = options.secret;
+        this.cookie = options.cookie || 'sid';
+        this.path = options.path || '/';
+        this.domain = options.domain;
+        this.secure = !!options.secure;
+        this.ttl = options.ttl || 3600;
+        this.cache = new ShmCache(options.size || 16 * 1024 * 1024, options.maxEntries);
+        this.storeOptions = options.store || null;
+        this.store = null;
+        this.pending = {};
+        this.req = null;
+        this.id = null;
+    };
+
+    Session.prototype.extend({
+        /**
+         * @function sessions.attach
+         *
+         * ### Synopsis
+         *
+         * sessions.attach(req);
+         *
+         * Make req.session load the session for the request when it is first used.  Called by HttpChild after the request is read.
+         *
+         * @param {object} req - the request.
+         */
+        attach: function(req) {
+            var me = this;
+            me.req = req;
+            me.id = null;
+            Object.defineProperty(req, 'session', {
+                configurable: true,
+                enumerable: true,
+                get: function() {
+                    return me.load();
+                },
+                set: function(value) {
+                    me.load();
+                    req.session = value;
+                }
+            });
+        },
+
+        /**
+         * @function sessions.load
+         *
+         * ### Synopsis
+         *
+         * var data = sessions.load();
+         *
+         * Load the session for the current request, or start a new one, and replace the lazy req.session with its data.
+         *
+         * @returns {object} data - the session data.
+         */
+        load: function() {
+            var req = this.req,
+                cookie = req.cookies[this.cookie],
+                id = cookie ? session.verify(this.secret, cookie) : null,
+                entry;
+
+            if (id) {
+                entry = this.cache.get(id);
+                if (entry === undefined) {
+                    entry = this.fetch(id);
+                }
+            }
+            if (entry) {
+                this.isNew = false;
+            }
+            else {
+                id = session.id();
+                entry = { data: {}, saved: 0 };
+                this.isNew = true;
+            }
+            this.id = id;
+            this.saved = entry.saved;
+            this.snapshot = JSON.stringify(entry.data);
+            Object.defineProperty(req, 'session', {
+                configurable: true,
+                enumerable: true,
+                writable: true,
+                value: entry.data
+            });
+            return entry.data;
+        },
+
+        /**
+         * @function sessions.save
+         *
+         * ### Synopsis
+         *
+         * sessions.save();
+         *
+         * Save the current request's session to the shared memory cache, if it was used and has been modified, and queue it for the persistent store.  Called by HttpChild at the end of the request, before the response is sent.
+         */
+        save: function() {
+            if (this.id === null) {
+                return;
+            }
+            var id = this.id,
+                data = this.req.session,
+                json = JSON.stringify(data),
+                t = now();
+
+            this.id = null;
+            if (json === this.snapshot && (this.isNew || t - this.saved < this.ttl * 500)) {
+                return;
+            }
+            var entry = { data: data, saved: t };
+            this.cache.set(id, entry, this.ttl);
+            if (this.storeOptions) {
+                this.pending[id] = entry;
+            }
+            if (this.isNew && !res.headersSent) {
+                res.setCookie(this.cookie, session.sign(this.secret, id), undefined, this.path, this.domain, { httpOnly: true, secure: this.secure });
+            }
+        },
+
+        /**
+         * @function sessions.persist
+         *
+         * ### Synopsis
+         *
+         * sessions.persist();
+         *
+         * Write the sessions saved since the last call to the persistent store, if there is one.  Called by HttpChild after the response has been sent.
+         */
+        persist: function() {
+            var me = this,
+                pending = me.pending;
+
+            me.pending = {};
+            pending.each(function(entry, id) {
+                me.openStore().put(id, JSON.stringify(entry), Math.floor(entry.saved / 1000) + me.ttl);
+            });
+        },
+
+        /**
+         * @function sessions.destroy
+         *
+         * ### Synopsis
+         *
+         * sessions.destroy();
+         *
+         * Delete the current request's session (e.g. on logout) and its cookie.  req.session is an empty object for the rest of the request and is not saved.
+         */
+        destroy: function() {
+            var req = this.req,
+                cookie = req.cookies[this.cookie],
+                id = cookie ? session.verify(this.secret, cookie) : null;
+
+            if (id) {
+                this.cache.remove(id);
+                delete this.pending[id];
+                if (this.storeOptions) {
+                    this.openStore().remove(id);
+                }
+            }
+            res.unsetCookie(this.cookie, this.path, this.domain);
+            this.id = null;
+            Object.defineProperty(req, 'session', {
+                configurable: true,
+                enumerable: true,
+                writable: true,
+                value: {}
+            });
+        },
+
+        fetch: function(id) {
+            if (!this.storeOptions) {
+                return undefined;
+            }
+            var json = this.openStore().get(id);
+            if (!json) {
+                return undefined;
+            }
+            var entry = JSON.parse(json);
+            if (entry.saved + this.ttl * 1000 < now()) {
+                return undefined;
+            }
+            this.cache.set(id, entry, this.ttl);
+            return entry;
+        },
+
+        openStore: function() {
+            if (this.store) {
+                return this.store;
+            }
+            // opened on first use, in the child process
+            var options = this.storeOptions,
+                db;
+            if (options.sqlite) {
+                db = require('SQLite').SQLite.openShared(options.sqlite);
+                db.exec('CREATE TABLE IF NOT EXISTS sessions (id TEXT PRIMARY KEY, data TEXT NOT NULL, expires INTEGER NOT NULL)');
+                this.store = {
+                    get: function(id) {
+                        var row = db.get('SELECT data FROM sessions WHERE id = ?', [ id ]);
+                        return row ? row.data : null;
+                    },
+                    put: function(id, json, expires) {
+                        db.run('INSERT OR REPLACE INTO sessions (id, data, expires) VALUES (?, ?, ?)', [ id, json, expires ]);
+                        if (Math.random() < 0.001) {
+                            db.run('DELETE FROM sessions WHERE expires < ?', [ Math.floor(now() / 1000) ]);
+                        }
+                    },
+                    remove: function(id) {
+                        db.run('DELETE FROM sessions WHERE id = ?', [ id ]);
+                    }
+                };
+            }
+            else if (options.bdb) {
+                var env = new (require('BDB').Environment)(options.bdb, { transactions: false });
+                db = env.open('sessions.db', { type: 'hash' });
+                this.store = {
+                    get: function(id) {
+                        return db.get(id);
+                    },
+                    put: function(id, json) {
+                        db.put(id, json);
+                    },
+                    remove: function(id) {
+                        db.remove(id);
+                    }
+                };
+            }
+            else {
+                this.store = options;
+            }
+            return this.store;
+        }
+    });
+
+    exports = Session;
+}());
@@ -0,0 +1,134 @@
+/**
+ * @class ShmCache
+ *
+ * ### Synopsis
+ *
+ * var ShmCache = require('ShmCache');
+ *
+ * ### Description
+ *
+ * JavaScript wrapper around the builtin/shmcache module: a bounded cache in shared memory, shared by all the processes forked after it is created.
+ *
+ * ### Notes
+ *
+ * A ShmCache must be created before calling process.fork() if the child processes are to share it.  The HTTP server creates one as global.shmcache if Config.shmcache is set.
+ *
+ * ### Example
+ * ```
+ * var cache = new ShmCache(64 * 1024 * 1024);
+ * cache.set('config', { theme: 'dark' }, 60);
+ * console.dir(cache.get('config'));
+ * ```
+ */
+/*global require, exports: true */
+
+(function() {
+    "use strict";
+    var shmcache = require('builtin/shmcache');
+    /**
+     * @constructor ShmCache
+     *
+     * ### Synopsis
+     *
+     * var cache = new ShmCache(size);
+     * var cache = new ShmCache(size, maxEntries);
+     *
+     * Create a shared memory cache.
+     *
+     * @param {int} size - size of the shared memory block, in bytes.
+     * @param {int} maxEntries - maximum number of entries (default one per 512 bytes of size).
+     * @returns {object} cache - instance of ShmCache class.
+     */
+    var ShmCache = function(size, maxEntries) {
+        this.handle = shmcache.init(size, maxEntries);
+    };
+    ShmCache.prototype.extend({
+        /**
+         * @function cache.get
+         *
+         * ### Synopsis
+         *
+         * var value = cache.get(key);
+         *
+         * Get a value from the cache.
+         *
+         * @param {string} key - key of the value.
+         * @returns {mixed} value - the value, or undefined if the key is not in the cache or has expired.
+         */
+        get: function(key) {
+            return shmcache.get(this.handle, key);
+        },
+        /**
+         * @function cache.set
+         *
+         * ### Synopsis
+         *
+         * var success = cache.set(key, value);
+         * var success = cache.set(key, value, ttl);
+         *
+         * Store a value in the cache, evicting other entries if necessary.
+         *
+         * @param {string} key - key of the value.
+         * @param {mixed} value - value to store.
+         * @param {int} ttl - time to live, in seconds; 0 or omitted for no expiration.
+         * @returns {boolean} success - false if the value is too large for the cache.
+         */
+        set: function(key, value, ttl) {
+            return shmcache.set(this.handle, key, value, ttl || 0);
+        },
+        /**
+         * @function cache.remove
+         *
+         * ### Synopsis
+         *
+         * cache.remove(key);
+         *
+         * Remove a value from the cache.
+         *
+         * @param {string} key - key of the value.
+         * @returns {boolean} removed - true if the key was in the cache.
+         */
+        remove: function(key) {
+            return shmcache.remove(this.handle, key);
+        },
+        /**
+         * @function cache.clear
+         *
+         * ### Synopsis
+         *
+         * cache.clear();
+         *
+         * Remove all the entries from the cache.
+         */
+        clear: function() {
+            shmcache.clear(this.handle);
+        },
+        /**
+         * @function cache.stats
+         *
+         * ### Synopsis
+         *
+         * var stats = cache.stats();
+         *
+         * Get the number of entries, hits, misses, evictions and available memory of the cache.  See shmcache.stats().
+         *
+         * @returns {object} stats - the statistics.
+         */
+        stats: function() {
+            return shmcache.stats(this.handle);
+        },
+        /**
+         * @function cache.destroy
+         *
+         * ### Synopsis
+         *
+         * cache.destroy();
+         *
+         * Free the shared memory used by the cache.
+         */
+        destroy: function() {
+            shmcache.destroy(this.handle);
+        }
+    });
+    exports = ShmCache;
+}());
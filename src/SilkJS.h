@@ -54,6 +54,13 @@ extern string Base64Encode(unsigned char const* bytes_to_encode, unsigned long i
 extern string Base64Decode(const char *encodedString);
 extern int decode_base64(unsigned char *dest, const char *src);
 
+// pack.cpp
+enum { PACK_ZLIB = 1, PACK_LZ4 = 2 };
+extern bool PackValue(string &out, Handle<Value>v);
+extern Handle<Value>UnpackValue(const unsigned char *data, size_t len);
+extern int PackCompress(string &out, const char *data, size_t len, int method);
+extern bool PackDecompress(string &out, const char *data, size_t len, int method);
+
 extern Persistent<ObjectTemplate> globalObject;
 extern Persistent<ObjectTemplate> builtinObject;
 
@@ -74,22 +81,44 @@ static inline void *JSEXTERN(Handle<Value>v) {
 }
 
 
+/*
+ * Native resources are handed to JavaScript as opaque handles: objects with
+ * the C++ pointer in internal field 0.  All the handles of an OpaqueType are
+ * made from one cached ObjectTemplate, so they share a hidden class.  Owned
+ * handles are weak, and counted per type; if the type has a finalizer, the
+ * resource is freed when the handle is garbage collected, unless the
+ * JavaScript code freed it first (the destroy function must then call
+ * Opaque::Clear).  The size given to Opaque::New is reported to V8 as
+ * external memory, so large native objects make the collector run sooner.
+ * See opaque.cpp.
+ */
+class OpaqueType {
+public:
+    const char *name;
+    void (*finalize)(void *p);
+    Persistent<ObjectTemplate>tmpl;
+    // owned handles not yet freed, ever created, and their external memory
+    long live;
+    long created;
+    long bytes;
+    OpaqueType *next;
+    static OpaqueType *first;
+public:
+    OpaqueType(const char *aName, void (*aFinalize)(void *p) = NULL) : name(aName), finalize(aFinalize), live(0), created(0), bytes(0) {
+        next = first;
+        first = this;
+    }
+};
+
 class Opaque {
 public:
-    static Handle<Object>New(void *p) {
-#if 1
-        Handle<ObjectTemplate>t = ObjectTemplate::New();
-        t->SetInternalFieldCount(1);
-        Local<Object>o = t->NewInstance();
-        o->SetPointerInInternalField(0, p);
-        return o;
-#else        
-        Handle<ObjectTemplate>t = ObjectTemplate::New();
-        t->SetInternalFieldCount(1);
-        Local<Object>o = t->NewInstance();
-        o->SetInternalField(0, External::New(p));
-        return o;
-#endif
+    static Handle<Object>New(void *p);
+    static Handle<Object>New(void *p, OpaqueType &type, bool owned = true, long size = 0);
+    static void Resize(Handle<Value>v, long size);
+    static void Clear(Handle<Value>v);
+    static OpaqueType *TypeOf(Handle<Value>v);
+    static bool Is(Handle<Value>v, OpaqueType &type) {
+        return TypeOf(v) == &type;
     }
 };
 static inline void *JSOPAQUE(Handle<Value>v) {
@@ -125,6 +154,38 @@ public:
 } Buffer;
 #endif
 
+/*
+ * Bump allocator for temporaries of native functions, e.g. the bytes read
+ * by http.readPost(), so the HTTP path doesn't call malloc for them, and
+ * doesn't put request sized arrays on the stack.  Allocate within an
+ * Arena::Scope; everything allocated is released when the scope ends, and
+ * chunks added for large requests are freed by arena.reset(), which
+ * res.init calls at the start of each request.  Alloc, Grow and Utf8
+ * return NULL if the memory can't be had.  See arena.cpp.
+ */
+class Arena {
+public:
+    class Scope {
+        size_t chunk;
+        size_t used;
+    public:
+        Scope();
+        ~Scope();
+    };
+    static void *Alloc(size_t n);
+    static void *Grow(void *p, size_t oldSize, size_t newSize);
+    static char *Utf8(Handle<Value>v, long *len = NULL);
+    static void Reset();
+};
+
+// threadpool.cpp
+extern void ParallelFor(int n, int grain, void (*fn)(void *arg, int begin, int end), void *arg);
+
+// buffer.cpp
+extern OpaqueType bufferType;
+extern void BufferAppend(Buffer *buf, const char *data, long len);
+extern void BufferAccount(Handle<Value>handle, Buffer *buf);
+
 class InputStream {
 protected:
     unsigned char buffer[4096];
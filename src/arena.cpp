@@ -0,0 +1,191 @@
+/**
+ * @module builtin/arena
+ *
+ * ### Synopsis
+ * SilkJS builtin arena object.
+ *
+ * ### Description
+ * Native functions on the HTTP path (builtin/http, builtin/net, builtin/buffer) allocate their temporary memory from a per process bump allocator rather than with malloc or on the stack.  Memory is released when each native call returns; arena.reset() also frees the extra memory a large request needed.  The HTTP server calls it at the start of each request.
+ *
+ * ### Usage
+ * var arena = require('builtin/arena');
+ */
+#include "SilkJS.h"
+#include <vector>
+
+// the first chunk is kept for the life of the process
+#define ARENA_CHUNK (64 * 1024)
+#define ARENA_ALIGN 16
+
+struct ArenaChunk {
+    char *mem;
+    size_t size;
+    size_t used;
+};
+
+static vector<ArenaChunk>chunks;
+static size_t current = 0;
+static size_t peak = 0;
+static long resets = 0;
+
+static size_t allocated () {
+    size_t total = 0;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        total += chunks[i].size;
+    }
+    return total;
+}
+
+static inline size_t align (size_t n) {
+    return (n + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+}
+
+static bool addChunk (size_t at, size_t size) {
+    ArenaChunk c;
+    c.mem = (char *) malloc(size);
+    if (!c.mem) {
+        return false;
+    }
+    c.size = size;
+    c.used = 0;
+    chunks.insert(chunks.begin() + at, c);
+    size_t total = allocated();
+    if (total > peak) {
+        peak = total;
+    }
+    return true;
+}
+
+Arena::Scope::Scope () {
+    if (chunks.empty()) {
+        addChunk(0, ARENA_CHUNK);
+    }
+    chunk = current;
+    used = chunks.empty() ? 0 : chunks[current].used;
+}
+
+Arena::Scope::~Scope () {
+    if (chunks.empty()) {
+        return;
+    }
+    for (size_t i = chunk + 1; i <= current; i++) {
+        chunks[i].used = 0;
+    }
+    current = chunk;
+    chunks[current].used = used;
+}
+
+/*
+ * Returns NULL if the memory can't be had; the caller fails the native call.
+ */
+void *Arena::Alloc (size_t n) {
+    if (chunks.empty() && !addChunk(0, ARENA_CHUNK)) {
+        return NULL;
+    }
+    if (align(n) < n) {
+        return NULL;
+    }
+    n = align(n);
+    while (chunks[current].used + n > chunks[current].size) {
+        // chunks after the current one are empty, left by an earlier Scope
+        size_t next = current + 1;
+        if ((next == chunks.size() || chunks[next].size < n) && !addChunk(next, n > ARENA_CHUNK ? n : ARENA_CHUNK)) {
+            return NULL;
+        }
+        current = next;
+    }
+    ArenaChunk &c = chunks[current];
+    void *p = c.mem + c.used;
+    c.used += n;
+    return p;
+}
+
+/*
+ * Resize the most recent allocation in place if there is room, otherwise
+ * copy it to a new one.
+ */
+void *Arena::Grow (void *p, size_t oldSize, size_t newSize) {
+    ArenaChunk &c = chunks[current];
+    oldSize = align(oldSize);
+    if ((char *) p + oldSize == c.mem + c.used && c.used - oldSize + align(newSize) <= c.size) {
+        c.used = c.used - oldSize + align(newSize);
+        return p;
+    }
+    void *q = Alloc(newSize);
+    if (!q) {
+        return NULL;
+    }
+    memcpy(q, p, oldSize < newSize ? oldSize : newSize);
+    return q;
+}
+
+/*
+ * UTF-8 copy of a JavaScript value, like String::Utf8Value.
+ */
+char *Arena::Utf8 (Handle<Value>v, long *len) {
+    Handle<String>s = v->ToString();
+    int n = s->Utf8Length();
+    char *p = (char *) Alloc(n + 1);
+    if (!p) {
+        return NULL;
+    }
+    s->WriteUtf8(p, n + 1);
+    if (len) {
+        *len = n;
+    }
+    return p;
+}
+
+void Arena::Reset () {
+    for (size_t i = 1; i < chunks.size(); i++) {
+        free(chunks[i].mem);
+    }
+    if (!chunks.empty()) {
+        chunks.resize(1);
+        chunks[0].used = 0;
+    }
+    current = 0;
+    resets++;
+}
+
+/**
+ * @function arena.reset
+ *
+ * ### Synopsis
+ *
+ * arena.reset();
+ *
+ * Free the memory the arena grew to beyond its first chunk.  It must not be called from within a native function using the arena, so it is done between requests.
+ */
+static JSVAL arena_reset (JSARGS args) {
+    Arena::Reset();
+    return Undefined();
+}
+
+/**
+ * @function arena.stats
+ *
+ * ### Synopsis
+ *
+ * var stats = arena.stats();
+ *
+ * Get the arena's memory use.
+ *
+ * @return {object} stats - object with size (bytes allocated now), peak (the most bytes allocated at once) and resets (number of calls to arena.reset()) members.
+ */
+static JSVAL arena_stats (JSARGS args) {
+    HandleScope scope;
+    Handle<Object>o = Object::New();
+    o->Set(String::New("size"), Number::New(allocated()));
+    o->Set(String::New("peak"), Number::New(peak));
+    o->Set(String::New("resets"), Number::New(resets));
+    return scope.Close(o);
+}
+
+void init_arena_object () {
+    Handle<ObjectTemplate>arena = ObjectTemplate::New();
+    arena->Set(String::New("reset"), FunctionTemplate::New(arena_reset));
+    arena->Set(String::New("stats"), FunctionTemplate::New(arena_stats));
+
+    builtinObject->Set(String::New("arena"), arena);
+}
@@ -38,6 +38,9 @@ static JSVAL async_fd_isset(JSARGS args) {
     return FD_ISSET(fd, set) ? True() : False();
 }
 
+// errno of the last select() that failed, 0 if the last one didn't
+static int selectErrno = 0;
+
 static JSVAL async_select(JSARGS args) {
     fd_set  readfds,
             writefds,
@@ -68,7 +71,16 @@ static JSVAL async_select(JSARGS args) {
     else {
         FD_ZERO(&exceptfds);
     }
-    int ret = select(maxfd, &readfds, &writefds, &exceptfds, NULL);
+    // optional 5th argument is a timeout in milliseconds
+    struct timeval *tp = NULL;
+    if (args.Length() > 4 && !args[4]->IsNull() && !args[4]->IsUndefined()) {
+        long ms = args[4]->IntegerValue();
+        timeout.tv_sec = ms / 1000;
+        timeout.tv_usec = (ms % 1000) * 1000;
+        tp = &timeout;
+    }
+    int ret = select(maxfd, &readfds, &writefds, &exceptfds, tp);
+    selectErrno = ret < 0 ? errno : 0;
     switch (ret) {
         case 0:
             return False();
@@ -99,6 +111,12 @@ static JSVAL async_select(JSARGS args) {
     return o;
 }
 
+// select() returns false both when it times out and when it fails; this
+// tells them apart: 0 for a timeout, else the errno (e.g. async.EINTR)
+static JSVAL async_errno(JSARGS args) {
+    return Integer::New(selectErrno);
+}
+
 JSVAL async_write(JSARGS args) {
     int fd = args[0]->IntegerValue();
     String::AsciiValue s(args[1]);
@@ -141,6 +159,8 @@ void init_async_object () {
     async->Set(String::New("FD_CLR"), FunctionTemplate::New(async_fd_clr));
     async->Set(String::New("FD_ISSET"), FunctionTemplate::New(async_fd_isset));
     async->Set(String::New("select"), FunctionTemplate::New(async_select));
+    async->Set(String::New("errno"), FunctionTemplate::New(async_errno));
+    async->Set(String::New("EINTR"), Integer::New(EINTR));
     async->Set(String::New("read"), FunctionTemplate::New(async_read));
     async->Set(String::New("write"), FunctionTemplate::New(async_write));
     async->Set(String::New("close"), FunctionTemplate::New(async_close));
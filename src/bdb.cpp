@@ -1,14 +1,616 @@
-/** @ignore */
-/*
- * Berkley Database (BDB) Interface
+/**
+ * @module builtin/bdb
+ *
+ * ### Synopsis
+ * SilkJS builtin Berkeley DB object.
+ *
+ * ### Description
+ *
+ * Interface to Berkeley DB, an embedded, persistent key/value store.  Databases live in an environment (a directory), whose shared memory pool and lock tables let several processes, such as the HttpChild processes, use the same databases at the same time without a server process or network hop.
+ *
+ * B-tree databases keep keys in byte order and support range scans; hash databases are faster for random access to large data sets.  Keys and values are strings.
+ *
+ * Environments and databases must be opened by each process that uses them, after it is forked; handles are not valid across fork().  Recovery (DB_RECOVER) must only be run by one process, before the others open the environment: typically the parent, before forking.
+ *
+ * Functions that take a txn argument accept null to run without an explicit transaction; in a transactional environment, single operations are then transactions of their own.
+ *
+ * Operations that fail with anything other than the expected "not found" or "key exists" results throw the Berkeley DB error message.  In particular, transactions may fail with DB_LOCK_DEADLOCK when two processes lock the same pages in different orders; the transaction must then be aborted and may be retried.
+ *
+ * ### Usage
+ * var bdb = require('builtin/bdb');
+ *
+ * ### See Also
+ * The BDB module, which wraps this one.
  */
 
-////////////////  IN PROGRESS - NOT READY FOR USE /////////////////////////
-
-
 #include "SilkJS.h"
 #include <db.h>
 
+static JSVAL error (int rc) {
+    return ThrowException(String::New(db_strerror(rc)));
+}
+
+static inline DB_TXN *TXN (Handle<Value>v) {
+    if (v->IsObject()) {
+        return (DB_TXN *) JSOPAQUE(v);
+    }
+    return NULL;
+}
+
+static inline void setDBT (DBT *dbt, String::Utf8Value &s) {
+    memset(dbt, 0, sizeof (DBT));
+    dbt->data = *s;
+    dbt->size = s.length();
+}
+
+// compare keys as the default B-tree comparison does
+static int compareKeys (const void *a, size_t alen, const string &b) {
+    int rc = memcmp(a, b.data(), alen < b.size() ? alen : b.size());
+    if (rc) {
+        return rc;
+    }
+    return alen < b.size() ? -1 : (alen > b.size() ? 1 : 0);
+}
+
+static JSOBJ MakeRecord (const void *key, size_t klen, const void *value, size_t vlen) {
+    JSOBJ o = Object::New();
+    o->Set(String::New("key"), String::New((const char *) key, klen));
+    o->Set(String::New("value"), String::New((const char *) value, vlen));
+    return o;
+}
+
+/**
+ * @function bdb.env_open
+ *
+ * ### Synopsis
+ *
+ * var env = bdb.env_open(home, flags);
+ * var env = bdb.env_open(home, flags, cacheSize);
+ *
+ * Open (or create) an environment.
+ *
+ * The flags are typically DB_CREATE | DB_INIT_MPOOL | DB_INIT_LOCK, plus DB_INIT_LOG | DB_INIT_TXN for transactions, and DB_RECOVER in the process that runs recovery.  Deadlocks are detected whenever a lock request conflicts.
+ *
+ * @param {string} home - directory of the environment.
+ * @param {int} flags - DB_* flags for DB_ENV->open().
+ * @param {int} cacheSize - size of the shared memory pool, in bytes (default 32MB).  Only used when the environment is created.
+ * @returns {object} env - handle to the environment, or a string containing an error message.
+ */
+static JSVAL bdb_env_open (JSARGS args) {
+    String::Utf8Value home(args[0]);
+    u_int32_t flags = args[1]->IntegerValue();
+    double cacheSize = 32 * 1024 * 1024;
+    if (args.Length() > 2 && !args[2]->IsUndefined()) {
+        cacheSize = args[2]->NumberValue();
+    }
+    DB_ENV *env;
+    int rc = db_env_create(&env, 0);
+    if (rc) {
+        return String::New(db_strerror(rc));
+    }
+    u_int32_t gbytes = (u_int32_t) (cacheSize / (1024. * 1024 * 1024));
+    env->set_cachesize(env, gbytes, (u_int32_t) (cacheSize - gbytes * 1024. * 1024 * 1024), 1);
+    env->set_lk_detect(env, DB_LOCK_DEFAULT);
+    rc = env->open(env, *home, flags, 0);
+    if (rc) {
+        env->close(env, 0);
+        return String::New(db_strerror(rc));
+    }
+    return Opaque::New(env);
+}
+
+/**
+ * @function bdb.env_close
+ *
+ * ### Synopsis
+ *
+ * bdb.env_close(env);
+ *
+ * Close an environment.  Databases opened in it must be closed first.
+ *
+ * @param {object} env - handle to the environment.
+ */
+static JSVAL bdb_env_close (JSARGS args) {
+    DB_ENV *env = (DB_ENV *) JSOPAQUE(args[0]);
+    return Integer::New(env->close(env, 0));
+}
+
+/**
+ * @function bdb.env_checkpoint
+ *
+ * ### Synopsis
+ *
+ * var rc = bdb.env_checkpoint(env);
+ * var rc = bdb.env_checkpoint(env, kbytes, minutes);
+ *
+ * Write a transaction checkpoint, if at least kbytes of log have been written or minutes have passed since the last one.  This bounds the time recovery takes.
+ *
+ * @param {object} env - handle to the environment.
+ * @param {int} kbytes - log size threshold (default 0).
+ * @param {int} minutes - time threshold (default 0).
+ * @returns {int} rc - 0 on success, otherwise an error code.
+ */
+static JSVAL bdb_env_checkpoint (JSARGS args) {
+    DB_ENV *env = (DB_ENV *) JSOPAQUE(args[0]);
+    u_int32_t kbytes = args.Length() > 1 ? args[1]->IntegerValue() : 0;
+    u_int32_t minutes = args.Length() > 2 ? args[2]->IntegerValue() : 0;
+    return Integer::New(env->txn_checkpoint(env, kbytes, minutes, 0));
+}
+
+/**
+ * @function bdb.txn_begin
+ *
+ * ### Synopsis
+ *
+ * var txn = bdb.txn_begin(env);
+ * var txn = bdb.txn_begin(env, parent, flags);
+ *
+ * Begin a transaction.
+ *
+ * @param {object} env - handle to the environment.
+ * @param {object} parent - parent transaction for a nested transaction, or null.
+ * @param {int} flags - DB_TXN_* flags, e.g. DB_TXN_NOSYNC.
+ * @returns {object} txn - handle to the transaction.
+ */
+static JSVAL bdb_txn_begin (JSARGS args) {
+    DB_ENV *env = (DB_ENV *) JSOPAQUE(args[0]);
+    DB_TXN *parent = args.Length() > 1 ? TXN(args[1]) : NULL;
+    u_int32_t flags = args.Length() > 2 ? args[2]->IntegerValue() : 0;
+    DB_TXN *txn;
+    int rc = env->txn_begin(env, parent, &txn, flags);
+    if (rc) {
+        return error(rc);
+    }
+    return Opaque::New(txn);
+}
+
+/**
+ * @function bdb.txn_commit
+ *
+ * ### Synopsis
+ *
+ * var rc = bdb.txn_commit(txn);
+ *
+ * Commit a transaction.  The handle is invalid afterwards, whether or not the commit succeeded.
+ *
+ * @param {object} txn - handle to the transaction.
+ * @returns {int} rc - 0 on success, otherwise an error code.
+ */
+static JSVAL bdb_txn_commit (JSARGS args) {
+    DB_TXN *txn = TXN(args[0]);
+    return Integer::New(txn->commit(txn, 0));
+}
+
+/**
+ * @function bdb.txn_abort
+ *
+ * ### Synopsis
+ *
+ * var rc = bdb.txn_abort(txn);
+ *
+ * Abort a transaction, undoing its changes.  Cursors opened in the transaction must be closed first.
+ *
+ * @param {object} txn - handle to the transaction.
+ * @returns {int} rc - 0 on success, otherwise an error code.
+ */
+static JSVAL bdb_txn_abort (JSARGS args) {
+    DB_TXN *txn = TXN(args[0]);
+    return Integer::New(txn->abort(txn));
+}
+
+/**
+ * @function bdb.open
+ *
+ * ### Synopsis
+ *
+ * var db = bdb.open(env, file, database, type, flags);
+ * var db = bdb.open(env, file, database, type, flags, mode);
+ *
+ * Open (or create) a database.
+ *
+ * @param {object} env - handle to the environment, or null for a database outside any environment (which can't be shared by processes safely).
+ * @param {string} file - file name, relative to the environment home.
+ * @param {string} database - name of the database within the file, or null.
+ * @param {int} type - DB_BTREE or DB_HASH.
+ * @param {int} flags - DB_* flags, e.g. DB_CREATE | DB_AUTO_COMMIT.
+ * @param {int} mode - file mode when created (default 0644).
+ * @returns {object} db - handle to the database, or a string containing an error message.
+ */
+static JSVAL bdb_open (JSARGS args) {
+    DB_ENV *env = args[0]->IsObject() ? (DB_ENV *) JSOPAQUE(args[0]) : NULL;
+    String::Utf8Value file(args[1]);
+    String::Utf8Value database(args[2]);
+    DBTYPE type = (DBTYPE) args[3]->IntegerValue();
+    u_int32_t flags = args[4]->IntegerValue();
+    int mode = args.Length() > 5 ? args[5]->IntegerValue() : 0644;
+
+    DB *db;
+    int rc = db_create(&db, env, 0);
+    if (rc) {
+        return String::New(db_strerror(rc));
+    }
+    rc = db->open(db, NULL, *file, args[2]->IsString() ? *database : NULL, type, flags, mode);
+    if (rc) {
+        db->close(db, 0);
+        return String::New(db_strerror(rc));
+    }
+    return Opaque::New(db);
+}
+
+/**
+ * @function bdb.close
+ *
+ * ### Synopsis
+ *
+ * bdb.close(db);
+ *
+ * Close a database.  Cursors opened on it must be closed first.
+ *
+ * @param {object} db - handle to the database.
+ */
+static JSVAL bdb_close (JSARGS args) {
+    DB *db = (DB *) JSOPAQUE(args[0]);
+    return Integer::New(db->close(db, 0));
+}
+
+/**
+ * @function bdb.sync
+ *
+ * ### Synopsis
+ *
+ * bdb.sync(db);
+ *
+ * Flush cached changes to a non-transactional database to disk.
+ *
+ * @param {object} db - handle to the database.
+ */
+static JSVAL bdb_sync (JSARGS args) {
+    DB *db = (DB *) JSOPAQUE(args[0]);
+    return Integer::New(db->sync(db, 0));
+}
+
+/**
+ * @function bdb.get
+ *
+ * ### Synopsis
+ *
+ * var value = bdb.get(db, txn, key);
+ *
+ * Get the value stored for a key.
+ *
+ * @param {object} db - handle to the database.
+ * @param {object} txn - handle to a transaction, or null.
+ * @param {string} key - the key.
+ * @returns {string} value - the value, or null if the key is not in the database.
+ */
+static JSVAL bdb_get (JSARGS args) {
+    DB *db = (DB *) JSOPAQUE(args[0]);
+    DB_TXN *txn = TXN(args[1]);
+    String::Utf8Value k(args[2]);
+    DBT key, data;
+    setDBT(&key, k);
+    memset(&data, 0, sizeof (data));
+    int rc = db->get(db, txn, &key, &data, 0);
+    if (rc == DB_NOTFOUND) {
+        return Null();
+    }
+    if (rc) {
+        return error(rc);
+    }
+    return String::New((const char *) data.data, data.size);
+}
+
+/**
+ * @function bdb.mget
+ *
+ * ### Synopsis
+ *
+ * var values = bdb.mget(db, txn, keys);
+ *
+ * Get the values stored for several keys.
+ *
+ * @param {object} db - handle to the database.
+ * @param {object} txn - handle to a transaction, or null.
+ * @param {array} keys - the keys.
+ * @returns {object} values - hash of values indexed by key; keys not in the database are omitted.
+ */
+static JSVAL bdb_mget (JSARGS args) {
+    DB *db = (DB *) JSOPAQUE(args[0]);
+    DB_TXN *txn = TXN(args[1]);
+    Handle<Array>keys = Handle<Array>::Cast(args[2]);
+    JSOBJ result = Object::New();
+    int numKeys = keys->Length();
+    for (int i = 0; i < numKeys; i++) {
+        Handle<Value>k = keys->Get(i);
+        String::Utf8Value s(k);
+        DBT key, data;
+        setDBT(&key, s);
+        memset(&data, 0, sizeof (data));
+        int rc = db->get(db, txn, &key, &data, 0);
+        if (rc == DB_NOTFOUND) {
+            continue;
+        }
+        if (rc) {
+            return error(rc);
+        }
+        result->Set(k, String::New((const char *) data.data, data.size));
+    }
+    return result;
+}
+
+/**
+ * @function bdb.put
+ *
+ * ### Synopsis
+ *
+ * var rc = bdb.put(db, txn, key, value);
+ * var rc = bdb.put(db, txn, key, value, flags);
+ *
+ * Store a value for a key, replacing any value already stored unless flags is DB_NOOVERWRITE.
+ *
+ * @param {object} db - handle to the database.
+ * @param {object} txn - handle to a transaction, or null.
+ * @param {string} key - the key.
+ * @param {string} value - the value.
+ * @param {int} flags - 0 or DB_NOOVERWRITE.
+ * @returns {int} rc - 0 on success, or DB_KEYEXIST if flags is DB_NOOVERWRITE and the key exists.
+ */
+static JSVAL bdb_put (JSARGS args) {
+    DB *db = (DB *) JSOPAQUE(args[0]);
+    DB_TXN *txn = TXN(args[1]);
+    String::Utf8Value k(args[2]);
+    String::Utf8Value v(args[3]);
+    u_int32_t flags = args.Length() > 4 ? args[4]->IntegerValue() : 0;
+    DBT key, data;
+    setDBT(&key, k);
+    setDBT(&data, v);
+    int rc = db->put(db, txn, &key, &data, flags);
+    if (rc && rc != DB_KEYEXIST) {
+        return error(rc);
+    }
+    return Integer::New(rc);
+}
+
+/**
+ * @function bdb.del
+ *
+ * ### Synopsis
+ *
+ * var rc = bdb.del(db, txn, key);
+ *
+ * Remove a key and its value.
+ *
+ * @param {object} db - handle to the database.
+ * @param {object} txn - handle to a transaction, or null.
+ * @param {string} key - the key.
+ * @returns {int} rc - 0 on success, or DB_NOTFOUND if the key is not in the database.
+ */
+static JSVAL bdb_del (JSARGS args) {
+    DB *db = (DB *) JSOPAQUE(args[0]);
+    DB_TXN *txn = TXN(args[1]);
+    String::Utf8Value k(args[2]);
+    DBT key;
+    setDBT(&key, k);
+    int rc = db->del(db, txn, &key, 0);
+    if (rc && rc != DB_NOTFOUND) {
+        return error(rc);
+    }
+    return Integer::New(rc);
+}
+
+/**
+ * @function bdb.cursor
+ *
+ * ### Synopsis
+ *
+ * var cursor = bdb.cursor(db, txn);
+ *
+ * Open a cursor on a database.  Cursors must be closed before their transaction is committed or aborted.
+ *
+ * @param {object} db - handle to the database.
+ * @param {object} txn - handle to a transaction, or null.
+ * @returns {object} cursor - handle to the cursor.
+ */
+static JSVAL bdb_cursor (JSARGS args) {
+    DB *db = (DB *) JSOPAQUE(args[0]);
+    DB_TXN *txn = TXN(args[1]);
+    DBC *dbc;
+    int rc = db->cursor(db, txn, &dbc, 0);
+    if (rc) {
+        return error(rc);
+    }
+    return Opaque::New(dbc);
+}
+
+/**
+ * @function bdb.cursor_get
+ *
+ * ### Synopsis
+ *
+ * var record = bdb.cursor_get(cursor, flags);
+ * var record = bdb.cursor_get(cursor, flags, key);
+ *
+ * Move the cursor and get the record at its new position.
+ *
+ * The flags are one of DB_FIRST, DB_LAST, DB_NEXT, DB_PREV, DB_CURRENT, DB_SET (position at key) or DB_SET_RANGE (position at the smallest key greater than or equal to key, B-tree only).
+ *
+ * @param {object} cursor - handle to the cursor.
+ * @param {int} flags - how to move the cursor.
+ * @param {string} key - key for DB_SET and DB_SET_RANGE.
+ * @returns {object} record - object with key and value members, or null if there is no such record.
+ */
+static JSVAL bdb_cursor_get (JSARGS args) {
+    DBC *dbc = (DBC *) JSOPAQUE(args[0]);
+    u_int32_t flags = args[1]->IntegerValue();
+    String::Utf8Value k(args.Length() > 2 ? args[2] : Handle<Value>(String::Empty()));
+    DBT key, data;
+    setDBT(&key, k);
+    memset(&data, 0, sizeof (data));
+    int rc = dbc->get(dbc, &key, &data, flags);
+    if (rc == DB_NOTFOUND) {
+        return Null();
+    }
+    if (rc) {
+        return error(rc);
+    }
+    return MakeRecord(key.data, key.size, data.data, data.size);
+}
+
+/**
+ * @function bdb.cursor_del
+ *
+ * ### Synopsis
+ *
+ * var rc = bdb.cursor_del(cursor);
+ *
+ * Remove the record at the cursor's position.
+ *
+ * @param {object} cursor - handle to the cursor.
+ * @returns {int} rc - 0 on success.
+ */
+static JSVAL bdb_cursor_del (JSARGS args) {
+    DBC *dbc = (DBC *) JSOPAQUE(args[0]);
+    int rc = dbc->del(dbc, 0);
+    if (rc) {
+        return error(rc);
+    }
+    return Integer::New(rc);
+}
+
+/**
+ * @function bdb.cursor_close
+ *
+ * ### Synopsis
+ *
+ * bdb.cursor_close(cursor);
+ *
+ * Close a cursor.
+ *
+ * @param {object} cursor - handle to the cursor.
+ */
+static JSVAL bdb_cursor_close (JSARGS args) {
+    DBC *dbc = (DBC *) JSOPAQUE(args[0]);
+    return Integer::New(dbc->close(dbc));
+}
+
+/**
+ * @function bdb.range
+ *
+ * ### Synopsis
+ *
+ * var records = bdb.range(db, txn, start, end);
+ * var records = bdb.range(db, txn, start, end, limit);
+ * var records = bdb.range(db, txn, start, end, limit, bufferSize);
+ *
+ * Get the records with keys from start (inclusive) to end (exclusive), in key order.
+ *
+ * Records are fetched with bulk retrieval (DB_MULTIPLE_KEY): each call into Berkeley DB fills a buffer with as many records as fit, instead of returning one record at a time.
+ *
+ * @param {object} db - handle to the database; ranges are only meaningful for B-tree databases.
+ * @param {object} txn - handle to a transaction, or null.
+ * @param {string} start - first key, or null to start at the first record.
+ * @param {string} end - key to stop at, or null to continue to the last record.
+ * @param {int} limit - maximum number of records to return, 0 (the default) for no limit.
+ * @param {int} bufferSize - size of the bulk retrieval buffer (default 256KB).  It grows as needed for large records.
+ * @returns {array} records - array of objects with key and value members.
+ */
+static JSVAL bdb_range (JSARGS args) {
+    DB *db = (DB *) JSOPAQUE(args[0]);
+    DB_TXN *txn = TXN(args[1]);
+    bool hasStart = args.Length() > 2 && args[2]->IsString(),
+        hasEnd = args.Length() > 3 && args[3]->IsString();
+    string start, end;
+    if (hasStart) {
+        String::Utf8Value s(args[2]);
+        start.assign(*s, s.length());
+    }
+    if (hasEnd) {
+        String::Utf8Value s(args[3]);
+        end.assign(*s, s.length());
+    }
+    int limit = args.Length() > 4 ? args[4]->IntegerValue() : 0;
+    u_int32_t bufferSize = args.Length() > 5 ? args[5]->IntegerValue() : 256 * 1024;
+    bufferSize = (bufferSize + 1023) & ~1023;
+    if (bufferSize < 64 * 1024) {
+        bufferSize = 64 * 1024;
+    }
+
+    DBC *dbc;
+    int rc = db->cursor(db, txn, &dbc, 0);
+    if (rc) {
+        return error(rc);
+    }
+    char *buf = (char *) malloc(bufferSize);
+    DBT key, data;
+    memset(&key, 0, sizeof (key));
+    memset(&data, 0, sizeof (data));
+    key.data = (void *) start.data();
+    key.size = start.size();
+    data.data = buf;
+    data.ulen = bufferSize;
+    data.flags = DB_DBT_USERMEM;
+
+    Handle<Array>records = Array::New();
+    int count = 0;
+    u_int32_t flags = (hasStart ? DB_SET_RANGE : DB_FIRST) | DB_MULTIPLE_KEY;
+    bool done = false;
+    while (!done) {
+        rc = dbc->get(dbc, &key, &data, flags);
+        if (rc == DB_BUFFER_SMALL) {
+            // a single record is larger than the buffer
+            bufferSize = (data.size + 1023) & ~1023;
+            buf = (char *) realloc(buf, bufferSize);
+            data.data = buf;
+            data.ulen = bufferSize;
+            continue;
+        }
+        if (rc) {
+            break;
+        }
+        void *p, *k, *v;
+        u_int32_t klen, vlen;
+        DB_MULTIPLE_INIT(p, &data);
+        for (;;) {
+            DB_MULTIPLE_KEY_NEXT(p, &data, k, klen, v, vlen);
+            if (!p) {
+                break;
+            }
+            if (hasEnd && compareKeys(k, klen, end) >= 0) {
+                done = true;
+                break;
+            }
+            records->Set(count++, MakeRecord(k, klen, v, vlen));
+            if (limit && count >= limit) {
+                done = true;
+                break;
+            }
+        }
+        flags = DB_NEXT | DB_MULTIPLE_KEY;
+    }
+    free(buf);
+    dbc->close(dbc);
+    if (rc && rc != DB_NOTFOUND) {
+        return error(rc);
+    }
+    return records;
+}
+
+/**
+ * @function bdb.strerror
+ *
+ * ### Synopsis
+ *
+ * var msg = bdb.strerror(rc);
+ *
+ * Get the error message for an error code returned by another bdb function.
+ *
+ * @param {int} rc - error code.
+ * @returns {string} msg - the error message.
+ */
+static JSVAL bdb_strerror (JSARGS args) {
+    return String::New(db_strerror(args[0]->IntegerValue()));
+}
+
 void init_bdb_object () {
     HandleScope scope;
 
@@ -20,7 +622,8 @@ void init_bdb_object () {
     bdb->Set(String::New("VERSION_STRING"), String::New(DB_VERSION_STRING));
 
     bdb->Set(String::New("DB_AUTO_COMMIT"), Integer::New(DB_AUTO_COMMIT));
-    bdb->Set(String::New("DB_CREATE"), Integer::New(DB_EXCL));
+    bdb->Set(String::New("DB_CREATE"), Integer::New(DB_CREATE));
+    bdb->Set(String::New("DB_EXCL"), Integer::New(DB_EXCL));
     bdb->Set(String::New("DB_MULTIVERSION"), Integer::New(DB_MULTIVERSION));
     bdb->Set(String::New("DB_NOMMAP"), Integer::New(DB_NOMMAP));
     bdb->Set(String::New("DB_RDONLY"), Integer::New(DB_RDONLY));
@@ -28,6 +631,57 @@ void init_bdb_object () {
     bdb->Set(String::New("DB_THREAD"), Integer::New(DB_THREAD));
     bdb->Set(String::New("DB_TRUNCATE"), Integer::New(DB_TRUNCATE));
 
+    // environment
+    bdb->Set(String::New("DB_INIT_MPOOL"), Integer::New(DB_INIT_MPOOL));
+    bdb->Set(String::New("DB_INIT_LOCK"), Integer::New(DB_INIT_LOCK));
+    bdb->Set(String::New("DB_INIT_LOG"), Integer::New(DB_INIT_LOG));
+    bdb->Set(String::New("DB_INIT_TXN"), Integer::New(DB_INIT_TXN));
+    bdb->Set(String::New("DB_RECOVER"), Integer::New(DB_RECOVER));
+    bdb->Set(String::New("DB_REGISTER"), Integer::New(DB_REGISTER));
+
+    // database types
+    bdb->Set(String::New("DB_BTREE"), Integer::New(DB_BTREE));
+    bdb->Set(String::New("DB_HASH"), Integer::New(DB_HASH));
+
+    // put and cursor flags
+    bdb->Set(String::New("DB_NOOVERWRITE"), Integer::New(DB_NOOVERWRITE));
+    bdb->Set(String::New("DB_FIRST"), Integer::New(DB_FIRST));
+    bdb->Set(String::New("DB_LAST"), Integer::New(DB_LAST));
+    bdb->Set(String::New("DB_NEXT"), Integer::New(DB_NEXT));
+    bdb->Set(String::New("DB_PREV"), Integer::New(DB_PREV));
+    bdb->Set(String::New("DB_CURRENT"), Integer::New(DB_CURRENT));
+    bdb->Set(String::New("DB_SET"), Integer::New(DB_SET));
+    bdb->Set(String::New("DB_SET_RANGE"), Integer::New(DB_SET_RANGE));
+
+    // transaction flags
+    bdb->Set(String::New("DB_TXN_NOSYNC"), Integer::New(DB_TXN_NOSYNC));
+    bdb->Set(String::New("DB_TXN_WRITE_NOSYNC"), Integer::New(DB_TXN_WRITE_NOSYNC));
+    bdb->Set(String::New("DB_TXN_SNAPSHOT"), Integer::New(DB_TXN_SNAPSHOT));
+
+    // return codes
+    bdb->Set(String::New("DB_NOTFOUND"), Integer::New(DB_NOTFOUND));
+    bdb->Set(String::New("DB_KEYEXIST"), Integer::New(DB_KEYEXIST));
+    bdb->Set(String::New("DB_LOCK_DEADLOCK"), Integer::New(DB_LOCK_DEADLOCK));
+
+    bdb->Set(String::New("env_open"), FunctionTemplate::New(bdb_env_open));
+    bdb->Set(String::New("env_close"), FunctionTemplate::New(bdb_env_close));
+    bdb->Set(String::New("env_checkpoint"), FunctionTemplate::New(bdb_env_checkpoint));
+    bdb->Set(String::New("txn_begin"), FunctionTemplate::New(bdb_txn_begin));
+    bdb->Set(String::New("txn_commit"), FunctionTemplate::New(bdb_txn_commit));
+    bdb->Set(String::New("txn_abort"), FunctionTemplate::New(bdb_txn_abort));
+    bdb->Set(String::New("open"), FunctionTemplate::New(bdb_open));
+    bdb->Set(String::New("close"), FunctionTemplate::New(bdb_close));
+    bdb->Set(String::New("sync"), FunctionTemplate::New(bdb_sync));
+    bdb->Set(String::New("get"), FunctionTemplate::New(bdb_get));
+    bdb->Set(String::New("mget"), FunctionTemplate::New(bdb_mget));
+    bdb->Set(String::New("put"), FunctionTemplate::New(bdb_put));
+    bdb->Set(String::New("del"), FunctionTemplate::New(bdb_del));
+    bdb->Set(String::New("cursor"), FunctionTemplate::New(bdb_cursor));
+    bdb->Set(String::New("cursor_get"), FunctionTemplate::New(bdb_cursor_get));
+    bdb->Set(String::New("cursor_del"), FunctionTemplate::New(bdb_cursor_del));
+    bdb->Set(String::New("cursor_close"), FunctionTemplate::New(bdb_cursor_close));
+    bdb->Set(String::New("range"), FunctionTemplate::New(bdb_range));
+    bdb->Set(String::New("strerror"), FunctionTemplate::New(bdb_strerror));
 
     builtinObject->Set(String::New("bdb"), bdb);
 }
@@ -19,7 +19,7 @@
 
 static inline void bufferWrite (Buffer *buf, const char *data, long len) {
 #ifdef BUFFER_STRING
-    buf->s += data;
+    buf->s.append(data, len);
 #else
     if (buf->pos + len >= buf->size) {
         while (buf->pos + len >= buf->size) {
@@ -33,6 +33,32 @@ static inline void bufferWrite (Buffer *buf, const char *data, long len) {
 #endif
 }
 
+void BufferAppend (Buffer *buf, const char *data, long len) {
+    bufferWrite(buf, data, len);
+}
+
+static void free_buffer (void *p) {
+    Buffer *buf = (Buffer *) p;
+#ifndef BUFFER_STRING
+    free(buf->mem);
+#endif
+    delete buf;
+}
+
+// buffers not destroyed with buffer.destroy() are freed when their handle is garbage collected
+OpaqueType bufferType("buffer", free_buffer);
+
+/*
+ * Tell V8 how much memory the buffer holds, after it may have grown.
+ */
+void BufferAccount (Handle<Value>handle, Buffer *buf) {
+#ifdef BUFFER_STRING
+    Opaque::Resize(handle, buf->s.capacity());
+#else
+    Opaque::Resize(handle, buf->size);
+#endif
+}
+
 /**
  * @function buffer.create
  * 
@@ -40,19 +66,21 @@ static inline void bufferWrite (Buffer *buf, const char *data, long len) {
  * 
  * var buf = buffer.create();
  * 
- * Creates a new buffer.  Buffers created with buffer.create() should be released by calling buffer.destroy() when you are finished with the buffer.
+ * Creates a new buffer.  Buffers created with buffer.create() should be released by calling buffer.destroy() when you are finished with the buffer; otherwise they are freed when the handle is garbage collected.
  * 
  * @return {object} buf - opaque handel to newly created buffer.
  */
 static JSVAL buffer_create (JSARGS args) {
     Buffer *buf = new Buffer;
 #ifndef BUFFER_STRING
-    buf->mem = new unsigned char[16384];
+    buf->mem = (unsigned char *) malloc(16384);
     buf->mem[0] = '\0';
     buf->size = 16384;
     buf->pos = 0;
+    return Opaque::New(buf, bufferType, true, buf->size);
+#else
+    return Opaque::New(buf, bufferType);
 #endif
-    return Opaque::New(buf);
 }
 
 /**
@@ -84,16 +112,16 @@ static JSVAL buffer_reset (JSARGS args) {
  * 
  * buffer.destroy(buf);
  * 
- * Free a previously created buffer.  Buffers allocate system resources that will not be freed until this function is called.
+ * Free a previously created buffer.  Buffers allocate system resources that are otherwise held until the handle is garbage collected.
  * 
  * @param {object} buf - buffer to free.
  */
 static JSVAL buffer_destroy (JSARGS args) {
     Buffer *buf = (Buffer *)JSOPAQUE(args[0]);
-#ifndef BUFFER_STRING
-    delete[] buf->mem;
-#endif
-    delete buf;
+    if (buf) {
+        Opaque::Clear(args[0]);
+        free_buffer(buf);
+    }
     return Undefined();
 }
 
@@ -110,8 +138,14 @@ static JSVAL buffer_destroy (JSARGS args) {
  */
 static JSVAL buffer_write (JSARGS args) {
     Buffer *buf = (Buffer *)JSOPAQUE(args[0]);
-    String::Utf8Value data(args[1]);
-    bufferWrite(buf, *data, data.length());
+    Arena::Scope arena;
+    long len;
+    char *data = Arena::Utf8(args[1], &len);
+    if (!data) {
+        return ThrowException(String::New("buffer.write: out of memory"));
+    }
+    bufferWrite(buf, data, len);
+    BufferAccount(args[0], buf);
     //#ifdef BUFFER_STRING
     //	buf->s += *data;
     //#else
@@ -143,14 +177,23 @@ static JSVAL buffer_write (JSARGS args) {
  */
 static JSVAL buffer_write64 (JSARGS args) {
     Buffer *buf = (Buffer *)JSOPAQUE(args[0]);
-    String::Utf8Value data(args[1]);
+    Arena::Scope arena;
+    long len;
+    char *data = Arena::Utf8(args[1], &len);
+    if (!data) {
+        return ThrowException(String::New("buffer.write64: out of memory"));
+    }
 #ifdef BUFFER_STRING
-    buf->s += Base64Decode(*data);
+    buf->s += Base64Decode(data);
 #else
-    char decodeBuf[data.length()];
-    long decodeLen = decode_base64((unsigned char *) decodeBuf, *data);
+    char *decodeBuf = (char *) Arena::Alloc(len);
+    if (!decodeBuf) {
+        return ThrowException(String::New("buffer.write64: out of memory"));
+    }
+    long decodeLen = decode_base64((unsigned char *) decodeBuf, data);
     bufferWrite(buf, decodeBuf, decodeLen);
 #endif
+    BufferAccount(args[0], buf);
     return Undefined();
 }
 
@@ -173,6 +216,22 @@ static JSVAL buffer_read (JSARGS args) {
 #endif
 }
 
+/**
+ * @function buffer.read64
+ * 
+ * var base64String = buffer.read64(buf);
+ * 
+ * Return contents of buffer base64 encoded, e.g. binary image data for a data: URL.
+ * 
+ * @param {object} buf - buffer to get contents of.
+ * @return {string} base64String - buffer contents, base64 encoded.
+ */
+static JSVAL buffer_read64 (JSARGS args) {
+    Buffer *buf = (Buffer *)JSOPAQUE(args[0]);
+    string out = Base64Encode(buf->data(), buf->length());
+    return String::New(out.c_str(), out.size());
+}
+
 /**
  * @function buffer.size
  * 
@@ -202,6 +261,7 @@ void init_buffer_object () {
     buffer->Set(String::New("write"), FunctionTemplate::New(buffer_write));
     buffer->Set(String::New("write64"), FunctionTemplate::New(buffer_write64));
     buffer->Set(String::New("read"), FunctionTemplate::New(buffer_read));
+    buffer->Set(String::New("read64"), FunctionTemplate::New(buffer_read64));
     buffer->Set(String::New("size"), FunctionTemplate::New(buffer_size));
 
     builtinObject->Set(String::New("buffer"), buffer);
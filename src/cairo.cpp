@@ -12,8 +12,75 @@
  */
 #include "SilkJS.h"
 #include <stdint.h>
+#include <limits.h>
+#include <vector>
+#include <map>
 #include <cairo/cairo.h>
 
+////////////////////////// HANDLE TYPES
+
+// Handles the caller owns are finalized when they are garbage collected, if
+// the corresponding cairo.*_destroy() function hasn't been called first.
+
+static void free_surface (void *p) {
+    cairo_surface_destroy((cairo_surface_t *) p);
+}
+
+static void free_context (void *p) {
+    cairo_destroy((cairo_t *) p);
+}
+
+static void free_pattern (void *p) {
+    cairo_pattern_destroy((cairo_pattern_t *) p);
+}
+
+static void free_matrix (void *p) {
+    delete (cairo_matrix_t *) p;
+}
+
+static void free_path (void *p) {
+    cairo_path_destroy((cairo_path_t *) p);
+}
+
+static void free_font_options (void *p) {
+    cairo_font_options_destroy((cairo_font_options_t *) p);
+}
+
+static void free_font_face (void *p) {
+    cairo_font_face_destroy((cairo_font_face_t *) p);
+}
+
+static void free_scaled_font (void *p) {
+    cairo_scaled_font_destroy((cairo_scaled_font_t *) p);
+}
+
+static OpaqueType surfaceType("cairo.surface", free_surface);
+static OpaqueType contextType("cairo.context", free_context);
+static OpaqueType patternType("cairo.pattern", free_pattern);
+static OpaqueType matrixType("cairo.matrix", free_matrix);
+static OpaqueType pathType("cairo.path", free_path);
+static OpaqueType fontOptionsType("cairo.font_options", free_font_options);
+static OpaqueType fontFaceType("cairo.font_face", free_font_face);
+static OpaqueType scaledFontType("cairo.scaled_font", free_scaled_font);
+
+// image surfaces hold their pixels outside the V8 heap; V8 is told about them
+static Handle<Object>surfaceHandle (cairo_surface_t *surface) {
+    long size = 0;
+    if (cairo_surface_get_type(surface) == CAIRO_SURFACE_TYPE_IMAGE) {
+        size = (long) cairo_image_surface_get_stride(surface) * cairo_image_surface_get_height(surface);
+    }
+    return Opaque::New(surface, surfaceType, true, size);
+}
+
+#if CAIRO_VERSION_MINOR >= 10
+static void free_region (void *p) {
+    cairo_region_destroy((cairo_region_t *) p);
+}
+
+static OpaqueType regionType("cairo.region", free_region);
+static OpaqueType deviceType("cairo.device");
+#endif
+
 ////////////////////////// MISC
 
 /**
@@ -68,7 +135,7 @@ static JSVAL surface_create_similar(JSARGS args) {
     int format = args[1]->IntegerValue();
     int width = args[2]->IntegerValue();
     int height = args[3]->IntegerValue();
-    return Opaque::New(cairo_surface_create_similar(surface, (cairo_content_t)format, width, height));
+    return surfaceHandle(cairo_surface_create_similar(surface, (cairo_content_t)format, width, height));
 }
 
 /**
@@ -87,7 +154,7 @@ static JSVAL surface_create_similar(JSARGS args) {
  */
 static JSVAL surface_reference(JSARGS args) {
     cairo_surface_t *surface = (cairo_surface_t *) JSOPAQUE(args[0]);
-    return Opaque::New(cairo_surface_reference(surface));
+    return Opaque::New(cairo_surface_reference(surface), surfaceType);
 }
 
 /**
@@ -122,7 +189,18 @@ static JSVAL surface_status(JSARGS args) {
  */
 static JSVAL surface_destroy(JSARGS args) {
     cairo_surface_t *surface = (cairo_surface_t *) JSOPAQUE(args[0]);
-    cairo_surface_destroy(surface);
+    if (surface) {
+        // detach the cairo.image_surface_get_pixels() view, so it can't touch freed memory
+        Handle<Value>pixels = args[0]->ToObject()->GetHiddenValue(String::New("pixels"));
+        if (!pixels.IsEmpty() && pixels->IsObject()) {
+            JSOBJ o = pixels->ToObject();
+            o->SetIndexedPropertiesToExternalArrayData(NULL, kExternalUnsignedByteArray, 0);
+            o->Set(String::New("length"), Integer::New(0));
+            args[0]->ToObject()->DeleteHiddenValue(String::New("pixels"));
+        }
+        cairo_surface_destroy(surface);
+        Opaque::Clear(args[0]);
+    }
     return Undefined();
 }
 
@@ -191,7 +269,7 @@ static JSVAL surface_get_device(JSARGS args) {
     if (device == NULL) {
         return Null();
     }
-    return Opaque::New(device);
+    return Opaque::New(device, deviceType, false);
 }
 #endif
 
@@ -225,7 +303,7 @@ static JSVAL surface_get_font_options(JSARGS args) {
     cairo_surface_t *surface = (cairo_surface_t *) JSOPAQUE(args[0]);
     cairo_font_options_t *options = cairo_font_options_create();
     cairo_surface_get_font_options(surface, options);
-    return Opaque::New(options);
+    return Opaque::New(options, fontOptionsType);
 }
 
 /**
@@ -563,7 +641,7 @@ static JSVAL image_surface_create(JSARGS args) {
     int format = args[0]->IntegerValue();
     int width = args[1]->IntegerValue();
     int height = args[2]->IntegerValue();
-    return Opaque::New(cairo_image_surface_create((cairo_format_t)format, width, height));
+    return surfaceHandle(cairo_image_surface_create((cairo_format_t)format, width, height));
 }
 
 /**
@@ -626,6 +704,64 @@ static JSVAL image_surface_get_height(JSARGS args) {
     return Integer::New(cairo_image_surface_get_height(surface));
 }
 
+/*
+ * ImageData objects, as used by the Canvas API: { width, height, data }.
+ * data holds width * height RGBA pixels, not premultiplied, in native
+ * memory indexed like a Uint8ClampedArray (an external pixel array), so
+ * JavaScript loops over it don't call into C++ per pixel.
+ */
+static void free_image_data (void *p) {
+    free(p);
+}
+
+static OpaqueType imageDataType("cairo.image_data", free_image_data);
+
+static Handle<Value>newImageData (int width, int height, uint8_t **pixels) {
+    if (width <= 0 || height <= 0 || (long) width * height > INT_MAX / 4) {
+        return ThrowException(String::New("Invalid ImageData size"));
+    }
+    int length = width * height * 4;
+    uint8_t *p = (uint8_t *) calloc(length, 1);
+    if (!p) {
+        return ThrowException(String::New("Out of memory"));
+    }
+    Handle<Object>data = Opaque::New(p, imageDataType, true, length);
+    data->SetIndexedPropertiesToPixelData(p, length);
+    data->Set(String::New("length"), Integer::New(length));
+    JSOBJ o = Object::New();
+    o->Set(String::New("width"), Integer::New(width));
+    o->Set(String::New("height"), Integer::New(height));
+    o->Set(String::New("data"), data);
+    *pixels = p;
+    return o;
+}
+
+static bool isPixelFormat (cairo_surface_t *surface) {
+    if (cairo_surface_get_type(surface) != CAIRO_SURFACE_TYPE_IMAGE) {
+        return false;
+    }
+    cairo_format_t format = cairo_image_surface_get_format(surface);
+    return format == CAIRO_FORMAT_ARGB32 || format == CAIRO_FORMAT_RGB24;
+}
+
+/**
+ * @function cairo.image_data_create
+ * 
+ * ### Synopsis
+ * 
+ * var imageData = cairo.image_data_create(width, height);
+ * 
+ * Create a canvas style ImageData object of transparent black pixels; see cairo.image_surface_get_data().
+ * 
+ * @param {int} width - width in pixels.
+ * @param {int} height - height in pixels.
+ * @return {object} imageData - ImageData object.
+ */
+static JSVAL image_data_create(JSARGS args) {
+    uint8_t *pixels;
+    return newImageData(args[0]->IntegerValue(), args[1]->IntegerValue(), &pixels);
+}
+
 /**
  * @function cairo.image_surface_get_data
  * 
@@ -633,15 +769,23 @@ static JSVAL image_surface_get_height(JSARGS args) {
  * 
  * var imageData = cairo.image_surface_get_data(surface, sx, sy, width, height);
  * 
- * Gets a canvas style ImageData object.
+ * Gets a canvas style ImageData object, a copy of the given rectangle of an ARGB32 or RGB24 image surface.
  * 
  * The imageData object returned is of the following form:
  * 
  * + {int} width - width of the image data pixel array in device pixels.
  * + {int} height - height of the image data pixel array in device pixels.
- * + {array} data - pixel data as a one dimensional array in RGBA order, as integers in the range 0..255.
+ * + {object} data - pixel data as a one dimensional array in RGBA order, as integers in the range 0..255 (not premultiplied by alpha).
+ * 
+ * data is indexed like an array (and has a length), but is held in native memory, and values stored into it are clamped to 0..255 like a Uint8ClampedArray.
+ * 
+ * Pixels of the rectangle outside the surface are transparent black.
  * 
  * @param {object} surface - opaque handle to a cairo surface.
+ * @param {int} sx - x coordinate of the upper left corner of the rectangle.
+ * @param {int} sy - y coordinate of the upper left corner of the rectangle.
+ * @param {int} width - width of the rectangle.
+ * @param {int} height - height of the rectangle.
  * @return {object} imageData - object of the above form.
  */
 static JSVAL image_surface_get_data(JSARGS args) {
@@ -650,51 +794,366 @@ static JSVAL image_surface_get_data(JSARGS args) {
     int sy = args[2]->IntegerValue();
     int width = args[3]->IntegerValue();
     int height = args[4]->IntegerValue();
-    int length = width * height;
+    if (!isPixelFormat(surface)) {
+        return ThrowException(String::New("cairo.image_surface_get_data: surface is not an ARGB32 or RGB24 image surface"));
+    }
+    uint8_t *dst;
+    Handle<Value>imageData = newImageData(width, height, &dst);
+    if (imageData.IsEmpty()) {
+        return imageData;
+    }
+    bool hasAlpha = cairo_image_surface_get_format(surface) == CAIRO_FORMAT_ARGB32;
     int stride = cairo_image_surface_get_stride(surface);
     int cWidth = cairo_image_surface_get_width(surface);
     int cHeight = cairo_image_surface_get_height(surface);
-    if (sx < 0) {
-        width += sx;
-        sx = 0;
+    // the part of the rectangle on the surface
+    int x0 = sx < 0 ? -sx : 0,
+        y0 = sy < 0 ? -sy : 0,
+        x1 = sx + width > cWidth ? cWidth - sx : width,
+        y1 = sy + height > cHeight ? cHeight - sy : height;
+    cairo_surface_flush(surface);
+    uint8_t *src = cairo_image_surface_get_data(surface);
+    for (int y = y0; y < y1; y++) {
+        uint32_t *row = (uint32_t *) (src + (long) stride * (y + sy)) + sx;
+        uint8_t *out = dst + ((long) y * width + x0) * 4;
+        for (int x = x0; x < x1; x++) {
+            uint32_t pixel = row[x];
+            int a = hasAlpha ? pixel >> 24 : 255,
+                r = (pixel >> 16) & 0xff,
+                g = (pixel >> 8) & 0xff,
+                b = pixel & 0xff;
+            if (a == 0) {
+                r = g = b = 0;
+            }
+            else if (a != 255) {
+                // unpremultiply, rounding
+                r = (r * 255 + a / 2) / a;
+                g = (g * 255 + a / 2) / a;
+                b = (b * 255 + a / 2) / a;
+            }
+            out[0] = r > 255 ? 255 : r;
+            out[1] = g > 255 ? 255 : g;
+            out[2] = b > 255 ? 255 : b;
+            out[3] = a;
+            out += 4;
+        }
+    }
+    return imageData;
+}
+
+/**
+ * @function cairo.image_surface_put_data
+ * 
+ * ### Synopsis
+ * 
+ * cairo.image_surface_put_data(surface, imageData, dx, dy);
+ * cairo.image_surface_put_data(surface, imageData, dx, dy, dirtyX, dirtyY, dirtyWidth, dirtyHeight);
+ * 
+ * Copy the pixels of a canvas style ImageData object to an ARGB32 or RGB24 image surface, replacing the surface's pixels (as the Canvas putImageData() does; there is no compositing).
+ * 
+ * Only the dirty rectangle of the ImageData is copied, if given, to dx + dirtyX, dy + dirtyY.  The parts of it outside the surface are ignored.
+ * 
+ * imageData.data may be the data of an ImageData from cairo.image_surface_get_data() or cairo.image_data_create(), or an array of width * height * 4 numbers.
+ * 
+ * @param {object} surface - opaque handle to a cairo surface.
+ * @param {object} imageData - ImageData object (see cairo.image_surface_get_data()).
+ * @param {int} dx - x coordinate on the surface of the ImageData's upper left corner.
+ * @param {int} dy - y coordinate on the surface of the ImageData's upper left corner.
+ * @param {int} dirtyX - optional x coordinate within the ImageData of the rectangle to copy.
+ * @param {int} dirtyY - optional y coordinate within the ImageData of the rectangle to copy.
+ * @param {int} dirtyWidth - optional width of the rectangle to copy.
+ * @param {int} dirtyHeight - optional height of the rectangle to copy.
+ */
+static JSVAL image_surface_put_data(JSARGS args) {
+    cairo_surface_t *surface = (cairo_surface_t *) JSOPAQUE(args[0]);
+    JSOBJ imageData = args[1]->ToObject();
+    int width = imageData->Get(String::New("width"))->IntegerValue();
+    int height = imageData->Get(String::New("height"))->IntegerValue();
+    int dx = args[2]->IntegerValue();
+    int dy = args[3]->IntegerValue();
+    int dirtyX = 0, dirtyY = 0, dirtyWidth = width, dirtyHeight = height;
+    if (args.Length() > 7) {
+        dirtyX = args[4]->IntegerValue();
+        dirtyY = args[5]->IntegerValue();
+        dirtyWidth = args[6]->IntegerValue();
+        dirtyHeight = args[7]->IntegerValue();
     }
-    if (sy < 0) {
-        height += sy;
-        sy = 0;
+    if (!isPixelFormat(surface)) {
+        return ThrowException(String::New("cairo.image_surface_put_data: surface is not an ARGB32 or RGB24 image surface"));
     }
-    if (sx + width > cWidth) {
-        width = cWidth - sx;
+    if (width <= 0 || height <= 0 || (long) width * height > INT_MAX / 4) {
+        return ThrowException(String::New("cairo.image_surface_put_data: invalid ImageData"));
     }
-    if (sy + height > cHeight) {
-        height = cHeight - sy;
+
+    // the pixels, in place if they're native memory, else copied from an array
+    JSOBJ data = imageData->Get(String::New("data"))->ToObject();
+    int length = width * height * 4;
+    const uint8_t *src;
+    Arena::Scope arena;
+    if (data->HasIndexedPropertiesInPixelData() && data->GetIndexedPropertiesPixelDataLength() >= length) {
+        src = data->GetIndexedPropertiesPixelData();
+    }
+    else if (data->HasIndexedPropertiesInExternalArrayData() && data->GetIndexedPropertiesExternalArrayDataType() == kExternalUnsignedByteArray && data->GetIndexedPropertiesExternalArrayDataLength() >= length) {
+        src = (const uint8_t *) data->GetIndexedPropertiesExternalArrayData();
+    }
+    else {
+        uint8_t *copy = (uint8_t *) Arena::Alloc(length);
+        if (!copy) {
+            return ThrowException(String::New("cairo.image_surface_put_data: out of memory"));
+        }
+        for (int i = 0; i < length; i++) {
+            int v = data->Get(i)->Int32Value();
+            copy[i] = v < 0 ? 0 : v > 255 ? 255 : v;
+        }
+        src = copy;
     }
+
+    // negative sizes count back from dirtyX, dirtyY; clip to the ImageData, then to the surface
+    if (dirtyWidth < 0) {
+        dirtyX += dirtyWidth;
+        dirtyWidth = -dirtyWidth;
+    }
+    if (dirtyHeight < 0) {
+        dirtyY += dirtyHeight;
+        dirtyHeight = -dirtyHeight;
+    }
+    int x0 = dirtyX > 0 ? dirtyX : 0,
+        y0 = dirtyY > 0 ? dirtyY : 0,
+        x1 = dirtyX + dirtyWidth < width ? dirtyX + dirtyWidth : width,
+        y1 = dirtyY + dirtyHeight < height ? dirtyY + dirtyHeight : height;
+    int cWidth = cairo_image_surface_get_width(surface),
+        cHeight = cairo_image_surface_get_height(surface);
+    if (dx + x0 < 0) {
+        x0 = -dx;
+    }
+    if (dy + y0 < 0) {
+        y0 = -dy;
+    }
+    if (dx + x1 > cWidth) {
+        x1 = cWidth - dx;
+    }
+    if (dy + y1 > cHeight) {
+        y1 = cHeight - dy;
+    }
+    if (x0 >= x1 || y0 >= y1) {
+        return Undefined();
+    }
+
+    bool hasAlpha = cairo_image_surface_get_format(surface) == CAIRO_FORMAT_ARGB32;
+    int stride = cairo_image_surface_get_stride(surface);
     cairo_surface_flush(surface);
-    uint8_t *src = cairo_image_surface_get_data(surface);
-    Handle<Array>bytes = Array::New(length*4);
-    int ndx = 0;
-    for (int y = 0; y<height; y++) {
-        uint32_t *row = (uint32_t *)(src + stride * (y + sy));
-        for (int x=0; x<width; x++) {
-//            int bx = x*4;
-            uint32_t *pixel = row + x + sx;
-            uint8_t a = *pixel >> 24;
-            uint8_t r = *pixel >> 16;
-            uint8_t g = *pixel >> 8;
-            uint8_t b = *pixel;
-            float alpha = (float)a / 255;
-            bytes->Set(ndx++, Integer::New((int)((float) r / alpha)));
-            bytes->Set(ndx++, Integer::New((int)((float) g / alpha)));
-            bytes->Set(ndx++, Integer::New((int)((float) b / alpha)));
-            bytes->Set(ndx++, Integer::New(a));
+    uint8_t *dst = cairo_image_surface_get_data(surface);
+    for (int y = y0; y < y1; y++) {
+        uint32_t *row = (uint32_t *) (dst + (long) stride * (y + dy)) + dx;
+        const uint8_t *in = src + ((long) y * width + x0) * 4;
+        for (int x = x0; x < x1; x++) {
+            uint32_t r = in[0], g = in[1], b = in[2], a = in[3];
+            if (!hasAlpha) {
+                a = 255;
+            }
+            else if (a != 255) {
+                // premultiply, rounding
+                r = (r * a + 127) / 255;
+                g = (g * a + 127) / 255;
+                b = (b * a + 127) / 255;
+            }
+            row[x] = (a << 24) | (r << 16) | (g << 8) | b;
+            in += 4;
         }
     }
-    JSOBJ o = Object::New();
-    o->Set(String::New("data"), bytes);
-    o->Set(String::New("width"), Integer::New(width));
+    cairo_surface_mark_dirty_rectangle(surface, dx + x0, dy + y0, x1 - x0, y1 - y0);
+    return Undefined();
+}
+
+/**
+ * @function cairo.image_surface_get_pixels
+ * 
+ * ### Synopsis
+ * 
+ * var pixels = cairo.image_surface_get_pixels(surface);
+ * 
+ * Get the pixels of an image surface, in place: reading and writing pixels[i] reads and writes the surface's memory.
+ * 
+ * The pixels are in cairo's format, not the Canvas ImageData format: for ARGB32 surfaces, each pixel is a native endian 32 bit value with alpha in the upper 8 bits, then red, green, and blue, with the colors premultiplied by alpha (so on x86, the bytes are blue, green, red, alpha).  Rows are pixels.stride bytes apart, which may be more than 4 * width.
+ * 
+ * The returned object has these properties, besides the bytes:
+ * 
+ * + {int} length - number of bytes, stride * height.
+ * + {int} width - width of the surface in pixels.
+ * + {int} height - height of the surface in pixels.
+ * + {int} stride - bytes from the start of one row to the next.
+ * + {int} format - one of cairo.FORMAT_*.
+ * 
+ * The surface is flushed first.  Call cairo.surface_mark_dirty(surface) after modifying the pixels, before drawing on the surface with cairo again.
+ * 
+ * The surface is not garbage collected while the pixels object is in use.  Each call for the same surface handle returns the same object; cairo.surface_destroy() empties it (its length becomes 0).
+ * 
+ * @param {object} surface - opaque handle to a cairo image surface.
+ * @return {object} pixels - object of the above form, or null if the surface has no pixels in memory.
+ */
+static JSVAL image_surface_get_pixels(JSARGS args) {
+    cairo_surface_t *surface = (cairo_surface_t *) JSOPAQUE(args[0]);
+    if (cairo_surface_get_type(surface) != CAIRO_SURFACE_TYPE_IMAGE) {
+        return Null();
+    }
+    cairo_surface_flush(surface);
+    uint8_t *data = cairo_image_surface_get_data(surface);
+    int stride = cairo_image_surface_get_stride(surface);
+    int height = cairo_image_surface_get_height(surface);
+    if (!data) {
+        return Null();
+    }
+    // the view is kept on the handle, for cairo.surface_destroy()
+    JSOBJ handle = args[0]->ToObject();
+    Handle<Value>pixels = handle->GetHiddenValue(String::New("pixels"));
+    JSOBJ o;
+    if (!pixels.IsEmpty() && pixels->IsObject()) {
+        o = pixels->ToObject();
+    }
+    else {
+        o = Object::New();
+        o->SetHiddenValue(String::New("surface"), args[0]);
+        handle->SetHiddenValue(String::New("pixels"), o);
+    }
+    o->SetIndexedPropertiesToExternalArrayData(data, kExternalUnsignedByteArray, stride * height);
+    o->Set(String::New("length"), Integer::New(stride * height));
+    o->Set(String::New("width"), Integer::New(cairo_image_surface_get_width(surface)));
     o->Set(String::New("height"), Integer::New(height));
+    o->Set(String::New("stride"), Integer::New(stride));
+    o->Set(String::New("format"), Integer::New(cairo_image_surface_get_format(surface)));
     return o;
 }
 
+/*
+ * Box blur for cairo.surface_blur().  Each pass is separable: a sliding
+ * window sum along each row, then down each column, with the edge pixels
+ * repeated beyond the edges.  The four channels of a pixel are summed at
+ * once, in the lanes of an SSE2 register where available.  Rows are split
+ * across the thread pool.
+ */
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+typedef __m128i BlurPixel;
+
+static inline BlurPixel blurZero () {
+    return _mm_setzero_si128();
+}
+
+static inline BlurPixel blurLoad (const unsigned char *p) {
+    __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(*(const int *) p), zero), zero);
+}
+
+static inline BlurPixel blurAdd (BlurPixel a, BlurPixel b) {
+    return _mm_add_epi32(a, b);
+}
+
+static inline BlurPixel blurSub (BlurPixel a, BlurPixel b) {
+    return _mm_sub_epi32(a, b);
+}
+
+static inline void blurStore (unsigned char *p, BlurPixel sum, float scale) {
+    __m128i v = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(sum), _mm_set1_ps(scale)));
+    v = _mm_packs_epi32(v, v);
+    *(int *) p = _mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+}
+#else
+struct BlurPixel {
+    int c[4];
+};
+
+static inline BlurPixel blurZero () {
+    BlurPixel r = { { 0, 0, 0, 0 } };
+    return r;
+}
+
+static inline BlurPixel blurLoad (const unsigned char *p) {
+    BlurPixel r = { { p[0], p[1], p[2], p[3] } };
+    return r;
+}
+
+static inline BlurPixel blurAdd (BlurPixel a, BlurPixel b) {
+    for (int i = 0; i < 4; i++) {
+        a.c[i] += b.c[i];
+    }
+    return a;
+}
+
+static inline BlurPixel blurSub (BlurPixel a, BlurPixel b) {
+    for (int i = 0; i < 4; i++) {
+        a.c[i] -= b.c[i];
+    }
+    return a;
+}
+
+static inline void blurStore (unsigned char *p, BlurPixel sum, float scale) {
+    for (int i = 0; i < 4; i++) {
+        int v = (int) (sum.c[i] * scale + 0.5f);
+        p[i] = v > 255 ? 255 : v;
+    }
+}
+#endif
+
+struct BlurPass {
+    const unsigned char *src;
+    unsigned char *dst;
+    int width, height;
+    int srcStride, dstStride;
+    int radius;
+    float scale;
+};
+
+static inline int clampIndex (int i, int n) {
+    return i < 0 ? 0 : i >= n ? n - 1 : i;
+}
+
+static void blurRows (void *arg, int begin, int end) {
+    BlurPass *b = (BlurPass *) arg;
+    int w = b->width,
+        r = b->radius;
+    for (int y = begin; y < end; y++) {
+        const unsigned char *in = b->src + (size_t) y * b->srcStride;
+        unsigned char *out = b->dst + (size_t) y * b->dstStride;
+        BlurPixel sum = blurZero();
+        for (int i = -r; i <= r; i++) {
+            sum = blurAdd(sum, blurLoad(&in[clampIndex(i, w) * 4]));
+        }
+        for (int x = 0; x < w; x++) {
+            blurStore(&out[x * 4], sum, b->scale);
+            sum = blurAdd(sum, blurLoad(&in[clampIndex(x + r + 1, w) * 4]));
+            sum = blurSub(sum, blurLoad(&in[clampIndex(x - r, w) * 4]));
+        }
+    }
+}
+
+static void blurColumns (void *arg, int begin, int end) {
+    BlurPass *b = (BlurPass *) arg;
+    int w = b->width,
+        h = b->height,
+        r = b->radius;
+    BlurPixel *sums = new BlurPixel[w];
+    for (int x = 0; x < w; x++) {
+        sums[x] = blurZero();
+    }
+    for (int i = begin - r; i <= begin + r; i++) {
+        const unsigned char *in = b->src + (size_t) clampIndex(i, h) * b->srcStride;
+        for (int x = 0; x < w; x++) {
+            sums[x] = blurAdd(sums[x], blurLoad(&in[x * 4]));
+        }
+    }
+    for (int y = begin; y < end; y++) {
+        unsigned char *out = b->dst + (size_t) y * b->dstStride;
+        const unsigned char *enter = b->src + (size_t) clampIndex(y + r + 1, h) * b->srcStride,
+            *leave = b->src + (size_t) clampIndex(y - r, h) * b->srcStride;
+        for (int x = 0; x < w; x++) {
+            blurStore(&out[x * 4], sums[x], b->scale);
+            sums[x] = blurSub(blurAdd(sums[x], blurLoad(&enter[x * 4])), blurLoad(&leave[x * 4]));
+        }
+    }
+    delete [] sums;
+}
+
 /**
  * @function cairo.surface_blur
  * 
@@ -702,76 +1161,56 @@ static JSVAL image_surface_get_data(JSARGS args) {
  * 
  * cairo.surface_blur(surface, radius);
  * 
- * Blur the given surface with the given radius.
+ * Blur the given image surface with the given radius.  Three passes of a box blur approximate a gaussian blur.
  * 
  * ### Note
  * 
  * This is a helper function to implement Canvas class; it is not a part of Cairo.
  * 
- * @param {object} surface - opaque handle to a cairo surface.
+ * @param {object} surface - opaque handle to a cairo image surface (ARGB32 or RGB24).
  * @param {int} radius - radius to blur
  */
 static JSVAL surface_blur(JSARGS args) {
-    // see implementation at https://github.com/LearnBoost/node-canvas/blob/master/src/CanvasRenderingContext2d.cc
     cairo_surface_t *surface = (cairo_surface_t *) JSOPAQUE(args[0]);
-    int radius = args[1]->IntegerValue();
-
-    // Steve Hanov, 2009
-    // Released into the public domain.
-    --radius;
-    // get width, height
-    int width = cairo_image_surface_get_width(surface);
-    int height = cairo_image_surface_get_height(surface);
-    unsigned* precalc =
-        (unsigned*) malloc(width * height * sizeof (unsigned));
-    unsigned char* src = cairo_image_surface_get_data(surface);
-    double mul = 1.f / ((radius * 2)*(radius * 2));
-    int channel;
-
-    // The number of times to perform the averaging. According to wikipedia,
-    // three iterations is good enough to pass for a gaussian.
-    const int MAX_ITERATIONS = 3;
-    int iteration;
-
-    for (iteration = 0; iteration < MAX_ITERATIONS; iteration++) {
-        for (channel = 0; channel < 4; channel++) {
-            int x, y;
-
-            // precomputation step.
-            unsigned char* pix = src;
-            unsigned* pre = precalc;
-
-            pix += channel;
-            for (y = 0; y < height; y++) {
-                for (x = 0; x < width; x++) {
-                    int tot = pix[0];
-                    if (x > 0) tot += pre[-1];
-                    if (y > 0) tot += pre[-width];
-                    if (x > 0 && y > 0) tot -= pre[-width - 1];
-                    *pre++ = tot;
-                    pix += 4;
-                }
-            }
-
-            // blur step.
-            pix = src + (int) radius * width * 4 + (int) radius * 4 + channel;
-            for (y = radius; y < height - radius; y++) {
-                for (x = radius; x < width - radius; x++) {
-                    int l = x < radius ? 0 : x - radius;
-                    int t = y < radius ? 0 : y - radius;
-                    int r = x + radius >= width ? width - 1 : x + radius;
-                    int b = y + radius >= height ? height - 1 : y + radius;
-                    int tot = precalc[r + b * width] + precalc[l + t * width] -
-                        precalc[l + b * width] - precalc[r + t * width];
-                    *pix = (unsigned char) (tot * mul);
-                    pix += 4;
-                }
-                pix += (int) radius * 2 * 4;
-            }
-        }
+    int radius = args[1]->IntegerValue() - 1;
+    if (radius < 1 || cairo_surface_get_type(surface) != CAIRO_SURFACE_TYPE_IMAGE) {
+        return Undefined();
     }
-
-    free(precalc);
+    cairo_format_t format = cairo_image_surface_get_format(surface);
+    if (format != CAIRO_FORMAT_ARGB32 && format != CAIRO_FORMAT_RGB24) {
+        return Undefined();
+    }
+    cairo_surface_flush(surface);
+    int width = cairo_image_surface_get_width(surface),
+        height = cairo_image_surface_get_height(surface),
+        stride = cairo_image_surface_get_stride(surface);
+    unsigned char *data = cairo_image_surface_get_data(surface);
+    if (!data || width <= 0 || height <= 0) {
+        return Undefined();
+    }
+    vector<unsigned char>tmp((size_t) width * height * 4);
+
+    BlurPass rows, columns;
+    rows.src = data;
+    rows.dst = &tmp[0];
+    rows.srcStride = stride;
+    rows.dstStride = width * 4;
+    columns.src = &tmp[0];
+    columns.dst = data;
+    columns.srcStride = width * 4;
+    columns.dstStride = stride;
+    rows.width = columns.width = width;
+    rows.height = columns.height = height;
+    rows.radius = columns.radius = radius;
+    rows.scale = columns.scale = 1.0f / (2 * radius + 1);
+
+    // roughly 64K pixels per task
+    int grain = 65536 / width + 1;
+    for (int i = 0; i < 3; i++) {
+        ParallelFor(height, grain, blurRows, &rows);
+        ParallelFor(height, grain, blurColumns, &columns);
+    }
+    cairo_surface_mark_dirty(surface);
     return Undefined();
 }
 
@@ -793,7 +1232,7 @@ static JSVAL surface_blur(JSARGS args) {
  */
 static JSVAL context_create(JSARGS args) {
     cairo_surface_t *surface = (cairo_surface_t *) JSOPAQUE(args[0]);
-    return Opaque::New(cairo_create(surface));
+    return Opaque::New(cairo_create(surface), contextType);
 }
 
 /**
@@ -812,7 +1251,7 @@ static JSVAL context_create(JSARGS args) {
  */
 static JSVAL context_reference(JSARGS args) {
     cairo_t *context = (cairo_t *) JSOPAQUE(args[0]);
-    return Opaque::New(cairo_reference(context));
+    return Opaque::New(cairo_reference(context), contextType);
 }
 
 /**
@@ -847,7 +1286,10 @@ static JSVAL context_get_reference_count(JSARGS args) {
  */
 static JSVAL context_destroy(JSARGS args) {
     cairo_t *context = (cairo_t *) JSOPAQUE(args[0]);
-    cairo_destroy(context);
+    if (context) {
+        cairo_destroy(context);
+        Opaque::Clear(args[0]);
+    }
     return Undefined();
 }
 
@@ -967,7 +1409,7 @@ static JSVAL context_restore(JSARGS args) {
  */
 static JSVAL context_get_target(JSARGS args) {
     cairo_t *context = (cairo_t *) JSOPAQUE(args[0]);
-    return Opaque::New(cairo_get_target(context));
+    return Opaque::New(cairo_get_target(context), surfaceType, false);
 }
 
 /**
@@ -1054,7 +1496,7 @@ static JSVAL context_push_group_with_content(JSARGS args) {
  */
 static JSVAL context_pop_group(JSARGS args) {
     cairo_t *context = (cairo_t *) JSOPAQUE(args[0]);
-    return Opaque::New(cairo_pop_group(context));
+    return Opaque::New(cairo_pop_group(context), patternType);
 }
 
 /**
@@ -1101,7 +1543,7 @@ static JSVAL context_pop_group_to_source(JSARGS args) {
  */
 static JSVAL context_get_group_target(JSARGS args) {
     cairo_t *context = (cairo_t *) JSOPAQUE(args[0]);
-    return Opaque::New(cairo_get_group_target(context));
+    return Opaque::New(cairo_get_group_target(context), surfaceType, false);
 }
 
 /**
@@ -1223,7 +1665,7 @@ static JSVAL context_set_source_surface(JSARGS args) {
  */
 static JSVAL context_get_source(JSARGS args) {
     cairo_t *context = (cairo_t *) JSOPAQUE(args[0]);
-    return Opaque::New(cairo_get_source(context));
+    return Opaque::New(cairo_get_source(context), patternType, false);
 }
 
 /**
@@ -2302,7 +2744,7 @@ static JSVAL context_get_matrix(JSARGS args) {
     cairo_t *context = (cairo_t *) JSOPAQUE(args[0]);
     cairo_matrix_t *matrix = new cairo_matrix_t;
     cairo_get_matrix(context, matrix);
-    return Opaque::New(matrix);
+    return Opaque::New(matrix, matrixType);
 }
 
 /**
@@ -2484,7 +2926,7 @@ static JSVAL context_device_to_user_distance(JSARGS args) {
  */
 static JSVAL context_copy_path(JSARGS args) {
     cairo_t *context = (cairo_t *) JSOPAQUE(args[0]);
-    return Opaque::New(cairo_copy_path(context));
+    return Opaque::New(cairo_copy_path(context), pathType);
 }
 
 /**
@@ -2509,7 +2951,7 @@ static JSVAL context_copy_path(JSARGS args) {
  */
 static JSVAL context_copy_path_flat(JSARGS args) {
     cairo_t *context = (cairo_t *) JSOPAQUE(args[0]);
-    return Opaque::New(cairo_copy_path_flat(context));
+    return Opaque::New(cairo_copy_path_flat(context), pathType);
 }
 
 /**
@@ -2548,7 +2990,10 @@ static JSVAL context_append_path(JSARGS args) {
  */
 static JSVAL path_destroy(JSARGS args) {
     cairo_path_t *path = (cairo_path_t *)JSOPAQUE(args[0]);
-    cairo_path_destroy(path);
+    if (path) {
+        cairo_path_destroy(path);
+        Opaque::Clear(args[0]);
+    }
     return Undefined();
 }
 
@@ -3191,7 +3636,7 @@ static JSVAL context_get_font_matrix(JSARGS args) {
     cairo_t *context = (cairo_t *) JSOPAQUE(args[0]);
     cairo_matrix_t *matrix = new cairo_matrix_t;
     cairo_get_font_matrix(context, matrix);
-    return Opaque::New(matrix);
+    return Opaque::New(matrix, matrixType);
 }
 
 /**
@@ -3249,7 +3694,7 @@ static JSVAL context_get_font_options(JSARGS args) {
     cairo_t *context = (cairo_t *) JSOPAQUE(args[0]);
     cairo_font_options_t *options = cairo_font_options_create();
     cairo_get_font_options(context, options);
-    return Opaque::New(options);
+    return Opaque::New(options, fontOptionsType);
 }
 
 /**
@@ -3311,7 +3756,7 @@ static JSVAL context_set_font_face(JSARGS args) {
  */
 static JSVAL context_get_font_face(JSARGS args) {
     cairo_t *context = (cairo_t *) JSOPAQUE(args[0]);
-    return Opaque::New(cairo_get_font_face(context));
+    return Opaque::New(cairo_get_font_face(context), fontFaceType, false);
 }
 
 /**
@@ -3371,7 +3816,7 @@ static JSVAL context_set_scaled_font(JSARGS args) {
  */
 static JSVAL context_get_scaled_font(JSARGS args) {
     cairo_t *context = (cairo_t *) JSOPAQUE(args[0]);
-    return Opaque::New(cairo_get_scaled_font(context));
+    return Opaque::New(cairo_get_scaled_font(context), scaledFontType, false);
 }
 
 /**
@@ -3699,7 +4144,7 @@ static JSVAL context_glyph_extents(JSARGS args) {
 static JSVAL toy_font_face_create(JSARGS args) {
     String::Utf8Value family(args[0]->ToString());
     cairo_font_face_t *font_face = cairo_toy_font_face_create(*family, (cairo_font_slant_t)args[1]->IntegerValue(), (cairo_font_weight_t)args[2]->IntegerValue());
-    return Opaque::New(font_face);
+    return Opaque::New(font_face, fontFaceType);
 }
 #endif
 
@@ -3821,7 +4266,7 @@ static JSVAL toy_font_face_get_weight(JSARGS args) {
  */
 static JSVAL font_face_reference(JSARGS args) {
     cairo_font_face_t *font_face = (cairo_font_face_t *)JSOPAQUE(args[0]);
-    return Opaque::New(cairo_font_face_reference(font_face));
+    return Opaque::New(cairo_font_face_reference(font_face), fontFaceType);
 }
 
 /**
@@ -3839,7 +4284,10 @@ static JSVAL font_face_reference(JSARGS args) {
  */
 static JSVAL font_face_destroy(JSARGS args) {
     cairo_font_face_t *font_face = (cairo_font_face_t *)JSOPAQUE(args[0]);
-    cairo_font_face_destroy(font_face);
+    if (font_face) {
+        cairo_font_face_destroy(font_face);
+        Opaque::Clear(args[0]);
+    }
     return Undefined();
 }
 
@@ -3951,7 +4399,7 @@ static JSVAL scaled_font_create(JSARGS args) {
     cairo_matrix_t *font_matrix = (cairo_matrix_t *) JSOPAQUE(args[1]);
     cairo_matrix_t *ctm = (cairo_matrix_t *) JSOPAQUE(args[2]);
     cairo_font_options_t *options = (cairo_font_options_t *)JSOPAQUE(args[3]);
-    return Opaque::New(cairo_scaled_font_create(font_face, font_matrix, ctm, options));
+    return Opaque::New(cairo_scaled_font_create(font_face, font_matrix, ctm, options), scaledFontType);
 }
 
 /**
@@ -3972,7 +4420,7 @@ static JSVAL scaled_font_create(JSARGS args) {
  */
 static JSVAL scaled_font_reference(JSARGS args) {
     cairo_scaled_font_t *scaled_font = (cairo_scaled_font_t *)JSOPAQUE(args[0]);
-    return Opaque::New(cairo_scaled_font_reference(scaled_font));
+    return Opaque::New(cairo_scaled_font_reference(scaled_font), scaledFontType);
 }
 
 /**
@@ -3990,7 +4438,10 @@ static JSVAL scaled_font_reference(JSARGS args) {
  */
 static JSVAL scaled_font_destroy(JSARGS args) {
     cairo_scaled_font_t *scaled_font = (cairo_scaled_font_t *)JSOPAQUE(args[0]);
-    cairo_scaled_font_destroy(scaled_font);
+    if (scaled_font) {
+        cairo_scaled_font_destroy(scaled_font);
+        Opaque::Clear(args[0]);
+    }
     return Undefined();
 }
 
@@ -4192,7 +4643,7 @@ static JSVAL scaled_font_glyph_extents(JSARGS args) {
 #if CAIRO_VERSION_MINOR >= 2
 static JSVAL scaled_font_get_font_face(JSARGS args) {
     cairo_scaled_font_t *scaled_font = (cairo_scaled_font_t *)JSOPAQUE(args[0]);
-    return Opaque::New(cairo_scaled_font_get_font_face(scaled_font));
+    return Opaque::New(cairo_scaled_font_get_font_face(scaled_font), fontFaceType, false);
 }
 #endif
 
@@ -4221,7 +4672,7 @@ static JSVAL scaled_font_get_font_options(JSARGS args) {
     cairo_scaled_font_t *scaled_font = (cairo_scaled_font_t *)JSOPAQUE(args[0]);
     cairo_font_options_t *options = cairo_font_options_create();
     cairo_scaled_font_get_font_options(scaled_font, options);
-    return Opaque::New(options);
+    return Opaque::New(options, fontOptionsType);
 }
 #endif
 
@@ -4244,7 +4695,7 @@ static JSVAL scaled_font_get_font_matrix(JSARGS args) {
     cairo_scaled_font_t *scaled_font = (cairo_scaled_font_t *)JSOPAQUE(args[0]);
     cairo_matrix_t *matrix = new cairo_matrix_t;
     cairo_scaled_font_get_font_matrix(scaled_font, matrix);
-    return Opaque::New(matrix);
+    return Opaque::New(matrix, matrixType);
 }
 #endif
 
@@ -4269,7 +4720,7 @@ static JSVAL scaled_font_get_ctm(JSARGS args) {
     cairo_scaled_font_t *scaled_font = (cairo_scaled_font_t *)JSOPAQUE(args[0]);
     cairo_matrix_t *matrix = new cairo_matrix_t;
     cairo_scaled_font_get_ctm(scaled_font, matrix);
-    return Opaque::New(matrix);
+    return Opaque::New(matrix, matrixType);
 }
 #endif
 
@@ -4296,7 +4747,7 @@ static JSVAL scaled_font_get_scale_matrix(JSARGS args) {
     cairo_scaled_font_t *scaled_font = (cairo_scaled_font_t *)JSOPAQUE(args[0]);
     cairo_matrix_t *matrix = new cairo_matrix_t;
     cairo_scaled_font_get_scale_matrix(scaled_font, matrix);
-    return Opaque::New(matrix);
+    return Opaque::New(matrix, matrixType);
 }
 #endif
 
@@ -4361,7 +4812,7 @@ static JSVAL scaled_font_get_type(JSARGS args) {
  * @return {object} options - opaque handle to a font options object.
  */
 static JSVAL font_options_create(JSARGS args) {
-    return Opaque::New(cairo_font_options_create());
+    return Opaque::New(cairo_font_options_create(), fontOptionsType);
 }
 
 /**
@@ -4382,7 +4833,7 @@ static JSVAL font_options_create(JSARGS args) {
  */
 static JSVAL font_options_copy(JSARGS args) {
     cairo_font_options_t *original = (cairo_font_options_t *)JSOPAQUE(args[0]);
-    return Opaque::New(cairo_font_options_copy(original));
+    return Opaque::New(cairo_font_options_copy(original), fontOptionsType);
 }
 
 /**
@@ -4399,7 +4850,10 @@ static JSVAL font_options_copy(JSARGS args) {
  */
 static JSVAL font_options_destroy(JSARGS args) {
     cairo_font_options_t *options = (cairo_font_options_t *)JSOPAQUE(args[0]);
-    cairo_font_options_destroy(options);
+    if (options) {
+        cairo_font_options_destroy(options);
+        Opaque::Clear(args[0]);
+    }
     return Undefined();
 }
 
@@ -4690,6 +5144,238 @@ static JSVAL font_options_get_hint_metrics(JSARGS args) {
     return Integer::New(cairo_font_options_get_hint_metrics(options));
 }
 
+////////////////////////// FONT CACHE
+
+/*
+ * Scaled fonts for the toy font API, kept for the life of the process, with
+ * the font extents and the extents of the strings measured in each.
+ *
+ * cairo.font_cache_select() looks up (or creates) the scaled font for a
+ * family, slant, weight and size at the context's current matrix and font
+ * options, and sets it with cairo_set_scaled_font(), which is what
+ * cairo_select_font_face() and cairo_set_font_size() would otherwise
+ * resolve, through cairo's own caches, the next time text is drawn.
+ *
+ * The extents are cached by scaled font, whichever way the context's font
+ * was set; each entry holds a reference, so the font can't be freed and
+ * another one created at the same address.
+ */
+#define FONT_CACHE_FONTS 256
+#define FONT_CACHE_STRINGS 4096
+
+struct FontCacheEntry {
+    cairo_font_extents_t fontExtents;
+    bool haveFontExtents;
+    map<string, cairo_text_extents_t>textExtents;
+};
+
+static map<string, cairo_scaled_font_t *>fontCacheFonts;
+static map<cairo_scaled_font_t *, FontCacheEntry>fontCacheExtents;
+static double fontCacheHits = 0, fontCacheMisses = 0, extentsCacheHits = 0, extentsCacheMisses = 0;
+
+static void font_cache_clear_all () {
+    for (map<string, cairo_scaled_font_t *>::iterator it = fontCacheFonts.begin(); it != fontCacheFonts.end(); ++it) {
+        cairo_scaled_font_destroy(it->second);
+    }
+    fontCacheFonts.clear();
+    for (map<cairo_scaled_font_t *, FontCacheEntry>::iterator it = fontCacheExtents.begin(); it != fontCacheExtents.end(); ++it) {
+        cairo_scaled_font_destroy(it->first);
+    }
+    fontCacheExtents.clear();
+}
+
+static FontCacheEntry &font_cache_entry (cairo_t *context) {
+    cairo_scaled_font_t *font = cairo_get_scaled_font(context);
+    map<cairo_scaled_font_t *, FontCacheEntry>::iterator it = fontCacheExtents.find(font);
+    if (it != fontCacheExtents.end()) {
+        return it->second;
+    }
+    if (fontCacheExtents.size() >= FONT_CACHE_FONTS) {
+        font_cache_clear_all();
+    }
+    FontCacheEntry &entry = fontCacheExtents[cairo_scaled_font_reference(font)];
+    entry.haveFontExtents = false;
+    return entry;
+}
+
+/**
+ * @function cairo.font_cache_select
+ * 
+ * ### Synopsis
+ * 
+ * cairo.font_cache_select(context, family, slant, weight, size);
+ * 
+ * Set the context's font, like cairo.context_select_font_face() followed by cairo.context_set_font_size(), using a scaled font from a cache shared by all the contexts of the process.
+ * 
+ * The scaled font is looked up by family, slant, weight, size, the context's current matrix (without translation) and font options, so text drawn with the same font at the same scale never goes through font selection again.  If the matrix is changed afterwards, cairo picks the scaled font for the new matrix itself.
+ * 
+ * @param {object} context - opaque handle to a cairo context.
+ * @param {string} family - font family name.
+ * @param {int} slant - cairo.FONT_SLANT_NORMAL, cairo.FONT_SLANT_ITALIC or cairo.FONT_SLANT_OBLIQUE.
+ * @param {int} weight - cairo.FONT_WEIGHT_NORMAL or cairo.FONT_WEIGHT_BOLD.
+ * @param {number} size - font size, in user space units.
+ * @return {int} status - cairo.STATUS_SUCCESS, or the error creating the scaled font.
+ */
+static JSVAL font_cache_select(JSARGS args) {
+    cairo_t *context = (cairo_t *) JSOPAQUE(args[0]);
+    String::Utf8Value family(args[1]->ToString());
+    cairo_font_slant_t slant = (cairo_font_slant_t) args[2]->IntegerValue();
+    cairo_font_weight_t weight = (cairo_font_weight_t) args[3]->IntegerValue();
+    double size = args[4]->NumberValue();
+
+    cairo_matrix_t ctm, fontMatrix;
+    cairo_get_matrix(context, &ctm);
+    ctm.x0 = ctm.y0 = 0;
+    // the options cairo would use: the surface's, overridden by the context's
+    cairo_font_options_t *options = cairo_font_options_create(),
+        *contextOptions = cairo_font_options_create();
+    cairo_surface_get_font_options(cairo_get_target(context), options);
+    cairo_get_font_options(context, contextOptions);
+    cairo_font_options_merge(options, contextOptions);
+    cairo_font_options_destroy(contextOptions);
+
+    char key[256];
+    snprintf(key, sizeof(key), "%d %d %.17g %.17g %.17g %.17g %.17g %lu ", slant, weight, size, ctm.xx, ctm.yx, ctm.xy, ctm.yy, cairo_font_options_hash(options));
+    string k = string(key) + *family;
+
+    cairo_scaled_font_t *font;
+    map<string, cairo_scaled_font_t *>::iterator it = fontCacheFonts.find(k);
+    if (it != fontCacheFonts.end()) {
+        fontCacheHits++;
+        font = it->second;
+    }
+    else {
+        fontCacheMisses++;
+        cairo_font_face_t *face = cairo_toy_font_face_create(*family, slant, weight);
+        cairo_matrix_init_scale(&fontMatrix, size, size);
+        font = cairo_scaled_font_create(face, &fontMatrix, &ctm, options);
+        cairo_font_face_destroy(face);
+        cairo_status_t status = cairo_scaled_font_status(font);
+        if (status != CAIRO_STATUS_SUCCESS) {
+            cairo_scaled_font_destroy(font);
+            cairo_font_options_destroy(options);
+            return Integer::New(status);
+        }
+        if (fontCacheFonts.size() >= FONT_CACHE_FONTS) {
+            font_cache_clear_all();
+        }
+        fontCacheFonts[k] = font;
+    }
+    cairo_font_options_destroy(options);
+    cairo_set_scaled_font(context, font);
+    return Integer::New(cairo_status(context));
+}
+
+/**
+ * @function cairo.font_cache_font_extents
+ * 
+ * ### Synopsis
+ * 
+ * var extents = cairo.font_cache_font_extents(context);
+ * 
+ * Like cairo.context_font_extents(), but computed once per scaled font.
+ * 
+ * @param {object} context - opaque handle to a cairo context.
+ * @return {object} extents - see cairo.context_font_extents().
+ */
+static JSVAL font_cache_font_extents(JSARGS args) {
+    cairo_t *context = (cairo_t *) JSOPAQUE(args[0]);
+    FontCacheEntry &entry = font_cache_entry(context);
+    if (!entry.haveFontExtents) {
+        extentsCacheMisses++;
+        cairo_font_extents(context, &entry.fontExtents);
+        entry.haveFontExtents = true;
+    }
+    else {
+        extentsCacheHits++;
+    }
+    cairo_font_extents_t &extents = entry.fontExtents;
+    JSOBJ o = Object::New();
+    o->Set(String::New("ascent"), Number::New(extents.ascent));
+    o->Set(String::New("descent"), Number::New(extents.descent));
+    o->Set(String::New("height"), Number::New(extents.height));
+    o->Set(String::New("max_x_advance"), Number::New(extents.max_x_advance));
+    o->Set(String::New("max_y_advance"), Number::New(extents.max_y_advance));
+    return o;
+}
+
+/**
+ * @function cairo.font_cache_text_extents
+ * 
+ * ### Synopsis
+ * 
+ * var extents = cairo.font_cache_text_extents(context, text);
+ * 
+ * Like cairo.context_text_extents(), but remembered for each scaled font and string, so measuring the same labels again costs a lookup.
+ * 
+ * @param {object} context - opaque handle to a cairo context.
+ * @param {string} text - a string of text encoded in UTF8.
+ * @return {object} extents - see cairo.context_text_extents().
+ */
+static JSVAL font_cache_text_extents(JSARGS args) {
+    cairo_t *context = (cairo_t *) JSOPAQUE(args[0]);
+    String::Utf8Value text(args[1]->ToString());
+    FontCacheEntry &entry = font_cache_entry(context);
+    string s(*text, text.length());
+    map<string, cairo_text_extents_t>::iterator it = entry.textExtents.find(s);
+    cairo_text_extents_t extents;
+    if (it != entry.textExtents.end()) {
+        extentsCacheHits++;
+        extents = it->second;
+    }
+    else {
+        extentsCacheMisses++;
+        cairo_text_extents(context, *text, &extents);
+        if (entry.textExtents.size() >= FONT_CACHE_STRINGS) {
+            entry.textExtents.clear();
+        }
+        entry.textExtents[s] = extents;
+    }
+    JSOBJ o = Object::New();
+    o->Set(String::New("x_bearing"), Number::New(extents.x_bearing));
+    o->Set(String::New("y_bearing"), Number::New(extents.y_bearing));
+    o->Set(String::New("width"), Number::New(extents.width));
+    o->Set(String::New("height"), Number::New(extents.height));
+    o->Set(String::New("x_advance"), Number::New(extents.x_advance));
+    o->Set(String::New("y_advance"), Number::New(extents.y_advance));
+    return o;
+}
+
+/**
+ * @function cairo.font_cache_stats
+ * 
+ * ### Synopsis
+ * 
+ * var stats = cairo.font_cache_stats();
+ * 
+ * Get the number of cached scaled fonts, and the hits and misses of font selection and of extents lookups, since the process started (or was forked).
+ * 
+ * @return {object} stats - object with fonts, fontHits, fontMisses, extentsHits and extentsMisses members.
+ */
+static JSVAL font_cache_stats(JSARGS args) {
+    JSOBJ o = Object::New();
+    o->Set(String::New("fonts"), Integer::New(fontCacheFonts.size()));
+    o->Set(String::New("fontHits"), Number::New(fontCacheHits));
+    o->Set(String::New("fontMisses"), Number::New(fontCacheMisses));
+    o->Set(String::New("extentsHits"), Number::New(extentsCacheHits));
+    o->Set(String::New("extentsMisses"), Number::New(extentsCacheMisses));
+    return o;
+}
+
+/**
+ * @function cairo.font_cache_clear
+ * 
+ * ### Synopsis
+ * 
+ * cairo.font_cache_clear();
+ * 
+ * Release the cached scaled fonts and extents.  Contexts using one of the fonts keep their own reference to it.
+ */
+static JSVAL font_cache_clear(JSARGS args) {
+    font_cache_clear_all();
+    return Undefined();
+}
+
 ////////////////////////// PNG SUPPORT
 
 /**
@@ -4710,7 +5396,7 @@ static JSVAL font_options_get_hint_metrics(JSARGS args) {
  */
 static JSVAL image_surface_create_from_png(JSARGS args) {
     String::Utf8Value filename(args[0]->ToString());
-    return Opaque::New(cairo_image_surface_create_from_png(*filename));
+    return surfaceHandle(cairo_image_surface_create_from_png(*filename));
 }
 
 /**
@@ -4737,6 +5423,78 @@ static JSVAL surface_write_to_png(JSARGS args) {
     return Integer::New(cairo_surface_write_to_png(surface, *filename));
 }
 
+// cairo_write_func_t appending to a buffer
+static cairo_status_t appendPng (void *closure, const unsigned char *data, unsigned int length) {
+    BufferAppend((Buffer *) closure, (const char *) data, length);
+    return CAIRO_STATUS_SUCCESS;
+}
+
+// cairo_read_func_t reading the contents of a buffer
+struct PngSource {
+    const unsigned char *data;
+    long size;
+    long pos;
+};
+
+static cairo_status_t readPng (void *closure, unsigned char *data, unsigned int length) {
+    PngSource *src = (PngSource *) closure;
+    if (src->pos + (long) length > src->size) {
+        return CAIRO_STATUS_READ_ERROR;
+    }
+    memcpy(data, &src->data[src->pos], length);
+    src->pos += length;
+    return CAIRO_STATUS_SUCCESS;
+}
+
+/**
+ * @function cairo.image_surface_create_from_png_buffer
+ * 
+ * ### Synopsis
+ * 
+ * var surface = cairo.image_surface_create_from_png_buffer(buf);
+ * 
+ * Creates a new image surface and initializes the contents to the PNG image in a buffer.
+ * 
+ * Errors are reported as for cairo.image_surface_create_from_png(), with cairo.STATUS_READ_ERROR if the buffer holds less than a whole PNG image.
+ * 
+ * @param {object} buf - opaque handle to a buffer (see builtin/buffer).
+ * @return {object} surface - opaque handle to a newly created surface, or null if the buffer has been destroyed.
+ */
+static JSVAL image_surface_create_from_png_buffer(JSARGS args) {
+    Buffer *buf = (Buffer *) JSOPAQUE(args[0]);
+    if (!buf) {
+        return Null();
+    }
+    PngSource src = { buf->data(), buf->length(), 0 };
+    return surfaceHandle(cairo_image_surface_create_from_png_stream(readPng, &src));
+}
+
+/**
+ * @function cairo.surface_write_to_png_buffer
+ * 
+ * ### Synopsis
+ * 
+ * var status = cairo.surface_write_to_png_buffer(surface, buf);
+ * 
+ * Appends the contents of surface to a buffer as a PNG image, e.g. to the response body, so it can be sent without a temporary file.
+ * 
+ * Errors are as for cairo.surface_write_to_png().
+ * 
+ * @param {object} surface - opaque handle to a cairo surface.
+ * @param {object} buf - opaque handle to a buffer (see builtin/buffer).
+ * @return {int} status - either cairo.STATUS_SUCCESS, or one of the values listed for cairo.surface_write_to_png().
+ */
+static JSVAL surface_write_to_png_buffer(JSARGS args) {
+    cairo_surface_t *surface = (cairo_surface_t *) JSOPAQUE(args[0]);
+    Buffer *buf = (Buffer *) JSOPAQUE(args[1]);
+    if (!buf) {
+        return Integer::New(CAIRO_STATUS_WRITE_ERROR);
+    }
+    cairo_status_t status = cairo_surface_write_to_png_stream(surface, appendPng, buf);
+    BufferAccount(args[1], buf);
+    return Integer::New(status);
+}
+
 ////////////////////////// PATTERNS
 // http://www.cairographics.org/manual/cairo-cairo-pattern-t.html
 
@@ -4907,7 +5665,7 @@ static JSVAL pattern_create_rgb(JSARGS args) {
         args[1]->NumberValue(),     // red
         args[2]->NumberValue(),     // green
         args[3]->NumberValue()      // blue
-     ));
+     ), patternType);
 }
 
 /**
@@ -4937,7 +5695,7 @@ static JSVAL pattern_create_rgba(JSARGS args) {
         args[2]->NumberValue(),     // green
         args[3]->NumberValue(),     // blue
         args[4]->NumberValue()      // alpha
-     ));
+     ), patternType);
 }
 
 /**
@@ -4996,7 +5754,7 @@ static JSVAL pattern_get_rgba(JSARGS args) {
  */
 static JSVAL pattern_create_for_surface(JSARGS args) {
     cairo_surface_t *surface = (cairo_surface_t *) JSOPAQUE(args[0]);
-    return Opaque::New(cairo_pattern_create_for_surface(surface));
+    return Opaque::New(cairo_pattern_create_for_surface(surface), patternType);
 }
 
 /**
@@ -5024,7 +5782,7 @@ static JSVAL pattern_get_surface(JSARGS args) {
     if (status != CAIRO_STATUS_SUCCESS) {
         ThrowException(String::New(cairo_status_to_string(status)));
     }
-    return Opaque::New(surface);
+    return Opaque::New(surface, surfaceType, false);
 }
 
 /**
@@ -5056,7 +5814,7 @@ static JSVAL pattern_create_linear(JSARGS args) {
         args[1]->NumberValue(),     // y0
         args[2]->NumberValue(),     // x1
         args[3]->NumberValue()      // y1
-    ));
+    ), patternType);
 }
 
 /**
@@ -5130,7 +5888,7 @@ static JSVAL pattern_create_radial(JSARGS args) {
         args[3]->NumberValue(),     // cx1
         args[4]->NumberValue(),     // cy1
         args[5]->NumberValue()      // radius1
-    ));
+    ), patternType);
 }
 
 /**
@@ -5193,7 +5951,29 @@ static JSVAL pattern_get_radial_circles(JSARGS args) {
  */
 static JSVAL pattern_reference(JSARGS args) {
     cairo_pattern_t *pattern = (cairo_pattern_t *) JSOPAQUE(args[0]);
-    return Opaque::New(cairo_pattern_reference(pattern));
+    return Opaque::New(cairo_pattern_reference(pattern), patternType);
+}
+
+/**
+ * @function cairo.pattern_destroy
+ * 
+ * ### Synopsis
+ * 
+ * cairo.pattern_destroy(pattern);
+ * 
+ * Decreases the reference count on pattern by one. 
+ * 
+ * If the result is zero, then pattern and all associated resources are freed. See cairo.pattern_reference().
+ * 
+ * @param {object} pattern - opaque handle to a cairo pattern.
+ */
+static JSVAL pattern_destroy(JSARGS args) {
+    cairo_pattern_t *pattern = (cairo_pattern_t *) JSOPAQUE(args[0]);
+    if (pattern) {
+        cairo_pattern_destroy(pattern);
+        Opaque::Clear(args[0]);
+    }
+    return Undefined();
 }
 
 /**
@@ -5386,7 +6166,7 @@ static JSVAL pattern_get_matrix(JSARGS args) {
     cairo_pattern_t *pattern = (cairo_pattern_t *) JSOPAQUE(args[0]);
     cairo_matrix_t *matrix = new cairo_matrix_t;
     cairo_pattern_get_matrix(pattern, matrix);
-    return Opaque::New(matrix);
+    return Opaque::New(matrix, matrixType);
 }
 
 /**
@@ -5474,7 +6254,7 @@ static JSVAL pattern_get_reference_count(JSARGS args) {
 static JSVAL matrix_create(JSARGS args) {
     cairo_matrix_t *matrix = new cairo_matrix_t;
     cairo_matrix_init_identity(matrix);
-    return Opaque::New(matrix);
+    return Opaque::New(matrix, matrixType);
 }
 
 /**
@@ -5534,7 +6314,7 @@ static JSVAL matrix_clone(JSARGS args) {
     cairo_matrix_t *matrix = (cairo_matrix_t *) JSOPAQUE(args[0]);
     cairo_matrix_t *clone = new cairo_matrix_t;
     memcpy(clone, matrix, sizeof(cairo_matrix_t));
-    return Opaque::New(clone);
+    return Opaque::New(clone, matrixType);
 }
 
 
@@ -5722,7 +6502,7 @@ static JSVAL matrix_multiply(JSARGS args) {
     cairo_matrix_t *b = (cairo_matrix_t *) JSOPAQUE(args[1]);
     cairo_matrix_t *result = new cairo_matrix_t;
     cairo_matrix_multiply(result, a, b);
-    return Opaque::New(result);
+    return Opaque::New(result, matrixType);
 }
 
 /**
@@ -5815,7 +6595,10 @@ static JSVAL matrix_transform_point(JSARGS args) {
  */
 static JSVAL matrix_destroy(JSARGS args) {
     cairo_matrix_t *matrix = (cairo_matrix_t *) JSOPAQUE(args[0]);
-    delete matrix;
+    if (matrix) {
+        delete matrix;
+        Opaque::Clear(args[0]);
+    }
     return Undefined();
 }
 
@@ -5843,7 +6626,7 @@ static JSVAL matrix_destroy(JSARGS args) {
  */
 #if CAIRO_VERSION_MINOR >= 10
 static JSVAL region_create(JSARGS args) {
-    return Opaque::New(cairo_region_create());
+    return Opaque::New(cairo_region_create(), regionType);
 }
 #endif
 
@@ -5887,7 +6670,7 @@ static JSVAL region_create_rectangle(JSARGS args) {
         o->Get(_w)->IntegerValue(),
         o->Get(_h)->IntegerValue()
     };
-    return Opaque::New(cairo_region_create_rectangle(&rect));
+    return Opaque::New(cairo_region_create_rectangle(&rect), regionType);
 }
 #endif
 
@@ -5938,7 +6721,7 @@ static JSVAL region_create_rectangles(JSARGS args) {
     }
     cairo_region_t *region = cairo_region_create_rectangles(rects, numRectangles);
     delete [] rects;
-    return Opaque::New(region);
+    return Opaque::New(region, regionType);
     
 }
 #endif
@@ -5966,7 +6749,7 @@ static JSVAL region_create_rectangles(JSARGS args) {
 #if CAIRO_VERSION_MINOR >= 10
 static JSVAL region_copy(JSARGS args) {
     cairo_region_t *region = (cairo_region_t *) JSOPAQUE(args[0]);
-    return Opaque::New(cairo_region_copy(region));
+    return Opaque::New(cairo_region_copy(region), regionType);
 }
 #endif
 
@@ -5989,7 +6772,7 @@ static JSVAL region_copy(JSARGS args) {
 #if CAIRO_VERSION_MINOR >= 10
 static JSVAL region_reference(JSARGS args) {
     cairo_region_t *region = (cairo_region_t *) JSOPAQUE(args[0]);
-    return Opaque::New(cairo_region_reference(region));
+    return Opaque::New(cairo_region_reference(region), regionType);
 }
 #endif
 
@@ -6009,7 +6792,10 @@ static JSVAL region_reference(JSARGS args) {
 #if CAIRO_VERSION_MINOR >= 10
 static JSVAL region_destroy(JSARGS args) {
     cairo_region_t *region = (cairo_region_t *) JSOPAQUE(args[0]);
-    cairo_region_destroy(region);
+    if (region) {
+        cairo_region_destroy(region);
+        Opaque::Clear(args[0]);
+    }
     return Undefined();
 }
 #endif
@@ -6522,6 +7308,256 @@ static JSVAL region_xor_rectangle(JSARGS args) {
 #endif
 
 
+////////////////////////// COMMAND LISTS
+
+/*
+ * A command list is a handle whose indexed elements are doubles in native
+ * memory (an external array), so JavaScript can store opcodes and their
+ * arguments into it as fast as into a plain array:
+ *
+ *     cmds[n++] = cairo.CMD_LINE_TO; cmds[n++] = x; cmds[n++] = y;
+ *
+ * and cairo.execute() replays them against a context in one call, rather
+ * than one native call per path segment.
+ */
+enum {
+    CMD_NEW_PATH,
+    CMD_CLOSE_PATH,
+    CMD_MOVE_TO,
+    CMD_LINE_TO,
+    CMD_CURVE_TO,
+    CMD_QUAD_CURVE_TO,
+    CMD_ARC,
+    CMD_ARC_NEGATIVE,
+    CMD_RECTANGLE,
+    CMD_SAVE,
+    CMD_RESTORE,
+    CMD_TRANSLATE,
+    CMD_SCALE,
+    CMD_ROTATE,
+    CMD_TRANSFORM,
+    CMD_IDENTITY_MATRIX,
+    CMD_SET_SOURCE_RGBA,
+    CMD_SET_LINE_WIDTH,
+    CMD_SET_OPERATOR,
+    CMD_FILL,
+    CMD_FILL_PRESERVE,
+    CMD_STROKE,
+    CMD_STROKE_PRESERVE,
+    CMD_CLIP,
+    CMD_CLIP_PRESERVE,
+    CMD_PAINT,
+    CMD_PAINT_WITH_ALPHA,
+    CMD_COUNT
+};
+
+// number of arguments following each opcode
+static const int commandArgs[CMD_COUNT] = {
+    0, 0, 2, 2, 6, 4, 5, 5, 4,      // paths
+    0, 0, 2, 2, 1, 6, 0,            // state and transformations
+    4, 1, 1,                        // source, line width, operator
+    0, 0, 0, 0, 0, 0, 0, 1          // drawing
+};
+
+static void free_commands (void *p) {
+    delete [] (double *) p;
+}
+
+static OpaqueType commandsType("cairo.commands", free_commands);
+
+/**
+ * @function cairo.commands_create
+ * 
+ * ### Synopsis
+ * 
+ * var cmds = cairo.commands_create(size);
+ * 
+ * Create a command list to be replayed by cairo.execute().
+ * 
+ * The command list holds size numbers: each command is one of the cairo.CMD_* opcodes followed by its arguments, which are those of the corresponding cairo.context_* function without the context.  For example:
+ * 
+ * + cairo.CMD_MOVE_TO, x, y
+ * + cairo.CMD_ARC, xc, yc, radius, angle1, angle2
+ * + cairo.CMD_SET_SOURCE_RGBA, red, green, blue, alpha
+ * + cairo.CMD_TRANSFORM, xx, yx, xy, yy, x0, y0
+ * + cairo.CMD_QUAD_CURVE_TO, x1, y1, x2, y2 (a quadratic curve from the current point)
+ * 
+ * The list does not grow; execute it and start over when it is full.
+ * 
+ * @param {int} size - number of elements.
+ * @return {object} cmds - opaque handle to a command list, indexed like an array.
+ */
+static JSVAL commands_create(JSARGS args) {
+    int size = args[0]->IntegerValue();
+    if (size <= 0) {
+        return ThrowException(String::New("cairo.commands_create: invalid size"));
+    }
+    double *cmds = new double[size];
+    Handle<Object>o = Opaque::New(cmds, commandsType, true, (long) size * sizeof (double));
+    o->SetIndexedPropertiesToExternalArrayData(cmds, kExternalDoubleArray, size);
+    return o;
+}
+
+/**
+ * @function cairo.commands_destroy
+ * 
+ * ### Synopsis
+ * 
+ * cairo.commands_destroy(cmds);
+ * 
+ * Free a command list.  Command lists are also freed when they are garbage collected.
+ * 
+ * @param {object} cmds - opaque handle to a command list.
+ */
+static JSVAL commands_destroy(JSARGS args) {
+    double *cmds = (double *) JSOPAQUE(args[0]);
+    if (cmds) {
+        args[0]->ToObject()->SetIndexedPropertiesToExternalArrayData(NULL, kExternalDoubleArray, 0);
+        Opaque::Clear(args[0]);
+        delete [] cmds;
+    }
+    return Undefined();
+}
+
+/**
+ * @function cairo.execute
+ * 
+ * ### Synopsis
+ * 
+ * var status = cairo.execute(context, cmds, count);
+ * 
+ * Replay the first count elements of a command list against a context.
+ * 
+ * An exception is thrown for an unknown opcode or a command cut off by count; the commands before it have been executed.
+ * 
+ * @param {object} context - opaque handle to a cairo context.
+ * @param {object} cmds - opaque handle to a command list, see cairo.commands_create().
+ * @param {int} count - number of elements to execute (defaults to the whole list).
+ * @return {int} status - the context's status, see cairo.context_status().
+ */
+static JSVAL execute(JSARGS args) {
+    cairo_t *context = (cairo_t *) JSOPAQUE(args[0]);
+    JSOBJ o = args[1]->ToObject();
+    if (!o->HasIndexedPropertiesInExternalArrayData() || o->GetIndexedPropertiesExternalArrayDataType() != kExternalDoubleArray) {
+        return ThrowException(String::New("cairo.execute: not a command list"));
+    }
+    const double *cmds = (const double *) o->GetIndexedPropertiesExternalArrayData();
+    int count = o->GetIndexedPropertiesExternalArrayDataLength();
+    if (args.Length() > 2 && args[2]->IntegerValue() < count) {
+        count = args[2]->IntegerValue();
+    }
+    cairo_matrix_t matrix;
+    double x, y;
+    int i = 0;
+    while (i < count) {
+        int op = (int) cmds[i];
+        if (op < 0 || op >= CMD_COUNT) {
+            return ThrowException(String::New("cairo.execute: unknown command"));
+        }
+        if (i + commandArgs[op] >= count) {
+            return ThrowException(String::New("cairo.execute: incomplete command"));
+        }
+        const double *a = &cmds[i + 1];
+        switch (op) {
+            case CMD_NEW_PATH:
+                cairo_new_path(context);
+                break;
+            case CMD_CLOSE_PATH:
+                cairo_close_path(context);
+                break;
+            case CMD_MOVE_TO:
+                cairo_move_to(context, a[0], a[1]);
+                break;
+            case CMD_LINE_TO:
+                cairo_line_to(context, a[0], a[1]);
+                break;
+            case CMD_CURVE_TO:
+                cairo_curve_to(context, a[0], a[1], a[2], a[3], a[4], a[5]);
+                break;
+            case CMD_QUAD_CURVE_TO:
+                if (cairo_has_current_point(context)) {
+                    cairo_get_current_point(context, &x, &y);
+                }
+                else {
+                    x = a[0];
+                    y = a[1];
+                }
+                cairo_curve_to(context,
+                    x + 2.0 / 3.0 * (a[0] - x), y + 2.0 / 3.0 * (a[1] - y),
+                    a[2] + 2.0 / 3.0 * (a[0] - a[2]), a[3] + 2.0 / 3.0 * (a[1] - a[3]),
+                    a[2], a[3]
+                );
+                break;
+            case CMD_ARC:
+                cairo_arc(context, a[0], a[1], a[2], a[3], a[4]);
+                break;
+            case CMD_ARC_NEGATIVE:
+                cairo_arc_negative(context, a[0], a[1], a[2], a[3], a[4]);
+                break;
+            case CMD_RECTANGLE:
+                cairo_rectangle(context, a[0], a[1], a[2], a[3]);
+                break;
+            case CMD_SAVE:
+                cairo_save(context);
+                break;
+            case CMD_RESTORE:
+                cairo_restore(context);
+                break;
+            case CMD_TRANSLATE:
+                cairo_translate(context, a[0], a[1]);
+                break;
+            case CMD_SCALE:
+                cairo_scale(context, a[0], a[1]);
+                break;
+            case CMD_ROTATE:
+                cairo_rotate(context, a[0]);
+                break;
+            case CMD_TRANSFORM:
+                cairo_matrix_init(&matrix, a[0], a[1], a[2], a[3], a[4], a[5]);
+                cairo_transform(context, &matrix);
+                break;
+            case CMD_IDENTITY_MATRIX:
+                cairo_identity_matrix(context);
+                break;
+            case CMD_SET_SOURCE_RGBA:
+                cairo_set_source_rgba(context, a[0], a[1], a[2], a[3]);
+                break;
+            case CMD_SET_LINE_WIDTH:
+                cairo_set_line_width(context, a[0]);
+                break;
+            case CMD_SET_OPERATOR:
+                cairo_set_operator(context, (cairo_operator_t) (int) a[0]);
+                break;
+            case CMD_FILL:
+                cairo_fill(context);
+                break;
+            case CMD_FILL_PRESERVE:
+                cairo_fill_preserve(context);
+                break;
+            case CMD_STROKE:
+                cairo_stroke(context);
+                break;
+            case CMD_STROKE_PRESERVE:
+                cairo_stroke_preserve(context);
+                break;
+            case CMD_CLIP:
+                cairo_clip(context);
+                break;
+            case CMD_CLIP_PRESERVE:
+                cairo_clip_preserve(context);
+                break;
+            case CMD_PAINT:
+                cairo_paint(context);
+                break;
+            case CMD_PAINT_WITH_ALPHA:
+                cairo_paint_with_alpha(context, a[0]);
+                break;
+        }
+        i += 1 + commandArgs[op];
+    }
+    return Integer::New(cairo_status(context));
+}
+
 //\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\///\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//
 //\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\///\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//
 //\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\///\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//
@@ -6770,6 +7806,9 @@ void init_cairo_object () {
     cairo->Set(String::New("image_surface_get_width"), FunctionTemplate::New(image_surface_get_width));
     cairo->Set(String::New("image_surface_get_height"), FunctionTemplate::New(image_surface_get_height));
     cairo->Set(String::New("image_surface_get_data"), FunctionTemplate::New(image_surface_get_data));
+    cairo->Set(String::New("image_surface_put_data"), FunctionTemplate::New(image_surface_put_data));
+    cairo->Set(String::New("image_surface_get_pixels"), FunctionTemplate::New(image_surface_get_pixels));
+    cairo->Set(String::New("image_data_create"), FunctionTemplate::New(image_data_create));
     cairo->Set(String::New("surface_blur"), FunctionTemplate::New(surface_blur));
     cairo->Set(String::New("context_create"), FunctionTemplate::New(context_create));
     cairo->Set(String::New("context_reference"), FunctionTemplate::New(context_reference));
@@ -6916,8 +7955,15 @@ void init_cairo_object () {
     cairo->Set(String::New("font_options_get_hint_style"), FunctionTemplate::New(font_options_get_hint_style));
     cairo->Set(String::New("font_options_set_hint_metrics"), FunctionTemplate::New(font_options_set_hint_metrics));
     cairo->Set(String::New("font_options_get_hint_metrics"), FunctionTemplate::New(font_options_get_hint_metrics));
+    cairo->Set(String::New("font_cache_select"), FunctionTemplate::New(font_cache_select));
+    cairo->Set(String::New("font_cache_font_extents"), FunctionTemplate::New(font_cache_font_extents));
+    cairo->Set(String::New("font_cache_text_extents"), FunctionTemplate::New(font_cache_text_extents));
+    cairo->Set(String::New("font_cache_stats"), FunctionTemplate::New(font_cache_stats));
+    cairo->Set(String::New("font_cache_clear"), FunctionTemplate::New(font_cache_clear));
     cairo->Set(String::New("image_surface_create_from_png"), FunctionTemplate::New(image_surface_create_from_png));
     cairo->Set(String::New("surface_write_to_png"), FunctionTemplate::New(surface_write_to_png));
+    cairo->Set(String::New("image_surface_create_from_png_buffer"), FunctionTemplate::New(image_surface_create_from_png_buffer));
+    cairo->Set(String::New("surface_write_to_png_buffer"), FunctionTemplate::New(surface_write_to_png_buffer));
     cairo->Set(String::New("pattern_add_color_stop_rgb"), FunctionTemplate::New(pattern_add_color_stop_rgb));
     cairo->Set(String::New("pattern_add_color_stop_rgba"), FunctionTemplate::New(pattern_add_color_stop_rgba));
     cairo->Set(String::New("pattern_get_stop_color_count"), FunctionTemplate::New(pattern_get_stop_color_count));
@@ -6932,6 +7978,7 @@ void init_cairo_object () {
     cairo->Set(String::New("pattern_create_radial"), FunctionTemplate::New(pattern_create_radial));
     cairo->Set(String::New("pattern_get_radial_circles"), FunctionTemplate::New(pattern_get_radial_circles));
     cairo->Set(String::New("pattern_reference"), FunctionTemplate::New(pattern_reference));
+    cairo->Set(String::New("pattern_destroy"), FunctionTemplate::New(pattern_destroy));
     cairo->Set(String::New("pattern_status"), FunctionTemplate::New(pattern_status));
     cairo->Set(String::New("pattern_set_extend"), FunctionTemplate::New(pattern_set_extend));
     cairo->Set(String::New("pattern_get_extend"), FunctionTemplate::New(pattern_get_extend));
@@ -6981,5 +8028,35 @@ void init_cairo_object () {
     cairo->Set(String::New("region_xor"), FunctionTemplate::New(region_xor));
     cairo->Set(String::New("region_xor_rectangle"), FunctionTemplate::New(region_xor_rectangle));
 #endif    
+    cairo->Set(String::New("CMD_NEW_PATH"), Integer::New(CMD_NEW_PATH));
+    cairo->Set(String::New("CMD_CLOSE_PATH"), Integer::New(CMD_CLOSE_PATH));
+    cairo->Set(String::New("CMD_MOVE_TO"), Integer::New(CMD_MOVE_TO));
+    cairo->Set(String::New("CMD_LINE_TO"), Integer::New(CMD_LINE_TO));
+    cairo->Set(String::New("CMD_CURVE_TO"), Integer::New(CMD_CURVE_TO));
+    cairo->Set(String::New("CMD_QUAD_CURVE_TO"), Integer::New(CMD_QUAD_CURVE_TO));
+    cairo->Set(String::New("CMD_ARC"), Integer::New(CMD_ARC));
+    cairo->Set(String::New("CMD_ARC_NEGATIVE"), Integer::New(CMD_ARC_NEGATIVE));
+    cairo->Set(String::New("CMD_RECTANGLE"), Integer::New(CMD_RECTANGLE));
+    cairo->Set(String::New("CMD_SAVE"), Integer::New(CMD_SAVE));
+    cairo->Set(String::New("CMD_RESTORE"), Integer::New(CMD_RESTORE));
+    cairo->Set(String::New("CMD_TRANSLATE"), Integer::New(CMD_TRANSLATE));
+    cairo->Set(String::New("CMD_SCALE"), Integer::New(CMD_SCALE));
+    cairo->Set(String::New("CMD_ROTATE"), Integer::New(CMD_ROTATE));
+    cairo->Set(String::New("CMD_TRANSFORM"), Integer::New(CMD_TRANSFORM));
+    cairo->Set(String::New("CMD_IDENTITY_MATRIX"), Integer::New(CMD_IDENTITY_MATRIX));
+    cairo->Set(String::New("CMD_SET_SOURCE_RGBA"), Integer::New(CMD_SET_SOURCE_RGBA));
+    cairo->Set(String::New("CMD_SET_LINE_WIDTH"), Integer::New(CMD_SET_LINE_WIDTH));
+    cairo->Set(String::New("CMD_SET_OPERATOR"), Integer::New(CMD_SET_OPERATOR));
+    cairo->Set(String::New("CMD_FILL"), Integer::New(CMD_FILL));
+    cairo->Set(String::New("CMD_FILL_PRESERVE"), Integer::New(CMD_FILL_PRESERVE));
+    cairo->Set(String::New("CMD_STROKE"), Integer::New(CMD_STROKE));
+    cairo->Set(String::New("CMD_STROKE_PRESERVE"), Integer::New(CMD_STROKE_PRESERVE));
+    cairo->Set(String::New("CMD_CLIP"), Integer::New(CMD_CLIP));
+    cairo->Set(String::New("CMD_CLIP_PRESERVE"), Integer::New(CMD_CLIP_PRESERVE));
+    cairo->Set(String::New("CMD_PAINT"), Integer::New(CMD_PAINT));
+    cairo->Set(String::New("CMD_PAINT_WITH_ALPHA"), Integer::New(CMD_PAINT_WITH_ALPHA));
+    cairo->Set(String::New("commands_create"), FunctionTemplate::New(commands_create));
+    cairo->Set(String::New("commands_destroy"), FunctionTemplate::New(commands_destroy));
+    cairo->Set(String::New("execute"), FunctionTemplate::New(execute));
     builtinObject->Set(String::New("cairo"), cairo);
 }
@@ -37,6 +37,23 @@ static inline CHANDLE *HANDLE (Handle<Value>v) {
     return w;
 }
 
+static void free_handle (void *p) {
+    CHANDLE *h = (CHANDLE *) p;
+    if (h->slist) {
+        curl_slist_free_all(h->slist);
+    }
+    if (h->post) {
+        curl_formfree(h->post);
+    }
+    curl_easy_cleanup(h->curl);
+    free(h->memory);
+    free(h->headers);
+    delete h;
+}
+
+// handles not freed with curl.destroy() are freed when they are garbage collected
+static OpaqueType handleType("curl.handle", free_handle);
+
 static size_t WriteMemoryCallback (void *contents, size_t size, size_t nmemb, void *userp) {
     size_t realsize = size * nmemb;
     struct CHANDLE *w = (CHANDLE *) userp;
@@ -120,7 +137,7 @@ static JSVAL init (JSARGS args) {
     curl_easy_setopt(curl, CURLOPT_HEADERDATA, (void *) w);
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1);
     curl_easy_setopt(curl, CURLOPT_USERAGENT, "SilkJS/1.0");
-    return Opaque::New(w);
+    return Opaque::New(w, handleType);
 }
 
 /**
@@ -372,7 +389,10 @@ static JSVAL perform (JSARGS args) {
     if (args.Length() > 1) {
         curl_easy_setopt(h->curl, CURLOPT_VERBOSE, args[1]->IntegerValue());
     }
-    return Integer::New(curl_easy_perform(h->curl));
+    CURLcode rc = curl_easy_perform(h->curl);
+    // the response is held in the handle until it is destroyed
+    Opaque::Resize(args[0], h->size + h->hsize);
+    return Integer::New(rc);
 }
 
 /**
@@ -469,17 +489,10 @@ static JSVAL getResponseText (JSARGS args) {
  */
 static JSVAL destroy (JSARGS args) {
     CHANDLE *h = HANDLE(args[0]);
-    if (h->slist) {
-        curl_slist_free_all(h->slist);
-        h->slist = NULL;
-    }
-    if (h->post) {
-        curl_formfree(h->post);
+    if (h) {
+        Opaque::Clear(args[0]);
+        free_handle(h);
     }
-    curl_easy_cleanup(h->curl);
-    free(h->memory);
-    free(h->headers);
-    free(h);
     return Undefined();
 }
 
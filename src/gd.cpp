@@ -21,11 +21,57 @@
 #include <gdfontmb.h>
 #include <gdfontg.h>
 #include <gdfontt.h>
+#include <math.h>
+
+// gdresample.cpp
+extern void GdResample(gdImagePtr dst, gdImagePtr src, int dstX, int dstY, int srcX, int srcY, int dstW, int dstH, int srcW, int srcH, int filter);
+extern void GdUnsharpMask(gdImagePtr im, double sigma, double amount, int threshold);
+extern const char *GdResampleSimd();
+// gddiff.cpp
+extern long GdDiff(gdImagePtr a, gdImagePtr b, gdImagePtr diff, int threshold, double perceptual, int *maxDelta, double *maxPerceptual, int box[4]);
 
 // not implemented:
 // gd2 file format functions
 // animated gif functions
 
+static void free_image (void *p) {
+    gdImageDestroy((gdImagePtr) p);
+}
+
+// images not destroyed with gd.imageDestroy() are freed when their handle is garbage collected
+static OpaqueType imageType("gd.image", free_image);
+// the pixels, and the row pointers, are reported to V8 as external memory
+static Handle<Object>imageHandle (gdImagePtr im) {
+    long size = 0;
+    if (im) {
+        size = (long) gdImageSY(im) * (gdImageSX(im) * (gdImageTrueColor(im) ? sizeof(int) : 1) + sizeof(void *));
+    }
+    return Opaque::New(im, imageType, true, size);
+}
+
+// the builtin fonts are static
+static OpaqueType fontType("gd.font");
+
+// the contents of a buffer (see builtin/buffer), to decode an image from
+static Buffer *bufferArg (Handle<Value>v) {
+    return Opaque::Is(v, bufferType) ? (Buffer *) JSOPAQUE(v) : NULL;
+}
+
+// append image data from one of the gdImage*Ptr() functions to a buffer
+static JSVAL appendImage (Handle<Value>handle, void *ptr, int size) {
+    Buffer *buf = bufferArg(handle);
+    if (!ptr || !buf) {
+        if (ptr) {
+            gdFree(ptr);
+        }
+        return False();
+    }
+    BufferAppend(buf, (const char *) ptr, size);
+    BufferAccount(handle, buf);
+    gdFree(ptr);
+    return Integer::New(size);
+}
+
 /**
  * @function gd.imageCreate
  * 
@@ -50,7 +96,7 @@ static JSVAL gd_imageCreate (JSARGS args) {
     if (!im) {
         return Null();
     }
-    return Opaque::New(im);
+    return imageHandle(im);
 }
 
 /**
@@ -77,7 +123,7 @@ static JSVAL gd_imageCreateTrueColor (JSARGS args) {
     if (!im) {
         return Null();
     }
-    return Opaque::New(im);
+    return imageHandle(im);
 }
 
 /**
@@ -125,7 +171,7 @@ static JSVAL gd_ImageCreateFromJpeg (JSARGS args) {
     if (!im) {
         return Null();
     }
-    return Opaque::New(im);
+    return imageHandle(im);
 }
 
 /**
@@ -150,7 +196,31 @@ static JSVAL gd_imageCreateFromJpeg64 (JSARGS args) {
     if (!im) {
         return Null();
     }
-    return Opaque::New(im);
+    return imageHandle(im);
+}
+
+/**
+ * @function gd.imageCreateFromJpegBuffer
+ * 
+ * ### Synopsis
+ * 
+ * var handle = gd.imageCreateFromJpegBuffer(buf);
+ * 
+ * Create image from JPEG data in a buffer, e.g. a file read or a request body, without a temporary file or base64 round trip.
+ * 
+ * @param {object} buf - opaque handle to a buffer (see builtin/buffer) containing a JPEG image.
+ * @return {object} handle - opaque handle to image, or null if the image could not be created.
+ */
+static JSVAL gd_imageCreateFromJpegBuffer (JSARGS args) {
+    Buffer *buf = bufferArg(args[0]);
+    if (!buf || !buf->length()) {
+        return Null();
+    }
+    gdImagePtr im = gdImageCreateFromJpegPtr(buf->length(), (void *) buf->data());
+    if (!im) {
+        return Null();
+    }
+    return imageHandle(im);
 }
 
 /**
@@ -176,7 +246,7 @@ static JSVAL gd_imageCreateFromPng (JSARGS args) {
     if (!im) {
         return Null();
     }
-    return Opaque::New(im);
+    return imageHandle(im);
 }
 
 /**
@@ -202,7 +272,31 @@ static JSVAL gd_imageCreateFromPng64 (JSARGS args) {
     if (!im) {
         return Null();
     }
-    return Opaque::New(im);
+    return imageHandle(im);
+}
+
+/**
+ * @function gd.imageCreateFromPngBuffer
+ * 
+ * ### Synopsis
+ * 
+ * var handle = gd.imageCreateFromPngBuffer(buf);
+ * 
+ * Create image from PNG data in a buffer, e.g. a file read or a request body, without a temporary file or base64 round trip.
+ * 
+ * @param {object} buf - opaque handle to a buffer (see builtin/buffer) containing a PNG image.
+ * @return {object} handle - opaque handle to image, or null if the image could not be created.
+ */
+static JSVAL gd_imageCreateFromPngBuffer (JSARGS args) {
+    Buffer *buf = bufferArg(args[0]);
+    if (!buf || !buf->length()) {
+        return Null();
+    }
+    gdImagePtr im = gdImageCreateFromPngPtr(buf->length(), (void *) buf->data());
+    if (!im) {
+        return Null();
+    }
+    return imageHandle(im);
 }
 
 /**
@@ -228,7 +322,7 @@ static JSVAL gd_imageCreateFromGif (JSARGS args) {
     if (!im) {
         return Null();
     }
-    return Opaque::New(im);
+    return imageHandle(im);
 }
 
 /**
@@ -255,7 +349,31 @@ static JSVAL gd_imageCreateFromGif64 (JSARGS args) {
     if (!im) {
         return Null();
     }
-    return Opaque::New(im);
+    return imageHandle(im);
+}
+
+/**
+ * @function gd.imageCreateFromGifBuffer
+ * 
+ * ### Synopsis
+ * 
+ * var handle = gd.imageCreateFromGifBuffer(buf);
+ * 
+ * Create image from GIF data in a buffer, e.g. a file read or a request body, without a temporary file or base64 round trip.
+ * 
+ * @param {object} buf - opaque handle to a buffer (see builtin/buffer) containing a GIF image.
+ * @return {object} handle - opaque handle to image, or null if the image could not be created.
+ */
+static JSVAL gd_imageCreateFromGifBuffer (JSARGS args) {
+    Buffer *buf = bufferArg(args[0]);
+    if (!buf || !buf->length()) {
+        return Null();
+    }
+    gdImagePtr im = gdImageCreateFromGifPtr(buf->length(), (void *) buf->data());
+    if (!im) {
+        return Null();
+    }
+    return imageHandle(im);
 }
 
 /**
@@ -281,7 +399,7 @@ static JSVAL gd_imageCreateFromGd (JSARGS args) {
     if (!im) {
         return Null();
     }
-    return Opaque::New(im);
+    return imageHandle(im);
 }
 
 /**
@@ -306,7 +424,7 @@ static JSVAL gd_imageCreateFromGd64 (JSARGS args) {
     if (!im) {
         return Null();
     }
-    return Opaque::New(im);
+    return imageHandle(im);
 }
 
 /**
@@ -332,7 +450,7 @@ static JSVAL gd_imageCreateFromWBMP (JSARGS args) {
     if (!im) {
         return Null();
     }
-    return Opaque::New(im);
+    return imageHandle(im);
 }
 
 /**
@@ -357,7 +475,7 @@ static JSVAL gd_imageCreateFromWBMP64 (JSARGS args) {
     if (!im) {
         return Null();
     }
-    return Opaque::New(im);
+    return imageHandle(im);
 }
 
 /**
@@ -375,7 +493,7 @@ static JSVAL gd_imageCreateFromWBMP64 (JSARGS args) {
 static JSVAL gd_imageCreateFromXpm (JSARGS args) {
     String::Utf8Value data(args[0]);
     gdImagePtr im = gdImageCreateFromXpm(*data);
-    return Opaque::New(im);
+    return imageHandle(im);
 }
 
 /**
@@ -401,7 +519,7 @@ static JSVAL gd_imageCreateFromXbm (JSARGS args) {
     if (!im) {
         return Null();
     }
-    return Opaque::New(im);
+    return imageHandle(im);
 }
 
 /**
@@ -413,13 +531,30 @@ static JSVAL gd_imageCreateFromXbm (JSARGS args) {
  * 
  * gd.imageDestroy is used to free the memory associated with an image. 
  * 
- * It is important to invoke gd.imageDestroy before exiting your program or allowing the handle handle to be garbage collected.
+ * An image that is not destroyed is freed when its handle is garbage collected, but garbage collection may not happen for a long time, so large images should be destroyed as soon as possible.
  * 
  * @param {object} handle - opaque handle to a GD image.
  */
 static JSVAL gd_imageDestroy (JSARGS args) {
     gdImagePtr im = (gdImagePtr)JSOPAQUE(args[0]);
-    gdImageDestroy(im);
+    if (im) {
+        // detach the gd.imageRow() views, so they can't touch freed memory
+        Handle<Value>rows = args[0]->ToObject()->GetHiddenValue(String::New("rows"));
+        if (!rows.IsEmpty() && rows->IsArray()) {
+            Handle<Array>a = Handle<Array>::Cast(rows);
+            for (uint32_t y = 0; y < a->Length(); y++) {
+                Handle<Value>row = a->Get(y);
+                if (row->IsObject()) {
+                    JSOBJ o = row->ToObject();
+                    o->SetIndexedPropertiesToExternalArrayData(NULL, o->GetIndexedPropertiesExternalArrayDataType(), 0);
+                    o->Set(String::New("length"), Integer::New(0));
+                }
+            }
+            args[0]->ToObject()->DeleteHiddenValue(String::New("rows"));
+        }
+        gdImageDestroy(im);
+        Opaque::Clear(args[0]);
+    }
     return Undefined();
 }
 
@@ -480,6 +615,30 @@ static JSVAL gd_imageJpeg64 (JSARGS args) {
     return String::New(out.c_str(), out.size());
 }
 
+/**
+ * @function gd.imageJpegBuffer
+ * 
+ * ### Synopsis
+ * 
+ * var size = gd.imageJpegBuffer(handle, buf, quality);
+ * 
+ * Append the image in JPEG format to a buffer, e.g. the response body, so it can be sent without a temporary file.
+ * 
+ * See gd.imageJpeg() for the meaning of quality.
+ * 
+ * @param {object} handle - opaque handle to a GD image.
+ * @param {object} buf - opaque handle to a buffer (see builtin/buffer).
+ * @param {int} quality - see gd.imageJpeg()
+ * @return {int} size - number of bytes appended, or false if there was an error.
+ */
+static JSVAL gd_imageJpegBuffer (JSARGS args) {
+    gdImagePtr im = (gdImagePtr)JSOPAQUE(args[0]);
+    int quality = args.Length() > 2 ? args[2]->IntegerValue() : -1;
+    int size;
+    void *ptr = gdImageJpegPtr(im, &size, quality);
+    return appendImage(args[1], ptr, size);
+}
+
 /**
  * @function gd.imageGif
  * 
@@ -531,6 +690,28 @@ static JSVAL gd_imageGif64 (JSARGS args) {
     return String::New(out.c_str(), out.size());
 }
 
+/**
+ * @function gd.imageGifBuffer
+ * 
+ * ### Synopsis
+ * 
+ * var size = gd.imageGifBuffer(handle, buf);
+ * 
+ * Append the image in GIF format to a buffer, e.g. the response body, so it can be sent without a temporary file.
+ * 
+ * See gd.imageGif() regarding truecolor images.
+ * 
+ * @param {object} handle - opaque handle to a GD image.
+ * @param {object} buf - opaque handle to a buffer (see builtin/buffer).
+ * @return {int} size - number of bytes appended, or false if there was an error.
+ */
+static JSVAL gd_imageGifBuffer (JSARGS args) {
+    gdImagePtr im = (gdImagePtr)JSOPAQUE(args[0]);
+    int size;
+    void *ptr = gdImageGifPtr(im, &size);
+    return appendImage(args[1], ptr, size);
+}
+
 // animated gif methods not implemented
 
 /**
@@ -580,6 +761,31 @@ static JSVAL gd_imagePng64 (JSARGS args) {
     return String::New(out.c_str(), out.size());
 }
 
+/**
+ * @function gd.imagePngBuffer
+ * 
+ * ### Synopsis
+ * 
+ * var size = gd.imagePngBuffer(handle, buf);
+ * var size = gd.imagePngBuffer(handle, buf, level);
+ * 
+ * Append the image in PNG format to a buffer, e.g. the response body, so it can be sent without a temporary file.
+ * 
+ * See gd.imagePngEx() for the meaning of level.
+ * 
+ * @param {object} handle - opaque handle to a GD image.
+ * @param {object} buf - opaque handle to a buffer (see builtin/buffer).
+ * @param {int} level - optional zlib compression level, 0-9, or -1 for the default.
+ * @return {int} size - number of bytes appended, or false if there was an error.
+ */
+static JSVAL gd_imagePngBuffer (JSARGS args) {
+    gdImagePtr im = (gdImagePtr)JSOPAQUE(args[0]);
+    int level = args.Length() > 2 ? args[2]->IntegerValue() : -1;
+    int size;
+    void *ptr = gdImagePngPtrEx(im, &size, level);
+    return appendImage(args[1], ptr, size);
+}
+
 /**
  * @function gd.imagePngEx
  * 
@@ -815,7 +1021,7 @@ static JSVAL gd_imageCreatePaletteFromTrueColor (JSARGS args) {
     int ditherFlag = args[1]->IntegerValue();
     int colorsWanted = args[2]->IntegerValue();
     gdImagePtr newImage = gdImageCreatePaletteFromTrueColor(im, ditherFlag, colorsWanted);
-    return Opaque::New(newImage);
+    return imageHandle(newImage);
 }
 
 /**
@@ -1304,6 +1510,8 @@ static JSVAL gd_imageSetBrush (JSARGS args) {
     gdImagePtr im = (gdImagePtr)JSOPAQUE(args[0]);
     gdImagePtr brush = (gdImagePtr)JSOPAQUE(args[1]);
     gdImageSetBrush(im, brush);
+    // keep the brush from being finalized while the image uses it
+    args[0]->ToObject()->SetHiddenValue(String::New("brush"), args[1]);
     return Undefined();
 }
 
@@ -1329,6 +1537,7 @@ static JSVAL gd_imageSetTile (JSARGS args) {
     gdImagePtr im = (gdImagePtr)JSOPAQUE(args[0]);
     gdImagePtr brush = (gdImagePtr)JSOPAQUE(args[1]);
     gdImageSetTile(im, brush);
+    args[0]->ToObject()->SetHiddenValue(String::New("tile"), args[1]);
     return Undefined();
 }
 
@@ -1538,6 +1747,59 @@ static JSVAL gd_imageGetPixel (JSARGS args) {
     return Integer::New(color);
 }
 
+/**
+ * @function gd.imageRow
+ * 
+ * ### Synopsis
+ * 
+ * var row = gd.imageRow(handle, y);
+ * 
+ * Get a row of the image's pixels, in place: reading and writing row[x] is the same as gd.imageGetPixel() and gd.imageSetPixel() without alpha blending, but without a native call per pixel.
+ * 
+ * For a truecolor image, each element is a truecolor value as returned by gd.trueColorAlpha() (alpha is 0 for opaque to 127 for transparent, and is not premultiplied); for a palette image, each element is a color index.  row.length is the width of the image.
+ * 
+ * gd keeps each row in a separate block of memory, so there is one of these per row rather than one for the whole image.
+ * 
+ * The image is not garbage collected while the row is in use.  Each call for the same row returns the same object; gd.imageDestroy() empties them all (their length becomes 0).
+ * 
+ * @param {object} handle - opaque handle to a GD image.
+ * @param {int} y - y coordinate of the row.
+ * @return {object} row - the pixels of the row, indexed like an array, or null if y is outside the image.
+ */
+static JSVAL gd_imageRow (JSARGS args) {
+    gdImagePtr im = (gdImagePtr)JSOPAQUE(args[0]);
+    int y = args[1]->IntegerValue();
+    if (!im || y < 0 || y >= gdImageSY(im)) {
+        return Null();
+    }
+    // the rows handed out are kept on the handle, for gd.imageDestroy()
+    JSOBJ handle = args[0]->ToObject();
+    Handle<Value>rows = handle->GetHiddenValue(String::New("rows"));
+    if (rows.IsEmpty() || !rows->IsArray()) {
+        rows = Array::New(gdImageSY(im));
+        handle->SetHiddenValue(String::New("rows"), rows);
+    }
+    Handle<Array>a = Handle<Array>::Cast(rows);
+    Handle<Value>row = a->Get(y);
+    JSOBJ o;
+    if (row->IsObject()) {
+        o = row->ToObject();
+    }
+    else {
+        o = Object::New();
+        o->SetHiddenValue(String::New("image"), args[0]);
+        a->Set(y, o);
+    }
+    if (gdImageTrueColor(im)) {
+        o->SetIndexedPropertiesToExternalArrayData(im->tpixels[y], kExternalIntArray, gdImageSX(im));
+    }
+    else {
+        o->SetIndexedPropertiesToExternalArrayData(im->pixels[y], kExternalUnsignedByteArray, gdImageSX(im));
+    }
+    o->Set(String::New("length"), Integer::New(gdImageSX(im)));
+    return o;
+}
+
 /**
  * @function gd.imageBoundsSafe
  * 
@@ -1667,7 +1929,7 @@ static JSVAL gd_imageSY (JSARGS args) {
  * @return {object} fontHandle - opaque handle to the font.
  */
 static JSVAL gd_fontGetSmall (JSARGS args) {
-    return Opaque::New(gdFontGetSmall());
+    return Opaque::New(gdFontGetSmall(), fontType, false);
 }
 
 /**
@@ -1682,7 +1944,7 @@ static JSVAL gd_fontGetSmall (JSARGS args) {
  * @return {object} fontHandle - opaque handle to the font.
  */
 static JSVAL gd_fontGetLarge (JSARGS args) {
-    return Opaque::New(gdFontGetLarge());
+    return Opaque::New(gdFontGetLarge(), fontType, false);
 }
 
 /**
@@ -1697,7 +1959,7 @@ static JSVAL gd_fontGetLarge (JSARGS args) {
  * @return {object} fontHandle - opaque handle to the font.
  */
 static JSVAL gd_fontGetMediumBold (JSARGS args) {
-    return Opaque::New(gdFontGetMediumBold());
+    return Opaque::New(gdFontGetMediumBold(), fontType, false);
 }
 
 /**
@@ -1712,7 +1974,7 @@ static JSVAL gd_fontGetMediumBold (JSARGS args) {
  * @return {object} fontHandle - opaque handle to the font.
  */
 static JSVAL gd_fontGetGiant (JSARGS args) {
-    return Opaque::New(gdFontGetGiant());
+    return Opaque::New(gdFontGetGiant(), fontType, false);
 }
 
 /**
@@ -1727,7 +1989,7 @@ static JSVAL gd_fontGetGiant (JSARGS args) {
  * @return {object} fontHandle - opaque handle to the font.
  */
 static JSVAL gd_fontGetTiny (JSARGS args) {
-    return Opaque::New(gdFontGetTiny());
+    return Opaque::New(gdFontGetTiny(), fontType, false);
 }
 
 /**
@@ -2409,6 +2671,70 @@ static JSVAL gd_imageCopyResampled (JSARGS args) {
     return Undefined();
 }
 
+/**
+ * @function gd.imageResample
+ * 
+ * ### Synopsis
+ * 
+ * gd.imageResample(dstImage, srcImage, dstX, dstY, srcX, srcY, dstW, dstH, srcW, srcH);
+ * gd.imageResample(dstImage, srcImage, dstX, dstY, srcX, srcY, dstW, dstH, srcW, srcH, filter);
+ * 
+ * Like gd.imageCopyResampled(), but with a separable Lanczos or bicubic filter, which gives sharper results and, using SSE2 or AVX2 when the CPU has them, is several times faster.
+ * 
+ * The destination pixels are replaced, with their alpha channel, rather than blended.  If either image is not truecolor, gd.imageCopyResampled() is used instead.
+ * 
+ * @param {object} dstImage - destination for resized image
+ * @param {object} srcImage - source for resized image
+ * @param {int} dstX - X coordinate of the upper left corner of the destination region
+ * @param {int} dstY - Y coordinate of the upper left corner of the destination region
+ * @param {int} srcX - X coordinate of the upper left corner of the source region
+ * @param {int} srcY - Y coordinate of the upper left corner of the source region
+ * @param {int} dstW - width of the destination region
+ * @param {int} dstH - height of the destination region
+ * @param {int} srcW - width of the source region
+ * @param {int} srcH - height of the source region
+ * @param {string} filter - 'lanczos' (default) or 'bicubic'.
+ */
+static JSVAL gd_imageResample (JSARGS args) {
+    gdImagePtr dst = (gdImagePtr)JSOPAQUE(args[0]);
+    gdImagePtr src = (gdImagePtr)JSOPAQUE(args[1]);
+    int dstX = args[2]->IntegerValue();
+    int dstY = args[3]->IntegerValue();
+    int srcX = args[4]->IntegerValue();
+    int srcY = args[5]->IntegerValue();
+    int dstW = args[6]->IntegerValue();
+    int dstH = args[7]->IntegerValue();
+    int srcW = args[8]->IntegerValue();
+    int srcH = args[9]->IntegerValue();
+    int filter = 0;
+    if (args.Length() > 10) {
+        String::Utf8Value name(args[10]);
+        filter = strcmp(*name, "bicubic") ? 0 : 1;
+    }
+    if (!gdImageTrueColor(dst) || !gdImageTrueColor(src)) {
+        gdImageCopyResampled(dst, src, dstX, dstY, srcX, srcY, dstW, dstH, srcW, srcH);
+    }
+    else {
+        GdResample(dst, src, dstX, dstY, srcX, srcY, dstW, dstH, srcW, srcH, filter);
+    }
+    return Undefined();
+}
+
+/**
+ * @function gd.resampleSimd
+ * 
+ * ### Synopsis
+ * 
+ * var simd = gd.resampleSimd();
+ * 
+ * Get the instruction set gd.imageResample() and gd.imageUnsharpMask() use on this CPU.
+ * 
+ * @return {string} simd - 'avx2', 'sse2' or 'scalar'.
+ */
+static JSVAL gd_resampleSimd (JSARGS args) {
+    return String::New(GdResampleSimd());
+}
+
 /**
  * @function gd.imageCopyRotated
  * 
@@ -2563,7 +2889,7 @@ static JSVAL gd_imagePaletteCopy (JSARGS args) {
 static JSVAL gd_imageSquareToCircle (JSARGS args) {
     gdImagePtr dst = (gdImagePtr)JSOPAQUE(args[0]);
     int radius = args[1]->IntegerValue();
-    return Opaque::New(gdImageSquareToCircle(dst, radius));
+    return imageHandle(gdImageSquareToCircle(dst, radius));
 }
 
 /**
@@ -2589,6 +2915,40 @@ static JSVAL gd_imageSharpen (JSARGS args) {
     return Undefined();
 }
 
+/**
+ * @function gd.imageUnsharpMask
+ * 
+ * ### Synopsis
+ * 
+ * gd.imageUnsharpMask(handle, radius, amount, threshold);
+ * 
+ * Sharpen a truecolor image with an unsharp mask: each color is moved away from a gaussian blur of the image by amount times the difference.  Faster, and better controlled, than gd.imageSharpen().
+ * 
+ * Silently does nothing to non-truecolor images.  Transparency/alpha channel are not altered.
+ * 
+ * @param {object} handle - opaque handle to a GD image.
+ * @param {number} radius - standard deviation of the blur, in pixels (default 1).
+ * @param {number} amount - strength, 1 for 100% (default 1).
+ * @param {int} threshold - differences smaller than this (0-255) are left alone, so noise is not sharpened (default 0).
+ */
+static JSVAL gd_imageUnsharpMask (JSARGS args) {
+    gdImagePtr im = (gdImagePtr)JSOPAQUE(args[0]);
+    // undefined or non-numeric arguments get the defaults
+    double radius = args.Length() > 1 && args[1]->IsNumber() ? args[1]->NumberValue() : 1;
+    double amount = args.Length() > 2 && args[2]->IsNumber() ? args[2]->NumberValue() : 1;
+    int threshold = args.Length() > 3 && args[3]->IsNumber() ? args[3]->IntegerValue() : 0;
+    if (!isfinite(radius)) {
+        radius = 1;
+    }
+    if (!isfinite(amount)) {
+        amount = 1;
+    }
+    if (im && gdImageTrueColor(im)) {
+        GdUnsharpMask(im, radius, amount, threshold);
+    }
+    return Undefined();
+}
+
 /**
  * @function gd.imagePaletteCompare
  * 
@@ -2624,6 +2984,92 @@ static JSVAL gd_imageCompare (JSARGS args) {
     return Integer::New(gdImageCompare(im1, im2));
 }
 
+/**
+ * @function gd.imageDiff
+ * 
+ * ### Synopsis
+ * 
+ * var result = gd.imageDiff(image1, image2);
+ * var result = gd.imageDiff(image1, image2, options);
+ * 
+ * Compare two images of the same size pixel by pixel, for example a rendered chart with a reference rendering.
+ * 
+ * Unlike gd.imageCompare(), which only tells whether the images differ, this counts the pixels that differ and finds where they are.  The comparison uses SSE2 or AVX2 when the CPU has them, and the rows are split across the CPU cores.
+ * 
+ * The options are:
+ * 
+ * + threshold: a pixel is mismatched if one of its channels differs by more than this, 0-255 (default 0, any difference).  The alpha channel is gd's, 0-127.
+ * + perceptual: instead, a pixel is mismatched if its color, composited over white, differs by more than this in YIQ space (the metric pixelmatch uses), 0-1; 0.1 is a good choice to ignore antialiasing noise.
+ * + diff: handle of a truecolor image of the same size, which is overwritten with the mismatched pixels in red over a faded grayscale copy of image1.
+ * 
+ * The result has these members:
+ * 
+ * + mismatched: number of mismatched pixels.
+ * + total: number of pixels compared.
+ * + maxDelta: largest difference of any channel of any pixel.
+ * + perceptual: with the perceptual option, largest YIQ difference of any pixel, 0 (same) to 1 (black and white).
+ * + box: x, y, width and height of the smallest rectangle containing the mismatched pixels, or null if there are none.
+ * 
+ * @param {object} image1 - opaque handle to a GD image.
+ * @param {object} image2 - opaque handle to a GD image of the same size.
+ * @param {object} options - see above.
+ * @return {object} result - see above, or null if the images are not the same size, or the diff image is not a truecolor image of that size.
+ */
+static JSVAL gd_imageDiff (JSARGS args) {
+    HandleScope scope;
+    gdImagePtr im1 = (gdImagePtr)JSOPAQUE(args[0]);
+    gdImagePtr im2 = (gdImagePtr)JSOPAQUE(args[1]);
+    gdImagePtr diff = NULL;
+    int threshold = 0;
+    double perceptual = -1;
+    if (args.Length() > 2 && args[2]->IsObject()) {
+        Handle<Object>options = args[2]->ToObject();
+        Local<Value>v = options->Get(String::New("threshold"));
+        if (v->IsNumber()) {
+            threshold = v->IntegerValue();
+        }
+        v = options->Get(String::New("perceptual"));
+        if (v->IsNumber()) {
+            perceptual = v->NumberValue();
+        }
+        v = options->Get(String::New("diff"));
+        if (v->IsObject()) {
+            diff = (gdImagePtr)JSOPAQUE(v);
+        }
+    }
+    int sx = gdImageSX(im1),
+        sy = gdImageSY(im1);
+    if (sx != gdImageSX(im2) || sy != gdImageSY(im2)) {
+        return Null();
+    }
+    if (diff && (!gdImageTrueColor(diff) || gdImageSX(diff) != sx || gdImageSY(diff) != sy)) {
+        return Null();
+    }
+    int maxDelta, box[4];
+    double maxPerceptual;
+    long mismatched = GdDiff(im1, im2, diff, threshold, perceptual, &maxDelta, &maxPerceptual, box);
+
+    Handle<Object>o = Object::New();
+    o->Set(String::New("mismatched"), Number::New(mismatched));
+    o->Set(String::New("total"), Number::New((double) sx * sy));
+    o->Set(String::New("maxDelta"), Integer::New(maxDelta));
+    if (perceptual >= 0) {
+        o->Set(String::New("perceptual"), Number::New(maxPerceptual));
+    }
+    if (mismatched) {
+        Handle<Object>b = Object::New();
+        b->Set(String::New("x"), Integer::New(box[0]));
+        b->Set(String::New("y"), Integer::New(box[1]));
+        b->Set(String::New("width"), Integer::New(box[2]));
+        b->Set(String::New("height"), Integer::New(box[3]));
+        o->Set(String::New("box"), b);
+    }
+    else {
+        o->Set(String::New("box"), Null());
+    }
+    return scope.Close(o);
+}
+
 /**
  * @function gd.imageInterlace
  * 
@@ -2699,10 +3145,13 @@ void init_gd_object () {
     gd->Set(String::New("imageCreateTrueColor"), FunctionTemplate::New(gd_imageCreateTrueColor));
     gd->Set(String::New("imageCreateFromJpeg"), FunctionTemplate::New(gd_ImageCreateFromJpeg));
     gd->Set(String::New("imageCreateFromJpeg64"), FunctionTemplate::New(gd_imageCreateFromJpeg64));
+    gd->Set(String::New("imageCreateFromJpegBuffer"), FunctionTemplate::New(gd_imageCreateFromJpegBuffer));
     gd->Set(String::New("imageCreateFromPng"), FunctionTemplate::New(gd_imageCreateFromPng));
     gd->Set(String::New("imageCreateFromPng64"), FunctionTemplate::New(gd_imageCreateFromPng64));
+    gd->Set(String::New("imageCreateFromPngBuffer"), FunctionTemplate::New(gd_imageCreateFromPngBuffer));
     gd->Set(String::New("imageCreateFromGif"), FunctionTemplate::New(gd_imageCreateFromGif));
     gd->Set(String::New("imageCreateFromGif64"), FunctionTemplate::New(gd_imageCreateFromGif64));
+    gd->Set(String::New("imageCreateFromGifBuffer"), FunctionTemplate::New(gd_imageCreateFromGifBuffer));
     gd->Set(String::New("imageCreateFromGd"), FunctionTemplate::New(gd_imageCreateFromGd));
     gd->Set(String::New("imageCreateFromGd64"), FunctionTemplate::New(gd_imageCreateFromGd64));
     gd->Set(String::New("imageCreateFromWBMP"), FunctionTemplate::New(gd_imageCreateFromWBMP));
@@ -2712,10 +3161,13 @@ void init_gd_object () {
     gd->Set(String::New("imageDestroy"), FunctionTemplate::New(gd_imageDestroy));
     gd->Set(String::New("imageJpeg"), FunctionTemplate::New(gd_imageJpeg));
     gd->Set(String::New("imageJpeg64"), FunctionTemplate::New(gd_imageJpeg64));
+    gd->Set(String::New("imageJpegBuffer"), FunctionTemplate::New(gd_imageJpegBuffer));
     gd->Set(String::New("imageGif"), FunctionTemplate::New(gd_imageGif));
     gd->Set(String::New("imageGif64"), FunctionTemplate::New(gd_imageGif64));
+    gd->Set(String::New("imageGifBuffer"), FunctionTemplate::New(gd_imageGifBuffer));
     gd->Set(String::New("imagePng"), FunctionTemplate::New(gd_imagePng));
     gd->Set(String::New("imagePng64"), FunctionTemplate::New(gd_imagePng64));
+    gd->Set(String::New("imagePngBuffer"), FunctionTemplate::New(gd_imagePngBuffer));
     gd->Set(String::New("imagePngEx"), FunctionTemplate::New(gd_imagePngEx));
     gd->Set(String::New("imagePng64Ex"), FunctionTemplate::New(gd_imagePng64Ex));
     gd->Set(String::New("imageWBMP"), FunctionTemplate::New(gd_imageWBMP));
@@ -2748,6 +3200,7 @@ void init_gd_object () {
     gd->Set(String::New("imageGetClip"), FunctionTemplate::New(gd_imageGetClip));
     gd->Set(String::New("imageAlpha"), FunctionTemplate::New(gd_imageAlpha));
     gd->Set(String::New("imageGetPixel"), FunctionTemplate::New(gd_imageGetPixel));
+    gd->Set(String::New("imageRow"), FunctionTemplate::New(gd_imageRow));
     gd->Set(String::New("imageBoundsSafe"), FunctionTemplate::New(gd_imageBoundsSafe));
     gd->Set(String::New("imageBlue"), FunctionTemplate::New(gd_imageBlue));
     gd->Set(String::New("imageGreen"), FunctionTemplate::New(gd_imageGreen));
@@ -2781,13 +3234,17 @@ void init_gd_object () {
     gd->Set(String::New("imageCopy"), FunctionTemplate::New(gd_imageCopy));
     gd->Set(String::New("imageCopyResized"), FunctionTemplate::New(gd_imageCopyResized));
     gd->Set(String::New("imageCopyResampled"), FunctionTemplate::New(gd_imageCopyResampled));
+    gd->Set(String::New("imageResample"), FunctionTemplate::New(gd_imageResample));
+    gd->Set(String::New("resampleSimd"), FunctionTemplate::New(gd_resampleSimd));
     gd->Set(String::New("imageCopyRotated"), FunctionTemplate::New(gd_imageCopyRotated));
     gd->Set(String::New("imageCopyMerge"), FunctionTemplate::New(gd_imageCopyMerge));
     gd->Set(String::New("imageCopyMergeGray"), FunctionTemplate::New(gd_imageCopyMergeGray));
     gd->Set(String::New("imagePaletteCopy"), FunctionTemplate::New(gd_imagePaletteCopy));
     gd->Set(String::New("imageSquareToCircle"), FunctionTemplate::New(gd_imageSquareToCircle));
     gd->Set(String::New("imageSharpen"), FunctionTemplate::New(gd_imageSharpen));
+    gd->Set(String::New("imageUnsharpMask"), FunctionTemplate::New(gd_imageUnsharpMask));
     gd->Set(String::New("imageCompare"), FunctionTemplate::New(gd_imageCompare));
+    gd->Set(String::New("imageDiff"), FunctionTemplate::New(gd_imageDiff));
     gd->Set(String::New("imageInterlace"), FunctionTemplate::New(gd_imageInterlace));
 
     builtinObject->Set(String::New("gd"), gd);
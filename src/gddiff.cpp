@@ -0,0 +1,349 @@
+/** @ignore */
+/*
+ * Pixel by pixel comparison of gd images, used by gd.imageDiff().
+ *
+ * Rows are compared four (SSE2) or eight (AVX2) pixels at a time: the
+ * absolute differences of the channels give the largest difference, and
+ * which pixels differ by more than the threshold.  For the perceptual
+ * comparison, only the pixels that differ at all are then measured in YIQ
+ * space (the metric pixelmatch uses).  The rows are split across the
+ * thread pool.  The AVX2 kernel needs gcc 4.9 or later to build.
+ */
+#include "SilkJS.h"
+#include <gd.h>
+#include <math.h>
+#include <vector>
+
+// SSE2 where the compiler targets it (always, on x86_64); AVX2 is compiled
+// with the target attribute, and chosen at run time, which needs gcc 4.9
+#if defined(__GNUC__) && defined(__SSE2__)
+#define DIFF_X86
+#include <emmintrin.h>
+#if !defined(__clang__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define DIFF_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+// largest possible YIQ delta, black against white
+#define YIQ_MAX 35215.0
+
+/*
+ * What a row kernel found: the number of pixels with a channel that
+ * differs by more than the threshold, the first and last of them (-1 if
+ * none), and the largest difference of any channel.
+ */
+struct RowDiff {
+    int count, first, last, maxDelta;
+};
+
+static inline int channelDelta (int a, int b, int shift) {
+    int d = ((a >> shift) & 0xff) - ((b >> shift) & 0xff);
+    return d < 0 ? -d : d;
+}
+
+static void diffPixels (const int *a, const int *b, int begin, int n, int threshold, unsigned char *flags, RowDiff &r) {
+    for (int x = begin; x < n; x++) {
+        if (a[x] == b[x]) {
+            continue;
+        }
+        int d = channelDelta(a[x], b[x], 0), t;
+        if ((t = channelDelta(a[x], b[x], 8)) > d) {
+            d = t;
+        }
+        if ((t = channelDelta(a[x], b[x], 16)) > d) {
+            d = t;
+        }
+        if ((t = channelDelta(a[x], b[x], 24)) > d) {
+            d = t;
+        }
+        if (d > r.maxDelta) {
+            r.maxDelta = d;
+        }
+        if (d > threshold) {
+            r.count++;
+            if (r.first < 0) {
+                r.first = x;
+            }
+            r.last = x;
+            if (flags) {
+                flags[x] = 1;
+            }
+        }
+    }
+}
+
+static void diffRowScalar (const int *a, const int *b, int n, int threshold, unsigned char *flags, RowDiff &r) {
+    diffPixels(a, b, 0, n, threshold, flags, r);
+}
+
+#ifdef DIFF_X86
+// mask has a bit for each of the pixels at x that differ by more than the threshold
+static inline void addMask (int mask, int x, unsigned char *flags, RowDiff &r) {
+    r.count += __builtin_popcount(mask);
+    if (r.first < 0) {
+        r.first = x + __builtin_ctz(mask);
+    }
+    r.last = x + 31 - __builtin_clz(mask);
+    if (flags) {
+        for (; mask; mask &= mask - 1) {
+            flags[x + __builtin_ctz(mask)] = 1;
+        }
+    }
+}
+
+static inline int maxByte (const unsigned char *bytes, int n) {
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        if (bytes[i] > m) {
+            m = bytes[i];
+        }
+    }
+    return m;
+}
+
+static void diffRowSSE2 (const int *a, const int *b, int n, int threshold, unsigned char *flags, RowDiff &r) {
+    __m128i zero = _mm_setzero_si128(),
+        thr = _mm_set1_epi8((char) threshold),
+        maxd = zero;
+    int x = 0;
+    for (; x + 4 <= n; x += 4) {
+        __m128i va = _mm_loadu_si128((const __m128i *) &a[x]),
+            vb = _mm_loadu_si128((const __m128i *) &b[x]),
+            d = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+        maxd = _mm_max_epu8(maxd, d);
+        // a pixel is within the threshold if all of its channels are
+        __m128i within = _mm_cmpeq_epi32(_mm_subs_epu8(d, thr), zero);
+        int mask = ~_mm_movemask_ps(_mm_castsi128_ps(within)) & 0xf;
+        if (mask) {
+            addMask(mask, x, flags, r);
+        }
+    }
+    unsigned char bytes[16];
+    _mm_storeu_si128((__m128i *) bytes, maxd);
+    int m = maxByte(bytes, 16);
+    if (m > r.maxDelta) {
+        r.maxDelta = m;
+    }
+    diffPixels(a, b, x, n, threshold, flags, r);
+}
+
+#endif
+
+#ifdef DIFF_AVX2
+__attribute__((target("avx2")))
+static void diffRowAVX2 (const int *a, const int *b, int n, int threshold, unsigned char *flags, RowDiff &r) {
+    __m256i zero = _mm256_setzero_si256(),
+        thr = _mm256_set1_epi8((char) threshold),
+        maxd = zero;
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        __m256i va = _mm256_loadu_si256((const __m256i *) &a[x]),
+            vb = _mm256_loadu_si256((const __m256i *) &b[x]),
+            d = _mm256_or_si256(_mm256_subs_epu8(va, vb), _mm256_subs_epu8(vb, va));
+        maxd = _mm256_max_epu8(maxd, d);
+        __m256i within = _mm256_cmpeq_epi32(_mm256_subs_epu8(d, thr), zero);
+        int mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(within)) & 0xff;
+        if (mask) {
+            addMask(mask, x, flags, r);
+        }
+    }
+    unsigned char bytes[32];
+    _mm256_storeu_si256((__m256i *) bytes, maxd);
+    int m = maxByte(bytes, 32);
+    if (m > r.maxDelta) {
+        r.maxDelta = m;
+    }
+    diffPixels(a, b, x, n, threshold, flags, r);
+}
+#endif
+
+static void (*diffRow)(const int *a, const int *b, int n, int threshold, unsigned char *flags, RowDiff &r) = NULL;
+
+static void dispatch () {
+    if (diffRow) {
+        return;
+    }
+    diffRow = diffRowScalar;
+#ifdef DIFF_X86
+    diffRow = diffRowSSE2;
+#endif
+#ifdef DIFF_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        diffRow = diffRowAVX2;
+    }
+#endif
+}
+
+// the color of a gd pixel, composited over white, in YIQ space
+static inline void yiq (int c, double &y, double &i, double &q) {
+    double o = (127 - gdTrueColorGetAlpha(c)) / 127.0,
+        r = 255 + (gdTrueColorGetRed(c) - 255) * o,
+        g = 255 + (gdTrueColorGetGreen(c) - 255) * o,
+        b = 255 + (gdTrueColorGetBlue(c) - 255) * o;
+    y = r * 0.29889531 + g * 0.58662247 + b * 0.11448223;
+    i = r * 0.59597799 - g * 0.27417610 - b * 0.32180189;
+    q = r * 0.21147017 - g * 0.52261711 + b * 0.31114694;
+}
+
+static inline double yiqDelta (int a, int b) {
+    double y1, i1, q1, y2, i2, q2;
+    yiq(a, y1, i1, q1);
+    yiq(b, y2, i2, q2);
+    double y = y1 - y2,
+        i = i1 - i2,
+        q = q1 - q2;
+    return 0.5053 * y * y + 0.299 * i * i + 0.1957 * q * q;
+}
+
+struct DiffJob {
+    gdImagePtr a, b, diff;
+    int width;
+    int threshold;
+    double perceptual;          // YIQ delta a pixel may differ by, or < 0
+    vector<RowDiff>rows;
+    vector<double>rowPerceptual;
+};
+
+static const int *rowOf (gdImagePtr im, int y, vector<int>&tmp) {
+    if (gdImageTrueColor(im)) {
+        return im->tpixels[y];
+    }
+    for (int x = 0; x < (int) tmp.size(); x++) {
+        tmp[x] = gdImageGetTrueColorPixel(im, x, y);
+    }
+    return &tmp[0];
+}
+
+static void diffRows (void *arg, int begin, int end) {
+    DiffJob *job = (DiffJob *) arg;
+    int n = job->width;
+    bool perceptual = job->perceptual >= 0;
+    vector<int>tmpA(n), tmpB(n);
+    vector<unsigned char>flags;
+    if (perceptual || job->diff) {
+        flags.resize(n);
+    }
+    for (int y = begin; y < end; y++) {
+        const int *a = rowOf(job->a, y, tmpA),
+            *b = rowOf(job->b, y, tmpB);
+        RowDiff &r = job->rows[y];
+        r.count = r.maxDelta = 0;
+        r.first = r.last = -1;
+        unsigned char *f = flags.empty() ? NULL : &flags[0];
+        if (f) {
+            memset(f, 0, n);
+        }
+        // perceptually, any difference might count
+        diffRow(a, b, n, perceptual ? 0 : job->threshold, f, r);
+
+        if (perceptual && r.count) {
+            double worst = 0;
+            r.count = 0;
+            r.first = r.last = -1;
+            for (int x = 0; x < n; x++) {
+                if (!f[x]) {
+                    continue;
+                }
+                double d = yiqDelta(a[x], b[x]);
+                if (d > worst) {
+                    worst = d;
+                }
+                if (d > job->perceptual) {
+                    r.count++;
+                    if (r.first < 0) {
+                        r.first = x;
+                    }
+                    r.last = x;
+                }
+                else {
+                    f[x] = 0;
+                }
+            }
+            job->rowPerceptual[y] = worst;
+        }
+
+        if (job->diff) {
+            // mismatches in red, over a faded grayscale copy of the first image
+            int *out = job->diff->tpixels[y];
+            for (int x = 0; x < n; x++) {
+                if (f[x]) {
+                    out[x] = gdTrueColor(255, 0, 0);
+                }
+                else {
+                    double yy, ii, qq;
+                    yiq(a[x], yy, ii, qq);
+                    int gray = (int) (255 + (yy - 255) * 0.1 + 0.5);
+                    out[x] = gdTrueColor(gray, gray, gray);
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Compare two images of the same size.  A pixel is mismatched if one of
+ * its channels (gd alpha included) differs by more than threshold or, if
+ * perceptual is 0 to 1, if its YIQ delta is more than perceptual squared
+ * of the largest possible.  If diff isn't NULL, it is a truecolor image of
+ * the same size, which is overwritten with an image of the differences.
+ *
+ * Returns the number of mismatched pixels, and fills in the largest
+ * channel difference, the largest YIQ delta (0 to 1) when perceptual is
+ * given, and box (x, y, width, height; all 0 when nothing is mismatched).
+ */
+long GdDiff (gdImagePtr a, gdImagePtr b, gdImagePtr diff, int threshold, double perceptual, int *maxDelta, double *maxPerceptual, int box[4]) {
+    dispatch();
+    DiffJob job;
+    int sx = gdImageSX(a),
+        sy = gdImageSY(a);
+    job.a = a;
+    job.b = b;
+    job.diff = diff;
+    job.width = sx;
+    job.threshold = threshold < 0 ? 0 : threshold > 255 ? 255 : threshold;
+    job.perceptual = perceptual >= 0 ? YIQ_MAX * perceptual * perceptual : -1;
+    job.rows.resize(sy);
+    job.rowPerceptual.assign(sy, 0);
+    ParallelFor(sy, 16, diffRows, &job);
+
+    long count = 0;
+    int minX = sx, minY = -1, maxX = -1, maxY = -1;
+    double worst = 0;
+    *maxDelta = 0;
+    for (int y = 0; y < sy; y++) {
+        RowDiff &r = job.rows[y];
+        if (r.maxDelta > *maxDelta) {
+            *maxDelta = r.maxDelta;
+        }
+        if (job.rowPerceptual[y] > worst) {
+            worst = job.rowPerceptual[y];
+        }
+        if (!r.count) {
+            continue;
+        }
+        count += r.count;
+        if (minY < 0) {
+            minY = y;
+        }
+        maxY = y;
+        if (r.first < minX) {
+            minX = r.first;
+        }
+        if (r.last > maxX) {
+            maxX = r.last;
+        }
+    }
+    *maxPerceptual = sqrt(worst / YIQ_MAX);
+    if (count) {
+        box[0] = minX;
+        box[1] = minY;
+        box[2] = maxX - minX + 1;
+        box[3] = maxY - minY + 1;
+    }
+    else {
+        box[0] = box[1] = box[2] = box[3] = 0;
+    }
+    return count;
+}
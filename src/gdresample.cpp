@@ -0,0 +1,418 @@
+/** @ignore */
+/*
+ * Separable resampling and unsharp masking of gd truecolor images, used by
+ * gd.imageResample() and gd.imageUnsharpMask().
+ *
+ * Rows of tpixels are converted to floats (four per pixel, B G R and
+ * opacity, with the colors premultiplied when resizing), filtered
+ * horizontally into a ring of rows, then vertically.  The inner loops have
+ * scalar, SSE2 and AVX2 versions; the best one the compiler and CPU support
+ * is chosen the first time they are used.
+ */
+#include "SilkJS.h"
+#include <gd.h>
+#include <math.h>
+#include <vector>
+
+// SSE2 where the compiler targets it (always, on x86_64); AVX2 is compiled
+// with the target attribute, and chosen at run time, which needs gcc 4.9
+#if defined(__GNUC__) && defined(__SSE2__)
+#define RESAMPLE_X86
+#include <emmintrin.h>
+#if !defined(__clang__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define RESAMPLE_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+enum { FILTER_LANCZOS, FILTER_BICUBIC };
+
+/*
+ * Weights for one axis: output pixel i is the sum of w[i * maxTaps + k] *
+ * input[first[i] + k], for k < taps[i].
+ */
+struct Weights {
+    vector<int>first;
+    vector<int>taps;
+    vector<float>w;
+    int maxTaps;
+};
+
+typedef double (*Kernel)(double x, double param);
+
+static double lanczos3 (double x, double param) {
+    if (x < 0) {
+        x = -x;
+    }
+    if (x < 1e-8) {
+        return 1;
+    }
+    if (x >= 3) {
+        return 0;
+    }
+    x *= M_PI;
+    return 3 * sin(x) * sin(x / 3) / (x * x);
+}
+
+// Keys cubic, a = -0.5 (Catmull-Rom)
+static double bicubic (double x, double param) {
+    if (x < 0) {
+        x = -x;
+    }
+    if (x < 1) {
+        return (1.5 * x - 2.5) * x * x + 1;
+    }
+    if (x < 2) {
+        return ((-0.5 * x + 2.5) * x - 4) * x + 2;
+    }
+    return 0;
+}
+
+static double gaussian (double x, double sigma) {
+    return exp(-x * x / (2 * sigma * sigma));
+}
+
+// the window [offset, offset + length) of the input, of size inSize, is resampled to outSize pixels
+static void makeWeights (Weights &f, int inSize, double offset, double length, int outSize, Kernel kernel, double radius, double param) {
+    double scale = length / outSize,
+        stretch = scale > 1 ? scale : 1,
+        support = radius * stretch;
+
+    f.maxTaps = (int) ceil(support) * 2 + 1;
+    f.first.resize(outSize);
+    f.taps.resize(outSize);
+    f.w.assign((size_t) outSize * f.maxTaps, 0);
+    for (int i = 0; i < outSize; i++) {
+        double center = offset + (i + 0.5) * scale;
+        int lo = (int) floor(center - support),
+            hi = (int) ceil(center + support);
+        if (lo < 0) {
+            lo = 0;
+        }
+        if (hi > inSize - 1) {
+            hi = inSize - 1;
+        }
+        if (hi - lo + 1 > f.maxTaps) {
+            hi = lo + f.maxTaps - 1;
+        }
+        float *w = &f.w[(size_t) i * f.maxTaps];
+        double total = 0;
+        for (int j = lo; j <= hi; j++) {
+            w[j - lo] = (float) kernel((j + 0.5 - center) / stretch, param);
+            total += w[j - lo];
+        }
+        if (total == 0) {
+            w[0] = 1;
+            hi = lo;
+            total = 1;
+        }
+        for (int j = lo; j <= hi; j++) {
+            w[j - lo] /= total;
+        }
+        f.first[i] = lo;
+        f.taps[i] = hi - lo + 1;
+    }
+}
+
+/*
+ * Inner loops.  horizontal() filters one row of n output pixels; vertical()
+ * sums taps rows of n floats.
+ */
+static void horizontalScalar (const float *in, float *out, const Weights &f, int n) {
+    for (int x = 0; x < n; x++, out += 4) {
+        const float *w = &f.w[(size_t) x * f.maxTaps];
+        const float *p = &in[f.first[x] * 4];
+        float b = 0, g = 0, r = 0, a = 0;
+        for (int k = 0; k < f.taps[x]; k++, p += 4) {
+            b += w[k] * p[0];
+            g += w[k] * p[1];
+            r += w[k] * p[2];
+            a += w[k] * p[3];
+        }
+        out[0] = b;
+        out[1] = g;
+        out[2] = r;
+        out[3] = a;
+    }
+}
+
+static void verticalScalar (const float **rows, const float *w, int taps, float *out, int n) {
+    for (int i = 0; i < n; i++) {
+        out[i] = 0;
+    }
+    for (int k = 0; k < taps; k++) {
+        const float *row = rows[k];
+        float wk = w[k];
+        for (int i = 0; i < n; i++) {
+            out[i] += wk * row[i];
+        }
+    }
+}
+
+#ifdef RESAMPLE_X86
+static void horizontalSSE2 (const float *in, float *out, const Weights &f, int n) {
+    for (int x = 0; x < n; x++, out += 4) {
+        const float *w = &f.w[(size_t) x * f.maxTaps];
+        const float *p = &in[f.first[x] * 4];
+        __m128 acc = _mm_setzero_ps();
+        for (int k = 0; k < f.taps[x]; k++, p += 4) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[k]), _mm_loadu_ps(p)));
+        }
+        _mm_storeu_ps(out, acc);
+    }
+}
+
+static void verticalSSE2 (const float **rows, const float *w, int taps, float *out, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 acc = _mm_setzero_ps();
+        for (int k = 0; k < taps; k++) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[k]), _mm_loadu_ps(&rows[k][i])));
+        }
+        _mm_storeu_ps(&out[i], acc);
+    }
+    for (; i < n; i++) {
+        float acc = 0;
+        for (int k = 0; k < taps; k++) {
+            acc += w[k] * rows[k][i];
+        }
+        out[i] = acc;
+    }
+}
+
+#endif
+
+#ifdef RESAMPLE_AVX2
+// two taps (pixels) at a time
+__attribute__((target("avx2")))
+static void horizontalAVX2 (const float *in, float *out, const Weights &f, int n) {
+    for (int x = 0; x < n; x++, out += 4) {
+        const float *w = &f.w[(size_t) x * f.maxTaps];
+        const float *p = &in[f.first[x] * 4];
+        int taps = f.taps[x], k = 0;
+        __m256 acc8 = _mm256_setzero_ps();
+        for (; k + 2 <= taps; k += 2, p += 8) {
+            __m256 wk = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(w[k])), _mm_set1_ps(w[k + 1]), 1);
+            acc8 = _mm256_add_ps(acc8, _mm256_mul_ps(wk, _mm256_loadu_ps(p)));
+        }
+        __m128 acc = _mm_add_ps(_mm256_castps256_ps128(acc8), _mm256_extractf128_ps(acc8, 1));
+        if (k < taps) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[k]), _mm_loadu_ps(p)));
+        }
+        _mm_storeu_ps(out, acc);
+    }
+}
+
+__attribute__((target("avx2")))
+static void verticalAVX2 (const float **rows, const float *w, int taps, float *out, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 acc0 = _mm256_setzero_ps(),
+            acc1 = _mm256_setzero_ps();
+        for (int k = 0; k < taps; k++) {
+            __m256 wk = _mm256_set1_ps(w[k]);
+            acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(wk, _mm256_loadu_ps(&rows[k][i])));
+            acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(wk, _mm256_loadu_ps(&rows[k][i + 8])));
+        }
+        _mm256_storeu_ps(&out[i], acc0);
+        _mm256_storeu_ps(&out[i + 8], acc1);
+    }
+    for (; i < n; i++) {
+        float acc = 0;
+        for (int k = 0; k < taps; k++) {
+            acc += w[k] * rows[k][i];
+        }
+        out[i] = acc;
+    }
+}
+#endif
+
+static void (*horizontal)(const float *in, float *out, const Weights &f, int n) = NULL;
+static void (*vertical)(const float **rows, const float *w, int taps, float *out, int n) = NULL;
+static const char *simdName = "scalar";
+
+static void dispatch () {
+    if (horizontal) {
+        return;
+    }
+    horizontal = horizontalScalar;
+    vertical = verticalScalar;
+#ifdef RESAMPLE_X86
+    horizontal = horizontalSSE2;
+    vertical = verticalSSE2;
+    simdName = "sse2";
+#endif
+#ifdef RESAMPLE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        horizontal = horizontalAVX2;
+        vertical = verticalAVX2;
+        simdName = "avx2";
+    }
+#endif
+}
+
+const char *GdResampleSimd () {
+    dispatch();
+    return simdName;
+}
+
+static inline unsigned char clamp255 (float v) {
+    return v <= 0 ? 0 : v >= 255 ? 255 : (unsigned char) (v + 0.5f);
+}
+
+static void loadRow (const int *px, int n, float *out, bool premultiply) {
+    for (int x = 0; x < n; x++, out += 4) {
+        int c = px[x];
+        float o = (127 - gdTrueColorGetAlpha(c)) / 127.0f,
+            m = premultiply ? o : 1;
+        out[0] = gdTrueColorGetBlue(c) * m;
+        out[1] = gdTrueColorGetGreen(c) * m;
+        out[2] = gdTrueColorGetRed(c) * m;
+        out[3] = o;
+    }
+}
+
+/*
+ * Separable filter over a window of a truecolor image, producing one row
+ * of floats at a time.  Horizontally filtered rows are kept in a ring just
+ * big enough for the vertical filter, so memory use doesn't depend on the
+ * image height.
+ */
+class Separable {
+    gdImagePtr src;
+    int srcX, srcY, srcW;
+    const Weights &fx, &fy;
+    bool premultiply;
+    vector<float>line;
+    vector<float>ring;
+    vector<int>ringRow;
+    vector<const float *>taps;
+public:
+    vector<float>out;
+
+    Separable(gdImagePtr aSrc, int aSrcX, int aSrcY, int aSrcW, const Weights &aFx, const Weights &aFy, bool aPremultiply) : src(aSrc), srcX(aSrcX), srcY(aSrcY), srcW(aSrcW), fx(aFx), fy(aFy), premultiply(aPremultiply) {
+        dispatch();
+        size_t n = fx.first.size() * 4;
+        line.resize((size_t) srcW * 4);
+        ring.resize(fy.maxTaps * n);
+        ringRow.assign(fy.maxTaps, -1);
+        taps.resize(fy.maxTaps);
+        out.resize(n);
+    }
+
+    const float *row (int y) {
+        int slot = y % fy.maxTaps;
+        float *p = &ring[slot * out.size()];
+        if (ringRow[slot] != y) {
+            loadRow(&src->tpixels[srcY + y][srcX], srcW, &line[0], premultiply);
+            horizontal(&line[0], p, fx, fx.first.size());
+            ringRow[slot] = y;
+        }
+        return p;
+    }
+
+    void filter (int y) {
+        int first = fy.first[y];
+        for (int k = 0; k < fy.taps[y]; k++) {
+            taps[k] = row(first + k);
+        }
+        vertical(&taps[0], &fy.w[(size_t) y * fy.maxTaps], fy.taps[y], &out[0], out.size());
+    }
+};
+
+/*
+ * Resample the srcW x srcH window at srcX, srcY of src into the dstW x dstH
+ * window at dstX, dstY of dst.  Both must be truecolor images.
+ */
+void GdResample (gdImagePtr dst, gdImagePtr src, int dstX, int dstY, int srcX, int srcY, int dstW, int dstH, int srcW, int srcH, int filter) {
+    // clip the source window to the image
+    if (srcX < 0) {
+        srcW += srcX;
+        srcX = 0;
+    }
+    if (srcY < 0) {
+        srcH += srcY;
+        srcY = 0;
+    }
+    if (srcX + srcW > gdImageSX(src)) {
+        srcW = gdImageSX(src) - srcX;
+    }
+    if (srcY + srcH > gdImageSY(src)) {
+        srcH = gdImageSY(src) - srcY;
+    }
+    if (srcW <= 0 || srcH <= 0 || dstW <= 0 || dstH <= 0) {
+        return;
+    }
+    Kernel kernel = filter == FILTER_BICUBIC ? bicubic : lanczos3;
+    double radius = filter == FILTER_BICUBIC ? 2 : 3;
+    Weights fx, fy;
+    makeWeights(fx, srcW, 0, srcW, dstW, kernel, radius, 0);
+    makeWeights(fy, srcH, 0, srcH, dstH, kernel, radius, 0);
+
+    Separable pass(src, srcX, srcY, srcW, fx, fy, true);
+    for (int y = 0; y < dstH; y++) {
+        int ty = dstY + y;
+        if (ty < 0 || ty >= gdImageSY(dst)) {
+            continue;
+        }
+        pass.filter(y);
+        const float *p = &pass.out[0];
+        int *row = dst->tpixels[ty];
+        for (int x = 0; x < dstW; x++, p += 4) {
+            int tx = dstX + x;
+            if (tx < 0 || tx >= gdImageSX(dst)) {
+                continue;
+            }
+            float o = p[3];
+            if (o <= 0.5f / 127) {
+                row[tx] = gdTrueColorAlpha(0, 0, 0, gdAlphaTransparent);
+                continue;
+            }
+            float m = o >= 1 ? 1 : 1 / o;
+            int alpha = o >= 1 ? 0 : 127 - (int) (o * 127 + 0.5f);
+            row[tx] = gdTrueColorAlpha(clamp255(p[2] * m), clamp255(p[1] * m), clamp255(p[0] * m), alpha);
+        }
+    }
+}
+
+/*
+ * Sharpen a truecolor image in place: each color channel is moved away
+ * from a gaussian blur of itself by amount times the difference, where
+ * the difference is at least threshold.
+ */
+void GdUnsharpMask (gdImagePtr im, double sigma, double amount, int threshold) {
+    int sx = gdImageSX(im),
+        sy = gdImageSY(im);
+    // !(sigma > 0) rejects NaN too
+    if (!(sigma > 0) || !isfinite(amount) || sx <= 0 || sy <= 0) {
+        return;
+    }
+    // a blur wider than the image is no different, and keeps the kernel size in range
+    double most = sx > sy ? sx : sy;
+    if (sigma > most) {
+        sigma = most;
+    }
+    Weights fx, fy;
+    makeWeights(fx, sx, 0, sx, sx, gaussian, 3 * sigma, sigma);
+    makeWeights(fy, sy, 0, sy, sy, gaussian, 3 * sigma, sigma);
+
+    // row y is read (and blurred) before it is written, and rows above it are not read again
+    Separable pass(im, 0, 0, sx, fx, fy, false);
+    for (int y = 0; y < sy; y++) {
+        pass.filter(y);
+        const float *blur = &pass.out[0];
+        int *row = im->tpixels[y];
+        for (int x = 0; x < sx; x++, blur += 4) {
+            int c = row[x],
+                channel[3] = { gdTrueColorGetBlue(c), gdTrueColorGetGreen(c), gdTrueColorGetRed(c) };
+            for (int i = 0; i < 3; i++) {
+                float diff = channel[i] - blur[i];
+                if (fabs(diff) >= threshold) {
+                    channel[i] = clamp255(channel[i] + amount * diff);
+                }
+            }
+            row[x] = gdTrueColorAlpha(channel[2], channel[1], channel[0], gdTrueColorGetAlpha(c));
+        }
+    }
+}
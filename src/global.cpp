@@ -153,6 +153,8 @@ static Handle<Value> LoadLibrary(const Arguments& args) {
 }
 
 extern void init_buffer_object ();
+extern void init_json_object ();
+extern void init_arena_object ();
 extern void init_console_object ();
 extern void init_process_object ();
 extern void init_v8_object ();
@@ -167,10 +169,15 @@ extern void init_watchdog_object ();
 extern void init_sem_object ();
 extern void init_mysql_object ();
 extern void init_sqlite3_object ();
+extern void init_bdb_object ();
 extern void init_memcached_object ();
 extern void init_gd_object ();
+extern void init_image_object ();
 extern void init_ncurses_object ();
 extern void init_logfile_object ();
+extern void init_shmcache_object ();
+extern void init_shm_object ();
+extern void init_session_object ();
 extern void init_curl_object ();
 extern void init_xhrHelper_object ();
 extern void init_ssh_object ();
@@ -186,6 +193,8 @@ void init_global_object () {
     builtinObject = Persistent<ObjectTemplate>::New(ObjectTemplate::New());
 
     init_buffer_object();
+    init_json_object();
+    init_arena_object();
     init_console_object();
     init_process_object();
     init_net_object();
@@ -199,11 +208,16 @@ void init_global_object () {
 
 #if !BOOTSTRAP_SILKJS
     init_logfile_object();
+    init_shmcache_object();
+    init_shm_object();
+    init_session_object();
     init_sem_object();
     init_mysql_object();
     init_sqlite3_object();
+    init_bdb_object();
     init_memcached_object();
     init_gd_object();
+    init_image_object();
     init_ncurses_object();
     init_curl_object();
     init_xhrHelper_object();
@@ -19,6 +19,67 @@
  */
 #include "SilkJS.h"
 
+static void free_stream (void *p) {
+    delete (InputStream *) p;
+}
+
+// streams not closed with http.closeStream() are freed when their handle is garbage collected
+static OpaqueType streamType("http.stream", free_stream);
+
+// largest request body http.readPost() and http.readMime() read, unless the caller gives one
+#define HTTP_MAX_CONTENT_LENGTH (64 * 1024 * 1024)
+
+/*
+ * Growable string in the arena; the result is built at the end of the arena,
+ * so it grows in place.  s is NULL if the arena ran out of memory.
+ */
+struct Output {
+    char *s;
+    long len;
+    long size;
+    Output(long aSize) : len(0), size(aSize > 64 ? aSize : 64) {
+        s = (char *) Arena::Alloc(size);
+    }
+    bool reserve(long n) {
+        if (!s) {
+            return false;
+        }
+        if (len + n > size) {
+            long newSize = size * 2;
+            while (len + n > newSize) {
+                newSize *= 2;
+            }
+            s = (char *) Arena::Grow(s, size, newSize);
+            size = newSize;
+        }
+        return s != NULL;
+    }
+    void append(char c) {
+        if (reserve(1)) {
+            s[len++] = c;
+        }
+    }
+    void append(const char *p, long n) {
+        if (reserve(n)) {
+            memcpy(&s[len], p, n);
+            len += n;
+        }
+    }
+};
+
+/*
+ * The Content-Length the caller passed, or -1 if it is negative or larger
+ * than the maximum (the optional argument max, or HTTP_MAX_CONTENT_LENGTH).
+ */
+static long contentLength (JSARGS args, int arg, int maxArg) {
+    long size = args[arg]->IntegerValue();
+    long max = HTTP_MAX_CONTENT_LENGTH;
+    if (args.Length() > maxArg && args[maxArg]->IsNumber()) {
+        max = args[maxArg]->IntegerValue();
+    }
+    return size < 0 || size > max ? -1 : size;
+}
+
 /**
  * @function http.openStream
  * 
@@ -37,7 +98,7 @@
  */
 static JSVAL OpenStream (JSARGS args) {
     InputStream *s = new InputStream(args[0]->IntegerValue());
-    return Opaque::New(s);
+    return Opaque::New(s, streamType, true, sizeof(InputStream));
 }
 
 /**
@@ -53,7 +114,10 @@ static JSVAL OpenStream (JSARGS args) {
  */
 static JSVAL CloseStream (JSARGS args) {
     InputStream *s = (InputStream *)JSOPAQUE(args[0]);
-    delete s;
+    if (s) {
+        Opaque::Clear(args[0]);
+        delete s;
+    }
     return Undefined();
 }
 
@@ -91,7 +155,8 @@ static JSVAL ReadByte (JSARGS args) {
 static JSVAL ReadHeaders (JSARGS args) {
     InputStream *s = (InputStream *)JSOPAQUE(args[0]);
 
-    string out;
+    Arena::Scope arena;
+    Output out(4096);
     int newlineCount = 0;
     while (newlineCount < 2) {
         char c = s->Read();
@@ -106,15 +171,18 @@ static JSVAL ReadHeaders (JSARGS args) {
                 continue;
             case '\n':
                 newlineCount++;
-                out += c;
+                out.append(c);
                 break;
             default:
-                out += c;
+                out.append(c);
                 newlineCount = 0;
                 break;
         }
+        if (!out.s) {
+            return Null();
+        }
     }
-    return String::New(out.c_str(), out.size());
+    return String::New(out.s, out.len);
 }
 
 /**
@@ -123,6 +191,7 @@ static JSVAL ReadHeaders (JSARGS args) {
  * ### Synopsis
  * 
  * var postString = http.readPost(stream, contentLength);
+ * var postString = http.readPost(stream, contentLength, maxLength);
  * 
  * Read POST variables from the stream, returning a raw string.  Post variables are of the form key=val&key=val...
  * 
@@ -130,13 +199,21 @@ static JSVAL ReadHeaders (JSARGS args) {
  * 
  * @param {object} stream - the stream to read POST headers from.
  * @param {int} contentLength - the value of Content-Length header; the number of bytes to read.
- * @return {string} postString - raw POST variables string.
+ * @param {int} maxLength - largest contentLength accepted (default 64MB).
+ * @return {string} postString - raw POST variables string, or null if contentLength is negative or too large.
  */
 static JSVAL ReadPost (JSARGS args) {
     InputStream *s = (InputStream *)JSOPAQUE(args[0]);
-    long size = args[1]->IntegerValue();
+    long size = contentLength(args, 1, 2);
+    if (size < 0) {
+        return Null();
+    }
 
-    char buf[size];
+    Arena::Scope arena;
+    char *buf = (char *) Arena::Alloc(size);
+    if (!buf) {
+        return Null();
+    }
     if (s->Read((unsigned char *) buf, size) < 0) {
         return False();
     }
@@ -150,6 +227,7 @@ static JSVAL ReadPost (JSARGS args) {
  * ### Synopsis
  * 
  * var mimeString = http.readMime(stream, size, boundary);
+ * var mimeString = http.readMime(stream, size, boundary, maxSize);
  * 
  * Process multi-part/mime stream data from the specified stream.
  * 
@@ -164,50 +242,60 @@ static JSVAL ReadPost (JSARGS args) {
  * @param {object} stream - opaque handle to stream to read multi-part/mime data from.
  * @param {int} size - the content length of the multi-part/mime stream.
  * @param {string} boundary - the MIME part boundary string parsed from the Content-type header.
- * @return {string} mimeString - transformed multi-part/mime stream as a JavaScript string.
+ * @param {int} maxSize - largest size accepted (default 64MB).
+ * @return {string} mimeString - transformed multi-part/mime stream as a JavaScript string, or null if size is negative or too large.
  */
 static JSVAL ReadMime (JSARGS args) {
     InputStream *s = (InputStream *)JSOPAQUE(args[0]);
-    long size = args[1]->IntegerValue();
-    String::Utf8Value jsboundary(args[2]);
-    char *boundary = *jsboundary;
+    long size = contentLength(args, 1, 3);
+    if (size < 0) {
+        return Null();
+    }
+    Arena::Scope arena;
+    char *boundary = Arena::Utf8(args[2]);
 
-    char *in = new char[size];
+    char *in = (char *) Arena::Alloc(size + 1);
+    if (!boundary || !in) {
+        return Null();
+    }
     if (s->Read((unsigned char *) in, size) < 0) {
-        delete [] in;
         return Null();
     }
+    in[size] = '\0';
 
-    char b[strlen(boundary) + 3];
+    char *b = (char *) Arena::Alloc(strlen(boundary) + 3);
+    if (!b) {
+        return Null();
+    }
     sprintf(b, "--%s", boundary);
     int bLength = strlen(b);
-    char end[strlen(boundary) + 3 + 2];
-    sprintf(end, "--%s--", boundary);
-    //	int endLength = strlen(end);
 
-    string out;
+    Output out(size + size / 2);
 
     long ndx = 0;
     while (ndx < size) {
-        while (strncmp(&in[ndx], b, bLength)) {
-            out += in[ndx++];
+        while (ndx < size && strncmp(&in[ndx], b, bLength)) {
+            out.append(in[ndx++]);
+        }
+        if (ndx >= size) {
+            break;
         }
         out.append(&in[ndx], bLength);
         ndx += bLength;
 
         if (!strncmp(&in[ndx], "--", 2)) {
-            out += "--\r\n";
+            out.append("--\r\n", 4);
             ndx += 4;
             break;
         }
         else {
-            out += "\r\n";
+            out.append("\r\n", 2);
             ndx += 2;
         }
         // mime part header
         long lookAhead = ndx;
-        while (in[lookAhead] != '\r' && (in[lookAhead] != '\n')) {
-            out += in[lookAhead];
+        while (lookAhead < size && in[lookAhead] != '\r' && (in[lookAhead] != '\n')) {
+            out.append(in[lookAhead]);
             lookAhead++;
         }
         char save = in[lookAhead];
@@ -215,26 +303,28 @@ static JSVAL ReadMime (JSARGS args) {
         if (strcasestr(&in[ndx], "filename=")) {
             in[lookAhead] = save;
             ndx = lookAhead;
-            while (strncmp(&in[ndx], "\r\n\r\n", 4)) {
-                out += in[ndx++];
+            while (ndx < size && strncmp(&in[ndx], "\r\n\r\n", 4)) {
+                out.append(in[ndx++]);
             }
-            out += "\r\n";
+            out.append("\r\n", 2);
             ndx += 4;
             // in[ndx] is start of binary data
             lookAhead = ndx;
-            while (in[lookAhead] != '-' || strncmp(&in[lookAhead], b, bLength)) {
+            while (lookAhead < size && (in[lookAhead] != '-' || strncmp(&in[lookAhead], b, bLength))) {
                 lookAhead++;
             }
             // in[lookAhead] is start of boundary
-            string base64 = Base64Encode((unsigned char *) &in[ndx], lookAhead - ndx - 2);
+            long length = lookAhead - ndx - 2;
+            if (length < 0) {
+                length = 0;
+            }
+            string base64 = Base64Encode((unsigned char *) &in[ndx], length);
             char buf[512];
-            sprintf(buf, "Content-Length: %ld\r\n", lookAhead - ndx - 2);
-            out.append(buf, strlen(buf));
-            strcpy(buf, "Content-Encoding: base64\r\n");
+            sprintf(buf, "Content-Length: %ld\r\n", length);
             out.append(buf, strlen(buf));
-            out += "\r\n";
-            out += base64;
-            out += "\r\n";
+            out.append("Content-Encoding: base64\r\n\r\n", 28);
+            out.append(base64.c_str(), base64.size());
+            out.append("\r\n", 2);
             ndx = lookAhead;
         }
         else {
@@ -242,8 +332,10 @@ static JSVAL ReadMime (JSARGS args) {
             ndx = lookAhead;
         }
     }
-    delete [] in;
-    return String::New(out.c_str());
+    if (!out.s) {
+        return Null();
+    }
+    return String::New(out.s, out.len);
 }
 
 void init_http_object () {
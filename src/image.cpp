@@ -0,0 +1,812 @@
+/**
+ * @module builtin/image
+ *
+ * ### Synopsis
+ * SilkJS builtin image object.
+ *
+ * ### Description
+ * Fast thumbnails of JPEG, PNG and GIF images.
+ *
+ * JPEG images are decoded at 1/2, 1/4 or 1/8 of their size when the thumbnail is small enough, which libjpeg does in the DCT domain, so the full size image is never decoded.  Rows are resampled (Lanczos 3, horizontally then vertically) as they are decoded, and the result is encoded directly to a file or a builtin/buffer.
+ *
+ * image.thumbnails() makes a batch of thumbnails in parallel, on a pool of threads.
+ *
+ * See also the Image module.
+ *
+ * ### Usage
+ * var image = require('builtin/image');
+ */
+#include "SilkJS.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <setjmp.h>
+#include <math.h>
+#include <pthread.h>
+#include <vector>
+#include <algorithm>
+#include <jpeglib.h>
+#include <gd.h>
+
+enum { FORMAT_JPEG, FORMAT_PNG, FORMAT_GIF };
+
+/*
+ * Encoded image, from a file (mapped) or a buffer.
+ */
+struct Source {
+    const unsigned char *data;
+    size_t size;
+    void *map;
+    Source() : data(NULL), size(0), map(NULL) {}
+    ~Source() {
+        if (map) {
+            munmap(map, size);
+        }
+    }
+};
+
+static const char *openFile (const char *path, Source &src) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return strerror(errno);
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        close(fd);
+        return "image.thumbnail: empty file";
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return strerror(errno);
+    }
+    src.map = map;
+    src.data = (const unsigned char *) map;
+    src.size = st.st_size;
+    return NULL;
+}
+
+/*
+ * Resampling weights for one axis: output pixel i is the sum of
+ * weights[i * maxTaps + k] * input[first[i] + k], for k < taps[i].
+ */
+struct Filter {
+    vector<int>first;
+    vector<int>taps;
+    vector<float>weights;
+    int maxTaps;
+};
+
+static inline double lanczos3 (double x) {
+    if (x < 0) {
+        x = -x;
+    }
+    if (x < 1e-8) {
+        return 1;
+    }
+    if (x >= 3) {
+        return 0;
+    }
+    x *= M_PI;
+    return 3 * sin(x) * sin(x / 3) / (x * x);
+}
+
+// the window [offset, offset + length) of the input, of size inSize, is resampled to outSize pixels
+static void makeFilter (Filter &f, int inSize, double offset, double length, int outSize) {
+    double scale = length / outSize,
+        support = 3 * (scale > 1 ? scale : 1);
+
+    f.maxTaps = (int) ceil(support) * 2 + 1;
+    f.first.resize(outSize);
+    f.taps.resize(outSize);
+    f.weights.assign((size_t) outSize * f.maxTaps, 0);
+    for (int i = 0; i < outSize; i++) {
+        double center = offset + (i + 0.5) * scale;
+        int lo = (int) floor(center - support),
+            hi = (int) ceil(center + support);
+        if (lo < 0) {
+            lo = 0;
+        }
+        if (hi > inSize - 1) {
+            hi = inSize - 1;
+        }
+        if (hi - lo + 1 > f.maxTaps) {
+            hi = lo + f.maxTaps - 1;
+        }
+        float *w = &f.weights[(size_t) i * f.maxTaps];
+        double total = 0;
+        for (int j = lo; j <= hi; j++) {
+            double x = (j + 0.5 - center) / (scale > 1 ? scale : 1);
+            w[j - lo] = (float) lanczos3(x);
+            total += w[j - lo];
+        }
+        if (total == 0) {
+            // window narrower than a pixel
+            w[0] = 1;
+            hi = lo;
+            total = 1;
+        }
+        for (int j = lo; j <= hi; j++) {
+            w[j - lo] /= total;
+        }
+        f.first[i] = lo;
+        f.taps[i] = hi - lo + 1;
+    }
+}
+
+/*
+ * Rows are passed to row() as they are decoded, and resampled horizontally
+ * into rows of floats; finish() resamples those vertically.  Four channel
+ * images are resampled with premultiplied alpha.
+ */
+struct Resampler {
+    int channels;
+    int outWidth, outHeight;
+    Filter fx, fy;
+    int rowFirst, rowLast;
+    vector<float>rows;
+    vector<unsigned char>out;
+
+    void init (int aChannels, int inWidth, int inHeight, double cropX, double cropY, double cropW, double cropH, int width, int height) {
+        channels = aChannels;
+        outWidth = width;
+        outHeight = height;
+        makeFilter(fx, inWidth, cropX, cropW, width);
+        makeFilter(fy, inHeight, cropY, cropH, height);
+        rowFirst = fy.first[0];
+        rowLast = fy.first[height - 1] + fy.taps[height - 1] - 1;
+        rows.assign((size_t) (rowLast - rowFirst + 1) * width * channels, 0);
+    }
+
+    void row (int y, const unsigned char *in) {
+        if (y < rowFirst || y > rowLast) {
+            return;
+        }
+        float *dst = &rows[(size_t) (y - rowFirst) * outWidth * channels];
+        for (int x = 0; x < outWidth; x++, dst += channels) {
+            const float *w = &fx.weights[(size_t) x * fx.maxTaps];
+            const unsigned char *p = &in[fx.first[x] * channels];
+            int taps = fx.taps[x];
+            if (channels == 3) {
+                float r = 0, g = 0, b = 0;
+                for (int k = 0; k < taps; k++, p += 3) {
+                    r += w[k] * p[0];
+                    g += w[k] * p[1];
+                    b += w[k] * p[2];
+                }
+                dst[0] = r;
+                dst[1] = g;
+                dst[2] = b;
+            }
+            else {
+                float r = 0, g = 0, b = 0, a = 0;
+                for (int k = 0; k < taps; k++, p += 4) {
+                    float wa = w[k] * p[3];
+                    r += wa * p[0];
+                    g += wa * p[1];
+                    b += wa * p[2];
+                    a += wa;
+                }
+                dst[0] = r;
+                dst[1] = g;
+                dst[2] = b;
+                dst[3] = a;
+            }
+        }
+    }
+
+    static inline unsigned char clamp (float v) {
+        return v <= 0 ? 0 : v >= 255 ? 255 : (unsigned char) (v + 0.5f);
+    }
+
+    // background is the value transparent pixels are composited over, or -1 to keep the alpha channel
+    void finish (int background) {
+        int outChannels = (channels == 4 && background < 0) ? 4 : 3;
+        size_t stride = (size_t) outWidth * channels;
+        vector<float>acc(stride);
+        out.resize((size_t) outWidth * outHeight * outChannels);
+        unsigned char *dst = &out[0];
+        for (int y = 0; y < outHeight; y++) {
+            const float *w = &fy.weights[(size_t) y * fy.maxTaps];
+            const float *src = &rows[(size_t) (fy.first[y] - rowFirst) * stride];
+            std::fill(acc.begin(), acc.end(), 0.0f);
+            for (int k = 0; k < fy.taps[y]; k++, src += stride) {
+                float wk = w[k];
+                for (size_t i = 0; i < stride; i++) {
+                    acc[i] += wk * src[i];
+                }
+            }
+            const float *a = &acc[0];
+            for (int x = 0; x < outWidth; x++, a += channels) {
+                if (channels == 3) {
+                    dst[0] = clamp(a[0]);
+                    dst[1] = clamp(a[1]);
+                    dst[2] = clamp(a[2]);
+                    dst += 3;
+                }
+                else if (outChannels == 4) {
+                    float alpha = a[3];
+                    if (alpha > 0.5f / 255) {
+                        dst[0] = clamp(a[0] / alpha);
+                        dst[1] = clamp(a[1] / alpha);
+                        dst[2] = clamp(a[2] / alpha);
+                    }
+                    else {
+                        dst[0] = dst[1] = dst[2] = 0;
+                    }
+                    dst[3] = clamp(alpha);
+                    dst += 4;
+                }
+                else {
+                    // premultiplied, so compositing is an add
+                    float under = background * (1 - a[3] / 255);
+                    dst[0] = clamp(a[0] / 255 + under);
+                    dst[1] = clamp(a[1] / 255 + under);
+                    dst[2] = clamp(a[2] / 255 + under);
+                    dst += 3;
+                }
+            }
+        }
+    }
+};
+
+/*
+ * Output size, and the part of the source image it shows.
+ */
+struct Geometry {
+    int width, height;
+    double cropX, cropY, cropW, cropH;
+};
+
+static const char *computeGeometry (Geometry &g, int srcWidth, int srcHeight, int width, int height, const string &fit) {
+    if (width <= 0 && height <= 0) {
+        return "image.thumbnail: width or height is required";
+    }
+    g.cropX = g.cropY = 0;
+    g.cropW = srcWidth;
+    g.cropH = srcHeight;
+    if (width <= 0 || height <= 0) {
+        // keep the aspect ratio
+        double scale = width > 0 ? (double) width / srcWidth : (double) height / srcHeight;
+        g.width = width > 0 ? width : (int) (srcWidth * scale + 0.5);
+        g.height = height > 0 ? height : (int) (srcHeight * scale + 0.5);
+    }
+    else if (fit == "fill") {
+        g.width = width;
+        g.height = height;
+    }
+    else if (fit == "cover") {
+        double sx = (double) width / srcWidth,
+            sy = (double) height / srcHeight,
+            scale = sx > sy ? sx : sy;
+        g.width = width;
+        g.height = height;
+        g.cropW = width / scale;
+        g.cropH = height / scale;
+        g.cropX = (srcWidth - g.cropW) / 2;
+        g.cropY = (srcHeight - g.cropH) / 2;
+    }
+    else if (fit == "contain") {
+        double sx = (double) width / srcWidth,
+            sy = (double) height / srcHeight,
+            scale = sx < sy ? sx : sy;
+        g.width = (int) (srcWidth * scale + 0.5);
+        g.height = (int) (srcHeight * scale + 0.5);
+    }
+    else {
+        return "image.thumbnail: fit must be contain, cover or fill";
+    }
+    if (g.width < 1) {
+        g.width = 1;
+    }
+    if (g.height < 1) {
+        g.height = 1;
+    }
+    return NULL;
+}
+
+struct JpegError {
+    struct jpeg_error_mgr pub;
+    jmp_buf jump;
+    char message[JMSG_LENGTH_MAX];
+};
+
+static void jpegErrorExit (j_common_ptr cinfo) {
+    JpegError *err = (JpegError *) cinfo->err;
+    (*cinfo->err->format_message)(cinfo, err->message);
+    longjmp(err->jump, 1);
+}
+
+static void jpegOutputMessage (j_common_ptr cinfo) {
+    // warnings about corrupt data are not fatal; ignore them
+}
+
+/*
+ * Decode a JPEG image, at the smallest DCT scale that is still at least as
+ * big as the thumbnail, through the resampler.  Everything with a destructor
+ * belongs to the caller, because of the longjmp.
+ */
+static bool decodeJpeg (Source &src, int width, int height, const string &fit, Resampler &rs, Geometry &g, int &denom, string &error) {
+    struct jpeg_decompress_struct cinfo;
+    JpegError err;
+    cinfo.err = jpeg_std_error(&err.pub);
+    err.pub.error_exit = jpegErrorExit;
+    err.pub.output_message = jpegOutputMessage;
+    if (setjmp(err.jump)) {
+        error = err.message;
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, (unsigned char *) src.data, src.size);
+    jpeg_read_header(&cinfo, TRUE);
+
+    const char *msg = computeGeometry(g, cinfo.image_width, cinfo.image_height, width, height, fit);
+    if (msg) {
+        error = msg;
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    double sx = g.width / g.cropW,
+        sy = g.height / g.cropH,
+        scale = sx > sy ? sx : sy;
+    denom = 8;
+    while (denom > 1 && denom * scale > 1) {
+        denom /= 2;
+    }
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = denom;
+    cinfo.dct_method = JDCT_ISLOW;
+    bool cmyk = cinfo.jpeg_color_space == JCS_CMYK || cinfo.jpeg_color_space == JCS_YCCK;
+    cinfo.out_color_space = cmyk ? JCS_CMYK : JCS_RGB;
+    jpeg_start_decompress(&cinfo);
+
+    // crop window in the coordinates of the scaled image
+    double fw = (double) cinfo.output_width / cinfo.image_width,
+        fh = (double) cinfo.output_height / cinfo.image_height;
+    rs.init(3, cinfo.output_width, cinfo.output_height, g.cropX * fw, g.cropY * fh, g.cropW * fw, g.cropH * fh, g.width, g.height);
+
+    JSAMPARRAY line = (*cinfo.mem->alloc_sarray)((j_common_ptr) &cinfo, JPOOL_IMAGE, cinfo.output_width * cinfo.output_components, 1);
+    JSAMPARRAY rgb = (*cinfo.mem->alloc_sarray)((j_common_ptr) &cinfo, JPOOL_IMAGE, cinfo.output_width * 3, 1);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        int y = cinfo.output_scanline;
+        if (y > rs.rowLast) {
+            // the rest of the image is cropped away
+            break;
+        }
+        jpeg_read_scanlines(&cinfo, line, 1);
+        if (cmyk) {
+            // Adobe writes inverted CMYK
+            unsigned char *p = line[0], *q = rgb[0];
+            for (unsigned int x = 0; x < cinfo.output_width; x++, p += 4, q += 3) {
+                q[0] = p[0] * p[3] / 255;
+                q[1] = p[1] * p[3] / 255;
+                q[2] = p[2] * p[3] / 255;
+            }
+            rs.row(y, rgb[0]);
+        }
+        else {
+            rs.row(y, line[0]);
+        }
+    }
+    jpeg_abort_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+
+/*
+ * gd 2.0.x keeps state in globals while it reads and writes PNG and GIF
+ * (e.g. the libpng error handling), so only one thread may be in it at a time.
+ */
+static pthread_mutex_t gdLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * PNG and GIF images are decoded by gd, then resampled.
+ */
+static bool decodeGd (Source &src, int format, int width, int height, const string &fit, Resampler &rs, Geometry &g, string &error) {
+    pthread_mutex_lock(&gdLock);
+    gdImagePtr im = format == FORMAT_PNG ? gdImageCreateFromPngPtr(src.size, (void *) src.data) : gdImageCreateFromGifPtr(src.size, (void *) src.data);
+    pthread_mutex_unlock(&gdLock);
+    if (!im) {
+        error = "image.thumbnail: could not decode image";
+        return false;
+    }
+    int sx = gdImageSX(im),
+        sy = gdImageSY(im);
+    const char *msg = computeGeometry(g, sx, sy, width, height, fit);
+    if (msg) {
+        gdImageDestroy(im);
+        error = msg;
+        return false;
+    }
+    rs.init(4, sx, sy, g.cropX, g.cropY, g.cropW, g.cropH, g.width, g.height);
+    vector<unsigned char>line((size_t) sx * 4);
+    for (int y = rs.rowFirst; y <= rs.rowLast; y++) {
+        unsigned char *p = &line[0];
+        for (int x = 0; x < sx; x++, p += 4) {
+            int c = gdImageGetTrueColorPixel(im, x, y);
+            p[0] = gdTrueColorGetRed(c);
+            p[1] = gdTrueColorGetGreen(c);
+            p[2] = gdTrueColorGetBlue(c);
+            // gd alpha is 0 (opaque) to 127 (transparent)
+            p[3] = 255 - gdTrueColorGetAlpha(c) * 255 / 127;
+        }
+        rs.row(y, &line[0]);
+    }
+    gdImageDestroy(im);
+    return true;
+}
+
+static bool writeFile (const string &path, const string &data, string &error) {
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (!fp) {
+        error = strerror(errno);
+        return false;
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), fp) == data.size();
+    if (fclose(fp) != 0 || !ok) {
+        error = strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+static bool encodeJpeg (Resampler &rs, int quality, string &encoded, string &error) {
+    struct jpeg_compress_struct cinfo;
+    JpegError err;
+    unsigned char *mem = NULL;
+    unsigned long memSize = 0;
+    cinfo.err = jpeg_std_error(&err.pub);
+    err.pub.error_exit = jpegErrorExit;
+    err.pub.output_message = jpegOutputMessage;
+    if (setjmp(err.jump)) {
+        error = err.message;
+        jpeg_destroy_compress(&cinfo);
+        free(mem);
+        return false;
+    }
+    jpeg_create_compress(&cinfo);
+    jpeg_mem_dest(&cinfo, &mem, &memSize);
+    cinfo.image_width = rs.outWidth;
+    cinfo.image_height = rs.outHeight;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, quality, TRUE);
+    jpeg_start_compress(&cinfo, TRUE);
+    while (cinfo.next_scanline < cinfo.image_height) {
+        JSAMPROW row = &rs.out[(size_t) cinfo.next_scanline * rs.outWidth * 3];
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+
+    encoded.assign((const char *) mem, memSize);
+    free(mem);
+    return true;
+}
+
+static bool encodeGd (Resampler &rs, int format, string &encoded, string &error) {
+    gdImagePtr im = gdImageCreateTrueColor(rs.outWidth, rs.outHeight);
+    if (!im) {
+        error = "image.thumbnail: out of memory";
+        return false;
+    }
+    gdImageAlphaBlending(im, 0);
+    gdImageSaveAlpha(im, 1);
+    int channels = rs.out.size() / ((size_t) rs.outWidth * rs.outHeight);
+    const unsigned char *p = &rs.out[0];
+    for (int y = 0; y < rs.outHeight; y++) {
+        for (int x = 0; x < rs.outWidth; x++, p += channels) {
+            int alpha = channels == 4 ? 127 - p[3] * 127 / 255 : 0;
+            gdImageSetPixel(im, x, y, gdTrueColorAlpha(p[0], p[1], p[2], alpha));
+        }
+    }
+    int len = 0;
+    pthread_mutex_lock(&gdLock);
+    void *data = format == FORMAT_PNG ? gdImagePngPtr(im, &len) : gdImageGifPtr(im, &len);
+    pthread_mutex_unlock(&gdLock);
+    gdImageDestroy(im);
+    if (!data) {
+        error = "image.thumbnail: could not encode image";
+        return false;
+    }
+    encoded.assign((const char *) data, len);
+    gdFree(data);
+    return true;
+}
+
+static int formatOf (const char *s) {
+    if (!strcasecmp(s, "png")) {
+        return FORMAT_PNG;
+    }
+    if (!strcasecmp(s, "gif")) {
+        return FORMAT_GIF;
+    }
+    if (!strcasecmp(s, "jpeg") || !strcasecmp(s, "jpg")) {
+        return FORMAT_JPEG;
+    }
+    return -1;
+}
+
+/*
+ * A thumbnail to make.  The source and options are copied out of their
+ * JavaScript objects on the main thread, so makeThumbnail() can run on any
+ * thread.
+ */
+struct Job {
+    string path;                    // source file, or
+    const unsigned char *data;      // source image in a buffer
+    size_t dataSize;
+    int width, height, quality, background, format;
+    string fit;
+    string file;                    // destination file, or
+    Buffer *buffer;                 // destination buffer, appended to on the main thread
+    Handle<Value>bufferHandle;
+
+    string encoded;
+    int outWidth, outHeight, scale;
+    size_t size;
+    string error;
+
+    Job() : data(NULL), dataSize(0), width(0), height(0), quality(85), background(255), format(FORMAT_JPEG), fit("contain"), buffer(NULL), outWidth(0), outHeight(0), scale(1), size(0) {}
+};
+
+static bool parseJob (Handle<Value>vSrc, Handle<Value>vOptions, Job &job) {
+    if (!vOptions->IsObject()) {
+        job.error = "image.thumbnail: options required";
+        return false;
+    }
+    Handle<Object>options = vOptions->ToObject();
+    Local<Value>vWidth = options->Get(String::New("width")),
+        vHeight = options->Get(String::New("height")),
+        vFit = options->Get(String::New("fit")),
+        vFile = options->Get(String::New("file")),
+        vBuffer = options->Get(String::New("buffer")),
+        vFormat = options->Get(String::New("format")),
+        vQuality = options->Get(String::New("quality")),
+        vBackground = options->Get(String::New("background"));
+
+    if (vSrc->IsObject()) {
+        Buffer *buf = (Buffer *) JSOPAQUE(vSrc);
+        if (!buf) {
+            job.error = "image.thumbnail: invalid buffer";
+            return false;
+        }
+        job.data = (const unsigned char *) buf->data();
+        job.dataSize = buf->length();
+    }
+    else {
+        String::Utf8Value path(vSrc);
+        job.path = *path;
+    }
+    if (vWidth->IsNumber()) {
+        job.width = vWidth->IntegerValue();
+    }
+    if (vHeight->IsNumber()) {
+        job.height = vHeight->IntegerValue();
+    }
+    if (vQuality->IsNumber()) {
+        job.quality = vQuality->IntegerValue();
+    }
+    if (vBackground->IsNumber()) {
+        // JPEG output is always flattened; -1 (keep alpha) is only for PNG and GIF, chosen by the format
+        int64_t background = vBackground->IntegerValue();
+        job.background = background < 0 ? 0 : background > 255 ? 255 : (int) background;
+    }
+    if (!vFit->IsUndefined()) {
+        String::Utf8Value s(vFit);
+        job.fit = *s;
+    }
+    bool toFile = !vFile->IsUndefined() && !vFile->IsNull();
+    if (toFile) {
+        String::Utf8Value s(vFile);
+        job.file = *s;
+    }
+    else if (vBuffer->IsObject() && JSOPAQUE(vBuffer)) {
+        job.buffer = (Buffer *) JSOPAQUE(vBuffer);
+        job.bufferHandle = vBuffer;
+    }
+    else {
+        job.error = "image.thumbnail: file or buffer option required";
+        return false;
+    }
+    if (!vFormat->IsUndefined()) {
+        String::Utf8Value s(vFormat);
+        job.format = formatOf(*s);
+    }
+    else if (toFile) {
+        const char *ext = strrchr(job.file.c_str(), '.');
+        job.format = ext ? formatOf(ext + 1) : FORMAT_JPEG;
+        if (job.format < 0) {
+            job.format = FORMAT_JPEG;
+        }
+    }
+    if (job.format < 0) {
+        job.error = "image.thumbnail: format must be jpeg, png or gif";
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Decode, resample and encode; the thumbnail is written to its file here,
+ * or left in job.encoded for the main thread to append to its buffer.
+ *
+ * libjpeg is reentrant, so JPEGs are decoded and encoded in parallel; gd's
+ * PNG and GIF codecs are not, and are serialized by gdLock.
+ */
+static bool makeThumbnail (Job &job) {
+    Source src;
+    if (job.data) {
+        src.data = job.data;
+        src.size = job.dataSize;
+    }
+    else {
+        const char *msg = openFile(job.path.c_str(), src);
+        if (msg) {
+            job.error = msg;
+            return false;
+        }
+    }
+    Resampler rs;
+    Geometry g;
+    int denom = 1;
+    bool ok;
+    if (src.size > 2 && src.data[0] == 0xff && src.data[1] == 0xd8) {
+        ok = decodeJpeg(src, job.width, job.height, job.fit, rs, g, denom, job.error);
+    }
+    else if (src.size > 8 && !memcmp(src.data, "\x89PNG", 4)) {
+        ok = decodeGd(src, FORMAT_PNG, job.width, job.height, job.fit, rs, g, job.error);
+    }
+    else if (src.size > 6 && !memcmp(src.data, "GIF8", 4)) {
+        ok = decodeGd(src, FORMAT_GIF, job.width, job.height, job.fit, rs, g, job.error);
+    }
+    else {
+        job.error = "image.thumbnail: not a JPEG, PNG or GIF image";
+        return false;
+    }
+    if (!ok) {
+        return false;
+    }
+
+    if (job.format == FORMAT_JPEG) {
+        rs.finish(job.background);
+        ok = encodeJpeg(rs, job.quality, job.encoded, job.error);
+    }
+    else {
+        rs.finish(-1);
+        ok = encodeGd(rs, job.format, job.encoded, job.error);
+    }
+    if (!ok) {
+        return false;
+    }
+    job.outWidth = rs.outWidth;
+    job.outHeight = rs.outHeight;
+    job.scale = denom;
+    job.size = job.encoded.size();
+    if (!job.buffer) {
+        ok = writeFile(job.file, job.encoded, job.error);
+        string().swap(job.encoded);
+    }
+    return ok;
+}
+
+static void makeThumbnails (void *arg, int begin, int end) {
+    Job *jobs = (Job *) arg;
+    for (int i = begin; i < end; i++) {
+        if (jobs[i].error.empty()) {
+            makeThumbnail(jobs[i]);
+        }
+    }
+}
+
+// back on the main thread: append to the destination buffer, and describe the thumbnail
+static Handle<Object>jobInfo (Job &job) {
+    if (job.buffer) {
+        BufferAppend(job.buffer, job.encoded.data(), job.encoded.size());
+        BufferAccount(job.bufferHandle, job.buffer);
+        string().swap(job.encoded);
+    }
+    Handle<Object>info = Object::New();
+    info->Set(String::New("width"), Integer::New(job.outWidth));
+    info->Set(String::New("height"), Integer::New(job.outHeight));
+    info->Set(String::New("size"), Number::New(job.size));
+    info->Set(String::New("scale"), Integer::New(job.scale));
+    return info;
+}
+
+/**
+ * @function image.thumbnail
+ *
+ * ### Synopsis
+ *
+ * var info = image.thumbnail(src, options);
+ *
+ * Make a thumbnail of a JPEG, PNG or GIF image.
+ *
+ * The options are:
+ *
+ * + width, height: size of the thumbnail; if only one is given, the other follows from the aspect ratio of the image.
+ * + fit: how the image fits in width x height: 'contain' (default) scales it to fit inside, so one side may be shorter; 'cover' scales it to cover the box and crops the middle; 'fill' stretches it.
+ * + file: path of the file to write the thumbnail to, or
+ * + buffer: builtin/buffer handle to append the thumbnail to.
+ * + format: 'jpeg', 'png' or 'gif'; by default, the extension of file, or 'jpeg'.
+ * + quality: JPEG quality, 1 to 100 (default 85).
+ * + background: gray level (0-255) transparent parts of the image are put on for JPEG thumbnails (default 255, white).
+ *
+ * @param {string|object} src - path of the image file, or a builtin/buffer handle holding the image.
+ * @param {object} options - the options.
+ * @return {object} info - object with width and height (of the thumbnail), size (bytes written) and scale (1, 2, 4 or 8: how much smaller the JPEG image was decoded) members.
+ *
+ * ### Exceptions
+ * This function throws an exception with a string describing the error if the image can't be read, decoded or written.
+ */
+static JSVAL image_thumbnail (JSARGS args) {
+    HandleScope scope;
+    Job job;
+    if (!parseJob(args[0], args[1], job) || !makeThumbnail(job)) {
+        return ThrowException(String::New(job.error.c_str()));
+    }
+    return scope.Close(jobInfo(job));
+}
+
+/**
+ * @function image.thumbnails
+ *
+ * ### Synopsis
+ *
+ * var results = image.thumbnails(jobs);
+ *
+ * Make a batch of thumbnails, in parallel on all the CPU cores.
+ *
+ * Each job is an object with a src member (path of the image file, or a builtin/buffer handle holding the image) and the options of image.thumbnail().  The jobs are read on the calling thread, then decoded, resampled and encoded by a pool of threads that never touch JavaScript; thumbnails for buffers are appended to them in the order of the jobs once all of them are done.
+ *
+ * A job that fails does not stop the others: its result is an object with an error member, the string image.thumbnail() would have thrown.
+ *
+ * Batches of a few dozen to a few hundred jobs keep all the cores busy; the results of a batch are only returned when its last job is done.
+ *
+ * @param {array} jobs - array of job objects.
+ * @return {array} results - for each job, the object image.thumbnail() returns, or { error: message }.
+ */
+static JSVAL image_thumbnails (JSARGS args) {
+    HandleScope scope;
+    if (args.Length() < 1 || !args[0]->IsArray()) {
+        return ThrowException(String::New("image.thumbnails: array of jobs required"));
+    }
+    Handle<Array>specs = Handle<Array>::Cast(args[0]);
+    int n = specs->Length();
+    vector<Job>jobs(n);
+    for (int i = 0; i < n; i++) {
+        Local<Value>spec = specs->Get(i);
+        if (!spec->IsObject()) {
+            jobs[i].error = "image.thumbnail: options required";
+            continue;
+        }
+        parseJob(spec->ToObject()->Get(String::New("src")), spec, jobs[i]);
+    }
+
+    if (n > 0) {
+        ParallelFor(n, 1, makeThumbnails, &jobs[0]);
+    }
+
+    Handle<Array>results = Array::New(n);
+    for (int i = 0; i < n; i++) {
+        if (jobs[i].error.empty()) {
+            results->Set(i, jobInfo(jobs[i]));
+        }
+        else {
+            Handle<Object>result = Object::New();
+            result->Set(String::New("error"), String::New(jobs[i].error.c_str()));
+            results->Set(i, result);
+        }
+    }
+    return scope.Close(results);
+}
+
+void init_image_object () {
+    Handle<ObjectTemplate>image = ObjectTemplate::New();
+    image->Set(String::New("thumbnail"), FunctionTemplate::New(image_thumbnail));
+    image->Set(String::New("thumbnails"), FunctionTemplate::New(image_thumbnails));
+
+    builtinObject->Set(String::New("image"), image);
+}
@@ -0,0 +1,629 @@
+/**
+ * @module builtin/json
+ *
+ * ### Synopsis
+ * SilkJS builtin JSON encoder and decoder for buffers.
+ *
+ * ### Description
+ * These functions convert between JavaScript values and JSON text held in a builtin/buffer, without building the JSON as a JavaScript string first.  This saves a large string allocation and a copy when sending or receiving large JSON documents; the HTTP server's res.writeJson() uses json.stringifyTo() to encode directly into the response buffer.
+ *
+ * The output of json.stringifyTo() is the same as that of JSON.stringify(), without the replacer and indentation arguments: toJSON() methods are called (so Dates become ISO strings), undefined and functions are omitted from objects and become null in arrays, and NaN and Infinity become null.
+ *
+ * ### Usage
+ * var json = require('builtin/json');
+ *
+ * ### See Also
+ * builtin/buffer
+ */
+#include "SilkJS.h"
+
+#define JSON_MAX_DEPTH 512
+
+class JsonWriter {
+    Buffer *buf;
+    char chunk[16384];
+    int n;
+public:
+    long total;
+    JsonWriter (Buffer *b) : buf(b), n(0), total(0) {}
+    ~JsonWriter () {
+        flush();
+    }
+    void flush () {
+        if (n) {
+            BufferAppend(buf, chunk, n);
+            total += n;
+            n = 0;
+        }
+    }
+    inline void put (char c) {
+        if (n == sizeof (chunk)) {
+            flush();
+        }
+        chunk[n++] = c;
+    }
+    void write (const char *s, long len) {
+        if (len > (long) sizeof (chunk) - n) {
+            flush();
+            if (len > (long) sizeof (chunk)) {
+                BufferAppend(buf, s, len);
+                total += len;
+                return;
+            }
+        }
+        memcpy(&chunk[n], s, len);
+        n += len;
+    }
+};
+
+static const char hexDigits[] = "0123456789abcdef";
+
+static void writeString (JsonWriter &out, Handle<String>s) {
+    static string scratch;
+    int len = s->Utf8Length();
+    scratch.resize(len + 1);
+    s->WriteUtf8(&scratch[0], len + 1);
+    const char *p = scratch.data(),
+        *end = p + len,
+        *run = p;
+
+    out.put('"');
+    for (; p < end; p++) {
+        unsigned char c = *p;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        out.write(run, p - run);
+        run = p + 1;
+        out.put('\\');
+        switch (c) {
+            case '"': out.put('"'); break;
+            case '\\': out.put('\\'); break;
+            case '\b': out.put('b'); break;
+            case '\f': out.put('f'); break;
+            case '\n': out.put('n'); break;
+            case '\r': out.put('r'); break;
+            case '\t': out.put('t'); break;
+            default:
+                out.write("u00", 3);
+                out.put(hexDigits[c >> 4]);
+                out.put(hexDigits[c & 0xf]);
+                break;
+        }
+    }
+    out.write(run, p - run);
+    out.put('"');
+}
+
+static void writeNumber (JsonWriter &out, Handle<Value>v) {
+    char tmp[32];
+    if (v->IsInt32()) {
+        out.write(tmp, sprintf(tmp, "%d", v->Int32Value()));
+        return;
+    }
+    double d = v->NumberValue();
+    if (d != d || d - d != 0) {
+        // NaN or Infinity
+        out.write("null", 4);
+        return;
+    }
+    // V8's number to string conversion gives the shortest representation, as JSON.stringify does
+    String::Utf8Value s(v->ToString());
+    out.write(*s, s.length());
+}
+
+/**
+ * Call the value's toJSON() method, if it has one, as JSON.stringify does.
+ */
+static Handle<Value>resolve (Handle<Value>v, bool &error) {
+    if (v->IsObject() && !v->IsFunction()) {
+        Handle<Object>o = v->ToObject();
+        Handle<Value>toJSON = o->Get(String::NewSymbol("toJSON"));
+        if (toJSON->IsFunction()) {
+            TryCatch tryCatch;
+            v = Handle<Function>::Cast(toJSON)->Call(o, 0, NULL);
+            if (tryCatch.HasCaught()) {
+                tryCatch.ReThrow();
+                error = true;
+                return Undefined();
+            }
+        }
+    }
+    return v;
+}
+
+/**
+ * Write a value that has been through resolve(); returns false if nothing
+ * was written (undefined or a function), or if an exception was thrown.
+ */
+static bool writeValue (JsonWriter &out, Handle<Value>v, int depth, bool &error) {
+    if (v->IsUndefined() || v->IsFunction()) {
+        return false;
+    }
+    if (v->IsNull()) {
+        out.write("null", 4);
+    }
+    else if (v->IsTrue()) {
+        out.write("true", 4);
+    }
+    else if (v->IsFalse()) {
+        out.write("false", 5);
+    }
+    else if (v->IsNumber() || v->IsNumberObject()) {
+        writeNumber(out, v->IsNumber() ? v : Handle<Value>(v->ToNumber()));
+    }
+    else if (v->IsString() || v->IsStringObject()) {
+        writeString(out, v->ToString());
+    }
+    else if (v->IsBooleanObject()) {
+        if (BooleanObject::Cast(*v)->BooleanValue()) {
+            out.write("true", 4);
+        }
+        else {
+            out.write("false", 5);
+        }
+    }
+    else {
+        if (depth >= JSON_MAX_DEPTH) {
+            ThrowException(Exception::TypeError(String::New("json.stringifyTo: converting circular structure, or nesting too deep")));
+            error = true;
+            return false;
+        }
+        if (v->IsArray()) {
+            Handle<Array>a = Handle<Array>::Cast(v);
+            uint32_t len = a->Length();
+            out.put('[');
+            for (uint32_t i = 0; i < len; i++) {
+                HandleScope scope;
+                if (i) {
+                    out.put(',');
+                }
+                Handle<Value>value = resolve(a->Get(i), error);
+                if (error) {
+                    return false;
+                }
+                if (!writeValue(out, value, depth + 1, error)) {
+                    if (error) {
+                        return false;
+                    }
+                    out.write("null", 4);
+                }
+            }
+            out.put(']');
+        }
+        else {
+            Handle<Object>o = v->ToObject();
+            Handle<Array>keys = o->GetOwnPropertyNames();
+            uint32_t len = keys->Length();
+            bool first = true;
+            out.put('{');
+            for (uint32_t i = 0; i < len; i++) {
+                HandleScope scope;
+                Handle<Value>value = resolve(o->Get(keys->Get(i)), error);
+                if (error) {
+                    return false;
+                }
+                if (value->IsUndefined() || value->IsFunction()) {
+                    continue;
+                }
+                if (!first) {
+                    out.put(',');
+                }
+                first = false;
+                writeString(out, keys->Get(i)->ToString());
+                out.put(':');
+                if (!writeValue(out, value, depth + 1, error)) {
+                    return false;
+                }
+            }
+            out.put('}');
+        }
+    }
+    return true;
+}
+
+/**
+ * @function json.stringifyTo
+ *
+ * ### Synopsis
+ *
+ * var length = json.stringifyTo(buf, value);
+ *
+ * Encode a value as JSON, appending it to a buffer.
+ *
+ * @param {object} buf - buffer to write to.
+ * @param {mixed} value - value to encode.
+ * @returns {int} length - number of bytes written; 0 if value is undefined or a function, as JSON.stringify() would return undefined.
+ */
+static JSVAL json_stringifyTo (JSARGS args) {
+    Buffer *buf = (Buffer *) JSOPAQUE(args[0]);
+    bool error = false;
+    long total;
+    {
+        JsonWriter out(buf);
+        Handle<Value>value = resolve(args[1], error);
+        if (!error) {
+            writeValue(out, value, 0, error);
+        }
+        out.flush();
+        total = out.total;
+    }
+    BufferAccount(args[0], buf);
+    if (error) {
+        return Handle<Value>();
+    }
+    return Integer::New(total);
+}
+
+class JsonParser {
+    const char *start, *p, *end;
+    string scratch;
+public:
+    bool failed;
+    JsonParser (const char *data, long len) : start(data), p(data), end(data + len), failed(false) {}
+
+    Handle<Value>fail (const char *message) {
+        if (!failed) {
+            char msg[128];
+            snprintf(msg, sizeof (msg), "json.parse: %s at offset %ld", p < end ? message : "unexpected end of input", (long) (p - start));
+            ThrowException(Exception::SyntaxError(String::New(msg)));
+            failed = true;
+        }
+        return Handle<Value>();
+    }
+
+    inline void skipSpace () {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+            p++;
+        }
+    }
+
+    bool done () {
+        skipSpace();
+        return p == end;
+    }
+
+    static int hex (char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    bool parseHex4 (unsigned int &u) {
+        if (end - p < 4) {
+            return false;
+        }
+        u = 0;
+        for (int i = 0; i < 4; i++) {
+            int h = hex(p[i]);
+            if (h < 0) {
+                return false;
+            }
+            u = (u << 4) | h;
+        }
+        p += 4;
+        return true;
+    }
+
+    void appendUtf8 (unsigned int u) {
+        if (u < 0x80) {
+            scratch += (char) u;
+        }
+        else if (u < 0x800) {
+            scratch += (char) (0xc0 | (u >> 6));
+            scratch += (char) (0x80 | (u & 0x3f));
+        }
+        else if (u < 0x10000) {
+            scratch += (char) (0xe0 | (u >> 12));
+            scratch += (char) (0x80 | ((u >> 6) & 0x3f));
+            scratch += (char) (0x80 | (u & 0x3f));
+        }
+        else {
+            scratch += (char) (0xf0 | (u >> 18));
+            scratch += (char) (0x80 | ((u >> 12) & 0x3f));
+            scratch += (char) (0x80 | ((u >> 6) & 0x3f));
+            scratch += (char) (0x80 | (u & 0x3f));
+        }
+    }
+
+    Handle<String>parseString (bool symbol) {
+        // p is just past the opening quote
+        const char *run = p;
+        while (p < end && *p != '"' && *p != '\\') {
+            if ((unsigned char) *p < 0x20) {
+                fail("control character in string");
+                return Handle<String>();
+            }
+            p++;
+        }
+        if (p < end && *p == '"') {
+            // no escapes, create the string straight from the input
+            int len = p - run;
+            p++;
+            return symbol ? String::NewSymbol(run, len) : String::New(run, len);
+        }
+        scratch.assign(run, p - run);
+        while (p < end && *p != '"') {
+            char c = *p++;
+            if ((unsigned char) c < 0x20) {
+                p--;
+                fail("control character in string");
+                return Handle<String>();
+            }
+            if (c != '\\') {
+                scratch += c;
+                continue;
+            }
+            if (p == end) {
+                break;
+            }
+            switch (*p++) {
+                case '"': scratch += '"'; break;
+                case '\\': scratch += '\\'; break;
+                case '/': scratch += '/'; break;
+                case 'b': scratch += '\b'; break;
+                case 'f': scratch += '\f'; break;
+                case 'n': scratch += '\n'; break;
+                case 'r': scratch += '\r'; break;
+                case 't': scratch += '\t'; break;
+                case 'u': {
+                    unsigned int u, lo;
+                    if (!parseHex4(u)) {
+                        fail("bad \\u escape");
+                        return Handle<String>();
+                    }
+                    if (u >= 0xd800 && u < 0xdc00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                        const char *save = p;
+                        p += 2;
+                        if (parseHex4(lo) && lo >= 0xdc00 && lo < 0xe000) {
+                            u = 0x10000 + ((u - 0xd800) << 10) + (lo - 0xdc00);
+                        }
+                        else {
+                            p = save;
+                        }
+                    }
+                    appendUtf8(u);
+                    break;
+                }
+                default:
+                    p--;
+                    fail("bad escape");
+                    return Handle<String>();
+            }
+        }
+        if (p == end) {
+            fail("unterminated string");
+            return Handle<String>();
+        }
+        p++;
+        return symbol ? String::NewSymbol(scratch.data(), scratch.size()) : String::New(scratch.data(), scratch.size());
+    }
+
+    Handle<Value>parseNumber () {
+        const char *s = p;
+        bool integer = true;
+        if (p < end && *p == '-') {
+            p++;
+        }
+        if (p == end || *p < '0' || *p > '9') {
+            return fail("bad number");
+        }
+        if (*p == '0') {
+            p++;
+        }
+        else {
+            while (p < end && *p >= '0' && *p <= '9') {
+                p++;
+            }
+        }
+        if (p < end && *p == '.') {
+            integer = false;
+            p++;
+            if (p == end || *p < '0' || *p > '9') {
+                return fail("bad number");
+            }
+            while (p < end && *p >= '0' && *p <= '9') {
+                p++;
+            }
+        }
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            integer = false;
+            p++;
+            if (p < end && (*p == '+' || *p == '-')) {
+                p++;
+            }
+            if (p == end || *p < '0' || *p > '9') {
+                return fail("bad number");
+            }
+            while (p < end && *p >= '0' && *p <= '9') {
+                p++;
+            }
+        }
+        int len = p - s;
+        if (integer && len <= 9) {
+            int n = 0;
+            const char *q = *s == '-' ? s + 1 : s;
+            while (q < p) {
+                n = n * 10 + (*q++ - '0');
+            }
+            if (*s == '-') {
+                return n ? Handle<Value>(Integer::New(-n)) : Handle<Value>(Number::New(-0.0));
+            }
+            return Integer::New(n);
+        }
+        // the input isn't NUL terminated
+        scratch.assign(s, len);
+        return Number::New(strtod(scratch.c_str(), NULL));
+    }
+
+    bool literal (const char *word, int len) {
+        if (end - p < len || memcmp(p, word, len)) {
+            return false;
+        }
+        p += len;
+        return true;
+    }
+
+    Handle<Value>parseValue (int depth) {
+        skipSpace();
+        if (p == end) {
+            return fail("unexpected end of input");
+        }
+        switch (*p) {
+            case '{': {
+                if (depth >= JSON_MAX_DEPTH) {
+                    return fail("nesting too deep");
+                }
+                HandleScope scope;
+                Handle<Object>o = Object::New();
+                p++;
+                skipSpace();
+                if (p < end && *p == '}') {
+                    p++;
+                    return scope.Close(o);
+                }
+                for (;;) {
+                    skipSpace();
+                    if (p == end || *p != '"') {
+                        return fail("expected string");
+                    }
+                    p++;
+                    Handle<String>key = parseString(true);
+                    if (failed) {
+                        return Handle<Value>();
+                    }
+                    skipSpace();
+                    if (p == end || *p != ':') {
+                        return fail("expected ':'");
+                    }
+                    p++;
+                    Handle<Value>value = parseValue(depth + 1);
+                    if (failed) {
+                        return Handle<Value>();
+                    }
+                    o->Set(key, value);
+                    skipSpace();
+                    if (p < end && *p == ',') {
+                        p++;
+                        continue;
+                    }
+                    if (p < end && *p == '}') {
+                        p++;
+                        return scope.Close(o);
+                    }
+                    return fail("expected ',' or '}'");
+                }
+            }
+            case '[': {
+                if (depth >= JSON_MAX_DEPTH) {
+                    return fail("nesting too deep");
+                }
+                HandleScope scope;
+                Handle<Array>a = Array::New();
+                uint32_t n = 0;
+                p++;
+                skipSpace();
+                if (p < end && *p == ']') {
+                    p++;
+                    return scope.Close(a);
+                }
+                for (;;) {
+                    Handle<Value>value = parseValue(depth + 1);
+                    if (failed) {
+                        return Handle<Value>();
+                    }
+                    a->Set(n++, value);
+                    skipSpace();
+                    if (p < end && *p == ',') {
+                        p++;
+                        continue;
+                    }
+                    if (p < end && *p == ']') {
+                        p++;
+                        return scope.Close(a);
+                    }
+                    return fail("expected ',' or ']'");
+                }
+            }
+            case '"': {
+                p++;
+                Handle<String>s = parseString(false);
+                if (failed) {
+                    return Handle<Value>();
+                }
+                return s;
+            }
+            case 't':
+                if (literal("true", 4)) {
+                    return True();
+                }
+                break;
+            case 'f':
+                if (literal("false", 5)) {
+                    return False();
+                }
+                break;
+            case 'n':
+                if (literal("null", 4)) {
+                    return Null();
+                }
+                break;
+            default:
+                if (*p == '-' || (*p >= '0' && *p <= '9')) {
+                    return parseNumber();
+                }
+                break;
+        }
+        return fail("unexpected character");
+    }
+};
+
+/**
+ * @function json.parse
+ *
+ * ### Synopsis
+ *
+ * var value = json.parse(buf);
+ * var value = json.parse(str);
+ *
+ * Decode JSON held in a buffer, e.g. a large request body, without first converting it to a JavaScript string.  A string may also be passed.
+ *
+ * A SyntaxError, giving the offset of the error, is thrown if the JSON is not valid.
+ *
+ * @param {object|string} buf - buffer (or string) holding the JSON.
+ * @returns {mixed} value - the decoded value.
+ */
+static JSVAL json_parse (JSARGS args) {
+    HandleScope scope;
+    if (args[0]->IsString()) {
+        String::Utf8Value s(args[0]);
+        JsonParser parser(*s, s.length());
+        Handle<Value>v = parser.parseValue(0);
+        if (parser.failed) {
+            return Handle<Value>();
+        }
+        if (!parser.done()) {
+            return parser.fail("unexpected data after JSON value");
+        }
+        return scope.Close(v);
+    }
+    Buffer *buf = (Buffer *) JSOPAQUE(args[0]);
+    JsonParser parser((const char *) buf->data(), buf->length());
+    Handle<Value>v = parser.parseValue(0);
+    if (parser.failed) {
+        return Handle<Value>();
+    }
+    if (!parser.done()) {
+        return parser.fail("unexpected data after JSON value");
+    }
+    return scope.Close(v);
+}
+
+void init_json_object () {
+    Handle<ObjectTemplate>json = ObjectTemplate::New();
+    json->Set(String::New("stringifyTo"), FunctionTemplate::New(json_stringifyTo));
+    json->Set(String::New("parse"), FunctionTemplate::New(json_parse));
+
+    builtinObject->Set(String::New("json"), json);
+}
@@ -19,12 +19,24 @@
  * 
  * These objects are of the form:
  * 
- * + value: the string value returned from memcached
+ * + value: the value returned from memcached
  * + flags: the 32-bit integer value stored with the value returned from memcached
  * + rc: memcached result code
+ * 
+ * ### Flags
+ * 
+ * Bits 28 to 30 of the flags stored with a value (FLAG_RESERVED) are reserved; they tell this module how the value is encoded:
+ * 
+ * + FLAG_PACKED: the value is any JavaScript value, stored in a compact binary (MessagePack) encoding instead of as a string.
+ * + FLAG_ZLIB, FLAG_LZ4: compress the value if it is larger than the compression threshold.  The bit is cleared if the value was stored uncompressed.
+ * 
+ * Values are decoded accordingly by get() and mget(), so the value member of the returned objects is whatever JavaScript value was stored.  The other bits are free for the caller's use; Memcached.js uses FLAG_STRING (1).  Values stored by other clients must not set the reserved bits, or they will be decoded as packed or compressed.
+ * 
+ * LZ4 compression requires SilkJS to be built with HAVE_LZ4; otherwise zlib is used.
  */
 #include "SilkJS.h"
 #include <libmemcached/memcached.h>
+#include <vector>
 
 #define M memcached_st
 //#ifdef __LIBMEMCACHED_MEMCACHED_H__
@@ -53,23 +65,139 @@ static inline M* HANDLE (Handle<Value>v) {
     return (M *) JSOPAQUE(v);
 }
 
+#define FLAG_STRING     0x00000001
+// reserved for the encoding of the value; the other bits belong to the caller
+#define FLAG_PACKED     0x10000000
+#define FLAG_ZLIB       0x20000000
+#define FLAG_LZ4        0x40000000
+#define FLAG_COMPRESSED (FLAG_ZLIB | FLAG_LZ4)
+#define FLAG_RESERVED   (FLAG_PACKED | FLAG_COMPRESSED)
+
+/**
+ * Encode value for storage according to flags, compressing it if it is
+ * larger than threshold bytes.  The compression bits of flags are
+ * updated to say how the value was actually stored.
+ */
+static bool encodeValue (string &out, Handle<Value>value, uint32_t &flags, long threshold) {
+    if (flags & FLAG_PACKED) {
+        if (!PackValue(out, value)) {
+            return false;
+        }
+    }
+    else {
+        String::Utf8Value s(value);
+        out.assign(*s, s.length());
+    }
+    uint32_t compression = flags & FLAG_COMPRESSED;
+    flags &= ~FLAG_COMPRESSED;
+    if (compression && (long) out.size() > threshold) {
+        string z;
+        int method = PackCompress(z, out.data(), out.size(), (compression & FLAG_LZ4) ? PACK_LZ4 : PACK_ZLIB);
+        if (method && z.size() < out.size()) {
+            out.swap(z);
+            flags |= method == PACK_LZ4 ? FLAG_LZ4 : FLAG_ZLIB;
+        }
+    }
+    return true;
+}
+
+/**
+ * Decode a value stored by encodeValue.  Returns an empty handle, with an
+ * exception pending, if the value is corrupt.
+ */
+static Handle<Value>decodeValue (const char *data, size_t len, uint32_t flags) {
+    string plain;
+    if (flags & FLAG_COMPRESSED) {
+        if (!PackDecompress(plain, data, len, (flags & FLAG_LZ4) ? PACK_LZ4 : PACK_ZLIB)) {
+            ThrowException(String::New("memcached: corrupt compressed value"));
+            return Handle<Value>();
+        }
+        data = plain.data();
+        len = plain.size();
+    }
+    if (flags & FLAG_PACKED) {
+        return UnpackValue((const unsigned char *) data, len);
+    }
+    return String::New(data, len);
+}
+
+typedef R (*STORE_FN)(M *, const char *, size_t, const char *, size_t, time_t, uint32_t);
+
+static JSVAL store (JSARGS args, STORE_FN fn) {
+    M *handle = HANDLE(args[0]);
+    String::Utf8Value key(args[1]);
+    time_t expiration = 0;
+    if (args.Length() > 3) {
+        expiration = args[3]->IntegerValue();
+    }
+    uint32_t flags = 0;
+    if (args.Length() > 4) {
+        flags = args[4]->IntegerValue();
+    }
+    long threshold = 0;
+    if (args.Length() > 5) {
+        threshold = args[5]->IntegerValue();
+    }
+    string value;
+    if (!encodeValue(value, args[2], flags, threshold)) {
+        return Handle<Value>();
+    }
+    return Integer::New(fn(handle, *key, key.length(), value.data(), value.size(), expiration, flags));
+}
+
+struct BEHAVIOR {
+    const char *name;
+    memcached_behavior flag;
+};
+static BEHAVIOR behaviors[] = {
+    { "binary", MEMCACHED_BEHAVIOR_BINARY_PROTOCOL },
+    { "ketama", MEMCACHED_BEHAVIOR_KETAMA_WEIGHTED },
+    { "noDelay", MEMCACHED_BEHAVIOR_TCP_NODELAY },
+    { "noReply", MEMCACHED_BEHAVIOR_NOREPLY },
+    { "buffered", MEMCACHED_BEHAVIOR_BUFFER_REQUESTS },
+    { NULL, MEMCACHED_BEHAVIOR_NO_BLOCK }
+};
+
 /**
  * @function memcached.connect
  * 
  * ### Synopsis
  * 
  * var handle = memcached.connect(servers);
+ * var handle = memcached.connect(servers, options);
  * 
  * Create a connection to the specified memcached servers.
  * 
  * The servers argument is a comma separated list of memcached servers.  The server names are of the form <code>hostname[:port]</code>.
  * 
+ * The optional options argument is an object whose members turn libmemcached behaviors on (true) or off (false):
+ * 
+ * + binary: use the binary protocol instead of the ASCII one.
+ * + ketama: distribute keys over the servers with weighted ketama consistent hashing instead of modulo hashing, so adding or removing a server only remaps the keys of that server.
+ * + noDelay: set TCP_NODELAY on the sockets.
+ * + noReply: don't wait for replies to storage commands.  Result codes of set, add, etc., are then meaningless.
+ * + buffered: buffer storage commands and send them when a reply is needed, or by memcached.flush_buffers().  Storage commands return BUFFERED.
+ * 
+ * Note that every process using a cache must use the same hashing (ketama or not) or they won't find each other's keys.
+ * 
  * @param {string} servers - comma separated list of servers
+ * @param {object} options - optional behaviors to set
  * @return {object} handle - opaque handle used for other memcached methods, or false if an error occurred.
  */
 JSVAL _memcached_connect (JSARGS args) {
     String::Utf8Value options(args[0]);
     M *handle = memcached_create(NULL);
+    if (args.Length() > 1 && args[1]->IsObject()) {
+        // behaviors must be set before the servers are pushed, so the
+        // distribution is computed for the right hashing
+        JSOBJ o = args[1]->ToObject();
+        for (BEHAVIOR *b = behaviors; b->name; b++) {
+            Handle<Value>v = o->Get(String::New(b->name));
+            if (!v->IsUndefined()) {
+                memcached_behavior_set(handle, b->flag, v->BooleanValue() ? 1 : 0);
+            }
+        }
+    }
     S *servers = memcached_servers_parse(*options);
     if (memcached_server_push(handle, servers) != MEMCACHED_SUCCESS) {
         memcached_server_list_free(servers);
@@ -80,6 +208,43 @@ JSVAL _memcached_connect (JSARGS args) {
     return Opaque::New(handle);
 }
 
+/**
+ * @function memcached.behavior_set
+ * 
+ * ### Synopsis
+ * 
+ * var rc = memcached.behavior_set(handle, behavior, value);
+ * 
+ * Set a libmemcached behavior.  The behavior is one of the BEHAVIOR_* constants.
+ * 
+ * @param {object} handle - handle to memcached connection.
+ * @param {int} behavior - behavior to set.
+ * @param {int} value - value for the behavior, 1/0 for flags.
+ * @return {int} rc - result code; 0 if no error, otherwise the error code.
+ */
+JSVAL _memcached_behavior_set (JSARGS args) {
+    M *handle = HANDLE(args[0]);
+    return Integer::New(memcached_behavior_set(handle, (memcached_behavior) args[1]->IntegerValue(), args[2]->IntegerValue()));
+}
+
+/**
+ * @function memcached.behavior_get
+ * 
+ * ### Synopsis
+ * 
+ * var value = memcached.behavior_get(handle, behavior);
+ * 
+ * Get the value of a libmemcached behavior.  The behavior is one of the BEHAVIOR_* constants.
+ * 
+ * @param {object} handle - handle to memcached connection.
+ * @param {int} behavior - behavior to get.
+ * @return {int} value - value of the behavior.
+ */
+JSVAL _memcached_behavior_get (JSARGS args) {
+    M *handle = HANDLE(args[0]);
+    return Number::New(memcached_behavior_get(handle, (memcached_behavior) args[1]->IntegerValue()));
+}
+
 /**
  * @function memcached.close
  * 
@@ -134,12 +299,17 @@ JSVAL _memcached_get (JSARGS args) {
     size_t value_length;
     uint32_t flags;
     R rc;
-    char *res = memcached_get(handle, *key, strlen(*key), &value_length, &flags, &rc);
+    char *res = memcached_get(handle, *key, key.length(), &value_length, &flags, &rc);
     if (!res) {
         return False();
     }
+    Handle<Value>value = decodeValue(res, value_length, flags);
+    if (value.IsEmpty()) {
+        free(res);
+        return value;
+    }
     JSOBJ o = Object::New();
-    o->Set(String::New("value"), String::New(res));
+    o->Set(String::New("value"), value);
     o->Set(String::New("flags"), Integer::New(flags));
     o->Set(String::New("rc"), Integer::New(rc));
     free(res);
@@ -167,14 +337,19 @@ JSVAL _memcached_mget (JSARGS args) {
     M* handle = HANDLE(args[0]);
     Handle<Array> aKeys = Handle<Array>::Cast(args[1]);
     int numKeys = aKeys->Length();
-    char *keys[numKeys];
-    size_t key_lengths[numKeys];
+    vector<string> keyStrings(numKeys);
+    vector<const char *> keys(numKeys);
+    vector<size_t> key_lengths(numKeys);
     for (int i = 0; i < numKeys; i++) {
         String::Utf8Value k(aKeys->Get(i));
-        keys[i] = *k;
-        key_lengths[i] = strlen(keys[i]);
+        keyStrings[i] = *k;
+        keys[i] = keyStrings[i].c_str();
+        key_lengths[i] = keyStrings[i].length();
+    }
+    if (!numKeys) {
+        return Object::New();
     }
-    R rc = memcached_mget(handle, keys, key_lengths, numKeys);
+    R rc = memcached_mget(handle, &keys[0], &key_lengths[0], numKeys);
     if (rc != MEMCACHED_SUCCESS) {
         return String::New(memcached_strerror(handle, rc));
     }
@@ -185,12 +360,20 @@ JSVAL _memcached_mget (JSARGS args) {
     uint32_t flags;
     JSOBJ result = Object::New();
     while ((return_value = memcached_fetch(handle, return_key, &return_key_length, &return_value_length, &flags, &rc))) {
+        Handle<Value>value = decodeValue(return_value, return_value_length, flags);
+        free(return_value);
+        if (value.IsEmpty()) {
+            // finish the fetch so the connection is usable
+            while ((return_value = memcached_fetch(handle, return_key, &return_key_length, &return_value_length, &flags, &rc))) {
+                free(return_value);
+            }
+            return value;
+        }
         JSOBJ o = Object::New();
-        o->Set(String::New("value"), String::New(return_value));
+        o->Set(String::New("value"), value);
         o->Set(String::New("flags"), Integer::New(flags));
         o->Set(String::New("rc"), Integer::New(rc));
-        free(return_value);
-        result->Set(String::New(return_key), o);
+        result->Set(String::New(return_key, return_key_length), o);
     }
     return result;
 }
@@ -203,6 +386,7 @@ JSVAL _memcached_mget (JSARGS args) {
  * var rc = memcached.set(handle, key, value);
  * var rc = memcached.set(handle, key, value, expiration);
  * var rc = memcached.set(handle, key, value, expiration, flags);
+ * var rc = memcached.set(handle, key, value, expiration, flags, threshold);
  * 
  * Store information in memcached indexed by key.  
  * 
@@ -210,24 +394,14 @@ JSVAL _memcached_mget (JSARGS args) {
  * 
  * @param {object} handle - handle to memcached connection.
  * @param {string} key - key of data to set in memcached.
- * @param {string} value - value of data to set in memcached.
+ * @param {string|mixed} value - value of data to set in memcached; any value if flags has FLAG_PACKED.
  * @param {int} expiration - length of time value is valid (after this it will be removed from memcached automatically).
- * @param {int} flags - user defined integer value stored along with the value.
+ * @param {int} flags - integer value stored along with the value; see Flags at the top of the page.
+ * @param {int} threshold - values larger than this many bytes are compressed if flags asks for it (default 0).
  * @return {int} rc - result code; 0 if no error, otherwise the error code.
  */
 JSVAL _memcached_set (JSARGS args) {
-    M *handle = HANDLE(args[0]);
-    String::Utf8Value key(args[1]);
-    String::Utf8Value value(args[2]);
-    time_t expiration = 0;
-    if (args.Length() > 3) {
-        expiration = args[3]->IntegerValue();
-    }
-    uint32_t flags = 0;
-    if (args.Length() > 4) {
-        flags = args[4]->IntegerValue();
-    }
-    return Integer::New(memcached_set(handle, *key, strlen(*key), *value, strlen(*value), expiration, flags));
+    return store(args, memcached_set);
 }
 
 /**
@@ -238,6 +412,7 @@ JSVAL _memcached_set (JSARGS args) {
  * var rc = memcached.add(handle, key, value);
  * var rc = memcached.add(handle, key, value, expiration);
  * var rc = memcached.add(handle, key, value, expiration, flags);
+ * var rc = memcached.add(handle, key, value, expiration, flags, threshold);
  * 
  * Store information in memcached indexed by key.  
  * 
@@ -245,25 +420,14 @@ JSVAL _memcached_set (JSARGS args) {
  * 
  * @param {object} handle - handle to memcached connection.
  * @param {string} key - key of data to set in memcached.
- * @param {string} value - value of data to set in memcached.
+ * @param {string|mixed} value - value of data to set in memcached; any value if flags has FLAG_PACKED.
  * @param {int} expiration - length of time value is valid (after this it will be removed from memcached automatically).
- * @param {int} flags - user defined integer value stored along with the value.
+ * @param {int} flags - integer value stored along with the value; see Flags at the top of the page.
+ * @param {int} threshold - values larger than this many bytes are compressed if flags asks for it (default 0).
  * @return {int} rc - result code; 0 if no error, otherwise the error code.
  */
 JSVAL _memcached_add (JSARGS args) {
-    M *handle = HANDLE(args[0]);
-    String::Utf8Value key(args[1]);
-    String::Utf8Value value(args[2]);
-    time_t expiration = 0;
-    if (args.Length() > 3) {
-        expiration = args[3]->IntegerValue();
-    }
-    uint32_t flags = 0;
-    if (args.Length() > 4) {
-        flags = args[4]->IntegerValue();
-    }
-
-    return Integer::New(memcached_add(handle, *key, strlen(*key), *value, strlen(*value), expiration, flags));
+    return store(args, memcached_add);
 }
 
 /**
@@ -274,6 +438,7 @@ JSVAL _memcached_add (JSARGS args) {
  * var rc = memcached.replace(handle, key, value);
  * var rc = memcached.replace(handle, key, value, expiration);
  * var rc = memcached.replace(handle, key, value, expiration, flags);
+ * var rc = memcached.replace(handle, key, value, expiration, flags, threshold);
  * 
  * Store information in memcached indexed by key.  
  * 
@@ -281,24 +446,14 @@ JSVAL _memcached_add (JSARGS args) {
  * 
  * @param {object} handle - handle to memcached connection.
  * @param {string} key - key of data to set in memcached.
- * @param {string} value - value of data to set in memcached.
+ * @param {string|mixed} value - value of data to set in memcached; any value if flags has FLAG_PACKED.
  * @param {int} expiration - length of time value is valid (after this it will be removed from memcached automatically).
- * @param {int} flags - user defined integer value stored along with the value.
+ * @param {int} flags - integer value stored along with the value; see Flags at the top of the page.
+ * @param {int} threshold - values larger than this many bytes are compressed if flags asks for it (default 0).
  * @return {int} rc - result code; 0 if no error, otherwise the error code.
  */
 JSVAL _memcached_replace (JSARGS args) {
-    M *handle = HANDLE(args[0]);
-    String::Utf8Value key(args[1]);
-    String::Utf8Value value(args[2]);
-    time_t expiration = 0;
-    if (args.Length() > 3) {
-        expiration = args[3]->IntegerValue();
-    }
-    uint32_t flags = 0;
-    if (args.Length() > 4) {
-        flags = args[4]->IntegerValue();
-    }
-    return Integer::New(memcached_replace(handle, *key, strlen(*key), *value, strlen(*value), expiration, flags));
+    return store(args, memcached_replace);
 }
 
 /**
@@ -309,6 +464,7 @@ JSVAL _memcached_replace (JSARGS args) {
  * var rc = memcached.prepend(handle, key, value);
  * var rc = memcached.prepend(handle, key, value, expiration);
  * var rc = memcached.prepend(handle, key, value, expiration, flags);
+ * var rc = memcached.prepend(handle, key, value, expiration, flags, threshold);
  * 
  * Prepends the given value string to the value of an existing item.  
  * 
@@ -318,22 +474,12 @@ JSVAL _memcached_replace (JSARGS args) {
  * @param {string} key - key of data to set in memcached.
  * @param {string} value - value of data to prepend in memcached.
  * @param {int} expiration - length of time value is valid (after this it will be removed from memcached automatically).
- * @param {int} flags - user defined integer value stored along with the value.
+ * @param {int} flags - integer value stored along with the value; see Flags at the top of the page.
+ * @param {int} threshold - values larger than this many bytes are compressed if flags asks for it (default 0).
  * @return {int} rc - result code; 0 if no error, otherwise the error code.
  */
 JSVAL _memcached_prepend (JSARGS args) {
-    M *handle = HANDLE(args[0]);
-    String::Utf8Value key(args[1]);
-    String::Utf8Value value(args[2]);
-    time_t expiration = 0;
-    if (args.Length() > 3) {
-        expiration = args[3]->IntegerValue();
-    }
-    uint32_t flags = 0;
-    if (args.Length() > 4) {
-        flags = args[4]->IntegerValue();
-    }
-    return Integer::New(memcached_prepend(handle, *key, strlen(*key), *value, strlen(*value), expiration, flags));
+    return store(args, memcached_prepend);
 }
 
 /**
@@ -344,6 +490,7 @@ JSVAL _memcached_prepend (JSARGS args) {
  * var rc = memcached.append(handle, key, value);
  * var rc = memcached.append(handle, key, value, expiration);
  * var rc = memcached.append(handle, key, value, expiration, flags);
+ * var rc = memcached.append(handle, key, value, expiration, flags, threshold);
  * 
  * Appends the given value string to the value of an existing item.  
  * 
@@ -353,22 +500,12 @@ JSVAL _memcached_prepend (JSARGS args) {
  * @param {string} key - key of data to set in memcached.
  * @param {string} value - value of data to append in memcached.
  * @param {int} expiration - length of time value is valid (after this it will be removed from memcached automatically).
- * @param {int} flags - user defined integer value stored along with the value.
+ * @param {int} flags - integer value stored along with the value; see Flags at the top of the page.
+ * @param {int} threshold - values larger than this many bytes are compressed if flags asks for it (default 0).
  * @return {int} rc - result code; 0 if no error, otherwise the error code.
  */
 JSVAL _memcached_append (JSARGS args) {
-    M *handle = HANDLE(args[0]);
-    String::Utf8Value key(args[1]);
-    String::Utf8Value value(args[2]);
-    time_t expiration = 0;
-    if (args.Length() > 3) {
-        expiration = args[3]->IntegerValue();
-    }
-    uint32_t flags = 0;
-    if (args.Length() > 4) {
-        flags = args[4]->IntegerValue();
-    }
-    return Integer::New(memcached_append(handle, *key, strlen(*key), *value, strlen(*value), expiration, flags));
+    return store(args, memcached_append);
 }
 
 /**
@@ -391,7 +528,119 @@ JSVAL _memcached_remove (JSARGS args) {
     if (args.Length() > 2) {
         expiration = args[2]->IntegerValue();
     }
-    return Integer::New(memcached_delete(handle, *key, strlen(*key), expiration));
+    return Integer::New(memcached_delete(handle, *key, key.length(), expiration));
+}
+
+/**
+ * @function memcached.mset
+ * 
+ * ### Synopsis
+ * 
+ * var rc = memcached.mset(handle, items);
+ * var rc = memcached.mset(handle, items, expiration);
+ * var rc = memcached.mset(handle, items, expiration, threshold);
+ * 
+ * Store several items in memcached.
+ * 
+ * The items argument is an array of objects of the form { key: key, value: value, flags: flags }; flags is optional.  Values are encoded according to their flags as for memcached.set().
+ * 
+ * Each item waits for its reply, as with set(), unless the connection was made with the buffered or noReply behaviors: with buffered, the items are sent together when the buffer is flushed at the end (failures of individual items are then not reported), and with noReply no replies are read at all, so storing many items costs about one round trip instead of one per item.  The binary protocol alone does not pipeline them.
+ * 
+ * @param {object} handle - handle to memcached connection.
+ * @param {array} items - items to store.
+ * @param {int} expiration - length of time the values are valid.
+ * @param {int} threshold - values larger than this many bytes are compressed if their flags ask for it (default 0).
+ * @return {int} rc - result code; 0 if no error, otherwise the error code of the first item that failed.
+ */
+JSVAL _memcached_mset (JSARGS args) {
+    M *handle = HANDLE(args[0]);
+    Handle<Array>items = Handle<Array>::Cast(args[1]);
+    time_t expiration = 0;
+    if (args.Length() > 2) {
+        expiration = args[2]->IntegerValue();
+    }
+    long threshold = 0;
+    if (args.Length() > 3) {
+        threshold = args[3]->IntegerValue();
+    }
+    Handle<String>_key = String::New("key"),
+        _value = String::New("value"),
+        _flags = String::New("flags");
+    R ret = MEMCACHED_SUCCESS;
+    int numItems = items->Length();
+    for (int i = 0; i < numItems; i++) {
+        JSOBJ item = items->Get(i)->ToObject();
+        String::Utf8Value key(item->Get(_key));
+        uint32_t flags = item->Get(_flags)->IntegerValue();
+        string value;
+        if (!encodeValue(value, item->Get(_value), flags, threshold)) {
+            return Handle<Value>();
+        }
+        R rc = memcached_set(handle, *key, key.length(), value.data(), value.size(), expiration, flags);
+        if (rc != MEMCACHED_SUCCESS && rc != MEMCACHED_BUFFERED && ret == MEMCACHED_SUCCESS) {
+            ret = rc;
+        }
+    }
+    if (memcached_behavior_get(handle, MEMCACHED_BEHAVIOR_BUFFER_REQUESTS)) {
+        R rc = memcached_flush_buffers(handle);
+        if (rc != MEMCACHED_SUCCESS && ret == MEMCACHED_SUCCESS) {
+            ret = rc;
+        }
+    }
+    return Integer::New(ret);
+}
+
+/**
+ * @function memcached.mdelete
+ * 
+ * ### Synopsis
+ * 
+ * var rc = memcached.mdelete(handle, keys);
+ * 
+ * Remove several items from memcached by key.  Keys that are not found are not an error.
+ * 
+ * As with mset(), the deletes are pipelined only when the connection uses the buffered or noReply behaviors; otherwise each waits for its reply, whatever the protocol.
+ * 
+ * @param {object} handle - handle to memcached connection.
+ * @param {array} keys - keys of the items to remove.
+ * @return {int} rc - result code; 0 if no error, otherwise the error code of the first delete that failed.
+ */
+JSVAL _memcached_mdelete (JSARGS args) {
+    M *handle = HANDLE(args[0]);
+    Handle<Array>keys = Handle<Array>::Cast(args[1]);
+    R ret = MEMCACHED_SUCCESS;
+    int numKeys = keys->Length();
+    for (int i = 0; i < numKeys; i++) {
+        String::Utf8Value key(keys->Get(i));
+        R rc = memcached_delete(handle, *key, key.length(), 0);
+        if (rc != MEMCACHED_SUCCESS && rc != MEMCACHED_BUFFERED && rc != MEMCACHED_NOTFOUND && ret == MEMCACHED_SUCCESS) {
+            ret = rc;
+        }
+    }
+    if (memcached_behavior_get(handle, MEMCACHED_BEHAVIOR_BUFFER_REQUESTS)) {
+        R rc = memcached_flush_buffers(handle);
+        if (rc != MEMCACHED_SUCCESS && ret == MEMCACHED_SUCCESS) {
+            ret = rc;
+        }
+    }
+    return Integer::New(ret);
+}
+
+/**
+ * @function memcached.flush_buffers
+ * 
+ * ### Synopsis
+ * 
+ * var rc = memcached.flush_buffers(handle);
+ * 
+ * Send any storage commands buffered by the buffered behavior to the servers.
+ * 
+ * @param {object} handle - handle to memcached connection.
+ * @return {int} rc - result code; 0 if no error, otherwise the error code.
+ */
+JSVAL _memcached_flush_buffers (JSARGS args) {
+    M *handle = HANDLE(args[0]);
+    return Integer::New(memcached_flush_buffers(handle));
 }
 
 /**
@@ -444,11 +693,29 @@ void init_memcached_object () {
     memcached->Set(String::New("DEFAULT_PORT"), Integer::New(MEMCACHED_DEFAULT_PORT));
     memcached->Set(String::New("VERSION"), String::New(LIBMEMCACHED_VERSION_STRING));
     memcached->Set(String::New("SUCCESS"), Integer::New(MEMCACHED_SUCCESS));
+    memcached->Set(String::New("NOTFOUND"), Integer::New(MEMCACHED_NOTFOUND));
+    memcached->Set(String::New("BUFFERED"), Integer::New(MEMCACHED_BUFFERED));
+    memcached->Set(String::New("FLAG_STRING"), Integer::New(FLAG_STRING));
+    memcached->Set(String::New("FLAG_PACKED"), Integer::New(FLAG_PACKED));
+    memcached->Set(String::New("FLAG_ZLIB"), Integer::New(FLAG_ZLIB));
+    memcached->Set(String::New("FLAG_LZ4"), Integer::New(FLAG_LZ4));
+    memcached->Set(String::New("FLAG_RESERVED"), Integer::New(FLAG_RESERVED));
+    memcached->Set(String::New("BEHAVIOR_NO_BLOCK"), Integer::New(MEMCACHED_BEHAVIOR_NO_BLOCK));
+    memcached->Set(String::New("BEHAVIOR_TCP_NODELAY"), Integer::New(MEMCACHED_BEHAVIOR_TCP_NODELAY));
+    memcached->Set(String::New("BEHAVIOR_BINARY_PROTOCOL"), Integer::New(MEMCACHED_BEHAVIOR_BINARY_PROTOCOL));
+    memcached->Set(String::New("BEHAVIOR_KETAMA"), Integer::New(MEMCACHED_BEHAVIOR_KETAMA));
+    memcached->Set(String::New("BEHAVIOR_KETAMA_WEIGHTED"), Integer::New(MEMCACHED_BEHAVIOR_KETAMA_WEIGHTED));
+    memcached->Set(String::New("BEHAVIOR_NOREPLY"), Integer::New(MEMCACHED_BEHAVIOR_NOREPLY));
+    memcached->Set(String::New("BEHAVIOR_BUFFER_REQUESTS"), Integer::New(MEMCACHED_BEHAVIOR_BUFFER_REQUESTS));
+    memcached->Set(String::New("BEHAVIOR_CONNECT_TIMEOUT"), Integer::New(MEMCACHED_BEHAVIOR_CONNECT_TIMEOUT));
+    memcached->Set(String::New("BEHAVIOR_POLL_TIMEOUT"), Integer::New(MEMCACHED_BEHAVIOR_POLL_TIMEOUT));
 
     // methods
     memcached->Set(String::New("connect"), FunctionTemplate::New(_memcached_connect));
     memcached->Set(String::New("close"), FunctionTemplate::New(_memcached_close));
     memcached->Set(String::New("error"), FunctionTemplate::New(_memcached_error));
+    memcached->Set(String::New("behavior_set"), FunctionTemplate::New(_memcached_behavior_set));
+    memcached->Set(String::New("behavior_get"), FunctionTemplate::New(_memcached_behavior_get));
 
     memcached->Set(String::New("get"), FunctionTemplate::New(_memcached_get));
     memcached->Set(String::New("mget"), FunctionTemplate::New(_memcached_mget));
@@ -458,7 +725,10 @@ void init_memcached_object () {
     memcached->Set(String::New("prepend"), FunctionTemplate::New(_memcached_prepend));
     memcached->Set(String::New("append"), FunctionTemplate::New(_memcached_append));
     memcached->Set(String::New("remove"), FunctionTemplate::New(_memcached_remove));
+    memcached->Set(String::New("mset"), FunctionTemplate::New(_memcached_mset));
+    memcached->Set(String::New("mdelete"), FunctionTemplate::New(_memcached_mdelete));
     memcached->Set(String::New("flush"), FunctionTemplate::New(_memcached_flush));
+    memcached->Set(String::New("flush_buffers"), FunctionTemplate::New(_memcached_flush_buffers));
     memcached->Set(String::New("keys"), FunctionTemplate::New(_memcached_keys));
 
     builtinObject->Set(String::New("memcached"), memcached);
@@ -5,17 +5,40 @@
 #include <mysql/mysql.h>
 #endif
 
+// The MariaDB client library provides a non-blocking API (mysql_*_start and
+// mysql_*_cont).  MYSQL_WAIT_READ is only defined when it is available.
+#ifdef MYSQL_WAIT_READ
+#define NONBLOCKING_MYSQL
+#endif
+
+enum {
+    ASYNC_IDLE,
+    ASYNC_QUERY,
+    ASYNC_STORE,
+    ASYNC_DONE
+};
+
 struct mstate {
     MYSQL *handle;
     char *currentDb;
     char *host;
     char *user;
     char *passwd;
+    bool multiStatements;
+    // non-blocking query in progress, see queryStart()
+    int asyncState;
+    int asyncError;
+    MYSQL_RES *asyncResult;
+    string asyncQuery;
 
     mstate(MYSQL *h, const char *d) {
         this->handle = h;
         this->currentDb = strdup(d);
         this->host = this->user = this->passwd = NULL;
+        this->multiStatements = false;
+        this->asyncState = ASYNC_IDLE;
+        this->asyncError = 0;
+        this->asyncResult = NULL;
     }
 
     ~mstate() {
@@ -56,20 +79,38 @@ static inline MYSQL* HANDLE (Handle<Value>v) {
         return NULL;
     }
     mstate *m = (mstate *) JSOPAQUE(v);
+    if (!m) {
+        ThrowException(String::New("Handle is closed"));
+        return NULL;
+    }
+    if (m->asyncState != ASYNC_IDLE) {
+        ThrowException(String::New("Non-blocking query in progress"));
+        return NULL;
+    }
     if (!mysql_ping(m->handle)) {
         return m->handle;
     }
-    // reconnect
+    // reconnect; on failure, keep the unconnected handle so the next call tries again
     mysql_close(m->handle);
     m->handle = mysql_init(NULL);
-    m->handle = mysql_real_connect(m->handle, m->host, m->user, m->passwd, m->currentDb, 3306, NULL, CLIENT_IGNORE_SIGPIPE | CLIENT_FOUND_ROWS);
-    if (!m->handle) {
+#ifdef NONBLOCKING_MYSQL
+    mysql_options(m->handle, MYSQL_OPT_NONBLOCK, 0);
+#endif
+    if (!mysql_real_connect(m->handle, m->host, m->user, m->passwd, m->currentDb, 3306, NULL, CLIENT_IGNORE_SIGPIPE | CLIENT_FOUND_ROWS | (m->multiStatements ? CLIENT_MULTI_STATEMENTS : 0))) {
         ThrowException(String::New("Could not reconnect to MySQL server"));
         return NULL;
     }
     return m->handle;
 }
 
+// HANDLE() for the native functions: returns from the caller, with the
+// exception pending, if there is no usable connection
+#define CHECKED_HANDLE(handle, v) \
+    MYSQL *handle = HANDLE(v); \
+    if (!handle) { \
+        return Handle<Value>(); \
+    }
+
 static inline void deleteHandle (Handle<Value>v) {
     if (v->IsNull()) {
         ThrowException(String::New("Handle is NULL"));
@@ -88,6 +129,20 @@ static inline void setCurrentDb (Handle<Value>v, const char *s) {
     m->setCurrentDb(s);
 }
 
+static void free_result_set (void *p) {
+    mysql_free_result((MYSQL_RES *) p);
+}
+
+// result sets not freed with mysql.free_result() are freed when their handle is garbage collected
+static OpaqueType resultType("mysql.result", free_result_set);
+
+static inline Handle<Value>resultHandle (MYSQL_RES *result) {
+    if (!result) {
+        return Null();
+    }
+    return Opaque::New(result, resultType);
+}
+
 static inline MYSQL_RES *RESULT_SET (Handle<Value> v) {
     if (v->IsNull()) {
         ThrowException(String::New("Handle is NULL"));
@@ -97,18 +152,18 @@ static inline MYSQL_RES *RESULT_SET (Handle<Value> v) {
 }
 
 static JSVAL affected_rows (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     return Integer::New(mysql_affected_rows(handle));
 }
 
 static JSVAL autocommit (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     bool flag = args[1]->BooleanValue();
     return Boolean::New(mysql_autocommit(handle, flag));
 }
 
 static JSVAL change_user (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     String::Utf8Value user(args[1]->ToString());
     String::Utf8Value password(args[2]->ToString());
     String::Utf8Value db(args[3]->ToString());
@@ -116,7 +171,7 @@ static JSVAL change_user (JSARGS args) {
 }
 
 static JSVAL character_set_name (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     return String::New(mysql_character_set_name(handle));
 }
 
@@ -128,7 +183,7 @@ static JSVAL character_set_name (JSARGS args) {
 //}
 
 static JSVAL commit (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     return Boolean::New(mysql_commit(handle));
 }
 
@@ -141,12 +196,12 @@ static JSVAL data_seek (JSARGS args) {
 #undef errno
 
 static JSVAL errno (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     return Integer::New(mysql_errno(handle));
 }
 
 static JSVAL error (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     const char *error = mysql_error(handle);
     return String::New(error);
 }
@@ -370,7 +425,7 @@ static JSVAL fetch_row (JSARGS args) {
 }
 
 static JSVAL field_count (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     return Integer::New(mysql_field_count(handle));
 }
 
@@ -387,12 +442,15 @@ static JSVAL field_tell (JSARGS args) {
 
 static JSVAL free_result (JSARGS args) {
     MYSQL_RES *result = RESULT_SET(args[0]);
-    mysql_free_result(result);
+    if (result) {
+        Opaque::Clear(args[0]);
+        mysql_free_result(result);
+    }
     return Undefined();
 }
 
 static JSVAL get_character_set_info (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     MY_CHARSET_INFO cs;
     mysql_get_character_set_info(handle, &cs);
     JSOBJ o = Object::New();
@@ -415,28 +473,28 @@ static JSVAL get_client_version (JSARGS args) {
 }
 
 static JSVAL get_host_info (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     return String::New(mysql_get_host_info(handle));
 }
 
 static JSVAL get_proto_info (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     return Integer::New(mysql_get_proto_info(handle));
 }
 
 static JSVAL get_server_info (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     const char *s = mysql_get_server_info(handle);
     return String::New(s);
 }
 
 static JSVAL get_server_version (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     return Integer::New(mysql_get_server_version(handle));
 }
 
 static JSVAL info (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     const char *info = mysql_info(handle);
     if (info) {
         return String::New(info);
@@ -447,28 +505,28 @@ static JSVAL info (JSARGS args) {
 }
 
 static JSVAL insert_id (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     return Integer::New(mysql_insert_id(handle));
 }
 
 static JSVAL kill (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
 
     return Integer::New(mysql_kill(handle, args[1]->IntegerValue()));
 }
 
 static JSVAL list_dbs (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     const char *wild = NULL;
     if (args.Length() > 1) {
         String::Utf8Value pat(args[1]->ToString());
         wild = *pat;
     }
-    return Integer::New((unsigned long) mysql_list_dbs(handle, wild));
+    return resultHandle(mysql_list_dbs(handle, wild));
 }
 
 static JSVAL list_fields (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     const char *table = NULL;
     const char *wild = NULL;
     if (args.Length() > 1) {
@@ -479,38 +537,37 @@ static JSVAL list_fields (JSARGS args) {
         String::Utf8Value pat(args[1]->ToString());
         wild = *pat;
     }
-    return Integer::New((unsigned long) mysql_list_fields(handle, table, wild));
+    return resultHandle(mysql_list_fields(handle, table, wild));
 }
 
 static JSVAL list_processes (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
-    return Integer::New((unsigned long) mysql_list_processes(handle));
+    CHECKED_HANDLE(handle, args[0]);
+    return resultHandle(mysql_list_processes(handle));
 }
 
 static JSVAL list_tables (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     const char *wild = NULL;
     if (args.Length() > 1) {
         String::Utf8Value pat(args[1]->ToString());
         wild = *pat;
     }
-    return Integer::New((unsigned long) mysql_list_tables(handle, wild));
+    return resultHandle(mysql_list_tables(handle, wild));
 }
 
 static JSVAL query (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     String::Utf8Value sql(args[1]->ToString());
     return Integer::New((unsigned long) mysql_query(handle, *sql));
 }
 
 static JSVAL store_result (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
-    MYSQL_RES *result = mysql_store_result(handle);
-    return Integer::New((unsigned long) result);
+    CHECKED_HANDLE(handle, args[0]);
+    return resultHandle(mysql_store_result(handle));
 }
 
 static JSVAL init (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
 #ifdef EMBEDDED_MYSQL
     if (handle) {
         mysql_options(handle, MYSQL_READ_DEFAULT_GROUP, "libmysqld_client");
@@ -521,7 +578,7 @@ static JSVAL init (JSARGS args) {
 }
 
 static JSVAL real_connect (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     String::Utf8Value host(args[1]->ToString());
     String::Utf8Value user(args[2]->ToString());
     String::Utf8Value password(args[3]->ToString());
@@ -541,7 +598,7 @@ static JSVAL real_connect (JSARGS args) {
 //}
 
 static JSVAL getDataRowsJson (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     String::Utf8Value sql(args[1]);
     mysql_ping(handle);
     //  printf("%d %s\n", mysql_ping(handle), mysql_error(handle));
@@ -624,18 +681,9 @@ static JSVAL getDataRowsJson (JSARGS args) {
     return String::New(json.c_str(), json.size());
 }
 
-JSVAL getDataRows (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
-    String::Utf8Value sql(args[1]->ToString());
-    mysql_ping(handle);
-    int failure = mysql_query(handle, *sql);
-    if (failure) {
-        return ThrowException(String::New(mysql_error(handle)));
-    }
-    MYSQL_RES *result = mysql_use_result(handle);
-    if (!result) {
-        return False();
-    }
+// Convert a result set to an array of row objects, with numeric columns
+// converted to JavaScript numbers.
+static JSARRAY ResultRows (MYSQL_RES *result) {
     unsigned int num_fields = mysql_num_fields(result);
     MYSQL_FIELD *fields = mysql_fetch_fields(result);
 
@@ -681,12 +729,28 @@ JSVAL getDataRows (JSARGS args) {
         }
         a->Set(rowNdx++, o);
     }
+    return a;
+}
+
+JSVAL getDataRows (JSARGS args) {
+    CHECKED_HANDLE(handle, args[0]);
+    String::Utf8Value sql(args[1]->ToString());
+    mysql_ping(handle);
+    int failure = mysql_query(handle, *sql);
+    if (failure) {
+        return ThrowException(String::New(mysql_error(handle)));
+    }
+    MYSQL_RES *result = mysql_use_result(handle);
+    if (!result) {
+        return False();
+    }
+    Handle<Array>a = ResultRows(result);
     mysql_free_result(result);
     return a;
 }
 
 JSVAL getDataRow (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     String::Utf8Value sql(args[1]->ToString());
     mysql_ping(handle);
     int failure = mysql_query(handle, *sql);
@@ -739,7 +803,7 @@ JSVAL getDataRow (JSARGS args) {
 }
 
 JSVAL getScalar (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     String::Utf8Value sql(args[1]->ToString());
 
     int failure = mysql_query(handle, *sql);
@@ -795,7 +859,7 @@ JSVAL getScalar (JSARGS args) {
 }
 
 JSVAL update (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     String::Utf8Value query(args[1]->ToString());
     int failure = mysql_query(handle, *query);
     if (failure) {
@@ -804,6 +868,249 @@ JSVAL update (JSARGS args) {
     return Integer::New(mysql_affected_rows(handle));
 }
 
+/**
+ * batch(handle, queries)
+ *
+ * Send an array of SQL statements to the server in a single round trip and
+ * return an array with one entry per statement: an array of rows for
+ * statements that return a result set, or the affected row count for those
+ * that don't.
+ *
+ * If the connection was not opened with multi statements enabled, they are
+ * enabled for the duration of the batch only, which takes a round trip to
+ * turn them on and another to turn them off again.
+ */
+JSVAL batch (JSARGS args) {
+    CHECKED_HANDLE(handle, args[0]);
+    mstate *m = (mstate *) JSOPAQUE(args[0]);
+    Handle<Array>queries = Handle<Array>::Cast(args[1]);
+    unsigned int count = queries->Length();
+    Handle<Array>results = Array::New(count);
+    if (!count) {
+        return results;
+    }
+    string sql;
+    for (unsigned int i = 0; i < count; i++) {
+        String::Utf8Value query(queries->Get(i)->ToString());
+        if (i) {
+            sql += ";\n";
+        }
+        sql.append(*query, query.length());
+    }
+    if (!m->multiStatements && mysql_set_server_option(handle, MYSQL_OPTION_MULTI_STATEMENTS_ON)) {
+        return ThrowException(Exception::Error(String::New(mysql_error(handle))));
+    }
+    string error;
+    unsigned int ndx = 0;
+    int status = mysql_real_query(handle, sql.c_str(), sql.size());
+    if (status) {
+        error = mysql_error(handle);
+    }
+    while (!status) {
+        MYSQL_RES *result = mysql_store_result(handle);
+        if (result) {
+            results->Set(ndx, ResultRows(result));
+            mysql_free_result(result);
+        }
+        else if (mysql_field_count(handle) == 0) {
+            results->Set(ndx, Number::New(mysql_affected_rows(handle)));
+        }
+        else {
+            error = mysql_error(handle);
+            // discard remaining results so the connection stays usable
+            while (!mysql_next_result(handle)) {
+                result = mysql_store_result(handle);
+                if (result) {
+                    mysql_free_result(result);
+                }
+            }
+            break;
+        }
+        ndx++;
+        status = mysql_next_result(handle);
+        if (status > 0) {
+            error = mysql_error(handle);
+        }
+    }
+    if (!m->multiStatements) {
+        mysql_set_server_option(handle, MYSQL_OPTION_MULTI_STATEMENTS_OFF);
+    }
+    if (error.size()) {
+        char msg[32];
+        snprintf(msg, sizeof(msg), "batch statement %u: ", ndx);
+        return ThrowException(Exception::Error(String::Concat(String::New(msg), String::New(error.c_str()))));
+    }
+    return results;
+}
+
+#ifdef NONBLOCKING_MYSQL
+// Advance a non-blocking query once the current step has completed
+// (status 0): the query itself is followed by fetching its result set.
+static int asyncStep (mstate *m, int status) {
+    while (!status) {
+        switch (m->asyncState) {
+            case ASYNC_QUERY:
+                if (m->asyncError) {
+                    m->asyncState = ASYNC_DONE;
+                    return 0;
+                }
+                m->asyncState = ASYNC_STORE;
+                status = mysql_store_result_start(&m->asyncResult, m->handle);
+                break;
+            case ASYNC_STORE:
+                m->asyncState = ASYNC_DONE;
+                return 0;
+            default:
+                return 0;
+        }
+    }
+    return status;
+}
+#endif
+
+/**
+ * queryStart(handle, sql)
+ *
+ * Start a query without blocking.  Returns 0 if the query (and fetching of
+ * its result set) has already completed, otherwise a bitmask of WAIT_READ,
+ * WAIT_WRITE, WAIT_EXCEPT and WAIT_TIMEOUT describing what to wait for on the
+ * connection's socket (see socket()) before calling queryContinue().
+ *
+ * Once completed, queryResult() returns the result.  The connection can't be
+ * used for anything else until then.
+ */
+JSVAL queryStart (JSARGS args) {
+#ifdef NONBLOCKING_MYSQL
+    mstate *m = (mstate *) JSOPAQUE(args[0]);
+    if (m->asyncState != ASYNC_IDLE) {
+        return ThrowException(Exception::Error(String::New("Non-blocking query in progress")));
+    }
+    String::Utf8Value sql(args[1]->ToString());
+    // the query text must outlive the calls to queryContinue()
+    m->asyncQuery.assign(*sql, sql.length());
+    m->asyncError = 0;
+    m->asyncResult = NULL;
+    m->asyncState = ASYNC_QUERY;
+    int status = mysql_real_query_start(&m->asyncError, m->handle, m->asyncQuery.c_str(), m->asyncQuery.size());
+    return Integer::New(asyncStep(m, status));
+#else
+    return ThrowException(Exception::Error(String::New("Non-blocking queries are not supported by this MySQL client library")));
+#endif
+}
+
+/**
+ * queryContinue(handle, ready)
+ *
+ * Continue a query started by queryStart() once the socket is ready.  ready
+ * is a bitmask of the WAIT_* conditions that occurred.  Returns 0 once the
+ * query has completed, otherwise what to wait for next.
+ */
+JSVAL queryContinue (JSARGS args) {
+#ifdef NONBLOCKING_MYSQL
+    mstate *m = (mstate *) JSOPAQUE(args[0]);
+    int ready = args[1]->IntegerValue();
+    int status;
+    switch (m->asyncState) {
+        case ASYNC_QUERY:
+            status = mysql_real_query_cont(&m->asyncError, m->handle, ready);
+            break;
+        case ASYNC_STORE:
+            status = mysql_store_result_cont(&m->asyncResult, m->handle, ready);
+            break;
+        case ASYNC_DONE:
+            return Integer::New(0);
+        default:
+            return ThrowException(Exception::Error(String::New("No non-blocking query in progress")));
+    }
+    return Integer::New(asyncStep(m, status));
+#else
+    return ThrowException(Exception::Error(String::New("Non-blocking queries are not supported by this MySQL client library")));
+#endif
+}
+
+/**
+ * queryResult(handle)
+ *
+ * Get the result of a completed non-blocking query: an array of rows if the
+ * query returned a result set, otherwise the number of affected rows.
+ * Throws if the query failed.
+ */
+JSVAL queryResult (JSARGS args) {
+    mstate *m = (mstate *) JSOPAQUE(args[0]);
+    if (m->asyncState != ASYNC_DONE) {
+        return ThrowException(Exception::Error(String::New("Non-blocking query has not completed")));
+    }
+    m->asyncState = ASYNC_IDLE;
+    m->asyncQuery.clear();
+    if (m->asyncError) {
+        return ThrowException(Exception::Error(String::New(mysql_error(m->handle))));
+    }
+    if (m->asyncResult) {
+        Handle<Array>a = ResultRows(m->asyncResult);
+        mysql_free_result(m->asyncResult);
+        m->asyncResult = NULL;
+        return a;
+    }
+    if (mysql_field_count(m->handle)) {
+        return ThrowException(Exception::Error(String::New(mysql_error(m->handle))));
+    }
+    return Number::New(mysql_affected_rows(m->handle));
+}
+
+/**
+ * queryTimeout(handle)
+ *
+ * Milliseconds to wait before calling queryContinue() with WAIT_TIMEOUT,
+ * when queryStart() or queryContinue() returned a status including it.
+ */
+JSVAL queryTimeout (JSARGS args) {
+#ifdef NONBLOCKING_MYSQL
+    mstate *m = (mstate *) JSOPAQUE(args[0]);
+    return Integer::New(mysql_get_timeout_value_ms(m->handle));
+#else
+    return ThrowException(Exception::Error(String::New("Non-blocking queries are not supported by this MySQL client library")));
+#endif
+}
+
+/**
+ * queryAbort(handle)
+ *
+ * Abandon a non-blocking query, e.g. when another query of a batch failed
+ * to start.  A query that has completed has its result discarded; one
+ * still in progress leaves the connection in an unknown state, so it is
+ * closed, and reconnected the next time the handle is used.
+ */
+JSVAL queryAbort (JSARGS args) {
+#ifdef NONBLOCKING_MYSQL
+    mstate *m = (mstate *) JSOPAQUE(args[0]);
+    if (m->asyncResult) {
+        mysql_free_result(m->asyncResult);
+        m->asyncResult = NULL;
+    }
+    if (m->asyncState == ASYNC_QUERY || m->asyncState == ASYNC_STORE) {
+        mysql_close(m->handle);
+        m->handle = mysql_init(NULL);
+    }
+    m->asyncState = ASYNC_IDLE;
+    m->asyncQuery.clear();
+#endif
+    return Undefined();
+}
+
+/**
+ * socket(handle)
+ *
+ * Get the file descriptor of the connection, for use with builtin/async.
+ */
+JSVAL socket (JSARGS args) {
+#ifdef NONBLOCKING_MYSQL
+    mstate *m = (mstate *) JSOPAQUE(args[0]);
+    return Integer::New(mysql_get_socket(m->handle));
+#else
+    return ThrowException(Exception::Error(String::New("Non-blocking queries are not supported by this MySQL client library")));
+#endif
+}
+
 JSVAL connect (JSARGS args) {
     String::AsciiValue host(args[0]->ToString());
     String::AsciiValue user(args[1]->ToString());
@@ -811,15 +1118,19 @@ JSVAL connect (JSARGS args) {
     String::AsciiValue db(args[3]->ToString());
 
     int port = 3306;
-    if (args.Length() > 4) {
+    if (args.Length() > 4 && !args[4]->IsUndefined()) {
         port = args[4]->IntegerValue();
     }
+    bool multiStatements = args.Length() > 5 && args[5]->BooleanValue();
     MYSQL *handle = mysql_init(NULL);
     my_bool reconnect = 1;
     mysql_options(handle, MYSQL_OPT_RECONNECT, &reconnect);
+#ifdef NONBLOCKING_MYSQL
+    mysql_options(handle, MYSQL_OPT_NONBLOCK, 0);
+#endif
 
     //      handle = mysql_real_connect(handle, "localhost", "mschwartz", "", "sim", 3306, NULL, 0);
-    if (!mysql_real_connect(handle, *host, *user, *passwd, *db, port, NULL, CLIENT_IGNORE_SIGPIPE | CLIENT_FOUND_ROWS)) {
+    if (!mysql_real_connect(handle, *host, *user, *passwd, *db, port, NULL, CLIENT_IGNORE_SIGPIPE | CLIENT_FOUND_ROWS | (multiStatements ? CLIENT_MULTI_STATEMENTS : 0))) {
         return ThrowException(Exception::Error(String::Concat(String::New("MySQL connection failed: "), String::New(mysql_error(handle)))));
     }
     mysql_options(handle, MYSQL_OPT_RECONNECT, &reconnect);
@@ -828,11 +1139,12 @@ JSVAL connect (JSARGS args) {
     m->host = strdup(*host);
     m->user = strdup(*user);
     m->passwd = strdup(*passwd);
+    m->multiStatements = multiStatements;
     return Opaque::New(m);
 }
 
 JSVAL select_db (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     String::AsciiValue db(args[1]->ToString());
     if (strcmp(*db, currentDb(args[0]))) {
         if (mysql_select_db(handle, *db)) {
@@ -844,7 +1156,7 @@ JSVAL select_db (JSARGS args) {
 }
 
 JSVAL close (JSARGS args) {
-    MYSQL *handle = HANDLE(args[0]);
+    CHECKED_HANDLE(handle, args[0]);
     mysql_close(handle);
     deleteHandle(args[0]);
     return Undefined();
@@ -859,6 +1171,19 @@ void init_mysql_object () {
     o->Set(String::New("getDataRow"), FunctionTemplate::New(getDataRow));
     o->Set(String::New("getScalar"), FunctionTemplate::New(getScalar));
     o->Set(String::New("update"), FunctionTemplate::New(update));
+    o->Set(String::New("batch"), FunctionTemplate::New(batch));
+    o->Set(String::New("queryStart"), FunctionTemplate::New(queryStart));
+    o->Set(String::New("queryContinue"), FunctionTemplate::New(queryContinue));
+    o->Set(String::New("queryResult"), FunctionTemplate::New(queryResult));
+    o->Set(String::New("queryTimeout"), FunctionTemplate::New(queryTimeout));
+    o->Set(String::New("queryAbort"), FunctionTemplate::New(queryAbort));
+    o->Set(String::New("socket"), FunctionTemplate::New(socket));
+#ifdef NONBLOCKING_MYSQL
+    o->Set(String::New("WAIT_READ"), Integer::New(MYSQL_WAIT_READ));
+    o->Set(String::New("WAIT_WRITE"), Integer::New(MYSQL_WAIT_WRITE));
+    o->Set(String::New("WAIT_EXCEPT"), Integer::New(MYSQL_WAIT_EXCEPT));
+    o->Set(String::New("WAIT_TIMEOUT"), Integer::New(MYSQL_WAIT_TIMEOUT));
+#endif
 
     o->Set(String::New("affected_rows"), FunctionTemplate::New(affected_rows));
     o->Set(String::New("autocommit"), FunctionTemplate::New(autocommit));
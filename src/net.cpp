@@ -21,6 +21,9 @@
 #define TCP_CORK TCP_NODELAY
 #endif
 
+// largest net.read()
+#define NET_MAX_READ (64 * 1024 * 1024)
+
 //#undef USE_CORK
 
 // net.nonblock(sock)
@@ -306,15 +309,18 @@ static JSVAL net_close (JSARGS args) {
  * If no data can be read for 5 seconds, the function returns null.
  * 
  * @param {int} sock - socket file descriptor to read from.
- * @param {int} length - maximum length of string to read.
+ * @param {int} length - maximum length of string to read, 1 to 64MB.
  * @return {string} s - string that was read from the socket, or null if the string could not be read.
  * 
  * ### Exceptions
- * This function throws an exception if there is a read error with the error message.
+ * This function throws an exception if there is a read error with the error message, or if length is out of range.
  */
 static JSVAL net_read (JSARGS args) {
     int fd = args[0]->IntegerValue();
     long size = args[1]->IntegerValue();
+    if (size <= 0 || size > NET_MAX_READ) {
+        return ThrowException(String::New("Read Error: bad length"));
+    }
 
     fd_set fds;
     FD_ZERO(&fds);
@@ -331,7 +337,11 @@ static JSVAL net_read (JSARGS args) {
             return Null();
     }
 
-    char buf[size];
+    Arena::Scope arena;
+    char *buf = (char *) Arena::Alloc(size);
+    if (!buf) {
+        return ThrowException(String::New("Read Error: out of memory"));
+    }
     long count = read(fd, buf, size);
     if (count < 0) {
         return ThrowException(String::Concat(String::New("Read Error: "), String::New(strerror(errno))));
@@ -362,10 +372,13 @@ static JSVAL net_read (JSARGS args) {
  */
 static JSVAL net_write (JSARGS args) {
     int fd = args[0]->IntegerValue();
-    String::Utf8Value buf(args[1]);
+    Arena::Scope arena;
+    char *s = Arena::Utf8(args[1]);
+    if (!s) {
+        return ThrowException(String::New("Write Error: out of memory"));
+    }
     long size = args[2]->IntegerValue();
     long written = 0;
-    char *s = *buf;
     while (size > 0) {
         long count = write(fd, s, size);
         if (count <= 0) {
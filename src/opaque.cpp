@@ -0,0 +1,118 @@
+/** @ignore */
+#include "SilkJS.h"
+
+OpaqueType *OpaqueType::first = NULL;
+
+// handles without a type share this one
+static OpaqueType opaqueType("opaque");
+
+// internal fields: 0 is the pointer, 1 the external memory accounted for the
+// handle (undefined if it isn't owned, or has been freed), 2 the OpaqueType
+enum { FIELD_POINTER, FIELD_SIZE, FIELD_TYPE, FIELD_COUNT };
+
+static void release (Handle<Object>o) {
+    Local<Value>size = o->GetInternalField(FIELD_SIZE);
+    if (size->IsUndefined()) {
+        return;
+    }
+    OpaqueType *type = (OpaqueType *) o->GetPointerFromInternalField(FIELD_TYPE);
+    long bytes = (long) size->NumberValue();
+    type->live--;
+    type->bytes -= bytes;
+    if (bytes) {
+        V8::AdjustAmountOfExternalAllocatedMemory(-bytes);
+    }
+    o->SetInternalField(FIELD_SIZE, Undefined());
+}
+
+static void weakCallback (Persistent<Value>object, void *parameter) {
+    OpaqueType *type = (OpaqueType *) parameter;
+    HandleScope scope;
+    Local<Object>o = object->ToObject();
+    void *p = o->GetPointerFromInternalField(FIELD_POINTER);
+    if (p) {
+        release(o);
+        if (type->finalize) {
+            type->finalize(p);
+        }
+    }
+    object.Dispose();
+    object.Clear();
+}
+
+Handle<Object>Opaque::New (void *p) {
+    return New(p, opaqueType, false);
+}
+
+/**
+ * Wrap p in a handle of the given type.  If owned is false, the resource
+ * belongs to something else (e.g. cairo.context_get_target()) and is neither
+ * counted nor finalized through this handle.  size is the memory the
+ * resource holds outside the V8 heap, if it is worth telling V8 about.
+ */
+Handle<Object>Opaque::New (void *p, OpaqueType &type, bool owned, long size) {
+    if (type.tmpl.IsEmpty()) {
+        Handle<ObjectTemplate>t = ObjectTemplate::New();
+        t->SetInternalFieldCount(FIELD_COUNT);
+        type.tmpl = Persistent<ObjectTemplate>::New(t);
+    }
+    Local<Object>o = type.tmpl->NewInstance();
+    o->SetPointerInInternalField(FIELD_POINTER, p);
+    o->SetPointerInInternalField(FIELD_TYPE, &type);
+    if (owned && p) {
+        type.live++;
+        type.created++;
+        type.bytes += size;
+        if (size) {
+            V8::AdjustAmountOfExternalAllocatedMemory(size);
+        }
+        o->SetInternalField(FIELD_SIZE, Number::New(size));
+        Persistent<Object>weak = Persistent<Object>::New(o);
+        weak.MakeWeak(&type, weakCallback);
+        weak.MarkIndependent();
+    }
+    return o;
+}
+
+/**
+ * Change the external memory accounted for an owned handle, for resources
+ * that grow, like buffers.
+ */
+void Opaque::Resize (Handle<Value>v, long size) {
+    Local<Object>o = v->ToObject();
+    Local<Value>old = o->GetInternalField(FIELD_SIZE);
+    if (old->IsUndefined()) {
+        return;
+    }
+    long delta = size - (long) old->NumberValue();
+    if (delta) {
+        OpaqueType *type = (OpaqueType *) o->GetPointerFromInternalField(FIELD_TYPE);
+        type->bytes += delta;
+        V8::AdjustAmountOfExternalAllocatedMemory(delta);
+        o->SetInternalField(FIELD_SIZE, Number::New(size));
+    }
+}
+
+/**
+ * Called by destroy functions, so the finalizer doesn't free the resource
+ * again, and later use of the handle finds NULL rather than freed memory.
+ */
+void Opaque::Clear (Handle<Value>v) {
+    Local<Object>o = v->ToObject();
+    release(o);
+    o->SetPointerInInternalField(FIELD_POINTER, NULL);
+}
+
+/**
+ * The type of an opaque handle, or NULL if v isn't one.
+ */
+OpaqueType *Opaque::TypeOf (Handle<Value>v) {
+    if (!v->IsObject()) {
+        return NULL;
+    }
+    Local<Object>o = v->ToObject();
+    if (o->InternalFieldCount() != FIELD_COUNT) {
+        return NULL;
+    }
+    return (OpaqueType *) o->GetPointerFromInternalField(FIELD_TYPE);
+}
@@ -0,0 +1,398 @@
+/**
+ * Compact binary serialization of JavaScript values, and compression
+ * of the serialized (or any other) bytes.
+ *
+ * The encoding is MessagePack: nil, booleans, integers, doubles, UTF-8
+ * strings, arrays and maps with string keys.  Dates are stored as a
+ * fixext 8 of type 1 holding the time in milliseconds as a double.  As
+ * with JSON, functions and undefined members of objects are skipped and
+ * become null in arrays.
+ *
+ * This is used by the native caches (memcached, shared memory) to avoid
+ * JSON encoding/decoding of cached values, and is not exposed to
+ * JavaScript directly.
+ */
+#include "SilkJS.h"
+#include <zlib.h>
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#define PACK_MAX_DEPTH 64
+// largest value PackDecompress will inflate, whatever its header says
+#define PACK_MAX_SIZE (256 * 1024 * 1024)
+// largest possible expansion: zlib's deflate is about 1032:1, LZ4's 255:1
+#define ZLIB_MAX_RATIO 1032
+#define LZ4_MAX_RATIO 255
+
+static inline void put8 (string &out, unsigned char c) {
+    out += (char) c;
+}
+
+static inline void put16 (string &out, uint16_t v) {
+    put8(out, v >> 8);
+    put8(out, v);
+}
+
+static inline void put32 (string &out, uint32_t v) {
+    put8(out, v >> 24);
+    put8(out, v >> 16);
+    put8(out, v >> 8);
+    put8(out, v);
+}
+
+static inline void putDouble (string &out, double d) {
+    uint64_t v;
+    memcpy(&v, &d, 8);
+    put32(out, (uint32_t) (v >> 32));
+    put32(out, (uint32_t) v);
+}
+
+static void packLength (string &out, uint32_t len, unsigned char fix, uint32_t fixMax, unsigned char c16) {
+    if (len <= fixMax) {
+        put8(out, fix | len);
+    }
+    else if (len < 0x10000) {
+        put8(out, c16);
+        put16(out, len);
+    }
+    else {
+        put8(out, c16 + 1);
+        put32(out, len);
+    }
+}
+
+static void packString (string &out, Handle<Value>v) {
+    String::Utf8Value s(v);
+    uint32_t len = s.length();
+    if (len < 32) {
+        put8(out, 0xa0 | len);
+    }
+    else if (len < 0x100) {
+        put8(out, 0xd9);
+        put8(out, len);
+    }
+    else if (len < 0x10000) {
+        put8(out, 0xda);
+        put16(out, len);
+    }
+    else {
+        put8(out, 0xdb);
+        put32(out, len);
+    }
+    out.append(*s, len);
+}
+
+static bool packValue (string &out, Handle<Value>v, int depth) {
+    if (depth > PACK_MAX_DEPTH) {
+        ThrowException(String::New("pack: value is nested too deeply (circular?)"));
+        return false;
+    }
+    if (v->IsNull() || v->IsUndefined() || v->IsFunction()) {
+        put8(out, 0xc0);
+    }
+    else if (v->IsBoolean()) {
+        put8(out, v->IsTrue() ? 0xc3 : 0xc2);
+    }
+    else if (v->IsInt32()) {
+        int32_t i = v->Int32Value();
+        if (i >= 0 && i < 128) {
+            put8(out, i);
+        }
+        else if (i < 0 && i >= -32) {
+            put8(out, (unsigned char) i);
+        }
+        else {
+            put8(out, 0xd2);
+            put32(out, (uint32_t) i);
+        }
+    }
+    else if (v->IsNumber()) {
+        put8(out, 0xcb);
+        putDouble(out, v->NumberValue());
+    }
+    else if (v->IsString()) {
+        packString(out, v);
+    }
+    else if (v->IsDate()) {
+        put8(out, 0xd7);
+        put8(out, 1);
+        putDouble(out, v->NumberValue());
+    }
+    else if (v->IsArray()) {
+        HandleScope scope;
+        Handle<Array>a = Handle<Array>::Cast(v);
+        uint32_t len = a->Length();
+        packLength(out, len, 0x90, 15, 0xdc);
+        for (uint32_t i = 0; i < len; i++) {
+            if (!packValue(out, a->Get(i), depth + 1)) {
+                return false;
+            }
+        }
+    }
+    else if (v->IsObject()) {
+        HandleScope scope;
+        JSOBJ o = v->ToObject();
+        Handle<Array>keys = o->GetOwnPropertyNames();
+        uint32_t numKeys = keys->Length(),
+            count = 0;
+        // the count is patched in once the skipped members are known
+        size_t header = out.size();
+        put8(out, 0xdf);
+        put32(out, 0);
+        for (uint32_t i = 0; i < numKeys; i++) {
+            Handle<Value>key = keys->Get(i);
+            Handle<Value>value = o->Get(key);
+            if (value->IsUndefined() || value->IsFunction()) {
+                continue;
+            }
+            packString(out, key);
+            if (!packValue(out, value, depth + 1)) {
+                return false;
+            }
+            count++;
+        }
+        if (count < 16) {
+            // shrink the map32 header to a fixmap
+            out.erase(header + 1, 4);
+            out[header] = (char) (0x80 | count);
+        }
+        else {
+            out[header + 1] = (char) (count >> 24);
+            out[header + 2] = (char) (count >> 16);
+            out[header + 3] = (char) (count >> 8);
+            out[header + 4] = (char) count;
+        }
+    }
+    else {
+        put8(out, 0xc0);
+    }
+    return true;
+}
+
+/**
+ * Append the encoding of v to out.  Returns false, with a JavaScript
+ * exception pending, if v can't be encoded.
+ */
+bool PackValue (string &out, Handle<Value>v) {
+    return packValue(out, v, 0);
+}
+
+class Unpacker {
+    const unsigned char *p;
+    const unsigned char *end;
+public:
+    Unpacker (const unsigned char *data, size_t len) : p(data), end(data + len) {}
+    bool need (size_t n) {
+        if ((size_t) (end - p) < n) {
+            ThrowException(String::New("unpack: truncated value"));
+            return false;
+        }
+        return true;
+    }
+    uint32_t get (int n) {
+        uint32_t v = 0;
+        while (n--) {
+            v = (v << 8) | *p++;
+        }
+        return v;
+    }
+    double getDouble () {
+        uint64_t v = (uint64_t) get(4) << 32;
+        v |= get(4);
+        double d;
+        memcpy(&d, &v, 8);
+        return d;
+    }
+    Handle<Value>str (uint32_t len) {
+        if (!need(len)) {
+            return Handle<Value>();
+        }
+        Handle<String>s = String::New((const char *) p, len);
+        p += len;
+        return s;
+    }
+    // each element takes at least one byte, so a count larger than the
+    // bytes left is corrupt, and mustn't be used to size anything
+    Handle<Value>array (uint32_t len, int depth) {
+        if (!need(len)) {
+            return Handle<Value>();
+        }
+        Handle<Array>a = Array::New(len);
+        for (uint32_t i = 0; i < len; i++) {
+            Handle<Value>v = value(depth + 1);
+            if (v.IsEmpty()) {
+                return v;
+            }
+            a->Set(i, v);
+        }
+        return a;
+    }
+    Handle<Value>map (uint32_t len, int depth) {
+        if (!need((size_t) len * 2)) {
+            return Handle<Value>();
+        }
+        JSOBJ o = Object::New();
+        for (uint32_t i = 0; i < len; i++) {
+            Handle<Value>k = value(depth + 1);
+            if (k.IsEmpty()) {
+                return k;
+            }
+            Handle<Value>v = value(depth + 1);
+            if (v.IsEmpty()) {
+                return v;
+            }
+            o->Set(k, v);
+        }
+        return o;
+    }
+    Handle<Value>value (int depth) {
+        if (depth > PACK_MAX_DEPTH) {
+            ThrowException(String::New("unpack: value is nested too deeply"));
+            return Handle<Value>();
+        }
+        if (!need(1)) {
+            return Handle<Value>();
+        }
+        unsigned char c = *p++;
+        if (c < 0x80) {
+            return Integer::New(c);
+        }
+        if (c >= 0xe0) {
+            return Integer::New((signed char) c);
+        }
+        if ((c & 0xe0) == 0xa0) {
+            return str(c & 0x1f);
+        }
+        if ((c & 0xf0) == 0x90) {
+            return array(c & 0x0f, depth);
+        }
+        if ((c & 0xf0) == 0x80) {
+            return map(c & 0x0f, depth);
+        }
+        switch (c) {
+            case 0xc0:
+                return Null();
+            case 0xc2:
+                return False();
+            case 0xc3:
+                return True();
+            case 0xcb:
+                if (!need(8)) {
+                    return Handle<Value>();
+                }
+                return Number::New(getDouble());
+            case 0xd2:
+                if (!need(4)) {
+                    return Handle<Value>();
+                }
+                return Integer::New((int32_t) get(4));
+            case 0xd7:
+                if (!need(9)) {
+                    return Handle<Value>();
+                }
+                p++;
+                return Date::New(getDouble());
+            case 0xd9:
+            case 0xda:
+            case 0xdb: {
+                int n = 1 << (c - 0xd9);
+                if (!need(n)) {
+                    return Handle<Value>();
+                }
+                return str(get(n));
+            }
+            case 0xdc:
+            case 0xdd: {
+                int n = c == 0xdc ? 2 : 4;
+                if (!need(n)) {
+                    return Handle<Value>();
+                }
+                return array(get(n), depth);
+            }
+            case 0xde:
+            case 0xdf: {
+                int n = c == 0xde ? 2 : 4;
+                if (!need(n)) {
+                    return Handle<Value>();
+                }
+                return map(get(n), depth);
+            }
+        }
+        ThrowException(String::New("unpack: invalid type byte"));
+        return Handle<Value>();
+    }
+};
+
+/**
+ * Decode a value encoded by PackValue.  Returns an empty handle, with a
+ * JavaScript exception pending, if the data is invalid.
+ */
+Handle<Value>UnpackValue (const unsigned char *data, size_t len) {
+    Unpacker u(data, len);
+    return u.value(0);
+}
+
+/**
+ * Compress len bytes of data with the given method (PACK_ZLIB or
+ * PACK_LZ4) into out.  The output is prefixed with the uncompressed
+ * length, so it can be decompressed in one step.  LZ4 falls back to zlib
+ * if SilkJS was built without it.
+ *
+ * Returns the method used, or 0 if the data could not be compressed.
+ */
+int PackCompress (string &out, const char *data, size_t len, int method) {
+#ifndef HAVE_LZ4
+    method = PACK_ZLIB;
+#endif
+    out.clear();
+    put32(out, len);
+#ifdef HAVE_LZ4
+    if (method == PACK_LZ4) {
+        int bound = LZ4_compressBound(len);
+        out.resize(4 + bound);
+        int n = LZ4_compress_default(data, &out[4], len, bound);
+        if (n <= 0) {
+            return 0;
+        }
+        out.resize(4 + n);
+        return PACK_LZ4;
+    }
+#endif
+    uLongf n = compressBound(len);
+    out.resize(4 + n);
+    if (compress2((Bytef *) &out[4], &n, (const Bytef *) data, len, Z_BEST_SPEED) != Z_OK) {
+        return 0;
+    }
+    out.resize(4 + n);
+    return PACK_ZLIB;
+}
+
+/**
+ * Decompress data produced by PackCompress.  Returns false if the data
+ * is corrupt or the method is not supported.
+ */
+bool PackDecompress (string &out, const char *data, size_t len, int method) {
+    if (len < 4) {
+        return false;
+    }
+    const unsigned char *p = (const unsigned char *) data;
+    uint32_t size = ((uint32_t) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    size_t ratio = method == PACK_LZ4 ? LZ4_MAX_RATIO : ZLIB_MAX_RATIO;
+    if (size > PACK_MAX_SIZE || size > (len - 4) * ratio + 64) {
+        return false;
+    }
+    out.resize(size);
+    if (size == 0) {
+        return true;
+    }
+    if (method == PACK_LZ4) {
+#ifdef HAVE_LZ4
+        return LZ4_decompress_safe(data + 4, &out[0], len - 4, size) == (int) size;
+#else
+        return false;
+#endif
+    }
+    uLongf n = size;
+    return uncompress((Bytef *) &out[0], &n, (const Bytef *) data + 4, len - 4) == Z_OK && n == size;
+}
@@ -1,13 +1,23 @@
 /** @ignore */
 #include "SilkJS.h"
 #include <semaphore.h>
+#include <sys/mman.h>
 
-static sem_t mutex;
+// in shared memory, so the semaphore is shared with the processes forked after sem.init()
+static sem_t *mutex = NULL;
 
 static JSVAL sem_Init (JSARGS args) {
     HandleScope scope;
     int ret;
-    if ((ret = sem_init(&mutex, 1, 1)) < 0) {
+    if (!mutex) {
+        void *p = mmap(NULL, sizeof (sem_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            perror("mmap");
+            return False();
+        }
+        mutex = (sem_t *) p;
+    }
+    if ((ret = sem_init(mutex, 1, 1)) < 0) {
         perror("sem_init");
         return False();
     }
@@ -15,17 +25,15 @@ static JSVAL sem_Init (JSARGS args) {
 }
 
 static JSVAL sem_Destroy (JSARGS args) {
-    return Integer::New(sem_destroy(&mutex));
+    return Integer::New(sem_destroy(mutex));
 }
 
 static JSVAL sem_Wait (JSARGS args) {
-    int ret = sem_wait(&mutex);
-    printf("wait %d\n", ret);
-    return Integer::New(ret);
+    return Integer::New(sem_wait(mutex));
 }
 
 static JSVAL sem_Post (JSARGS args) {
-    return Integer::New(sem_post(&mutex));
+    return Integer::New(sem_post(mutex));
 }
 
 void init_sem_object () {
@@ -0,0 +1,127 @@
+/**
+ * @module builtin/session
+ *
+ * ### Synopsis
+ * SilkJS builtin session ID and cookie signing functions.
+ *
+ * ### Description
+ * Session IDs are random bytes from the OpenSSL CSPRNG; cookies are signed with HMAC-SHA256.  All strings are URL safe base64, so they need no escaping in a cookie.
+ *
+ * See the Session module for the session store used by the HTTP server.
+ *
+ * ### Usage
+ * var session = require('builtin/session');
+ */
+#include "SilkJS.h"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+
+static string base64url (const unsigned char *bytes, unsigned long len) {
+    string s = Base64Encode(bytes, len);
+    string::size_type end = s.find('=');
+    if (end != string::npos) {
+        s.erase(end);
+    }
+    for (string::size_type i = 0; i < s.size(); i++) {
+        if (s[i] == '+') {
+            s[i] = '-';
+        }
+        else if (s[i] == '/') {
+            s[i] = '_';
+        }
+    }
+    return s;
+}
+
+static string signature (Handle<Value>secret, const char *value, size_t len) {
+    String::Utf8Value key(secret);
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int mdLen = 0;
+    HMAC(EVP_sha256(), *key, key.length(), (const unsigned char *) value, len, md, &mdLen);
+    return base64url(md, mdLen);
+}
+
+/**
+ * @function session.id
+ *
+ * ### Synopsis
+ *
+ * var id = session.id();
+ * var id = session.id(bytes);
+ *
+ * Generate a random session ID.
+ *
+ * @param {int} bytes - number of random bytes (default 16, 128 bits).
+ * @returns {string} id - the bytes, URL safe base64 encoded.
+ */
+static JSVAL session_id (JSARGS args) {
+    int len = args.Length() > 0 ? args[0]->IntegerValue() : 16;
+    if (len <= 0 || len > 256) {
+        return ThrowException(String::New("session.id: bytes must be between 1 and 256"));
+    }
+    unsigned char bytes[256];
+    if (RAND_bytes(bytes, len) != 1) {
+        return ThrowException(String::New("session.id: RAND_bytes failed"));
+    }
+    return String::New(base64url(bytes, len).c_str());
+}
+
+/**
+ * @function session.sign
+ *
+ * ### Synopsis
+ *
+ * var signed = session.sign(secret, value);
+ *
+ * Sign a value, e.g. a session ID, for use as a cookie.
+ *
+ * @param {string} secret - the server's secret key.
+ * @param {string} value - the value to sign; it must not contain '.'.
+ * @returns {string} signed - value + '.' + HMAC-SHA256 signature.
+ */
+static JSVAL session_sign (JSARGS args) {
+    String::Utf8Value value(args[1]);
+    string out(*value, value.length());
+    out += '.';
+    out += signature(args[0], *value, value.length());
+    return String::New(out.c_str(), out.size());
+}
+
+/**
+ * @function session.verify
+ *
+ * ### Synopsis
+ *
+ * var value = session.verify(secret, signed);
+ *
+ * Check the signature of a value signed by session.sign().  The comparison takes constant time.
+ *
+ * @param {string} secret - the server's secret key.
+ * @param {string} signed - the signed value, e.g. from a cookie.
+ * @returns {string} value - the value, or null if the signature is missing or wrong.
+ */
+static JSVAL session_verify (JSARGS args) {
+    String::Utf8Value s(args[1]);
+    const char *dot = strrchr(*s, '.');
+    if (!dot) {
+        return Null();
+    }
+    size_t len = dot - *s;
+    string expected = signature(args[0], *s, len);
+    const char *sig = dot + 1;
+    if (strlen(sig) != expected.size() || CRYPTO_memcmp(sig, expected.c_str(), expected.size())) {
+        return Null();
+    }
+    return String::New(*s, len);
+}
+
+void init_session_object () {
+    Handle<ObjectTemplate>session = ObjectTemplate::New();
+    session->Set(String::New("id"), FunctionTemplate::New(session_id));
+    session->Set(String::New("sign"), FunctionTemplate::New(session_sign));
+    session->Set(String::New("verify"), FunctionTemplate::New(session_verify));
+
+    builtinObject->Set(String::New("session"), session);
+}
@@ -0,0 +1,514 @@
+/**
+ * @module builtin/shm
+ *
+ * ### Synopsis
+ * SilkJS builtin shared memory counters and rate limiters.
+ *
+ * ### Description
+ *
+ * A segment is a named block of POSIX shared memory holding a fixed size table of slots, each identified by a string key (up to 63 bytes).  Any process may open a segment by name, so the HttpChild processes can share counters without a round trip to memcached, whether the segment was opened before they were forked or not.
+ *
+ * A slot is either an atomic 64-bit integer counter or a token bucket rate limiter.  Counter operations are single atomic instructions; rate limiter checks take a per-slot spin lock for a few instructions.  Neither takes a lock shared by the whole segment.
+ *
+ * Counters are never removed.  A rate limiter whose bucket has filled up again is indistinguishable from one that doesn't exist, so its slot is reused for another key when the table is crowded; per-IP limiters therefore don't fill the segment.
+ *
+ * ### Usage
+ * var shm = require('builtin/shm');
+ *
+ * ### Example
+ *
+ * ```
+ * // in HttpChild.requestHandler: at most 10 requests per second per IP, bursts of up to 20
+ * var seg = global.throttle || (global.throttle = shm.open('throttle'));
+ * if (!shm.rateLimit(seg, req.remote_addr, 10, 20)) {
+ *     res.status = 429;
+ *     res.stop();
+ * }
+ * shm.add(seg, 'requests', 1);
+ * ```
+ */
+
+#include "SilkJS.h"
+#include <sys/mman.h>
+#include <sched.h>
+
+#define SHM_MAGIC       0x53484d31
+#define SHM_KEY_SIZE    64
+#define SHM_PROBES      32
+#define SHM_DEFAULT_SLOTS 16384
+#define SHM_OPEN_TIMEOUT 5.0    // seconds to wait for another process to finish creating a segment
+
+enum { SLOT_EMPTY, SLOT_BUSY, SLOT_READY };
+enum { KIND_COUNTER, KIND_LIMITER };
+
+struct SLOT {
+    volatile uint32_t state;
+    volatile uint32_t lock;
+    uint32_t hash;
+    uint32_t kind;
+    volatile int64_t value;     // counter
+    double tokens;              // rate limiter; < 0 for a new bucket
+    double last;
+    double rate;
+    double burst;
+    char key[SHM_KEY_SIZE];
+    char pad[128 - 16 - 8 - 32 - SHM_KEY_SIZE];
+};
+
+struct SEGMENT {
+    volatile uint32_t magic;
+    uint32_t numSlots;
+    char pad[128 - 8];
+    SLOT slots[1];
+};
+
+struct STATE {
+    SEGMENT *seg;
+    size_t size;
+};
+
+static inline STATE* HANDLE (Handle<Value>v) {
+    if (v->IsNull()) {
+        ThrowException(String::New("Handle is NULL"));
+        return NULL;
+    }
+    STATE *state = (STATE *) JSOPAQUE(v);
+    return state;
+}
+
+/*
+ * PRIVATE
+ */
+
+static inline uint32_t hash_key (const char *key) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    while (*key) {
+        h ^= (unsigned char) *key++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static inline double now () {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static inline void lock_slot (SLOT *s) {
+    while (__sync_lock_test_and_set(&s->lock, 1)) {
+        sched_yield();
+    }
+}
+
+static inline void unlock_slot (SLOT *s) {
+    __sync_lock_release(&s->lock);
+}
+
+static inline bool bucket_full (SLOT *s, double t) {
+    return s->tokens < 0 || s->tokens + (t - s->last) * s->rate >= s->burst;
+}
+
+static inline bool slot_matches (SLOT *s, const char *key, uint32_t hash, uint32_t kind) {
+    return s->hash == hash && s->kind == kind && !strcmp(s->key, key);
+}
+
+static void init_slot (SLOT *s, const char *key, uint32_t hash, uint32_t kind) {
+    strcpy(s->key, key);
+    s->hash = hash;
+    s->kind = kind;
+    s->value = 0;
+    s->tokens = -1;
+    s->last = 0;
+}
+
+/**
+ * Find the slot for key, creating it if create is true.  Returns NULL if
+ * the key doesn't exist and create is false, or if the table is full.
+ */
+static SLOT *find_slot (SEGMENT *seg, const char *key, uint32_t kind, bool create) {
+    uint32_t hash = hash_key(key);
+    for (int i = 0; i < SHM_PROBES; i++) {
+        SLOT *s = &seg->slots[(hash + i) % seg->numSlots];
+        if (s->state == SLOT_EMPTY) {
+            if (!create) {
+                return NULL;
+            }
+            if (__sync_bool_compare_and_swap(&s->state, SLOT_EMPTY, SLOT_BUSY)) {
+                init_slot(s, key, hash, kind);
+                __sync_synchronize();
+                s->state = SLOT_READY;
+                return s;
+            }
+        }
+        while (s->state == SLOT_BUSY) {
+            sched_yield();
+        }
+        if (slot_matches(s, key, hash, kind)) {
+            return s;
+        }
+    }
+    if (!create || kind != KIND_LIMITER) {
+        return NULL;
+    }
+    // crowded: reuse a rate limiter slot whose bucket is full
+    double t = now();
+    for (int i = 0; i < SHM_PROBES; i++) {
+        SLOT *s = &seg->slots[(hash + i) % seg->numSlots];
+        if (s->kind != KIND_LIMITER) {
+            continue;
+        }
+        lock_slot(s);
+        if (bucket_full(s, t)) {
+            init_slot(s, key, hash, kind);
+            unlock_slot(s);
+            return s;
+        }
+        unlock_slot(s);
+    }
+    return NULL;
+}
+
+static SLOT *counter (JSARGS args, bool create) {
+    STATE *state = HANDLE(args[0]);
+    String::Utf8Value key(args[1]);
+    if (key.length() >= SHM_KEY_SIZE) {
+        ThrowException(String::New("shm: key is too long"));
+        return NULL;
+    }
+    SLOT *s = find_slot(state->seg, *key, KIND_COUNTER, create);
+    if (!s && create) {
+        ThrowException(String::New("shm: segment is full"));
+    }
+    return s;
+}
+
+/**
+ * @function shm.open
+ *
+ * ### Synopsis
+ *
+ * var seg = shm.open(name);
+ * var seg = shm.open(name, slots);
+ * var seg = shm.open(name, slots, mode);
+ *
+ * Open a named shared memory segment, creating it if it doesn't exist.
+ *
+ * By default the segment is only accessible to the user SilkJS runs as.  Pass a mode such as 0660 to share it with other users; anyone who can write to it can reset counters and rate limiters.
+ *
+ * @param {string} name - name of the segment.
+ * @param {int} slots - number of counters and rate limiters the segment can hold, if it is created (default 16384).
+ * @param {int} mode - permissions of the segment, if it is created (default 0600).
+ * @returns {object} seg - handle to the segment.
+ */
+static JSVAL shm_open_segment (JSARGS args) {
+    String::Utf8Value name(args[0]);
+    int64_t numSlots = SHM_DEFAULT_SLOTS;
+    if (args.Length() > 1 && !args[1]->IsUndefined()) {
+        numSlots = args[1]->IntegerValue();
+    }
+    if (numSlots <= 0 || numSlots > (int64_t) (0x7fffffff / sizeof (SLOT))) {
+        return ThrowException(String::New("shm.open: bad number of slots"));
+    }
+    mode_t mode = 0600;
+    if (args.Length() > 2 && !args[2]->IsUndefined()) {
+        mode = args[2]->IntegerValue() & 0777;
+    }
+    char path[PATH_MAX];
+    snprintf(path, sizeof (path), "/silkjs-%s", *name);
+
+    bool created = true;
+    int fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL, mode);
+    if (fd < 0 && errno == EEXIST) {
+        created = false;
+        fd = shm_open(path, O_RDWR, 0);
+    }
+    if (fd < 0) {
+        return ThrowException(String::Concat(String::New("shm.open: "), String::New(strerror(errno))));
+    }
+    size_t size;
+    double deadline = now() + SHM_OPEN_TIMEOUT;
+    if (created) {
+        // shm_open() is subject to the umask
+        fchmod(fd, mode);
+        size = sizeof (SEGMENT) + (numSlots - 1) * sizeof (SLOT);
+        if (ftruncate(fd, size) < 0) {
+            close(fd);
+            shm_unlink(path);
+            return ThrowException(String::Concat(String::New("shm.open: "), String::New(strerror(errno))));
+        }
+    }
+    else {
+        // wait for the creator to size the segment
+        struct stat st;
+        for (;;) {
+            if (fstat(fd, &st) < 0) {
+                close(fd);
+                return ThrowException(String::Concat(String::New("shm.open: "), String::New(strerror(errno))));
+            }
+            if (st.st_size != 0) {
+                break;
+            }
+            if (now() > deadline) {
+                close(fd);
+                return ThrowException(String::New("shm.open: timed out waiting for the segment to be created"));
+            }
+            usleep(1000);
+        }
+        size = st.st_size;
+        if (size < sizeof (SEGMENT)) {
+            close(fd);
+            return ThrowException(String::New("shm.open: not a shm segment"));
+        }
+    }
+    SEGMENT *seg = (SEGMENT *) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (seg == MAP_FAILED) {
+        return ThrowException(String::Concat(String::New("shm.open: "), String::New(strerror(errno))));
+    }
+    if (created) {
+        seg->numSlots = numSlots;
+        __sync_synchronize();
+        seg->magic = SHM_MAGIC;
+    }
+    else {
+        while (seg->magic != SHM_MAGIC) {
+            if (now() > deadline) {
+                munmap(seg, size);
+                return ThrowException(String::New("shm.open: timed out waiting for the segment to be created"));
+            }
+            usleep(1000);
+        }
+        if (sizeof (SEGMENT) + (seg->numSlots - 1) * sizeof (SLOT) > size) {
+            munmap(seg, size);
+            return ThrowException(String::New("shm.open: not a shm segment"));
+        }
+    }
+    STATE *state = new STATE;
+    state->seg = seg;
+    state->size = size;
+    return Opaque::New(state);
+}
+
+/**
+ * @function shm.close
+ *
+ * ### Synopsis
+ *
+ * shm.close(seg);
+ *
+ * Detach from a segment.  The segment and its contents remain until shm.unlink() is called.
+ *
+ * @param {object} seg - handle to the segment.
+ */
+static JSVAL shm_close (JSARGS args) {
+    STATE *state = HANDLE(args[0]);
+    munmap(state->seg, state->size);
+    delete state;
+    return Undefined();
+}
+
+/**
+ * @function shm.unlink
+ *
+ * ### Synopsis
+ *
+ * shm.unlink(name);
+ *
+ * Remove a named segment.  Processes that have it open may continue to use it; the next shm.open() of the name creates a new, empty, segment.
+ *
+ * @param {string} name - name of the segment.
+ */
+static JSVAL shm_unlink_segment (JSARGS args) {
+    String::Utf8Value name(args[0]);
+    char path[PATH_MAX];
+    snprintf(path, sizeof (path), "/silkjs-%s", *name);
+    return Integer::New(shm_unlink(path));
+}
+
+/**
+ * @function shm.get
+ *
+ * ### Synopsis
+ *
+ * var value = shm.get(seg, key);
+ *
+ * Get the value of a counter.
+ *
+ * @param {object} seg - handle to the segment.
+ * @param {string} key - name of the counter.
+ * @returns {int} value - value of the counter; 0 if it doesn't exist.
+ */
+static JSVAL shm_get (JSARGS args) {
+    SLOT *s = counter(args, false);
+    return Number::New(s ? s->value : 0);
+}
+
+/**
+ * @function shm.set
+ *
+ * ### Synopsis
+ *
+ * var old = shm.set(seg, key, value);
+ *
+ * Atomically set the value of a counter.
+ *
+ * @param {object} seg - handle to the segment.
+ * @param {string} key - name of the counter.
+ * @param {int} value - new value.
+ * @returns {int} old - the previous value.
+ */
+static JSVAL shm_set (JSARGS args) {
+    SLOT *s = counter(args, true);
+    if (!s) {
+        return Handle<Value>();
+    }
+    return Number::New(__sync_lock_test_and_set(&s->value, (int64_t) args[2]->NumberValue()));
+}
+
+/**
+ * @function shm.add
+ *
+ * ### Synopsis
+ *
+ * var value = shm.add(seg, key);
+ * var value = shm.add(seg, key, delta);
+ *
+ * Atomically add to a counter, creating it with value 0 if necessary.
+ *
+ * @param {object} seg - handle to the segment.
+ * @param {string} key - name of the counter.
+ * @param {int} delta - amount to add, may be negative (default 1).
+ * @returns {int} value - the new value.
+ */
+static JSVAL shm_add (JSARGS args) {
+    SLOT *s = counter(args, true);
+    if (!s) {
+        return Handle<Value>();
+    }
+    int64_t delta = args.Length() > 2 ? (int64_t) args[2]->NumberValue() : 1;
+    return Number::New(__sync_add_and_fetch(&s->value, delta));
+}
+
+/**
+ * @function shm.cas
+ *
+ * ### Synopsis
+ *
+ * var swapped = shm.cas(seg, key, expected, value);
+ *
+ * Atomically set a counter to value if its current value is expected.
+ *
+ * @param {object} seg - handle to the segment.
+ * @param {string} key - name of the counter.
+ * @param {int} expected - value the counter must have.
+ * @param {int} value - new value.
+ * @returns {boolean} swapped - true if the counter had the expected value and was set.
+ */
+static JSVAL shm_cas (JSARGS args) {
+    SLOT *s = counter(args, true);
+    if (!s) {
+        return Handle<Value>();
+    }
+    int64_t expected = (int64_t) args[2]->NumberValue(),
+        value = (int64_t) args[3]->NumberValue();
+    return __sync_bool_compare_and_swap(&s->value, expected, value) ? True() : False();
+}
+
+/**
+ * @function shm.rateLimit
+ *
+ * ### Synopsis
+ *
+ * var allowed = shm.rateLimit(seg, key, rate, burst);
+ * var allowed = shm.rateLimit(seg, key, rate, burst, cost);
+ *
+ * Token bucket rate limiter.  The bucket for key holds up to burst tokens and refills at rate tokens per second; each call takes cost tokens from it, if there are enough.
+ *
+ * @param {object} seg - handle to the segment.
+ * @param {string} key - name of the rate limiter, e.g. a client IP address.
+ * @param {number} rate - tokens added per second.
+ * @param {number} burst - capacity of the bucket.
+ * @param {number} cost - tokens this call takes (default 1).
+ * @returns {boolean} allowed - true if there were enough tokens, false if the caller should be throttled.
+ */
+static JSVAL shm_rate_limit (JSARGS args) {
+    STATE *state = HANDLE(args[0]);
+    String::Utf8Value key(args[1]);
+    double rate = args[2]->NumberValue(),
+        burst = args[3]->NumberValue(),
+        cost = args.Length() > 4 ? args[4]->NumberValue() : 1;
+    if (key.length() >= SHM_KEY_SIZE) {
+        return ThrowException(String::New("shm: key is too long"));
+    }
+    uint32_t hash = hash_key(*key);
+    for (;;) {
+        SLOT *s = find_slot(state->seg, *key, KIND_LIMITER, true);
+        if (!s) {
+            return ThrowException(String::New("shm: segment is full"));
+        }
+        lock_slot(s);
+        if (!slot_matches(s, *key, hash, KIND_LIMITER)) {
+            // the slot was reused for another key between find and lock
+            unlock_slot(s);
+            continue;
+        }
+        double t = now();
+        double tokens = s->tokens < 0 ? burst : s->tokens + (t - s->last) * rate;
+        if (tokens > burst) {
+            tokens = burst;
+        }
+        bool allowed = tokens >= cost;
+        if (allowed) {
+            tokens -= cost;
+        }
+        s->tokens = tokens;
+        s->last = t;
+        s->rate = rate;
+        s->burst = burst;
+        unlock_slot(s);
+        return allowed ? True() : False();
+    }
+}
+
+/**
+ * @function shm.counters
+ *
+ * ### Synopsis
+ *
+ * var counters = shm.counters(seg);
+ *
+ * Get all the counters in a segment, e.g. for a status page.
+ *
+ * @param {object} seg - handle to the segment.
+ * @returns {object} counters - hash of counter values, indexed by key.
+ */
+static JSVAL shm_counters (JSARGS args) {
+    STATE *state = HANDLE(args[0]);
+    SEGMENT *seg = state->seg;
+    JSOBJ o = Object::New();
+    for (uint32_t i = 0; i < seg->numSlots; i++) {
+        SLOT *s = &seg->slots[i];
+        if (s->state == SLOT_READY && s->kind == KIND_COUNTER) {
+            o->Set(String::New(s->key), Number::New(s->value));
+        }
+    }
+    return o;
+}
+
+void init_shm_object () {
+    Handle<ObjectTemplate>shm = ObjectTemplate::New();
+
+    shm->Set(String::New("open"), FunctionTemplate::New(shm_open_segment));
+    shm->Set(String::New("close"), FunctionTemplate::New(shm_close));
+    shm->Set(String::New("unlink"), FunctionTemplate::New(shm_unlink_segment));
+    shm->Set(String::New("get"), FunctionTemplate::New(shm_get));
+    shm->Set(String::New("set"), FunctionTemplate::New(shm_set));
+    shm->Set(String::New("add"), FunctionTemplate::New(shm_add));
+    shm->Set(String::New("cas"), FunctionTemplate::New(shm_cas));
+    shm->Set(String::New("rateLimit"), FunctionTemplate::New(shm_rate_limit));
+    shm->Set(String::New("counters"), FunctionTemplate::New(shm_counters));
+
+    builtinObject->Set(String::New("shm"), shm);
+}
@@ -0,0 +1,454 @@
+/**
+ * @module builtin/shmcache
+ *
+ * ### Synopsis
+ * SilkJS builtin shared memory cache object.
+ *
+ * ### Description
+ *
+ * A bounded key/value cache in a block of shared memory, shared by a process and all the children it forks afterwards, e.g. all the HttpChild processes of the HTTP server.  Reading a hot key costs a hash lookup and a memcpy, instead of a round trip to memcached.
+ *
+ * Values may be any JavaScript value that can be stored as JSON; they are stored in the same compact binary encoding the memcached module uses.  Each entry may have a time to live, in seconds.
+ *
+ * When the cache is full, either because the maximum number of entries is reached or because the shared memory block is exhausted, entries are evicted using the CLOCK algorithm (an approximation of LRU): reading an entry marks it as recently used, and the eviction hand passes over marked entries once, clearing the mark, before it evicts them.  Expired entries are evicted whether they are marked or not.
+ *
+ * Lookups take a shared (read) lock, so any number of processes can read at the same time; only storing and removing entries is serialized.
+ *
+ * The cache must be created with shmcache.init() before the processes that share it are forked.
+ *
+ * ### Usage
+ * var shmcache = require('builtin/shmcache');
+ *
+ * ### See Also
+ * builtin/logfile, which uses shared memory the same way.
+ */
+
+#include "SilkJS.h"
+#include <mm.h>
+#include <pthread.h>
+#include <limits.h>
+
+struct ENTRY {
+    ENTRY *next;            // hash chain
+    uint32_t hash;
+    uint32_t slot;
+    time_t expires;         // 0 for never
+    uint32_t keyLength;
+    uint32_t valueLength;
+    volatile unsigned char referenced;
+    char data[1];           // key, then value
+};
+
+struct CACHE {
+    pthread_rwlock_t lock;
+    uint32_t numBuckets;
+    uint32_t numSlots;
+    uint32_t count;
+    uint32_t hand;          // CLOCK hand
+    uint32_t nextFree;      // where to start looking for an empty slot
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+    ENTRY **buckets;
+    ENTRY **slots;
+};
+
+struct STATE {
+    bool alive;
+    char *mm_file;
+    MM *mm;
+    CACHE *cache;
+    size_t capacity;            // bytes free when the cache is empty
+
+    STATE(size_t size, uint32_t maxEntries, const char *name) {
+        this->alive = false;
+        this->cache = NULL;
+        this->capacity = 0;
+        this->mm_file = strdup(name);
+        this->mm = mm_create(size, this->mm_file);
+        if (!this->mm) {
+            return;
+        }
+        CACHE *cache = (CACHE *) mm_calloc(mm, 1, sizeof (CACHE));
+        if (!cache) {
+            return;
+        }
+        uint32_t numBuckets = 16;
+        while (numBuckets < maxEntries) {
+            numBuckets <<= 1;
+        }
+        cache->numBuckets = numBuckets;
+        cache->numSlots = maxEntries;
+        cache->buckets = (ENTRY **) mm_calloc(mm, numBuckets, sizeof (ENTRY *));
+        cache->slots = (ENTRY **) mm_calloc(mm, maxEntries, sizeof (ENTRY *));
+        if (!cache->buckets || !cache->slots) {
+            return;
+        }
+        pthread_rwlockattr_t attr;
+        pthread_rwlockattr_init(&attr);
+        pthread_rwlockattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_rwlock_init(&cache->lock, &attr);
+        pthread_rwlockattr_destroy(&attr);
+        this->cache = cache;
+        this->capacity = mm_available(mm);
+        this->alive = true;
+    }
+
+    ~STATE() {
+        if (this->cache) {
+            pthread_rwlock_destroy(&this->cache->lock);
+        }
+        if (this->mm) {
+            mm_destroy(this->mm);
+        }
+        free(this->mm_file);
+    }
+};
+
+static inline STATE* HANDLE (Handle<Value>v) {
+    if (v->IsNull()) {
+        ThrowException(String::New("Handle is NULL"));
+        return NULL;
+    }
+    STATE *state = (STATE *) JSOPAQUE(v);
+    return state;
+}
+
+/*
+ * PRIVATE
+ */
+
+static inline uint32_t hash_key (const char *key, uint32_t len) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    while (len--) {
+        h ^= (unsigned char) *key++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static ENTRY *find_entry (CACHE *cache, const char *key, uint32_t len, uint32_t hash) {
+    for (ENTRY *e = cache->buckets[hash & (cache->numBuckets - 1)]; e; e = e->next) {
+        if (e->hash == hash && e->keyLength == len && !memcmp(e->data, key, len)) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void remove_entry (STATE *state, ENTRY *e) {
+    CACHE *cache = state->cache;
+    ENTRY **pe = &cache->buckets[e->hash & (cache->numBuckets - 1)];
+    while (*pe != e) {
+        pe = &(*pe)->next;
+    }
+    *pe = e->next;
+    cache->slots[e->slot] = NULL;
+    if (e->slot < cache->nextFree) {
+        cache->nextFree = e->slot;
+    }
+    cache->count--;
+    mm_free(state->mm, e);
+}
+
+// advance the CLOCK hand until an entry is evicted; returns false if the cache is empty
+static bool evict_one (STATE *state, time_t now) {
+    CACHE *cache = state->cache;
+    if (!cache->count) {
+        return false;
+    }
+    for (;;) {
+        ENTRY *e = cache->slots[cache->hand];
+        cache->hand = (cache->hand + 1) % cache->numSlots;
+        if (!e) {
+            continue;
+        }
+        if (e->referenced && (!e->expires || e->expires > now)) {
+            e->referenced = 0;
+            continue;
+        }
+        remove_entry(state, e);
+        cache->evictions++;
+        return true;
+    }
+}
+
+static uint32_t free_slot (CACHE *cache) {
+    uint32_t slot = cache->nextFree;
+    while (cache->slots[slot]) {
+        slot = (slot + 1) % cache->numSlots;
+    }
+    cache->nextFree = (slot + 1) % cache->numSlots;
+    return slot;
+}
+
+/**
+ * @function shmcache.init
+ *
+ * ### Synopsis
+ *
+ * var handle = shmcache.init(size);
+ * var handle = shmcache.init(size, maxEntries);
+ * var handle = shmcache.init(size, maxEntries, name);
+ *
+ * Create a shared memory cache.  This must be done before forking the processes that are to share it.
+ *
+ * @param {int} size - size of the shared memory block, in bytes.
+ * @param {int} maxEntries - maximum number of entries (default one per 512 bytes of size).
+ * @param {string} name - optional path used by the shared memory allocator for its files; it must be different for each cache (by default, a name unique to the cache is made up).
+ * @returns {object} handle - handle to the cache.
+ */
+static JSVAL shmcache_init (JSARGS args) {
+    size_t size = args[0]->IntegerValue();
+    uint32_t maxEntries = size / 512;
+    if (args.Length() > 1 && !args[1]->IsUndefined()) {
+        maxEntries = args[1]->IntegerValue();
+    }
+    if (maxEntries < 1) {
+        maxEntries = 1;
+    }
+    // each cache needs its own allocator file and lock
+    static int count = 0;
+    char name[PATH_MAX];
+    if (args.Length() > 2 && !args[2]->IsUndefined()) {
+        String::Utf8Value s(args[2]);
+        snprintf(name, sizeof (name), "%s", *s);
+    }
+    else {
+        snprintf(name, sizeof (name), "/tmp/silkjs-shmcache-%d-%d", getpid(), count++);
+    }
+    STATE *state = new STATE(size, maxEntries, name);
+    if (!state->alive) {
+        char buf[PATH_MAX + 500];
+        sprintf(buf, "Could not initialize shared memory cache (%s): %s", name, strerror(errno));
+        delete state;
+        return ThrowException(String::New(buf));
+    }
+    return Opaque::New(state);
+}
+
+/**
+ * @function shmcache.get
+ *
+ * ### Synopsis
+ *
+ * var value = shmcache.get(handle, key);
+ *
+ * Get a value from the cache.
+ *
+ * @param {object} handle - handle to the cache.
+ * @param {string} key - key of the value.
+ * @returns {mixed} value - the value stored, or undefined if the key is not in the cache or has expired.
+ */
+static JSVAL shmcache_get (JSARGS args) {
+    STATE *state = HANDLE(args[0]);
+    CACHE *cache = state->cache;
+    String::Utf8Value key(args[1]);
+    uint32_t hash = hash_key(*key, key.length());
+    string value;
+    bool found = false;
+
+    pthread_rwlock_rdlock(&cache->lock);
+    ENTRY *e = find_entry(cache, *key, key.length(), hash);
+    if (e && (!e->expires || e->expires > time(NULL))) {
+        e->referenced = 1;
+        value.assign(&e->data[e->keyLength], e->valueLength);
+        found = true;
+    }
+    pthread_rwlock_unlock(&cache->lock);
+
+    if (!found) {
+        __sync_fetch_and_add(&cache->misses, 1);
+        return Undefined();
+    }
+    __sync_fetch_and_add(&cache->hits, 1);
+    return UnpackValue((const unsigned char *) value.data(), value.size());
+}
+
+/**
+ * @function shmcache.set
+ *
+ * ### Synopsis
+ *
+ * var success = shmcache.set(handle, key, value);
+ * var success = shmcache.set(handle, key, value, ttl);
+ *
+ * Store a value in the cache, replacing any value already stored for the key.  Other entries are evicted if necessary to make room.
+ *
+ * @param {object} handle - handle to the cache.
+ * @param {string} key - key of the value.
+ * @param {mixed} value - value to store.
+ * @param {int} ttl - time to live, in seconds; 0 (the default) for no expiration.
+ * @returns {boolean} success - false if the value is too large for the cache.
+ */
+static JSVAL shmcache_set (JSARGS args) {
+    STATE *state = HANDLE(args[0]);
+    CACHE *cache = state->cache;
+    String::Utf8Value key(args[1]);
+    string value;
+    if (!PackValue(value, args[2])) {
+        return Handle<Value>();
+    }
+    time_t now = time(NULL);
+    time_t expires = 0;
+    if (args.Length() > 3 && args[3]->IntegerValue() > 0) {
+        expires = now + args[3]->IntegerValue();
+    }
+    uint32_t hash = hash_key(*key, key.length());
+    size_t size = sizeof (ENTRY) + key.length() + value.size();
+    if (size > state->capacity || size > mm_maxsize()) {
+        // it would never fit; don't evict everything else finding that out
+        return False();
+    }
+
+    pthread_rwlock_wrlock(&cache->lock);
+    ENTRY *e = find_entry(cache, *key, key.length(), hash);
+    if (e) {
+        remove_entry(state, e);
+    }
+    if (cache->count == cache->numSlots) {
+        evict_one(state, now);
+    }
+    while (!(e = (ENTRY *) mm_malloc(state->mm, size))) {
+        if (!evict_one(state, now)) {
+            pthread_rwlock_unlock(&cache->lock);
+            return False();
+        }
+    }
+    e->hash = hash;
+    e->expires = expires;
+    e->keyLength = key.length();
+    e->valueLength = value.size();
+    e->referenced = 0;
+    memcpy(e->data, *key, key.length());
+    memcpy(&e->data[key.length()], value.data(), value.size());
+    e->slot = free_slot(cache);
+    cache->slots[e->slot] = e;
+    ENTRY **bucket = &cache->buckets[hash & (cache->numBuckets - 1)];
+    e->next = *bucket;
+    *bucket = e;
+    cache->count++;
+    pthread_rwlock_unlock(&cache->lock);
+    return True();
+}
+
+/**
+ * @function shmcache.remove
+ *
+ * ### Synopsis
+ *
+ * var removed = shmcache.remove(handle, key);
+ *
+ * Remove a value from the cache.
+ *
+ * @param {object} handle - handle to the cache.
+ * @param {string} key - key of the value.
+ * @returns {boolean} removed - true if the key was in the cache.
+ */
+static JSVAL shmcache_remove (JSARGS args) {
+    STATE *state = HANDLE(args[0]);
+    CACHE *cache = state->cache;
+    String::Utf8Value key(args[1]);
+    uint32_t hash = hash_key(*key, key.length());
+
+    pthread_rwlock_wrlock(&cache->lock);
+    ENTRY *e = find_entry(cache, *key, key.length(), hash);
+    if (e) {
+        remove_entry(state, e);
+    }
+    pthread_rwlock_unlock(&cache->lock);
+    return e ? True() : False();
+}
+
+/**
+ * @function shmcache.clear
+ *
+ * ### Synopsis
+ *
+ * shmcache.clear(handle);
+ *
+ * Remove all the entries from the cache.
+ *
+ * @param {object} handle - handle to the cache.
+ */
+static JSVAL shmcache_clear (JSARGS args) {
+    STATE *state = HANDLE(args[0]);
+    CACHE *cache = state->cache;
+
+    pthread_rwlock_wrlock(&cache->lock);
+    for (uint32_t i = 0; i < cache->numSlots; i++) {
+        if (cache->slots[i]) {
+            remove_entry(state, cache->slots[i]);
+        }
+    }
+    cache->hand = cache->nextFree = 0;
+    pthread_rwlock_unlock(&cache->lock);
+    return Undefined();
+}
+
+/**
+ * @function shmcache.stats
+ *
+ * ### Synopsis
+ *
+ * var stats = shmcache.stats(handle);
+ *
+ * Get statistics about the cache.  The returned object has the following members:
+ *
+ * + entries: number of entries in the cache.
+ * + maxEntries: maximum number of entries.
+ * + hits: number of successful gets.
+ * + misses: number of gets of keys not in the cache, or expired.
+ * + evictions: number of entries evicted to make room for others.
+ * + available: bytes of shared memory available.
+ *
+ * @param {object} handle - handle to the cache.
+ * @returns {object} stats - the statistics.
+ */
+static JSVAL shmcache_stats (JSARGS args) {
+    STATE *state = HANDLE(args[0]);
+    CACHE *cache = state->cache;
+    JSOBJ o = Object::New();
+
+    pthread_rwlock_rdlock(&cache->lock);
+    o->Set(String::New("entries"), Integer::New(cache->count));
+    o->Set(String::New("maxEntries"), Integer::New(cache->numSlots));
+    o->Set(String::New("hits"), Number::New(cache->hits));
+    o->Set(String::New("misses"), Number::New(cache->misses));
+    o->Set(String::New("evictions"), Number::New(cache->evictions));
+    pthread_rwlock_unlock(&cache->lock);
+    o->Set(String::New("available"), Number::New(mm_available(state->mm)));
+    return o;
+}
+
+/**
+ * @function shmcache.destroy
+ *
+ * ### Synopsis
+ *
+ * shmcache.destroy(handle);
+ *
+ * Free the shared memory of the cache.  This should only be called by the process that created the cache, after the others have exited.
+ *
+ * @param {object} handle - handle to the cache.
+ */
+static JSVAL shmcache_destroy (JSARGS args) {
+    STATE *state = HANDLE(args[0]);
+    delete state;
+    return Undefined();
+}
+
+void init_shmcache_object () {
+    Handle<ObjectTemplate>shmcache = ObjectTemplate::New();
+
+    shmcache->Set(String::New("init"), FunctionTemplate::New(shmcache_init));
+    shmcache->Set(String::New("get"), FunctionTemplate::New(shmcache_get));
+    shmcache->Set(String::New("set"), FunctionTemplate::New(shmcache_set));
+    shmcache->Set(String::New("remove"), FunctionTemplate::New(shmcache_remove));
+    shmcache->Set(String::New("clear"), FunctionTemplate::New(shmcache_clear));
+    shmcache->Set(String::New("stats"), FunctionTemplate::New(shmcache_stats));
+    shmcache->Set(String::New("destroy"), FunctionTemplate::New(shmcache_destroy));
+
+    builtinObject->Set(String::New("shmcache"), shmcache);
+}
@@ -1,5 +1,7 @@
 #include "SilkJS.h"
 #include <sqlite3.h>
+#include <math.h>
+#include <vector>
 
 static JSVAL sqlite_open (JSARGS args) {
     String::Utf8Value filename(args[0]->ToString());
@@ -23,13 +25,119 @@ static JSVAL sqlite_open_v2 (JSARGS args) {
     String::Utf8Value filename(args[0]->ToString());
     int flags = args[1]->IntegerValue();
     String::Utf8Value zVfs(args[2]->ToString());
+    bool defaultVfs = args.Length() < 3 || args[2]->IsNull() || args[2]->IsUndefined();
     sqlite3 *db;
-    if (sqlite3_open_v2(*filename, &db, flags, *zVfs)) {
+    if (sqlite3_open_v2(*filename, &db, flags, defaultVfs ? NULL : *zVfs)) {
         return String::New(sqlite3_errmsg(db));
     }
     return Opaque::New(db);
 }
 
+// Busy handler with exponential backoff: sleep 1, 2, 4 ... up to 100ms
+// between retries, giving up once the total exceeds the timeout in ms, which
+// is passed as the handler argument.
+static int busyBackoff (void *arg, int count) {
+    long timeout = (long) (intptr_t) arg;
+    long waited = 0,
+        delay = 1;
+    for (int i = 0; i < count; i++) {
+        waited += delay;
+        delay = delay * 2 > 100 ? 100 : delay * 2;
+    }
+    if (waited >= timeout) {
+        return 0;
+    }
+    // jitter, so processes that collided don't retry in lockstep; the seed
+    // is taken per process, after fork, or every child would draw the same
+    static pid_t seedPid = 0;
+    static unsigned int seed;
+    if (seedPid != getpid()) {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        seedPid = getpid();
+        seed = (unsigned int) seedPid * 2654435761U ^ (unsigned int) tv.tv_usec ^ (unsigned int) tv.tv_sec;
+    }
+    usleep((delay + rand_r(&seed) % (delay / 2 + 1)) * 1000);
+    return 1;
+}
+
+static JSVAL sqlite_busy_timeout (JSARGS args) {
+    sqlite3 *db = (sqlite3 *)JSOPAQUE(args[0]);
+    long ms = args[1]->IntegerValue();
+    return Integer::New(sqlite3_busy_handler(db, busyBackoff, (void *) (intptr_t) ms));
+}
+
+/**
+ * openShared(filename, options)
+ *
+ * Open a database to be shared by several processes, e.g. HttpChild
+ * processes.  Each process must open the database itself, after forking.
+ *
+ * The database is put in WAL mode, so readers don't block the writer, and
+ * SQLITE_BUSY is retried with backoff instead of failing immediately.
+ *
+ * options:
+ *   wal: use WAL journal mode (default true)
+ *   mmapSize: bytes of the database to memory map (default 64MB)
+ *   synchronous: 'OFF', 'NORMAL' (default) or 'FULL'
+ *   busyTimeout: ms to keep retrying a locked database (default 5000)
+ *   cacheSize: page cache size, as for PRAGMA cache_size
+ *
+ * Returns the database handle, or an error message string.
+ */
+static JSVAL sqlite_open_shared (JSARGS args) {
+    String::Utf8Value filename(args[0]->ToString());
+    JSOBJ options = args.Length() > 1 && args[1]->IsObject() ? args[1]->ToObject() : Object::New();
+
+    bool wal = true;
+    long mmapSize = 64 * 1024 * 1024;
+    const char *synchronous = "NORMAL";
+    long busyTimeout = 5000;
+    Handle<Value>v;
+    v = options->Get(String::New("wal"));
+    if (!v->IsUndefined()) {
+        wal = v->BooleanValue();
+    }
+    v = options->Get(String::New("mmapSize"));
+    if (!v->IsUndefined()) {
+        mmapSize = v->IntegerValue();
+    }
+    v = options->Get(String::New("busyTimeout"));
+    if (!v->IsUndefined()) {
+        busyTimeout = v->IntegerValue();
+    }
+    String::Utf8Value sync(options->Get(String::New("synchronous")));
+    if (!strcasecmp(*sync, "OFF")) {
+        synchronous = "OFF";
+    }
+    else if (!strcasecmp(*sync, "FULL")) {
+        synchronous = "FULL";
+    }
+
+    sqlite3 *db;
+    if (sqlite3_open_v2(*filename, &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, NULL)) {
+        Handle<String>msg = String::New(sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return msg;
+    }
+    sqlite3_busy_handler(db, busyBackoff, (void *) (intptr_t) busyTimeout);
+
+    char pragmas[256];
+    snprintf(pragmas, sizeof(pragmas), "PRAGMA journal_mode=%s; PRAGMA synchronous=%s; PRAGMA mmap_size=%ld;",
+             wal ? "WAL" : "DELETE", synchronous, mmapSize);
+    if (sqlite3_exec(db, pragmas, NULL, NULL, NULL) != SQLITE_OK) {
+        Handle<String>msg = String::New(sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return msg;
+    }
+    v = options->Get(String::New("cacheSize"));
+    if (!v->IsUndefined()) {
+        snprintf(pragmas, sizeof(pragmas), "PRAGMA cache_size=%ld;", (long) v->IntegerValue());
+        sqlite3_exec(db, pragmas, NULL, NULL, NULL);
+    }
+    return Opaque::New(db);
+}
+
 static JSVAL sqlite_extended_result_codes (JSARGS args) {
     sqlite3 *db = (sqlite3 *)JSOPAQUE(args[0]);
     int onoff = args[1]->IntegerValue();
@@ -59,9 +167,9 @@ static JSVAL sqlite_errmsg16 (JSARGS args) {
 static JSVAL sqlite_prepare (JSARGS args) {
     sqlite3 *db = (sqlite3 *)JSOPAQUE(args[0]);
     String::Utf8Value zSql(args[1]->ToString());
-    int nByte = args[2]->IntegerValue();
+    int nByte = args.Length() > 2 ? args[2]->IntegerValue() : -1;
     sqlite3_stmt *stmt;
-    if (!sqlite3_prepare(db, *zSql, nByte, &stmt, NULL)) {
+    if (sqlite3_prepare(db, *zSql, nByte, &stmt, NULL) != SQLITE_OK) {
         return String::New(sqlite3_errmsg(db));
     }
     return Opaque::New(stmt);
@@ -70,9 +178,9 @@ static JSVAL sqlite_prepare (JSARGS args) {
 static JSVAL sqlite_prepare_v2 (JSARGS args) {
     sqlite3 *db = (sqlite3 *)JSOPAQUE(args[0]);
     String::Utf8Value zSql(args[1]->ToString());
-    int nByte = args[2]->IntegerValue();
+    int nByte = args.Length() > 2 ? args[2]->IntegerValue() : -1;
     sqlite3_stmt *stmt;
-    if (!sqlite3_prepare_v2(db, *zSql, nByte, &stmt, NULL)) {
+    if (sqlite3_prepare_v2(db, *zSql, nByte, &stmt, NULL) != SQLITE_OK) {
         return String::New(sqlite3_errmsg(db));
     }
     return Opaque::New(stmt);
@@ -81,9 +189,9 @@ static JSVAL sqlite_prepare_v2 (JSARGS args) {
 static JSVAL sqlite_prepare16 (JSARGS args) {
     sqlite3 *db = (sqlite3 *)JSOPAQUE(args[0]);
     String::Utf8Value zSql(args[1]->ToString());
-    int nByte = args[2]->IntegerValue();
+    int nByte = args.Length() > 2 ? args[2]->IntegerValue() : -1;
     sqlite3_stmt *stmt;
-    if (!sqlite3_prepare16(db, *zSql, nByte, &stmt, NULL)) {
+    if (sqlite3_prepare16(db, *zSql, nByte, &stmt, NULL) != SQLITE_OK) {
         return String::New(sqlite3_errmsg(db));
     }
     return Opaque::New(stmt);
@@ -92,9 +200,9 @@ static JSVAL sqlite_prepare16 (JSARGS args) {
 static JSVAL sqlite_prepare16_v2 (JSARGS args) {
     sqlite3 *db = (sqlite3 *)JSOPAQUE(args[0]);
     String::Utf8Value zSql(args[1]->ToString());
-    int nByte = args[2]->IntegerValue();
+    int nByte = args.Length() > 2 ? args[2]->IntegerValue() : -1;
     sqlite3_stmt *stmt;
-    if (!sqlite3_prepare16_v2(db, *zSql, nByte, &stmt, NULL)) {
+    if (sqlite3_prepare16_v2(db, *zSql, nByte, &stmt, NULL) != SQLITE_OK) {
         return String::New(sqlite3_errmsg(db));
     }
     return Opaque::New(stmt);
@@ -199,12 +307,275 @@ static JSVAL sqlite_column_value (JSARGS args) {
     return Opaque::New(sqlite3_column_value(stmt, iCol));
 }
 
+static JSVAL sqlite_column_name (JSARGS args) {
+    sqlite3_stmt *stmt = (sqlite3_stmt *)JSOPAQUE(args[0]);
+    int iCol = args[1]->IntegerValue();
+    return String::New(sqlite3_column_name(stmt, iCol));
+}
+
+static JSVAL sqlite_changes (JSARGS args) {
+    sqlite3 *db = (sqlite3 *)JSOPAQUE(args[0]);
+    return Integer::New(sqlite3_changes(db));
+}
+
+static JSVAL sqlite_last_insert_rowid (JSARGS args) {
+    sqlite3 *db = (sqlite3 *)JSOPAQUE(args[0]);
+    return Number::New(sqlite3_last_insert_rowid(db));
+}
+
+// execute one or more statements that return no rows
+static JSVAL sqlite_exec (JSARGS args) {
+    sqlite3 *db = (sqlite3 *)JSOPAQUE(args[0]);
+    String::Utf8Value sql(args[1]->ToString());
+    return Integer::New(sqlite3_exec(db, *sql, NULL, NULL, NULL));
+}
+
+// parameter binding.  Parameter indexes start at 1.
+
+static JSVAL sqlite_bind_parameter_count (JSARGS args) {
+    sqlite3_stmt *stmt = (sqlite3_stmt *)JSOPAQUE(args[0]);
+    return Integer::New(sqlite3_bind_parameter_count(stmt));
+}
+
+static JSVAL sqlite_bind_parameter_index (JSARGS args) {
+    sqlite3_stmt *stmt = (sqlite3_stmt *)JSOPAQUE(args[0]);
+    String::Utf8Value name(args[1]->ToString());
+    return Integer::New(sqlite3_bind_parameter_index(stmt, *name));
+}
+
+static JSVAL sqlite_bind_null (JSARGS args) {
+    sqlite3_stmt *stmt = (sqlite3_stmt *)JSOPAQUE(args[0]);
+    return Integer::New(sqlite3_bind_null(stmt, args[1]->IntegerValue()));
+}
+
+static JSVAL sqlite_bind_int (JSARGS args) {
+    sqlite3_stmt *stmt = (sqlite3_stmt *)JSOPAQUE(args[0]);
+    return Integer::New(sqlite3_bind_int(stmt, args[1]->IntegerValue(), args[2]->Int32Value()));
+}
+
+static JSVAL sqlite_bind_int64 (JSARGS args) {
+    sqlite3_stmt *stmt = (sqlite3_stmt *)JSOPAQUE(args[0]);
+    return Integer::New(sqlite3_bind_int64(stmt, args[1]->IntegerValue(), args[2]->IntegerValue()));
+}
+
+static JSVAL sqlite_bind_double (JSARGS args) {
+    sqlite3_stmt *stmt = (sqlite3_stmt *)JSOPAQUE(args[0]);
+    return Integer::New(sqlite3_bind_double(stmt, args[1]->IntegerValue(), args[2]->NumberValue()));
+}
+
+static JSVAL sqlite_bind_text (JSARGS args) {
+    sqlite3_stmt *stmt = (sqlite3_stmt *)JSOPAQUE(args[0]);
+    String::Utf8Value text(args[2]->ToString());
+    return Integer::New(sqlite3_bind_text(stmt, args[1]->IntegerValue(), *text, text.length(), SQLITE_TRANSIENT));
+}
+
+// bind the contents of a builtin/buffer as a blob
+static JSVAL sqlite_bind_blob (JSARGS args) {
+    sqlite3_stmt *stmt = (sqlite3_stmt *)JSOPAQUE(args[0]);
+    Buffer *buf = (Buffer *)JSOPAQUE(args[2]);
+    return Integer::New(sqlite3_bind_blob(stmt, args[1]->IntegerValue(), buf->data(), buf->length(), SQLITE_TRANSIENT));
+}
+
+// bind a base64 encoded string as a blob
+static JSVAL sqlite_bind_blob64 (JSARGS args) {
+    sqlite3_stmt *stmt = (sqlite3_stmt *)JSOPAQUE(args[0]);
+    String::Utf8Value data(args[2]->ToString());
+    string blob = Base64Decode(*data);
+    return Integer::New(sqlite3_bind_blob(stmt, args[1]->IntegerValue(), blob.data(), blob.size(), SQLITE_TRANSIENT));
+}
+
+static JSVAL sqlite_clear_bindings (JSARGS args) {
+    sqlite3_stmt *stmt = (sqlite3_stmt *)JSOPAQUE(args[0]);
+    return Integer::New(sqlite3_clear_bindings(stmt));
+}
+
+// Bind a JavaScript value by type: null/undefined as NULL, booleans and
+// integral numbers as INTEGER, other numbers as FLOAT, builtin/buffer handles
+// as BLOB and anything else as TEXT.
+static int bindValue (sqlite3_stmt *stmt, int ndx, Handle<Value> v) {
+    if (v->IsNull() || v->IsUndefined()) {
+        return sqlite3_bind_null(stmt, ndx);
+    }
+    if (v->IsBoolean()) {
+        return sqlite3_bind_int(stmt, ndx, v->BooleanValue() ? 1 : 0);
+    }
+    if (v->IsInt32()) {
+        return sqlite3_bind_int(stmt, ndx, v->Int32Value());
+    }
+    if (v->IsNumber()) {
+        double d = v->NumberValue();
+        // the cast is only defined for finite values in range
+        if (d >= -9.2e18 && d <= 9.2e18 && d == floor(d)) {
+            return sqlite3_bind_int64(stmt, ndx, (sqlite3_int64)d);
+        }
+        return sqlite3_bind_double(stmt, ndx, d);
+    }
+    if (Opaque::Is(v, bufferType)) {
+        Buffer *buf = (Buffer *)JSOPAQUE(v);
+        if (!buf) {
+            return sqlite3_bind_null(stmt, ndx);
+        }
+        return sqlite3_bind_blob(stmt, ndx, buf->data(), buf->length(), SQLITE_TRANSIENT);
+    }
+    String::Utf8Value text(v->ToString());
+    return sqlite3_bind_text(stmt, ndx, *text, text.length(), SQLITE_TRANSIENT);
+}
+
+/**
+ * bind(stmt, params)
+ *
+ * Bind parameters by type (see bindValue()).  params is an array of values
+ * for positional parameters, or an object whose keys name parameters, with or
+ * without the :, @ or $ prefix.  Returns SQLITE_OK or the first error.
+ */
+static JSVAL sqlite_bind (JSARGS args) {
+    sqlite3_stmt *stmt = (sqlite3_stmt *)JSOPAQUE(args[0]);
+    if (args[1]->IsArray()) {
+        Handle<Array>params = Handle<Array>::Cast(args[1]);
+        int count = params->Length();
+        for (int i = 0; i < count; i++) {
+            int rc = bindValue(stmt, i + 1, params->Get(i));
+            if (rc != SQLITE_OK) {
+                return Integer::New(rc);
+            }
+        }
+        return Integer::New(SQLITE_OK);
+    }
+    JSOBJ params = args[1]->ToObject();
+    Handle<Array>keys = params->GetOwnPropertyNames();
+    int count = keys->Length();
+    for (int i = 0; i < count; i++) {
+        Local<Value>key = keys->Get(i);
+        String::Utf8Value name(key);
+        int ndx = 0;
+        if ((*name)[0] == ':' || (*name)[0] == '@' || (*name)[0] == '$') {
+            ndx = sqlite3_bind_parameter_index(stmt, *name);
+        }
+        else {
+            string prefixed = string(":") + *name;
+            const char *prefixes = ":@$";
+            for (int p = 0; !ndx && p < 3; p++) {
+                prefixed[0] = prefixes[p];
+                ndx = sqlite3_bind_parameter_index(stmt, prefixed.c_str());
+            }
+        }
+        if (!ndx) {
+            continue;
+        }
+        int rc = bindValue(stmt, ndx, params->Get(key));
+        if (rc != SQLITE_OK) {
+            return Integer::New(rc);
+        }
+    }
+    return Integer::New(SQLITE_OK);
+}
+
+// Build an object from the current row.  BLOB columns are base64 encoded.
+static JSOBJ MakeRow (sqlite3_stmt *stmt, int count, const vector<Local<String> >&names) {
+    JSOBJ o = Object::New();
+    for (int i = 0; i < count; i++) {
+        switch (sqlite3_column_type(stmt, i)) {
+            case SQLITE_INTEGER:
+                o->Set(names[i], Number::New(sqlite3_column_int64(stmt, i)));
+                break;
+            case SQLITE_FLOAT:
+                o->Set(names[i], Number::New(sqlite3_column_double(stmt, i)));
+                break;
+            case SQLITE_BLOB:
+                o->Set(names[i], String::New(Base64Encode((unsigned char const *) sqlite3_column_blob(stmt, i), sqlite3_column_bytes(stmt, i)).c_str()));
+                break;
+            case SQLITE_NULL:
+                o->Set(names[i], Null());
+                break;
+            default:
+                o->Set(names[i], String::New((const char *) sqlite3_column_text(stmt, i), sqlite3_column_bytes(stmt, i)));
+                break;
+        }
+    }
+    return o;
+}
+
+// Reset the statement (keeping its bindings) and throw the error that ended a step loop.
+static JSVAL stepError (sqlite3_stmt *stmt) {
+    Handle<String>msg = String::New(sqlite3_errmsg(sqlite3_db_handle(stmt)));
+    sqlite3_reset(stmt);
+    return ThrowException(Exception::Error(msg));
+}
+
+/**
+ * all(stmt)
+ *
+ * Step a prepared statement to completion and return an array of row
+ * objects keyed by column name.  The statement is reset afterwards, with its
+ * bindings intact, so it can be executed again.
+ */
+static JSVAL sqlite_all (JSARGS args) {
+    sqlite3_stmt *stmt = (sqlite3_stmt *)JSOPAQUE(args[0]);
+    int count = sqlite3_column_count(stmt);
+    vector<Local<String> >names(count);
+    for (int i = 0; i < count; i++) {
+        names[i] = String::New(sqlite3_column_name(stmt, i));
+    }
+    Handle<Array>a = Array::New();
+    int rowNdx = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        a->Set(rowNdx++, MakeRow(stmt, count, names));
+    }
+    if (rc != SQLITE_DONE) {
+        return stepError(stmt);
+    }
+    sqlite3_reset(stmt);
+    return a;
+}
+
+/**
+ * each(stmt, fn)
+ *
+ * Step a prepared statement, calling fn(row) for each row.  Stops early if fn
+ * returns false.  Returns the number of rows passed to fn.  The statement is
+ * reset afterwards, with its bindings intact.
+ */
+static JSVAL sqlite_each (JSARGS args) {
+    sqlite3_stmt *stmt = (sqlite3_stmt *)JSOPAQUE(args[0]);
+    Handle<Function>fn = Handle<Function>::Cast(args[1]);
+    int count = sqlite3_column_count(stmt);
+    vector<Local<String> >names(count);
+    for (int i = 0; i < count; i++) {
+        names[i] = String::New(sqlite3_column_name(stmt, i));
+    }
+    int rows = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        HandleScope scope;
+        Handle<Value>av[1];
+        av[0] = MakeRow(stmt, count, names);
+        rows++;
+        Handle<Value>ret = fn->Call(Context::GetCurrent()->Global(), 1, av);
+        if (ret.IsEmpty()) {
+            // exception thrown by fn
+            sqlite3_reset(stmt);
+            return ret;
+        }
+        if (ret->IsFalse()) {
+            rc = SQLITE_DONE;
+            break;
+        }
+    }
+    if (rc != SQLITE_DONE) {
+        return stepError(stmt);
+    }
+    sqlite3_reset(stmt);
+    return Integer::New(rows);
+}
+
 void init_sqlite3_object () {
     JSOBJT o = ObjectTemplate::New();
 
     // open flags
     o->Set(String::New("OPEN_READONLY"), Integer::New(SQLITE_OPEN_READONLY));
     o->Set(String::New("OPEN_READWRITENLY"), Integer::New(SQLITE_OPEN_READWRITE));
+    o->Set(String::New("OPEN_READWRITE"), Integer::New(SQLITE_OPEN_READWRITE));
     o->Set(String::New("OPEN_CREATE"), Integer::New(SQLITE_OPEN_CREATE));
     o->Set(String::New("SQLITE_OPEN_DELETEONCLOSE"), Integer::New(SQLITE_OPEN_DELETEONCLOSE));
     o->Set(String::New("SQLITE_OPEN_EXCLUSIVE"), Integer::New(SQLITE_OPEN_EXCLUSIVE));
@@ -327,6 +698,8 @@ void init_sqlite3_object () {
     o->Set(String::New("open"), FunctionTemplate::New(sqlite_open));
     o->Set(String::New("open16"), FunctionTemplate::New(sqlite_open16));
     o->Set(String::New("open_v2"), FunctionTemplate::New(sqlite_open_v2));
+    o->Set(String::New("openShared"), FunctionTemplate::New(sqlite_open_shared));
+    o->Set(String::New("busy_timeout"), FunctionTemplate::New(sqlite_busy_timeout));
     o->Set(String::New("extended_result_codes"), FunctionTemplate::New(sqlite_extended_result_codes));
     o->Set(String::New("errcode"), FunctionTemplate::New(sqlite_errcode));
     o->Set(String::New("extended_errcode"), FunctionTemplate::New(sqlite_extended_errcode));
@@ -353,6 +726,23 @@ void init_sqlite3_object () {
     o->Set(String::New("column_text"), FunctionTemplate::New(sqlite_column_text));
     o->Set(String::New("column_text16"), FunctionTemplate::New(sqlite_column_text16));
     o->Set(String::New("column_value"), FunctionTemplate::New(sqlite_column_value));
+    o->Set(String::New("column_name"), FunctionTemplate::New(sqlite_column_name));
+    o->Set(String::New("changes"), FunctionTemplate::New(sqlite_changes));
+    o->Set(String::New("last_insert_rowid"), FunctionTemplate::New(sqlite_last_insert_rowid));
+    o->Set(String::New("exec"), FunctionTemplate::New(sqlite_exec));
+    o->Set(String::New("bind_parameter_count"), FunctionTemplate::New(sqlite_bind_parameter_count));
+    o->Set(String::New("bind_parameter_index"), FunctionTemplate::New(sqlite_bind_parameter_index));
+    o->Set(String::New("bind_null"), FunctionTemplate::New(sqlite_bind_null));
+    o->Set(String::New("bind_int"), FunctionTemplate::New(sqlite_bind_int));
+    o->Set(String::New("bind_int64"), FunctionTemplate::New(sqlite_bind_int64));
+    o->Set(String::New("bind_double"), FunctionTemplate::New(sqlite_bind_double));
+    o->Set(String::New("bind_text"), FunctionTemplate::New(sqlite_bind_text));
+    o->Set(String::New("bind_blob"), FunctionTemplate::New(sqlite_bind_blob));
+    o->Set(String::New("bind_blob64"), FunctionTemplate::New(sqlite_bind_blob64));
+    o->Set(String::New("clear_bindings"), FunctionTemplate::New(sqlite_clear_bindings));
+    o->Set(String::New("bind"), FunctionTemplate::New(sqlite_bind));
+    o->Set(String::New("all"), FunctionTemplate::New(sqlite_all));
+    o->Set(String::New("each"), FunctionTemplate::New(sqlite_each));
 
     builtinObject->Set(String::New("sqlite3"), o);
 }
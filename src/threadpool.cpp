@@ -0,0 +1,122 @@
+/** @ignore */
+/*
+ * A small pool of worker threads for splitting native loops (e.g. the rows
+ * of an image) across CPU cores.  JavaScript only ever runs on the main
+ * thread; ParallelFor() doesn't return until all the work is done, and the
+ * work functions must not touch V8.
+ *
+ * The workers are started the first time they are needed, in each process:
+ * threads don't survive fork(), so a child of the HTTP server that inherits
+ * a started pool starts its own.
+ */
+#include "SilkJS.h"
+#include <pthread.h>
+
+#define MAX_THREADS 8
+
+static pthread_mutex_t lock;
+static pthread_cond_t wake;
+static pthread_cond_t done;
+static pid_t poolPid = 0;
+static int numThreads = 0;
+
+// the current job
+static void (*jobFn)(void *arg, int begin, int end);
+static void *jobArg;
+static int jobSize;
+static int jobChunk;
+static volatile int jobNext;
+static int jobPending;
+static unsigned long jobGeneration = 0;
+
+// claim chunks of the job until there are none left
+static void work () {
+    int n = jobSize,
+        chunk = jobChunk;
+    for (;;) {
+        int begin = __sync_fetch_and_add(&jobNext, chunk);
+        if (begin >= n) {
+            break;
+        }
+        int end = begin + chunk < n ? begin + chunk : n;
+        jobFn(jobArg, begin, end);
+    }
+}
+
+static void *worker (void *unused) {
+    unsigned long generation = 0;
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        while (jobGeneration == generation) {
+            pthread_cond_wait(&wake, &lock);
+        }
+        generation = jobGeneration;
+        pthread_mutex_unlock(&lock);
+        work();
+        pthread_mutex_lock(&lock);
+        if (--jobPending == 0) {
+            pthread_cond_signal(&done);
+        }
+    }
+    return NULL;
+}
+
+static void start () {
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&wake, NULL);
+    pthread_cond_init(&done, NULL);
+    jobGeneration = 0;
+    poolPid = getpid();
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    numThreads = 0;
+    // the calling thread works too
+    for (long i = 1; i < cpus && i < MAX_THREADS; i++) {
+        pthread_t thread;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (pthread_create(&thread, &attr, worker, NULL) == 0) {
+            numThreads++;
+        }
+        pthread_attr_destroy(&attr);
+    }
+}
+
+/*
+ * Call fn(arg, begin, end) for consecutive ranges covering 0 to n, of at
+ * least grain items each, using the pool.
+ */
+void ParallelFor (int n, int grain, void (*fn)(void *arg, int begin, int end), void *arg) {
+    if (n <= 0) {
+        return;
+    }
+    if (poolPid != getpid()) {
+        start();
+    }
+    if (numThreads == 0 || n < grain * 2) {
+        fn(arg, 0, n);
+        return;
+    }
+    int chunk = n / ((numThreads + 1) * 4);
+    if (chunk < grain) {
+        chunk = grain;
+    }
+    pthread_mutex_lock(&lock);
+    jobFn = fn;
+    jobArg = arg;
+    jobSize = n;
+    jobChunk = chunk;
+    jobNext = 0;
+    jobPending = numThreads;
+    jobGeneration++;
+    pthread_cond_broadcast(&wake);
+    pthread_mutex_unlock(&lock);
+
+    work();
+
+    pthread_mutex_lock(&lock);
+    while (jobPending > 0) {
+        pthread_cond_wait(&done, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+}
@@ -125,6 +125,30 @@ static JSVAL freeScript (JSARGS args) {
     return Undefined();
 }
 
+/**
+ * @function v8.handles
+ * 
+ * ### Synopsis
+ * 
+ * var counts = v8.handles();
+ * 
+ * Get counts of the native objects (buffers, streams, images, etc.) handed to JavaScript, by type.  Objects not freed explicitly are freed when their handle is garbage collected, so live counts that keep growing point to a leak of the handles themselves.
+ * 
+ * @return {object} counts - hash indexed by type name (e.g. 'buffer', 'gd.image') of objects with live (not yet freed), created (in total) and bytes (native memory held by the live objects) members.
+ */
+static JSVAL handles (JSARGS args) {
+    HandleScope scope;
+    Handle<Object>counts = Object::New();
+    for (OpaqueType *type = OpaqueType::first; type; type = type->next) {
+        Handle<Object>o = Object::New();
+        o->Set(String::New("live"), Number::New(type->live));
+        o->Set(String::New("created"), Number::New(type->created));
+        o->Set(String::New("bytes"), Number::New(type->bytes));
+        counts->Set(String::New(type->name), o);
+    }
+    return scope.Close(counts);
+}
+
 static void debugger () {
     extern Persistent<Context> context;
     Context::Scope scope(context);
@@ -155,6 +179,7 @@ void init_v8_object () {
     v8->Set(String::New("runScript"), FunctionTemplate::New(runScript));
     v8->Set(String::New("freeScript"), FunctionTemplate::New(freeScript));
     v8->Set(String::New("enableDebugger"), FunctionTemplate::New(enableDebugger));
+    v8->Set(String::New("handles"), FunctionTemplate::New(handles));
 
     builtinObject->Set(String::New("v8"), v8);
 }
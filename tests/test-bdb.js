@@ -0,0 +1,88 @@
+/*
+ * Exercise builtin/bdb through the BDB module: put/get, add/remove, range, each and transactions.
+ */
+
+var BDB = require('BDB'),
+    fs = require('fs'),
+    console = require('console');
+
+function main() {
+    var home = '/tmp/test-bdb';
+    fs.removeDirectory(home);
+    var env = new BDB.Environment(home, { recover: true, noSync: true }),
+        db = env.open('test.db'),
+        i;
+
+    for (i = 0; i < 100; i++) {
+        db.put('key' + (1000 + i), 'value' + i);
+    }
+    console.log(db.get('key1042') === 'value42' && db.get('nokey') === null ? 'get ok' : 'get FAILED');
+
+    var values = db.mget(['key1001', 'nokey', 'key1099']);
+    console.log(values.key1001 === 'value1' && values.key1099 === 'value99' && !('nokey' in values) ? 'mget ok' : 'mget FAILED');
+
+    console.log(!db.add('key1000', 'x') && db.get('key1000') === 'value0' && db.add('extra', 'x') ? 'add ok' : 'add FAILED');
+    console.log(db.remove('extra') && !db.remove('extra') && db.get('extra') === null ? 'remove ok' : 'remove FAILED');
+
+    // start inclusive, end exclusive, in key order
+    var records = db.range('key1010', 'key1020');
+    var ok = records.length === 10;
+    records.each(function(record, n) {
+        ok = ok && record.key === 'key' + (1010 + n) && record.value === 'value' + (10 + n);
+    });
+    console.log(ok ? 'range ok' : 'range FAILED');
+    console.log(db.range('key1090', null, 5).length === 5 && db.range(null, null).length === 100 ? 'range limit ok' : 'range limit FAILED');
+
+    var seen = [];
+    db.each('key1095', function(key, value) {
+        seen.push(key);
+        return key !== 'key1097';
+    });
+    console.log(seen.join(',') === 'key1095,key1096,key1097' ? 'each ok' : 'each FAILED');
+
+    // committed
+    env.transaction(function(txn) {
+        db.put('counter', '1', txn);
+    });
+    console.log(db.get('counter') === '1' ? 'commit ok' : 'commit FAILED');
+
+    // aborted by an exception
+    try {
+        env.transaction(function(txn) {
+            db.put('counter', '2', txn);
+            throw 'oops';
+        });
+    }
+    catch (e) {
+    }
+    console.log(db.get('counter') === '1' ? 'abort ok' : 'abort FAILED');
+
+    // a deadlock victim is aborted and retried; the first attempt's write is undone
+    var calls = 0;
+    var result = env.transaction(function(txn) {
+        calls++;
+        db.put('counter' + calls, 'x', txn);
+        if (calls === 1) {
+            throw new Error('DB_LOCK_DEADLOCK: Locker killed to resolve a deadlock');
+        }
+        return 'done';
+    });
+    console.log(result === 'done' && calls === 2 && db.get('counter1') === null && db.get('counter2') === 'x' ? 'retry ok' : 'retry FAILED');
+
+    // and gives up after the given number of retries
+    calls = 0;
+    try {
+        env.transaction(function(txn) {
+            calls++;
+            throw new Error('DB_LOCK_DEADLOCK: Locker killed to resolve a deadlock');
+        }, 2);
+        console.log('retry limit FAILED');
+    }
+    catch (e) {
+        console.log(calls === 3 ? 'retry limit ok' : 'retry limit FAILED');
+    }
+
+    db.close();
+    env.close();
+    fs.removeDirectory(home);
+}
@@ -0,0 +1,45 @@
+/*
+ * Test that native objects dropped without being destroyed are freed by the garbage collector.
+ */
+
+var buffer = require('builtin/buffer'),
+	gd = require('builtin/gd'),
+	v8 = require('builtin/v8'),
+	console = require('console');
+
+function show(label) {
+	var counts = v8.handles();
+	console.log(label);
+	['buffer', 'gd.image'].each(function(name) {
+		var c = counts[name];
+		console.log('  ' + name + ': live ' + c.live + ', created ' + c.created + ', bytes ' + c.bytes);
+	});
+}
+
+function live() {
+	var counts = v8.handles();
+	return counts['buffer'].live + counts['gd.image'].live;
+}
+
+function main() {
+	var i, buf, im,
+		before = live();
+
+	show('start');
+	for (i = 0; i < 1000; i++) {
+		buf = buffer.create();
+		buffer.write(buf, 'hello, world');
+		im = gd.imageCreateTrueColor(256, 256);
+	}
+	show('after creating 1000 of each, none destroyed');
+	console.log(live() - before >= 2000 - 100 ? 'count ok' : 'count FAILED');
+
+	// explicitly destroyed objects are not finalized again
+	buffer.destroy(buf);
+	gd.imageDestroy(im);
+	buf = im = null;
+	v8.gc();
+	show('after gc (live should be near 0)');
+	// a few may survive if the collector ran during the loop and promoted them
+	console.log(live() - before < 100 ? 'gc ok' : 'gc FAILED');
+}
@@ -0,0 +1,71 @@
+/*
+ * Test encoding images to, and decoding them from, buffers: gd *Buffer functions, cairo PNG streams, and Canvas.toBuffer()/toDataURL().
+ */
+
+require.path.unshift('../modules');
+
+var gd = require('builtin/gd'),
+	cairo = require('builtin/cairo'),
+	buffer = require('builtin/buffer'),
+	console = require('console'),
+	Canvas = require('Canvas').Canvas,
+	Image = require('Canvas').Image;
+
+function main() {
+	var im = gd.imageCreateTrueColor(320, 200),
+		buf = buffer.create(),
+		failures = 0,
+		copy;
+
+	function check(ok, message) {
+		if (!ok) {
+			console.log(message);
+			failures++;
+		}
+	}
+
+	gd.imageFilledRectangle(im, 10, 10, 100, 100, gd.imageColorAllocate(im, 255, 0, 0));
+	['Png', 'Jpeg', 'Gif'].each(function(format) {
+		buffer.reset(buf);
+		var size = gd['image' + format + 'Buffer'](im, buf);
+		check(size > 0 && buffer.size(buf) === size, format + ': wrote ' + size + ' bytes, buffer holds ' + buffer.size(buf));
+		copy = gd['imageCreateFrom' + format + 'Buffer'](buf);
+		if (!copy) {
+			check(false, format + ': decoding failed');
+			return;
+		}
+		check(gd.imageSX(copy) === 320 && gd.imageSY(copy) === 200, format + ': decoded ' + gd.imageSX(copy) + 'x' + gd.imageSY(copy));
+		var pixel = gd.imageGetPixel(copy, 50, 50),
+			red = gd.imageRed(copy, pixel),
+			green = gd.imageGreen(copy, pixel),
+			blue = gd.imageBlue(copy, pixel);
+		// JPEG is lossy, the others must round trip exactly
+		check(format === 'Jpeg' ? red > 240 && green < 16 && blue < 16 : red === 255 && green === 0 && blue === 0,
+			format + ': pixel at 50,50 is ' + red + ',' + green + ',' + blue);
+		gd.imageDestroy(copy);
+	});
+	gd.imageDestroy(im);
+	check(gd.imageCreateFromPngBuffer({}) === null, 'imageCreateFromPngBuffer accepted an object that is not a buffer');
+
+	var canvas = new Canvas(200, 100),
+		ctx = canvas.getContext('2d');
+	ctx.fillStyle = '#00ff00';
+	ctx.fillRect(0, 0, 100, 100);
+	buffer.reset(buf);
+	canvas.toBuffer(buf);
+	check(buffer.size(buf) > 0, 'Canvas.toBuffer wrote nothing');
+	var image = new Image(buf);
+	check(image.width === 200 && image.height === 100, 'Image from buffer is ' + image.width + 'x' + image.height);
+	image.destroy();
+	var url = canvas.toDataURL();
+	check(url.indexOf('data:image/png;base64,') === 0 && url.length > 22, 'Canvas.toDataURL returned ' + url.substr(0, 40));
+	canvas.destroy();
+
+	buffer.reset(buf);
+	buffer.write(buf, 'not a png');
+	var surface = cairo.image_surface_create_from_png_buffer(buf);
+	check(cairo.surface_status(surface) !== cairo.STATUS_SUCCESS, 'invalid PNG decoded without an error');
+	cairo.surface_destroy(surface);
+	buffer.destroy(buf);
+	console.log(failures ? failures + ' failures' : 'all passed');
+}
@@ -0,0 +1,59 @@
+/*
+ * Test pixel access: Canvas getImageData()/putImageData() (premultiplied alpha conversion), cairo.image_surface_get_pixels() and gd.imageRow().
+ */
+
+require.path.unshift('../modules');
+
+var gd = require('builtin/gd'),
+	cairo = require('builtin/cairo'),
+	time = require('builtin/time'),
+	console = require('console'),
+	Canvas = require('Canvas').Canvas;
+
+function main() {
+	var canvas = new Canvas(400, 300),
+		ctx = canvas.getContext('2d'),
+		imageData, data, i, n, start;
+
+	ctx.fillStyle = 'rgba(200, 100, 50, 0.5)';
+	ctx.fillRect(0, 0, 200, 300);
+	imageData = ctx.getImageData(0, 0, 400, 300);
+	data = imageData.data;
+	console.log('getImageData: ' + imageData.width + 'x' + imageData.height + ', ' + data.length + ' bytes, pixel 0: ' + [data[0], data[1], data[2], data[3]].join(','));
+
+	// invert, as a JavaScript loop
+	start = time.gettimeofday();
+	for (i = 0, n = data.length; i < n; i += 4) {
+		data[i] = 255 - data[i];
+		data[i + 1] = 255 - data[i + 1];
+		data[i + 2] = 255 - data[i + 2];
+	}
+	console.log('invert 400x300: ' + ((time.gettimeofday() - start) * 1000).toFixed(2) + ' ms');
+	data[0] = 300;
+	console.log('clamped: ' + data[0]);
+
+	ctx.putImageData(imageData, 0, 0);
+	data = ctx.getImageData(10, 10, 1, 1).data;
+	console.log('after putImageData: ' + [data[0], data[1], data[2], data[3]].join(','));
+	ctx.putImageData(ctx.createImageData(50, 50), 10, 10, 0, 0, 20, 20);
+	data = ctx.getImageData(15, 15, 1, 1).data;
+	console.log('dirty rectangle cleared: ' + [data[0], data[1], data[2], data[3]].join(','));
+	data = ctx.getImageData(-5, -5, 10, 10).data;
+	console.log('outside the canvas: ' + [data[0], data[1], data[2], data[3]].join(','));
+
+	var pixels = cairo.image_surface_get_pixels(canvas.surface);
+	console.log('surface pixels: ' + pixels.width + 'x' + pixels.height + ', stride ' + pixels.stride + ', alpha at 250,250: ' + pixels[250 * pixels.stride + 250 * 4 + 3]);
+	canvas.destroy();
+
+	var im = gd.imageCreateTrueColor(640, 480),
+		row, x, y;
+	start = time.gettimeofday();
+	for (y = 0; y < 480; y++) {
+		row = gd.imageRow(im, y);
+		for (x = 0; x < 640; x++) {
+			row[x] = (x & 0xff) << 16 | (y & 0xff) << 8;
+		}
+	}
+	console.log('gd.imageRow fill 640x480: ' + ((time.gettimeofday() - start) * 1000).toFixed(2) + ' ms, pixel 100,50: ' + gd.imageGetPixel(im, 100, 50).toString(16));
+	gd.imageDestroy(im);
+}
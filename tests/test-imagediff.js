@@ -0,0 +1,63 @@
+/*
+ * Test gd.imageDiff: mismatch count, bounding box, threshold, perceptual (YIQ) comparison and the diff image, against a JavaScript per-pixel loop.
+ */
+
+var gd = require('builtin/gd'),
+	time = require('builtin/time'),
+	console = require('console');
+
+function chart(w, h) {
+	var im = gd.imageCreateTrueColor(w, h),
+		x;
+	gd.imageFilledRectangle(im, 0, 0, w - 1, h - 1, gd.imageColorAllocate(im, 255, 255, 255));
+	for (x = 20; x < w - 20; x += 40) {
+		gd.imageFilledRectangle(im, x, h - (x * 7) % (h - 20) - 10, x + 29, h - 1, gd.imageColorAllocate(im, 40, 90, 200));
+	}
+	return im;
+}
+
+function main() {
+	var w = 1200,
+		h = 800,
+		a = chart(w, h),
+		b = chart(w, h),
+		diff = gd.imageCreateTrueColor(w, h),
+		result, start, x, y, count;
+
+	result = gd.imageDiff(a, b);
+	console.log('same: ' + result.mismatched + ' mismatched of ' + result.total + ', box ' + result.box);
+
+	// a changed bar, and antialiasing-like noise
+	gd.imageFilledRectangle(b, 300, 500, 329, 799, gd.imageColorAllocate(b, 200, 40, 40));
+	gd.imageSetPixel(b, 1000, 20, gd.imageColorAllocate(b, 253, 255, 255));
+
+	result = gd.imageDiff(a, b, { diff: diff });
+	console.log('raw: ' + result.mismatched + ' mismatched, maxDelta ' + result.maxDelta + ', box ' + JSON.stringify(result.box));
+	console.log('diff image pixel in the box: ' + gd.imageGetPixel(diff, 310, 790).toString(16));
+	result = gd.imageDiff(a, b, { threshold: 2 });
+	console.log('threshold 2: ' + result.mismatched + ' mismatched');
+	result = gd.imageDiff(a, b, { perceptual: 0.1 });
+	console.log('perceptual 0.1: ' + result.mismatched + ' mismatched, largest difference ' + result.perceptual.toFixed(3) + ', box ' + JSON.stringify(result.box));
+	console.log('different sizes: ' + gd.imageDiff(a, gd.imageCreateTrueColor(10, 10)));
+
+	start = time.gettimeofday();
+	for (x = 0; x < 10; x++) {
+		gd.imageDiff(a, b);
+	}
+	console.log('gd.imageDiff: ' + ((time.gettimeofday() - start) * 100).toFixed(2) + ' ms');
+
+	start = time.gettimeofday();
+	count = 0;
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			if (gd.imageGetPixel(a, x, y) !== gd.imageGetPixel(b, x, y)) {
+				count++;
+			}
+		}
+	}
+	console.log('JavaScript loop: ' + ((time.gettimeofday() - start) * 1000).toFixed(2) + ' ms, ' + count + ' mismatched');
+
+	gd.imageDestroy(diff);
+	gd.imageDestroy(b);
+	gd.imageDestroy(a);
+}
@@ -0,0 +1,68 @@
+/*
+ * Test builtin/json: stringifyTo() must match JSON.stringify(), and parse() must round trip.
+ */
+
+var json = require('builtin/json'),
+	buffer = require('builtin/buffer'),
+	console = require('console');
+
+function main() {
+	var buf = buffer.create(),
+		values = [
+			null, true, false, 0, -0, 1, -1, 123456789012, 1.5, 1e21, 1e-7, NaN, Infinity,
+			'', 'plain', 'quote " backslash \\ newline \n tab \t nul \u0000 bell \u0007', 'unicode é中😀',
+			[], [ 1, 'two', null, undefined, function() {} ],
+			{}, { a: 1, b: undefined, c: function() {}, d: [ { e: 'f' } ], 'key "quoted"': true },
+			new Date(0), { date: new Date(1000000) }, new Number(3), new String('boxed'), new Boolean(false),
+			{ toJSON: function() { return 'custom'; } }, { omitted: { toJSON: function() { return undefined; } } }
+		],
+		failures = 0;
+
+	values.each(function(value, i) {
+		buffer.reset(buf);
+		json.stringifyTo(buf, value);
+		var expected = JSON.stringify(value),
+			actual = buffer.read(buf);
+		if (actual !== expected) {
+			console.log('stringifyTo ' + i + ': expected ' + expected + ' got ' + actual);
+			failures++;
+		}
+		if (JSON.stringify(json.parse(buf)) !== expected) {
+			console.log('parse ' + i + ': expected ' + expected + ' got ' + JSON.stringify(json.parse(buf)));
+			failures++;
+		}
+	});
+
+	[ '', '{', '[1,]', '{"a" 1}', '"unterminated', '01', '1.', 'nul', '[1] x', '"\\x"' ].each(function(s) {
+		try {
+			json.parse(s);
+			console.log('parse should have failed: ' + s);
+			failures++;
+		}
+		catch (e) {
+		}
+	});
+
+	var cyclic = {};
+	cyclic.self = cyclic;
+	try {
+		json.stringifyTo(buf, cyclic);
+		console.log('stringifyTo should have failed on a cyclic object');
+		failures++;
+	}
+	catch (e) {
+	}
+
+	var big = [];
+	for (var i = 0; i < 100000; i++) {
+		big.push({ id: i, name: 'row ' + i, value: i / 7 });
+	}
+	buffer.reset(buf);
+	json.stringifyTo(buf, big);
+	if (buffer.read(buf) !== JSON.stringify(big)) {
+		console.log('large array mismatch');
+		failures++;
+	}
+	buffer.destroy(buf);
+	console.log(failures ? failures + ' failures' : 'all passed');
+}
@@ -0,0 +1,67 @@
+/*
+ * Test builtin/shm: counters shared with forked children, CAS and the rate limiter.
+ */
+
+var shm = require('builtin/shm'),
+	process = require('builtin/process'),
+	console = require('console');
+
+function main() {
+	var seg = shm.open('test-shm', 1024),
+		children = 4,
+		failures = 0,
+		i;
+
+	function check(ok, message) {
+		if (!ok) {
+			console.log(message);
+			failures++;
+		}
+	}
+
+	for (i = 0; i < children; i++) {
+		if (process.fork() === 0) {
+			// open by name in the child, as an unrelated process would
+			var s = shm.open('test-shm');
+			for (var n = 0; n < 10000; n++) {
+				shm.add(s, 'hits');
+			}
+			process.exit(0);
+		}
+	}
+	for (i = 0; i < children; i++) {
+		process.wait();
+	}
+	var hits = shm.get(seg, 'hits');
+	check(hits === children * 10000, 'hits: ' + hits + ' (expected ' + children * 10000 + ')');
+
+	check(shm.cas(seg, 'hits', 40000, 1) === true, 'cas 40000 -> 1 failed');
+	check(shm.cas(seg, 'hits', 40000, 2) === false, 'cas 40000 -> 2 succeeded');
+	check(shm.set(seg, 'hits', 0) === 1, 'set did not return the old value');
+	check(shm.get(seg, 'hits') === 0, 'set did not store the new value');
+
+	var allowed = 0;
+	for (i = 0; i < 100; i++) {
+		if (shm.rateLimit(seg, '10.0.0.1', 1, 10)) {
+			allowed++;
+		}
+	}
+	check(allowed === 10, 'allowed ' + allowed + ' of 100 (expected 10)');
+	process.sleep(2);
+	check(shm.rateLimit(seg, '10.0.0.1', 1, 10) === true, 'rate limiter did not refill after 2s');
+
+	// limiters with full buckets are recycled, so many keys fit in a small segment
+	try {
+		for (i = 0; i < 5000; i++) {
+			shm.rateLimit(seg, '192.168.' + (i >> 8) + '.' + (i & 255), 1000000, 1);
+		}
+	}
+	catch (e) {
+		check(false, 'rate limiter slots were not recycled after ' + i + ' keys: ' + e);
+	}
+	var counters = shm.counters(seg);
+	check(counters.hits === 0 && Object.keys(counters).length === 1, 'counters: ' + JSON.stringify(counters));
+	shm.close(seg);
+	shm.unlink('test-shm');
+	console.log(failures ? failures + ' failures' : 'all passed');
+}
@@ -0,0 +1,46 @@
+/*
+ * Test builtin/shmcache: values shared with a forked child, TTL and eviction.
+ */
+
+var shmcache = require('builtin/shmcache'),
+	process = require('builtin/process'),
+	console = require('console');
+
+function main() {
+	var cache = shmcache.init(1024 * 1024, 100),
+		value = { a: 'string', b: 10, c: [ 1, 2.5, null ], d: new Date(0), e: true },
+		failures = 0,
+		pid;
+
+	function check(ok, message) {
+		if (!ok) {
+			console.log(message);
+			failures++;
+		}
+	}
+
+	shmcache.set(cache, 'obj', value);
+	pid = process.fork();
+	if (pid === 0) {
+		shmcache.set(cache, 'child', 'set by child ' + process.getpid());
+		process.exit(0);
+	}
+	process.wait();
+	var obj = shmcache.get(cache, 'obj');
+	check(JSON.stringify(obj) === JSON.stringify(value) && obj.d instanceof Date, 'obj: ' + JSON.stringify(obj));
+	check(shmcache.get(cache, 'child') === 'set by child ' + pid, 'child: ' + shmcache.get(cache, 'child'));
+
+	shmcache.set(cache, 'short', 'expires', 1);
+	check(shmcache.get(cache, 'short') === 'expires', 'short: not stored');
+	process.sleep(2);
+	check(shmcache.get(cache, 'short') === undefined, 'short: not expired');
+
+	for (var i = 0; i < 500; i++) {
+		shmcache.set(cache, 'key' + i, i);
+	}
+	var stats = shmcache.stats(cache);
+	check(shmcache.get(cache, 'key499') === 499, 'key499: ' + shmcache.get(cache, 'key499'));
+	check(stats.entries <= 100 && stats.evictions >= 400, 'stats: ' + JSON.stringify(stats));
+	shmcache.destroy(cache);
+	console.log(failures ? failures + ' failures' : 'all passed');
+}
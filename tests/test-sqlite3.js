@@ -0,0 +1,46 @@
+/*
+ * Exercise builtin/sqlite3 parameter binding and the SQLite module.
+ */
+
+var SQLite = require('SQLite').SQLite,
+    buffer = require('builtin/buffer'),
+    fs = require('builtin/fs'),
+    console = require('console');
+
+function main() {
+    var path = '/tmp/test-sqlite3.db';
+    if (fs.exists(path)) {
+        fs.unlink(path);
+    }
+    var db = new SQLite(path);
+    db.exec('CREATE TABLE kv (k TEXT PRIMARY KEY, n INTEGER, f REAL, b BLOB)');
+
+    var blob = buffer.create();
+    buffer.write(blob, 'hello');
+    for (var i = 0; i < 100; i++) {
+        db.run('INSERT INTO kv VALUES (?, ?, ?, ?)', [ 'key' + i, i, i / 2, blob ]);
+    }
+    buffer.destroy(blob);
+
+    var rows = db.all('SELECT * FROM kv WHERE n < :n ORDER BY n', { n: 10 });
+    console.log(rows.length === 10 ? 'all ok' : 'all FAILED');
+    console.dir(rows[3]);
+    // blobs come back base64 encoded
+    console.log(rows[3].b === 'aGVsbG8=' ? 'blob ok' : 'blob FAILED');
+
+    var row = db.get('SELECT * FROM kv WHERE k=$k', { k: 'key42' });
+    console.log(row.n === 42 && row.f === 21 ? 'get ok' : 'get FAILED');
+
+    var count = db.each('SELECT n FROM kv', [], function(row) {
+        return row.n < 49;
+    });
+    console.log(count === 50 ? 'each ok' : 'each FAILED');
+
+    var info = db.run('DELETE FROM kv WHERE n >= ?', [ 90 ]);
+    console.log(info.changes === 10 ? 'run ok' : 'run FAILED');
+
+    console.log(db.prepare('SELECT * FROM kv WHERE k=?') === db.prepare('SELECT * FROM kv WHERE k=?') ? 'cache ok' : 'cache FAILED');
+
+    db.close();
+    fs.unlink(path);
+}
@@ -0,0 +1,82 @@
+/*
+ * Test builtin/image.thumbnail: DCT scaled JPEG decoding, the fit modes, and output to a file and a buffer.
+ * Test builtin/image.thumbnails: a batch made in parallel, with a failing job.
+ */
+
+var image = require('builtin/image'),
+	gd = require('builtin/gd'),
+	buffer = require('builtin/buffer'),
+	time = require('builtin/time'),
+	console = require('console');
+
+function main() {
+	var src = '/tmp/test-thumbnail.jpg',
+		im = gd.imageCreateTrueColor(4000, 3000),
+		x, info, start;
+
+	for (x = 0; x < 4000; x += 100) {
+		gd.imageFilledRectangle(im, x, 0, x + 49, 2999, gd.imageColorAllocate(im, x % 256, 128, 255 - x % 256));
+	}
+	gd.imageJpeg(im, src, 90);
+	gd.imageDestroy(im);
+
+	// 4000x3000 into 200x200: every fit decodes at 1/8, the most libjpeg can scale
+	var expected = {
+		contain: [200, 150],
+		cover: [200, 200],
+		fill: [200, 200]
+	};
+	['contain', 'cover', 'fill'].each(function(fit) {
+		info = image.thumbnail(src, { width: 200, height: 200, fit: fit, file: '/tmp/test-thumbnail-' + fit + '.jpg' });
+		console.log(fit + ': ' + info.width + 'x' + info.height + ', ' + info.size + ' bytes, decoded at 1/' + info.scale);
+		var ok = info.width === expected[fit][0] && info.height === expected[fit][1] && info.scale === 8 && info.size > 0;
+		console.log(fit + (ok ? ' ok' : ' FAILED'));
+	});
+
+	var buf = buffer.create();
+	info = image.thumbnail(src, { width: 64, format: 'png', buffer: buf });
+	console.log('png to buffer: ' + info.width + 'x' + info.height + ', buffer size ' + buffer.size(buf));
+	console.log(info.width === 64 && info.height === 48 && buffer.size(buf) === info.size ? 'png ok' : 'png FAILED');
+	buffer.destroy(buf);
+
+	start = time.gettimeofday();
+	for (x = 0; x < 10; x++) {
+		image.thumbnail(src, { width: 200, height: 200, file: '/tmp/test-thumbnail.out.jpg' });
+	}
+	console.log('image.thumbnail: ' + ((time.gettimeofday() - start) * 100).toFixed(1) + ' ms');
+
+	var jobs = [];
+	for (x = 0; x < 32; x++) {
+		jobs.push({ src: src, width: 200, height: 200, file: '/tmp/test-thumbnail-batch-' + x + '.jpg' });
+	}
+	start = time.gettimeofday();
+	var results = image.thumbnails(jobs),
+		failed = 0;
+	console.log('image.thumbnails, 32 jobs: ' + ((time.gettimeofday() - start) * 1000 / 32).toFixed(1) + ' ms per thumbnail');
+	results.each(function(result, i) {
+		if (result.error || result.width !== 200 || result.height !== 150) {
+			console.log('job ' + i + ' failed: ' + (result.error || result.width + 'x' + result.height));
+			failed++;
+		}
+	});
+	console.log(failed === 0 ? 'batch ok' : 'batch FAILED');
+	buf = buffer.create();
+	results = image.thumbnails([
+		{ src: '/tmp/test-thumbnail-missing.jpg', width: 200, file: '/tmp/test-thumbnail.out.jpg' },
+		{ src: src, width: 100, buffer: buf }
+	]);
+	console.log('missing file: ' + results[0].error + '; next job: ' + results[1].width + 'x' + results[1].height + ', buffer size ' + buffer.size(buf));
+	console.log(results[0].error && results[1].width === 100 && results[1].height === 75 && buffer.size(buf) === results[1].size ? 'batch error ok' : 'batch error FAILED');
+	buffer.destroy(buf);
+
+	start = time.gettimeofday();
+	for (x = 0; x < 10; x++) {
+		im = gd.imageCreateFromJpeg(src);
+		var thumb = gd.imageCreateTrueColor(200, 150);
+		gd.imageCopyResampled(thumb, im, 0, 0, 0, 0, 200, 150, 4000, 3000);
+		gd.imageJpeg(thumb, '/tmp/test-thumbnail.out.jpg', -1);
+		gd.imageDestroy(thumb);
+		gd.imageDestroy(im);
+	}
+	console.log('gd.imageCopyResampled: ' + ((time.gettimeofday() - start) * 100).toFixed(1) + ' ms');
+}